@@ -62,13 +62,27 @@ Convert:   .asmfunc
 
 
 ; solution
+; D = IRSlope/(n - 1058) is read from IRTable, which holds D*16 every 64 ADC
+; codes starting at IRMax, and interpolated linearly, so no UDIV is needed.
+; The assembler computes the table from IRSlope/IROffset/IRMax.
 	LDR R1, IRMax
 	CMP	R1, R0
 	BGE	TooClose
-	LDR R2, IROffset
-	LDR R3, IRSlope
-	ADD R0, R0, R2	; R0 = n-1058
-	UDIV R0, R3, R0
+	MOVW R2, #16383
+	CMP R0, R2
+	IT HI
+	MOVHI R0, R2		; clamp to the 14-bit range
+	SUB R0, R0, R1		; R0 = n-IRMax
+	LSR R2, R0, #6		; R2 = segment index
+	AND R0, R0, #63		; R0 = position within the segment
+	LDR R3, IRTableAddr
+	ADD R3, R3, R2, LSL #1
+	LDRH R1, [R3]		; R1 = y0 = table[i]
+	LDRH R2, [R3, #2]	; R2 = y1 = table[i+1], y1 <= y0
+	SUB R2, R1, R2		; R2 = y0-y1
+	MUL R2, R2, R0		; R2 = (y0-y1)*frac
+	RSB R0, R2, R1, LSL #6	; R0 = y0*64 - (y0-y1)*frac
+	LSR R0, R0, #10		; remove 6 segment bits and 4 fraction bits
 	BX LR
 TooClose:
 	LDR R0, MaxDist
@@ -80,5 +94,18 @@ IRSlope  .word 1195172
 IROffset .word -1058
 IRMax    .word 2552
 MaxDist	 .word 800
+IRTableAddr .word IRTable
+
+; IRTable[i] = 16*IRSLOPE/(IRMAX + 64*i - IROFFSET), enough entries to reach 16383
+IRSLOPE  .set 1195172
+IROFFSET .set 1058
+IRMAX    .set 2552
+      .align 2
+IRTable:
+      .eval 0, i
+      .loop ((16383-IRMAX)>>6)+2
+      .half (IRSLOPE*16)/(IRMAX+i*64-IROFFSET)
+      .eval i+1, i
+      .endloop
 
     .end
@@ -12,6 +12,10 @@
 
 #include "../inc/Motor.h"
 
+#include "../inc/MotorRamp.h"
+
+#include "../inc/MotorCal.h"
+
 #include "../inc/Nokia5110.h"
 
 #include "../inc/Tachometer.h"
@@ -24,6 +28,8 @@
 
 #include "../inc/UART0.h"
 
+#include "../inc/TelemetryStream.h"
+
 #include "../inc/TimerA1.h"
 
 #include "../inc/Clock.h"           // System clock management
@@ -46,124 +52,29 @@
 
 // =============== Program 16.1 =====================================
 
-int16_t  LeftDistance_mm;   // Distance traveled by the left motor (in mm)
+int32_t  LeftDistance_mm;   // Distance traveled by the left motor (in mm)
 
-int16_t  RightDistance_mm;  // Distance traveled by the right motor (in mm)
-
-#define BUFFER_SIZE 3000    // Size of data buffers for storing measurements
+int32_t  RightDistance_mm;  // Distance traveled by the right motor (in mm)
 
 #define BUMP_DELAY 1000
 
-uint16_t CoordBufferX[BUFFER_SIZE];
-
-uint16_t CoordBufferY[BUFFER_SIZE];
-
-
-static void TxBuffer(void) {
-
-    // wait for release
-
-    while(LaunchPad_SW() || Bump_Read()) {
-
-        Clock_Delay1ms(200); LaunchPad_RGB(RGB_OFF); // off
-
-        Clock_Delay1ms(200); LaunchPad_RGB(RED); // red
-
-    }
-
-    uint8_t isTxEnabled = 0;
-
-    while(1) {
-
-        Nokia5110_Clear();
-
-        Nokia5110_OutString("Tx Buffer?");
-
-        Nokia5110_SetCursor2(2,1);  Nokia5110_OutString("Bump: Y/N");
-
-        Nokia5110_SetCursor2(4,1);  Nokia5110_OutString("SW to Cont.");
-
-        while(!LaunchPad_SW()) {    // until SW is pressed
-
-            // update the screen
-
-            if (isTxEnabled) {      // Display Y/N on LCD
-
-                Nokia5110_SetCursor2(1,12);
-
-                Nokia5110_OutString("Y");
-
-            } else {
-
-                Nokia5110_SetCursor2(1,12);
-
-                Nokia5110_OutString("N");
-
-            }
-
-            if (Bump_Read()) {
-
-                isTxEnabled ^= 1;   // Toggle Y/N
-
-            }
-
-            // flash the blue LED while desired speeds are updated.
-
-            BLUELED ^= 1;
-
-            Clock_Delay1ms(200);
-
-        }
-
-        // SW is pressed
-
-        if(isTxEnabled) {   // Tx Buffer? is Y. Start transmitting data via USB
-
-            UART0_OutString("\n\r***Receiving buffer data***\n\r");
-
-            for (int i = 0; i < BUFFER_SIZE; i++) {
-
-                UART0_OutUDec(i); UART0_OutChar(',');
-
-                UART0_OutSDec(CoordBufferX[i]); UART0_OutChar(',');
-
-                UART0_OutSDec(CoordBufferY[i]); UART0_OutString("\n\r");
+// The coordinates are streamed to the PC while the robot drives,
 
-            }
-
-            Nokia5110_SetCursor2(4,1);
-
-            Nokia5110_OutString("TX is Done   ");
-
-            Nokia5110_SetCursor2(5,1);
-
-            Nokia5110_OutString("SW to Cont.");
-
-            while(!LaunchPad_SW());     // until SW is pressed
-
-            Clock_Delay1ms(500);
-
-        } else {    // Tx Buffer? is N. wrap up the function and exit.
-
-            break;
-
-        }
+// decode them with tools/TelemetryDecode
 
-    }
-
-    for(int k = 0; k < 5; k++){
+static int8_t CoordChannel = -1;
 
-        LaunchPad_RGB(YELLOW);
+// Columns of the coordinate channel, x and y in mm
 
-        Clock_Delay1ms(100);
+static const TelemetryField_t TxFields[3] = {
 
-        LaunchPad_RGB(RGB_OFF);
+    {"x", TELEMETRY_I16},
 
-        Clock_Delay1ms(100);
+    {"y", TELEMETRY_I16},
 
-    }
+    {"heading", TELEMETRY_U8}
 
-}
+};
 
 
 // =============== Program 16.3 =====================================
@@ -219,11 +130,9 @@ static state_t NextState = Forward;     // Next state variable
 
 typedef struct command {
 
-    uint16_t left_permil;     // PWM duty cycle for the left wheel
-
-    uint16_t right_permil;    // PWM duty cycle for the right wheel
+    int16_t left_rpm;         // Signed speed of the left wheel, negative = backward
 
-    void (*MotorFunction)(uint16_t, uint16_t);  // Motor function to call (e.g., Motor_Forward)
+    int16_t right_rpm;        // Signed speed of the right wheel, negative = backward
 
     int32_t dist_mm;          // Wheel displacement in mm
 
@@ -237,19 +146,32 @@ typedef struct command {
 
 #define TR90_DIST       93   // 90 degree turn
 
+#define FRWD_RPM        40   // forward speed, was 380/375 permil
+
+#define SLOW_RPM        10   // backward and turning speed, was 150 permil
+
 #define NUM_STATES      4
 
+// Largest duty cycle change in permil per ms. A step from 380 forward
+
+// to 150 backward made the wheels slip and the distances wrong;
+
+// at 2 permil/ms it takes 265 ms.
+
+#define RAMP_RATE       2
+
+
 // Control commands for each state
 
 command_t ControlCommands[NUM_STATES] = {
 
-    {0,   0,   &Motor_Stop,        0},          // Stop indefinitely
+    {0,          0,         0},          // Stop indefinitely
 
-    {380, 375, &Motor_Forward,     FRWD_DIST},  // Move forward until bump sensor triggered
+    {FRWD_RPM,   FRWD_RPM,  FRWD_DIST},  // Move forward until bump sensor triggered
 
-    {150, 150, &Motor_Backward,    BKWD_DIST},  // Move backward for 90mm
+    {-SLOW_RPM, -SLOW_RPM,  BKWD_DIST},  // Move backward for 90mm
 
-    {150, 150, &Motor_TurnLeft,    TR90_DIST},          // Turn left, 90
+    {-SLOW_RPM,  SLOW_RPM,  TR90_DIST},          // Turn left, 90
 
 };
 
@@ -257,15 +179,17 @@ command_t ControlCommands[NUM_STATES] = {
 
 static void LCDClear3(void) {
 
-    Nokia5110_Clear();                  // Clear the entire display
+    Nokia5110_ClearBuffer();            // Clear the entire display
 
-    Nokia5110_OutString("SECT. 8 BOT"); // Bot name
+    Nokia5110_DrawString(1,1,"SECT. 8 BOT"); // Bot name
 
-    Nokia5110_SetCursor2(3,1); Nokia5110_OutString("X");  // Show current state
+    Nokia5110_DrawString(3,1,"X");      // Show current state
 
-    Nokia5110_SetCursor2(4,1); Nokia5110_OutString("Y");   // Show distance traveled
+    Nokia5110_DrawString(4,1,"Y");      // Show distance traveled
 
-    Nokia5110_SetCursor2(5,1); Nokia5110_OutString("D");
+    Nokia5110_DrawString(5,1,"D");
+
+    Nokia5110_Update();
 
 }
 
@@ -273,17 +197,13 @@ static void LCDClear3(void) {
 
 static void LCDOut3(void) {
 
-    Nokia5110_SetCursor2(3, 3);         //display x-coordinate
-
-    Nokia5110_OutSDec(x, 5);
-
-    Nokia5110_SetCursor2(4, 3);         //display y-coordinate
+    Nokia5110_DrawSDec(3, 3, x, 5);     //display x-coordinate
 
-    Nokia5110_OutSDec(y, 5);
+    Nokia5110_DrawSDec(4, 3, y, 5);     //display y-coordinate
 
-    Nokia5110_SetCursor2(5, 3);         //display orientation (number corresponds to direction, as defined)
+    Nokia5110_DrawSDec(5, 3, head, 1);  //display orientation (number corresponds to direction, as defined)
 
-    Nokia5110_OutSDec(head, 1);
+    Nokia5110_Update();                 //send only what changed
 
 }
 
@@ -323,7 +243,7 @@ static void Coordinates(uint16_t heading, uint32_t distance) {
 
 void Blink(void) {
 
-    if (ControlCommands[CurrentState].left_permil == 0) {
+    if (ControlCommands[CurrentState].left_rpm == 0) {
 
         static uint16_t Time_1ms = 0;
 
@@ -445,13 +365,17 @@ static void Controller3(void) {
 
     // Get the PWM duty cycles for the current state
 
-    uint16_t left_permil = ControlCommands[CurrentState].left_permil;
+    // Both wheels get the same speed, the calibration tables (Program17_4)
 
-    uint16_t right_permil = ControlCommands[CurrentState].right_permil;
+    // turn it into the duty cycle each wheel needs, no hand trimming
 
-    // FSM Output: Execute the motor command for the current state
+    int16_t left_permil = MotorCal_Velocity(MOTOR_LEFT, ControlCommands[CurrentState].left_rpm);
 
-    ControlCommands[CurrentState].MotorFunction(left_permil, right_permil);
+    int16_t right_permil = MotorCal_Velocity(MOTOR_RIGHT, ControlCommands[CurrentState].right_rpm);
+
+    // FSM Output: Ramp toward the motor command for the current state, 0/0 brakes
+
+    MotorRamp_SetTarget(left_permil, right_permil);
 
     // State transition logic based on bump sensors and distance
 
@@ -496,12 +420,16 @@ static void Controller3(void) {
 
             else if (bumpRead & 0x04){
 
+                MotorRamp_Brake();  // hit something, stop now instead of ramping down
+
                 NextState = Backward;
 
             }
 
             else if (bumpRead & 0x08){
 
+                MotorRamp_Brake();
+
                 NextState = Backward;
 
             }
@@ -541,6 +469,10 @@ static void Controller3(void) {
 
     Coordinates(head, dT); //coordinates, heading
 
+    int32_t record[3] = {x, y, head};
+
+    TelemetryStream_Push(CoordChannel, record);  // the main loop sends it
+
     ErrorX = homeX - x;
 
     ErrorY = homeY - y;
@@ -593,6 +525,10 @@ void Program1(void) {
 
     Motor_Init();           // Initialize motor driver
 
+    MotorRamp_Init(RAMP_RATE);  // Limit how fast the duty cycles change
+
+    MotorCal_Init();        // Load the wheel duty-to-speed tables (Program17_4), if any
+
     Nokia5110_Init();       // Initialize Nokia 5110 LCD display
 
     Tachometer_Init();      // Initialize tachometers for wheel distance measurement
@@ -621,10 +557,16 @@ void Program1(void) {
 
     LCDClear3();  // Clear the LCD and display initial state
 
-    uint32_t const baudrate = 115200; // Set UART baud rate for PC communication
+    uint32_t const baudrate = TELEMETRY_BAUD; // 460800, the terminal and TelemetryDecode must match
 
     UART0_Init(baudrate);             // Initialize UART0 communication with set baud rate
 
+    TelemetryStream_Init();           // Stream the coordinates during the run
+
+    CoordChannel = TelemetryStream_AddChannel("Level1", TxFields, 3, 1);
+
+    uint8_t isStreaming = 1;
+
     EnableInterrupts();  // Enable interrupts
 
     // ========== Main Loop ==========
@@ -635,6 +577,10 @@ void Program1(void) {
 
         WaitForInterrupt();
 
+        // Send the coordinates logged so far, without waiting for the UART
+
+        TelemetryStream_Service();
+
         // Update the LCD every 10 Hz
 
         if (NumControllerExecuted == LcdUpdateRate) {
@@ -643,9 +589,11 @@ void Program1(void) {
 
             NumControllerExecuted = 0;  // Reset the execution count
 
-        if (ControlCommands[CurrentState].dist_mm == 0) {
+        if ((ControlCommands[CurrentState].dist_mm == 0) && isStreaming) {
+
+            TelemetryStream_Close();    // home, send the rest and end the stream
 
-            TxBuffer();
+            isStreaming = 0;
 
         }
 
@@ -49,6 +49,7 @@ policies, either expressed or implied, of the FreeBSD Project.
 #include "../inc/CortexM.h"
 #include "../inc/LaunchPad.h"
 #include "../inc/Motor.h"
+#include "../inc/MotorRamp.h"
 #include "../inc/BumpInt.h"
 #include "../inc/TimerA1.h"
 #include "../inc/Nokia5110.h"
@@ -219,12 +220,11 @@ void Program14_2(void) {
 // and TimerA1 for timed control of motor commands.
 
 // Structure defining a command for controlling the robot�셲 motors.
-// Contains motor duty cycles (left and right), the motor function to be called, 
+// Contains signed motor duty cycles (left and right, negative = backward)
 // and the duration for which the command should be executed.
 typedef struct command {
-    uint16_t dutyLeft_permil;   // 0 to 999
-    uint16_t dutyRight_permil;    // 0 to 999
-    void (*MotorFunction)(uint16_t, uint16_t);
+    int16_t dutyLeft_permil;    // -999 to 999, negative = backward
+    int16_t dutyRight_permil;     // -999 to 999, negative = backward
     uint32_t duration_ms;           // time to run in ms
 } command_t;
 
@@ -237,13 +237,17 @@ typedef struct command {
 // 4. Turn left slowly for 1.5 seconds  (30% duty cycle)
 #define NUM_STEPS   4    // update this line -> updated to 4
 const command_t Control[NUM_STEPS]={
-	{200, 200, &Motor_Backward, 2000},       //20%, 20%, backward, 2s
-	{300, 300, &Motor_TurnRight, 1500},     //30%, 30%, right, 1.5s
-	{400, 400, &Motor_Forward, 1000},       //40%, 40%, forward, 1s
-	{300, 300, &Motor_TurnLeft, 1500},      //30%, 30%, left, 1.5s
+	{-200, -200, 2000},     //20%, 20%, backward, 2s
+	{300, -300, 1500},      //30%, 30%, right, 1.5s
+	{400, 400, 1000},       //40%, 40%, forward, 1s
+	{-300, 300, 1500},      //30%, 30%, left, 1.5s
 };
 
-//structure: {dutyLeft_permil, dutyRight_permil, MotorFunction, duration_ms}
+//structure: {dutyLeft_permil, dutyRight_permil, duration_ms}
+
+// Largest duty cycle change in permil per ms, 400 permil takes 0.4 s.
+// Stepping straight from one command to the next makes the wheels slip.
+#define RAMP_RATE   1
 
 
 uint32_t ElapsedTime_ms;
@@ -261,7 +265,7 @@ void Controller3(void) {
     if (ElapsedTime_ms >= Control[CurrentStep].duration_ms) {           //comparing to currentStep
         CurrentStep = (CurrentStep + 1) % (NUM_STEPS);
         ElapsedTime_ms = 0;
-        Control[CurrentStep].MotorFunction(Control[CurrentStep].dutyRight_permil, Control[CurrentStep].dutyLeft_permil);
+        MotorRamp_SetTarget(Control[CurrentStep].dutyLeft_permil, Control[CurrentStep].dutyRight_permil);
     }
 }
 
@@ -273,10 +277,10 @@ void Controller3(void) {
 void Collision3(uint8_t bumpSensor) {
     // Write this as part of Lab 14
     // Note: After collision, the robot must move backward.
-    Motor_Coast();
+    MotorRamp_Brake();      // stop pushing into the obstacle now, no ramp
     CurrentStep = 0;
     ElapsedTime_ms = 0;
-    Control[CurrentStep].MotorFunction(Control[CurrentStep].dutyRight_permil, Control[CurrentStep].dutyLeft_permil);
+    MotorRamp_SetTarget(Control[CurrentStep].dutyLeft_permil, Control[CurrentStep].dutyRight_permil);
 
 }
 
@@ -289,6 +293,7 @@ void Program14_3(void) {
     Clock_Init48MHz();   // 48 MHz clock; 12 MHz Timer A clock
     LaunchPad_Init();
     Motor_Init();
+    MotorRamp_Init(RAMP_RATE);  // commands ramp instead of stepping the duty cycle
 	// write this as part of Lab 14, Integrated Robotic System
 	// Initialize Bump with the Collision() function you wrote
     BumpInt_Init(&Collision3);
@@ -298,7 +303,7 @@ void Program14_3(void) {
 	// Initialize Step to the first command
     CurrentStep = 0;
 	// Run the first command
-    Control[CurrentStep].MotorFunction(Control[CurrentStep].dutyRight_permil, Control[CurrentStep].dutyLeft_permil);
+    MotorRamp_SetTarget(Control[CurrentStep].dutyLeft_permil, Control[CurrentStep].dutyRight_permil);
     // Reset Elapsed Time
     ElapsedTime_ms = 0;
 
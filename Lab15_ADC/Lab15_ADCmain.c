@@ -63,6 +63,8 @@ policies, either expressed or implied, of the FreeBSD Project.
 #include "../inc/LPF.h"
 #include "../inc/Nokia5110.h"
 #include "../inc/Classifier.h"
+#include "../inc/IRCalibration.h"
+#include "../inc/FlashInfo.h"
 
 // Global variables for Lab15
 uint32_t FilteredLeft, FilteredCenter, FilteredRight;
@@ -147,6 +149,8 @@ int Program15_1(void) { // example program 15.1
     Nokia5110_Init();
     LCDClear1();
 
+    IRDistance_Init();                // use the stored calibration if there is one
+
     // Initialize ADC
     uint16_t raw17, raw14, raw16;
     ADC0_InitSWTriggerCh17_14_16();   // initialize channels 17,14,16
@@ -212,6 +216,7 @@ void Program15_2(void){
 // Test classify using all cases
 
 // This exhaustive test will take over 16 hours to complete
+// tools/ClassifierCheck runs the same sweep on a PC in seconds
 void Program15_3(void) {
 
     scenario_t result, truth;
@@ -343,6 +348,8 @@ int Program15_4(void) { // example program 15.1
     Nokia5110_Init();
     LCDClear4();
 
+    IRDistance_Init();                // use the stored calibration if there is one
+
     // Initialize ADC
     uint16_t raw17, raw14, raw16;
     ADC0_InitSWTriggerCh17_14_16();   // initialize channels 17,14,16
@@ -374,8 +381,114 @@ int Program15_4(void) { // example program 15.1
 }
 
 
+// =============== Program 15.5 =====================================
+// Calibrate the IR sensors on the robot and store the coefficients in flash
+
+// Place walls at each of these distances from the robot center,
+// on the left, in front and on the right, then press a switch.
+// Closer than 200 mm the sensors saturate and then fold back, and
+// IRCal_Fit rejects such readings.
+int32_t const CalDistances[] = {200, 250, 300, 350, 400, 500, 600, 700, 800};
+#define NUM_CAL_POINTS (sizeof(CalDistances)/sizeof(CalDistances[0]))
+
+// ADC sampling
+// Runs at 2000 Hz by TimerA1 periodic interrupt.
+void AdcSampling5(void){
+
+    uint16_t raw17, raw14, raw16;
+    ADC_In17_14_16(&raw17, &raw14, &raw16);     // sample
+
+    FilteredLeft = LPF_Calc3(raw16);            // left is channel 16, P9.1
+    FilteredCenter = LPF_Calc2(raw14);          // center is channel 14, P4.1
+    FilteredRight = LPF_Calc(raw17);            // right is channel 17 P9.0
+}
+
+void LCDOutCoeff(char const *name, IRCoeff_t const *coeff){
+    Nokia5110_OutString(name);
+    Nokia5110_OutUDec(coeff->Slope, 7);
+    Nokia5110_OutSDec(coeff->Offset, 4);
+}
+
+void Program15_5(void){
+
+    Clock_Init48MHz();
+    DisableInterrupts();
+    LaunchPad_Init();
+    Nokia5110_Init();
+    Nokia5110_SetContrast(0xB8);
+
+    // Initialize ADC
+    uint16_t raw17, raw14, raw16;
+    ADC0_InitSWTriggerCh17_14_16();   // initialize channels 17,14,16
+    ADC_In17_14_16(&raw17,&raw14,&raw16);  // sample
+
+    // Initialized Digital Low Pass Filters
+    uint32_t const filterLength = 256;
+    LPF_Init(raw17, filterLength);     // channel 17
+    LPF_Init2(raw14, filterLength);    // channel 14
+    LPF_Init3(raw16, filterLength);    // channel 16
+
+    // Initialize TimerA1 for periodic interrupt.
+    uint16_t const period_2us = 250;  // T = 500us --> f = 2000Hz
+    TimerA1_Init(&AdcSampling5, period_2us);
+
+    EnableInterrupts();
+
+    // collect one filtered reading per sensor at each distance
+    uint32_t adc[IR_NUM_SENSORS][NUM_CAL_POINTS];
+    for(int i = 0; i < NUM_CAL_POINTS; i++){
+        Nokia5110_Clear();
+        Nokia5110_SetCursor2(1,1); Nokia5110_OutString("IR calibrate");
+        Nokia5110_SetCursor2(2,1); Nokia5110_OutString("Walls at");
+        Nokia5110_SetCursor2(3,1); Nokia5110_OutUDec(CalDistances[i], 4); Nokia5110_OutString(" mm");
+        Nokia5110_SetCursor2(5,1); Nokia5110_OutString("SW to sample");
+        LaunchPad_Wait4SW();
+        Clock_Delay1ms(500);           // let the 256-tap filters settle
+        adc[IR_LEFT][i] = FilteredLeft;
+        adc[IR_CENTER][i] = FilteredCenter;
+        adc[IR_RIGHT][i] = FilteredRight;
+    }
+
+    // fit m, c, and r for each sensor
+    IRCoeff_t coeff[IR_NUM_SENSORS];
+    uint8_t fitted = 1;
+    for(int s = 0; s < IR_NUM_SENSORS; s++){
+        fitted &= IRCal_Fit(adc[s], CalDistances, NUM_CAL_POINTS, &coeff[s]);
+    }
+
+    Nokia5110_Clear();
+    if(!fitted){
+        Nokia5110_SetCursor2(1,1); Nokia5110_OutString("Fit failed");
+        Nokia5110_SetCursor2(2,1); Nokia5110_OutString("nothing saved");
+        LaunchPad_RGB(RED);
+        while(1);
+    }
+    Nokia5110_SetCursor2(1,1); LCDOutCoeff("L", &coeff[IR_LEFT]);
+    Nokia5110_SetCursor2(2,1); LCDOutCoeff("C", &coeff[IR_CENTER]);
+    Nokia5110_SetCursor2(3,1); LCDOutCoeff("R", &coeff[IR_RIGHT]);
+    Nokia5110_SetCursor2(5,1); Nokia5110_OutString("SW to save");
+    LaunchPad_Wait4SW();
+    TimerA1_Stop();                    // no sampling while the flash is busy
+
+    // store in flash so IRDistance_Init loads it at every boot
+    IRCalRecord_t record;
+    IRDistance_MakeRecord(&record, coeff);
+    Nokia5110_SetCursor2(6,1);
+    if((FlashInfo_Update(IRCAL_ADDRESS, (uint32_t const *)&record, sizeof(record)/4) == FLASHINFO_NOERROR) &&
+       IRDistance_Init()){
+        Nokia5110_OutString("Saved       ");
+        LaunchPad_RGB(GREEN);
+    } else {
+        Nokia5110_OutString("Flash error ");
+        LaunchPad_RGB(RED);
+    }
+    while(1);
+}
+
+
 int main(void){
     Program15_1();
 	//Program15_2();
 	//Program15_4();
+	//Program15_5();
 }
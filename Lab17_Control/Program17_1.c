@@ -42,18 +42,22 @@ policies, either expressed or implied, of the FreeBSD Project.
 
 // Required libraries for microcontroller functions and peripherals
 #include <stdbool.h>
+#include <stddef.h>
 #include "msp.h"                    // MSP432 microcontroller library
 #include "../inc/Clock.h"           // System clock management
 #include "../inc/CortexM.h"         // Cortex M specific functions
 #include "../inc/PWM.h"             // PWM signal control
 #include "../inc/LaunchPad.h"       // MSP432 LaunchPad functionality
 #include "../inc/UART0.h"           // UART for data transmission
+#include "../inc/TelemetryStream.h" // Live telemetry over UART0
+#include "../inc/Console.h"         // Parameter tuning over UART0
 #include "../inc/Motor.h"           // Motor control
 #include "../inc/Bump.h"            // Bump sensors
 #include "../inc/TimerA2.h"         // Timer A2
 #include "../inc/Nokia5110.h"       // Nokia LCD
 #include "../inc/LPF.h"             // Low-pass filter
 #include "../inc/Tachometer.h"      // Tachometer for motor feedback
+#include "../inc/SpeedEstimator.h"  // M/T wheel speed estimator
 
 
 // This macro limits a value within a specified minimum and maximum range.
@@ -72,6 +76,11 @@ policies, either expressed or implied, of the FreeBSD Project.
 #define PWMMIN 0        // Minimum PWM value
 #define PWMMAX 999      // Maximum PWM value
 
+// Motor PWM carrier. At the default 50 Hz the motor current, and with it
+// the tachometer period, ripples at the PWM rate; 20 kHz is inaudible
+// and smooths it out, at 0.33% duty resolution.
+#define MOTOR_PWM_HZ 20000
+
 // This divider scales down the controller output by dividing it inside the Controller.
 // Specifically, (Kp * error) / GAIN_DIVIDER is used to compute the controller output.
 // This allows us to select real (non-integer) values for Kp, such as 1.01, 2.43, and 3.75,
@@ -109,14 +118,17 @@ static bool IsControllerEnabled = false; // Do not run the controller if this se
 // Display some information on the LCD when this value reaches a certain threshold.
 static uint8_t NumControllerExecuted = 0;   // Counts controller executions for display updates
 
-// Buffers for storing recent speed and PWM values for performance analysis
-#define TACHBUFF_SIZE 10  // Tachometer data buffer size for speed averaging
-#define BUFFER_SIZE 1000  // Storage size for analysis data over a 20-second period
-static uint16_t LeftSpeedBuffer[BUFFER_SIZE];
-static uint16_t RightSpeedBuffer[BUFFER_SIZE];
-static uint16_t LeftDutyBuffer[BUFFER_SIZE];
-static uint16_t RightDutyBuffer[BUFFER_SIZE];
-static uint16_t BufferIndex = 0;  // Current position in buffer arrays
+// Speeds and PWM values are streamed to the PC for performance analysis
+// while the robot runs, decode them with tools/TelemetryDecode
+static int8_t ControlChannel = -1;
+
+// Columns of the controller channel
+static const TelemetryField_t TxFields[4] = {
+    {"leftSpeed", TELEMETRY_U16},
+    {"rightSpeed", TELEMETRY_U16},
+    {"leftDuty", TELEMETRY_U16},
+    {"rightDuty", TELEMETRY_U16}
+};
 
 // Speed-related and error-tracking variables for the PI controller
 static uint16_t LeftSpeed_rpm = 0;
@@ -128,6 +140,13 @@ static int32_t AccumSpeedErrorR = 0;  // Accumulated error for integral control,
 static int16_t LeftDuty_permil = 0;  // PWM duty cycle, left motor
 static int16_t RightDuty_permil = 0;  // PWM duty cycle, right motor
 
+// Shows the reference speeds, again each time they change;
+// the next LCDOut sends them
+static void LCDRef(void){
+    Nokia5110_DrawUDec(2, 5, DesiredSpeed_rpm, 4);
+    Nokia5110_DrawUDec(2, 9, DesiredSpeed_rpm, 4);
+}
+
 // Function to initialize and clear the LCD display with setup data
 // Displays target speeds and initializes the user interface
 static void LCDClear(void){
@@ -137,42 +156,40 @@ static void LCDClear(void){
     uint8_t const contrast = 0xB1;
     Nokia5110_SetContrast(contrast);
 
-    Nokia5110_Clear();  // erase entire display
-    Nokia5110_SetCursor2(1, 1);
-    Nokia5110_OutString("RPM  L   R  ");
-    Nokia5110_SetCursor2(2, 1); Nokia5110_OutString("Ref");
-    Nokia5110_SetCursor2(2, 5); Nokia5110_OutUDec(DesiredSpeed_rpm, 4);
-    Nokia5110_SetCursor2(2, 9); Nokia5110_OutUDec(DesiredSpeed_rpm, 4);
-    Nokia5110_SetCursor2(3, 1); Nokia5110_OutString("S");   // Speeds
-    Nokia5110_SetCursor2(4, 1); Nokia5110_OutString("E");   // Errors
-    Nokia5110_SetCursor2(5, 1); Nokia5110_OutString("A");   // Accumulated errors
-    Nokia5110_SetCursor2(6, 1); Nokia5110_OutString("D");   // Duty cycles
+    Nokia5110_ClearBuffer();  // erase entire display
+    Nokia5110_DrawString(1, 1, "RPM  L   R  ");
+    Nokia5110_DrawString(2, 1, "Ref");
+    LCDRef();
+    Nokia5110_DrawString(3, 1, "S");   // Speeds
+    Nokia5110_DrawString(4, 1, "E");   // Errors
+    Nokia5110_DrawString(5, 1, "A");   // Accumulated errors
+    Nokia5110_DrawString(6, 1, "D");   // Duty cycles
+    Nokia5110_Update();
 }
 
-// Updates LCD display with current motor speeds, control errors, and PWM duties
+// Updates LCD display with current motor speeds, control errors, and PWM duties.
+// Every field is drawn into the screen buffer; only the changed pixels are sent.
 static void LCDOut(void){
-    Nokia5110_SetCursor2(3, 2); Nokia5110_OutUDec(LeftSpeed_rpm, 5);
-    Nokia5110_SetCursor2(3, 8); Nokia5110_OutUDec(RightSpeed_rpm, 5);
-    Nokia5110_SetCursor2(4, 2); Nokia5110_OutSDec(ErrorL, 5);
-    Nokia5110_SetCursor2(4, 8); Nokia5110_OutSDec(ErrorR, 5);
-    Nokia5110_SetCursor2(5, 2); Nokia5110_OutUDec(AccumSpeedErrorL, 5);
-    Nokia5110_SetCursor2(5, 8); Nokia5110_OutUDec(AccumSpeedErrorR, 5);
-    Nokia5110_SetCursor2(6, 2); Nokia5110_OutUDec(LeftDuty_permil, 5);
-    Nokia5110_SetCursor2(6, 8); Nokia5110_OutUDec(RightDuty_permil, 5);
+    Nokia5110_DrawUDec(3, 2, LeftSpeed_rpm, 5);
+    Nokia5110_DrawUDec(3, 8, RightSpeed_rpm, 5);
+    Nokia5110_DrawSDec(4, 2, ErrorL, 5);
+    Nokia5110_DrawSDec(4, 8, ErrorR, 5);
+    Nokia5110_DrawUDec(5, 2, AccumSpeedErrorL, 5);
+    Nokia5110_DrawUDec(5, 8, AccumSpeedErrorR, 5);
+    Nokia5110_DrawUDec(6, 2, LeftDuty_permil, 5);
+    Nokia5110_DrawUDec(6, 8, RightDuty_permil, 5);
+    Nokia5110_Update();
 }
 
 
-// ------------ average ------------
-// Calculates and returns the average value of an array of unsigned integers
-// Used to smooth tachometer data for speed calculation
-static uint16_t average(uint16_t *data, int data_length) {
-    uint32_t sum = 0;
-    for (int i = 0; i < data_length; i++) {
-        sum += data[i];
-    }
-    return sum/data_length;
-}
-
+// Parameters the UART0 console can change while the controller runs,
+// e.g. "set kp 450".  The bump switch menu in UpdateParameters still
+// works while the robot is stopped.
+static const ConsoleParam_t ConsoleParams[3] = {
+    {"kp", &Kp, CONSOLE_I32, 0, 10000, NULL},
+    {"ki", &Ki, CONSOLE_I32, 0, 10000, NULL},
+    {"speed", &DesiredSpeed_rpm, CONSOLE_U16, 0, 300, &LCDRef}
+};
 
 // If a bump switch is pressed and hold for more than five iterations,
 // the delay will decrease, and the numbers will increment rapidly.
@@ -286,84 +303,12 @@ static void UpdateParameters(void) {
 
 }
 
-// send analysis data to PC.
-static void TxBuffer(void) {
-
-    // wait for release
-    while(LaunchPad_SW() || Bump_Read()) {
-        Clock_Delay1ms(200); LaunchPad_RGB(RGB_OFF); // off
-        Clock_Delay1ms(200); LaunchPad_RGB(RED); // red
-    }
-
-    uint8_t isTxEnabled = 0;
-
-    while(1) {
-
-        Nokia5110_Clear();
-        Nokia5110_OutString("Tx Buffer?");
-        Nokia5110_SetCursor2(2,1);  Nokia5110_OutString("Bump: Y/N");
-        Nokia5110_SetCursor2(4,1);  Nokia5110_OutString("SW to Cont.");
-
-        while(!LaunchPad_SW()) {    // until SW is pressed
-            // update the screen
-            if (isTxEnabled) {      // Display Y/N on LCD
-                Nokia5110_SetCursor2(1,12);
-                Nokia5110_OutString("Y");
-            } else {
-                Nokia5110_SetCursor2(1,12);
-                Nokia5110_OutString("N");
-            }
-
-            if (Bump_Read()) {
-                isTxEnabled ^= 1;   // Toggle Y/N
-            }
-
-            // flash the blue LED while desired speeds are updated.
-            BLUELED ^= 1;
-            Clock_Delay1ms(200);
-        }
-
-        // SW is pressed
-        if(isTxEnabled) {   // Tx Buffer? is Y. Start transmitting data via USB
-            UART0_OutString("\n\r***Receiving buffer data***\n\r");
-            for (int i = 0; i < BUFFER_SIZE; i++) {
-                UART0_OutUDec(i); UART0_OutChar(',');
-                UART0_OutSDec(LeftSpeedBuffer[i]); UART0_OutChar(',');
-                UART0_OutSDec(RightSpeedBuffer[i]); UART0_OutChar(',');
-                UART0_OutSDec(LeftDutyBuffer[i]); UART0_OutChar(',');
-                UART0_OutSDec(RightDutyBuffer[i]); UART0_OutString("\n\r");
-            }
-            Nokia5110_SetCursor2(4,1);
-            Nokia5110_OutString("TX is Done   ");
-            Nokia5110_SetCursor2(5,1);
-            Nokia5110_OutString("SW to Cont.");
-
-            while(!LaunchPad_SW());     // until SW is pressed
-            Clock_Delay1ms(500);
-        } else {    // Tx Buffer? is N. wrap up the function and exit.
-            break;
-        }
-    }
-
-    for(int k = 0; k < 5; k++){
-        LaunchPad_RGB(YELLOW);
-        Clock_Delay1ms(100);
-        LaunchPad_RGB(RGB_OFF);
-        Clock_Delay1ms(100);
-    }
-}
-
-
 //**********************************************************
 // Proportional-Integral (PI) controller for motor speed control
 // Utilizes tachometer data to adjust motor speed.
 static void Controller(void){
 
 
-    static uint8_t idxTachoData = 0;             // Index for TachoPeriod arrays.
-    static uint16_t LeftTachoPeriod[TACHBUFF_SIZE]; // Array to store left tachometer periods.
-    static uint16_t RightTachoPeriod[TACHBUFF_SIZE]; // Array to store right tachometer periods.
-
     // If controller is disabled, exit the function.
     if(!IsControllerEnabled) {
         return;
@@ -384,16 +329,12 @@ static void Controller(void){
     // Complete the rest for lab17
     // ====================================================================
 
-    // Obtain tachometer data and store in arrays.
-    Tachometer_GetSpeeds(&LeftTachoPeriod[idxTachoData], &RightTachoPeriod[idxTachoData]);
-
-    idxTachoData = (idxTachoData + 1) % TACHBUFF_SIZE;
-
-    uint16_t LeftPeriod = average(LeftTachoPeriod, TACHBUFF_SIZE);
-    uint16_t RightPeriod = average(RightTachoPeriod, TACHBUFF_SIZE);
-
-    LeftSpeed_rpm = PULSE2RPM/LeftPeriod;
-    RightSpeed_rpm = PULSE2RPM/RightPeriod;
+    // Measure the wheel speeds over this 20 ms window (M/T method).
+    // The robot only drives forward here, so a negative speed counts as 0.
+    int32_t leftSpeed, rightSpeed;
+    SpeedEstimator_UpdateWheels(&leftSpeed, &rightSpeed);
+    LeftSpeed_rpm = (leftSpeed < 0) ? 0 : leftSpeed;
+    RightSpeed_rpm = (rightSpeed < 0) ? 0 : rightSpeed;
 
     ErrorR = DesiredSpeed_rpm - RightSpeed_rpm;
     ErrorL = DesiredSpeed_rpm - LeftSpeed_rpm;
@@ -415,14 +356,9 @@ static void Controller(void){
     // Step 7: Update motor speed using calculated duty cycles.
     Motor_Forward(LeftDuty_permil, RightDuty_permil);
 
-    // Log data for performance analysis if buffer is not full.
-    if (BufferIndex < BUFFER_SIZE) {
-        LeftSpeedBuffer[BufferIndex] = LeftSpeed_rpm;
-        RightSpeedBuffer[BufferIndex] = RightSpeed_rpm;
-        LeftDutyBuffer[BufferIndex] = LeftDuty_permil;
-        RightDutyBuffer[BufferIndex] = RightDuty_permil;
-        BufferIndex++;
-    }
+    // Log data for performance analysis, the main loop sends it
+    int32_t record[4] = {LeftSpeed_rpm, RightSpeed_rpm, LeftDuty_permil, RightDuty_permil};
+    TelemetryStream_Push(ControlChannel, record);
 
     // Increment counter to keep track of controller executions.
     NumControllerExecuted++;
@@ -439,13 +375,15 @@ void Program17_1(void) {
     LaunchPad_Init();                // Initialize LaunchPad buttons and LEDs
     Bump_Init();                     // Initialize bump sensors
     Motor_Init();                    // Initialize motor controls
+    Motor_SetPWMFrequency(MOTOR_PWM_HZ);
     Nokia5110_Init();                // Initialize the Nokia LCD
     LCDClear();                      // Clear the LCD screen
 
     Tachometer_Init(); // Initialize tachometers to measure wheel distances with set priority
 
-    uint32_t const baudrate = 115200; // Set UART baud rate for PC communication
+    uint32_t const baudrate = TELEMETRY_BAUD; // 460800, the terminal and TelemetryDecode must match
     UART0_Init(baudrate);             // Initialize UART0 communication with set baud rate
+    Console_Init(ConsoleParams, 3);   // Gains and speed can be tuned over UART0
 
     // Use TimerA2 to run the controller at 50 Hz (every 20ms)
     uint16_t const period_4us = 5000;       // Timer period to achieve 20ms (5000 x 4us)
@@ -454,7 +392,6 @@ void Program17_1(void) {
     // Variables to control display update rate
     uint16_t const LcdUpdateRate = 5; // LCD updates every 5 controller cycles (every 100ms)
 
-    BufferIndex = 0;                  // Initialize data buffer index
     IsControllerEnabled = false;      // Initially disable the controller
     Tachometer_ResetSteps();          // Reset tachometer step counters
 
@@ -466,6 +403,12 @@ void Program17_1(void) {
         // Enter low-power mode, waiting for interrupts
         WaitForInterrupt();
 
+        // Send the records the controller logged, without waiting for the UART
+        TelemetryStream_Service();
+
+        // Run the tuning commands typed so far, without waiting for more
+        Console_Poll();
+
         // Update the LCD display every 10 Hz (5 controller runs)
         // Note: Avoid adding LCDOut inside the ISR since Nokia5110 is a slow device.
         if (NumControllerExecuted == LcdUpdateRate) {
@@ -484,18 +427,21 @@ void Program17_1(void) {
 
         LaunchPad_RGB(RGB_OFF); // Turn off RGB LED on LaunchPad
         Motor_Coast();          // Set motors to coast mode (stop gradually)
+
+        // Send the rest of the run's data and end its stream
+        TelemetryStream_Close();
         Clock_Delay1ms(300);    // Delay to stabilize
 
         // Update control parameters based on user input or other settings
         UpdateParameters();
 
-        // Transmit the buffer data to the PC for analysis
-        TxBuffer();
-
         LCDClear();               // Clear the LCD screen
-        BufferIndex = 0;          // Reset buffer index for new data collection
+        // Stream the new run, it starts with its own schema frame
+        TelemetryStream_Init();
+        ControlChannel = TelemetryStream_AddChannel("Program17_1", TxFields, 4, 1);
         AccumSpeedErrorL = 0;     // Reset accumulated speed error (left wheel)
         AccumSpeedErrorR = 0;     // Reset accumulated speed error (right wheel)
+        SpeedEstimator_InitWheels(TACH_STALL_TIMEOUT_MS);  // Start speed windows from now
 
         // Enable the controller for active speed control
         IsControllerEnabled = true;
@@ -2,12 +2,15 @@
 
 // Required libraries for microcontroller functions and peripherals
 #include <stdbool.h>
+#include <stddef.h>
 #include "msp.h"                    // MSP432 microcontroller library
 #include "../inc/Clock.h"           // System clock management
 #include "../inc/CortexM.h"         // Cortex M specific functions
 #include "../inc/PWM.h"             // PWM signal control
 #include "../inc/LaunchPad.h"       // MSP432 LaunchPad functionality
 #include "../inc/UART0.h"           // UART for data transmission
+#include "../inc/TelemetryStream.h" // Live telemetry over UART0
+#include "../inc/Console.h"         // Parameter tuning over UART0
 #include "../inc/Motor.h"           // Motor control
 #include "../inc/Bump.h"            // Bump sensors
 #include "../inc/ADC14.h"           // Analog-to-digital converter
@@ -17,6 +20,7 @@
 #include "../inc/Nokia5110.h"       // Nokia LCD
 #include "../inc/LPF.h"             // Low-pass filter
 #include "../inc/Classifier.h"
+#include "../inc/ScenarioTracker.h"  // Debounced scenarios
 
 
 /************** Program17_3 ******************************************
@@ -73,12 +77,25 @@ static bool IsActuatorEnabled = false;
 // LCD update rate: used to track number of controller executions for display.
 static uint8_t NumControllerExecuted = 0;
 
-// Data buffers for storing performance data, such as error and duty cycle values.
-#define BUFFER_SIZE 1000              // Buffer for 20 seconds of data (at 50Hz controller rate)
-static int32_t ErrorBuffer[BUFFER_SIZE];          // Stores controller error values
-static uint16_t LeftDutyBuffer[BUFFER_SIZE];      // Stores left motor duty cycles
-static uint16_t RightDutyBuffer[BUFFER_SIZE];     // Stores right motor duty cycles
-static uint16_t BufferIndex = 0;                  // Index for data buffering
+// Performance data, such as error and duty cycle values, is streamed to
+// the PC while the robot runs, decode it with tools/TelemetryDecode
+static int8_t ControlChannel = -1;    // one record per controller run, 50 Hz
+static int8_t IRChannel = -1;         // one of every IR_DECIMATION IR samples
+#define IR_DECIMATION 40              // 2000 Hz IR sampling / 40 = 50 Hz
+
+// Columns of the controller channel, the error in mm fits in 16 bits.
+static const TelemetryField_t TxFields[3] = {
+    {"error", TELEMETRY_I16},
+    {"leftDuty", TELEMETRY_U16},
+    {"rightDuty", TELEMETRY_U16}
+};
+
+// Columns of the IR channel, distances in mm
+static const TelemetryField_t IRFields[3] = {
+    {"left", TELEMETRY_I16},
+    {"center", TELEMETRY_I16},
+    {"right", TELEMETRY_I16}
+};
 
 // IR distance variables to store readings from wall sensors (in mm).
 int32_t Left, Center, Right;          // Distances to the left, center, and right walls
@@ -92,36 +109,47 @@ static void LCDClear(void) {
     // Adjust this from 0xA0 (lighter) to 0xCF (darker) if needed.
     uint8_t const contrast = 0xB1;
     Nokia5110_SetContrast(contrast);  // Apply the contrast setting
-    Nokia5110_Clear();                // Clear the entire display screen
+    Nokia5110_ClearBuffer();          // Clear the entire display screen
 
     // Display initial text for each measurement label on the LCD.
-    Nokia5110_OutString("17.3:Kp");  // Display program ID and Kp label at the top
-    Nokia5110_SetCursor2(2,1); Nokia5110_OutString("IR distance");
+    Nokia5110_DrawString(1,1,"17.3:Kp");  // Display program ID and Kp label at the top
+    Nokia5110_DrawString(2,1,"IR distance");
 
     // Set labels and units for left, center, right IR sensor values, and error.
-    Nokia5110_SetCursor2(3,1); Nokia5110_OutString("L= ");
-    Nokia5110_OutUDec(0, 5); Nokia5110_OutString(" mm");    // Initialize left distance
-    Nokia5110_SetCursor2(4,1); Nokia5110_OutString("C= ");
-    Nokia5110_OutUDec(0, 5); Nokia5110_OutString(" mm");    // Initialize center distance
-    Nokia5110_SetCursor2(5,1); Nokia5110_OutString("R= ");
-    Nokia5110_OutUDec(0, 5); Nokia5110_OutString(" mm");    // Initialize right distance
-    Nokia5110_SetCursor2(6,1); Nokia5110_OutString("E= ");
-    Nokia5110_OutUDec(0, 5); Nokia5110_OutString(" mm");    // Initialize error
+    Nokia5110_DrawString(3,1,"L= ");
+    Nokia5110_DrawUDec(3,4,0,5); Nokia5110_DrawString(3,9," mm");    // Initialize left distance
+    Nokia5110_DrawString(4,1,"C= ");
+    Nokia5110_DrawUDec(4,4,0,5); Nokia5110_DrawString(4,9," mm");    // Initialize center distance
+    Nokia5110_DrawString(5,1,"R= ");
+    Nokia5110_DrawUDec(5,4,0,5); Nokia5110_DrawString(5,9," mm");    // Initialize right distance
+    Nokia5110_DrawString(6,1,"E= ");
+    Nokia5110_DrawUDec(6,4,0,5); Nokia5110_DrawString(6,9," mm");    // Initialize error
+    Nokia5110_Update();
 
 }
 
 // Updates the LCD display with real-time data values for Kp, left, center, right distances, and error.
+// The values are drawn into the screen buffer and only the changed pixels are sent.
 static void LCDOut(void) {
     // Update the Kp gain value at a predefined position.
-    Nokia5110_SetCursor2(1,8); Nokia5110_OutUDec(Kp, 5);
+    Nokia5110_DrawUDec(1,8,Kp,5);
 
     // Display sensor distances and error in their respective positions.
-    Nokia5110_SetCursor2(3,4); Nokia5110_OutSDec(Left, 6);    // Left distance
-    Nokia5110_SetCursor2(4,4); Nokia5110_OutSDec(Center, 6);  // Center distance
-    Nokia5110_SetCursor2(5,4); Nokia5110_OutSDec(Right, 6);   // Right distance
+    Nokia5110_DrawSDec(3,4,Left,6);    // Left distance
+    Nokia5110_DrawSDec(4,4,Center,6);  // Center distance
+    Nokia5110_DrawSDec(5,4,Right,6);   // Right distance
+    Nokia5110_Update();
 }
 
 
+// Parameters the UART0 console can change while the controller runs,
+// e.g. "set kp 40" or "set motors 0".  The bump switch menus still
+// work while the robot is stopped.
+static const ConsoleParam_t ConsoleParams[2] = {
+    {"kp", &Kp, CONSOLE_I16, 0, 1000, NULL},
+    {"motors", &IsActuatorEnabled, CONSOLE_BOOL, 0, 1, NULL}
+};
+
 // If a bump switch is pressed and hold for more than five iterations,
 // the delay will decrease, and the numbers will increment rapidly.
 #define BUMP_DELAY       200       // Initial delay for bump button press in ms
@@ -227,77 +255,6 @@ static void EnableActuator(void) {
     }
 }
 
-// Function to send analysis data to PC via UART communication.
-static void TxBuffer(void) {
-
-    // Step 1: Wait for button release.
-    // Ensures the function starts only after any active button press is released.
-    while(LaunchPad_SW() || Bump_Read()) {
-        Clock_Delay1ms(200); LaunchPad_RGB(RGB_OFF); // Turn off LED
-        Clock_Delay1ms(200); LaunchPad_RGB(RED);     // Turn on red LED
-    }
-
-    uint8_t isTxEnabled = 0; // Flag to determine if data transmission is enabled
-
-    while(1) {
-        // Display prompt on LCD screen
-        Nokia5110_Clear();
-        Nokia5110_OutString("Tx Buffer?");
-        Nokia5110_SetCursor2(2,1);  Nokia5110_OutString("Bump: Y/N");
-        Nokia5110_SetCursor2(4,1);  Nokia5110_OutString("SW to Cont.");
-
-        // Step 2: Wait for SW button press.
-        while(!LaunchPad_SW()) {
-            // Update Y/N indicator based on `isTxEnabled` status.
-            Nokia5110_SetCursor2(1,12);
-            Nokia5110_OutString(isTxEnabled ? "Y" : "N");
-
-            // Toggle `isTxEnabled` if a bump switch is pressed.
-            if (Bump_Read()) {
-                isTxEnabled ^= 1; // Toggle between Y/N
-            }
-
-            // Flash the blue LED during screen update.
-            BLUELED ^= 1;
-            Clock_Delay1ms(200);
-        }
-
-        // Step 3: Transmit buffer data if `isTxEnabled` is true.
-        if(isTxEnabled) {
-            UART0_OutString("\n\r***Receiving buffer data***\n\r");
-
-            // Transmit each buffer element over UART
-            for (int i = 0; i < BUFFER_SIZE; i++) {
-                UART0_OutUDec(i); UART0_OutChar(',');
-                UART0_OutSDec(ErrorBuffer[i]); UART0_OutChar(',');
-                UART0_OutSDec(LeftDutyBuffer[i]); UART0_OutChar(',');
-                UART0_OutSDec(RightDutyBuffer[i]); UART0_OutString("\n\r");
-            }
-
-            // Display transmission completion message.
-            Nokia5110_SetCursor2(4,1);
-            Nokia5110_OutString("TX is Done   ");
-            Nokia5110_SetCursor2(5,1);
-            Nokia5110_OutString("SW to Cont.");
-
-            // Wait for SW button press to exit transmission mode.
-            while(!LaunchPad_SW());
-            Clock_Delay1ms(500);
-        } else {
-            // If `isTxEnabled` is false, exit the function.
-            break;
-        }
-    }
-
-    // Flash the yellow LED to indicate the end of the function.
-    for(int k = 0; k < 5; k++){
-        LaunchPad_RGB(YELLOW);
-        Clock_Delay1ms(100);
-        LaunchPad_RGB(RGB_OFF);
-        Clock_Delay1ms(100);
-    }
-}
-
 // Periodic ADC sampling function for IR sensors.
 // This function should be triggered periodically by TimerA ISR.
 static void IRsampling(void){
@@ -312,6 +269,9 @@ static void IRsampling(void){
     Left = LeftConvert(nl);                     // Convert smoothed left data to distance (or other scaled units)
     Center = CenterConvert(nc);                 // Convert smoothed center data to distance
     Right = RightConvert(nr);                   // Convert smoothed right data to distance
+
+    int32_t record[3] = {Left, Center, Right};
+    TelemetryStream_Push(IRChannel, record);    // decimated to 50 Hz
 }
 
 
@@ -321,6 +281,13 @@ scenario_t correctedDecision = Straight;            //set up classify usage
 static int numTurns = 0;
 static uint16_t Time_1ms = 0;
 
+// Scenario tracker parameters: a sensor changes state 20 mm past its threshold
+// and a scenario must win 3 of the last 5 controller runs (60-100 ms at 50 Hz).
+#define TRACKER_HYSTERESIS 20
+#define TRACKER_VOTES      3
+#define TRACKER_WINDOW     5
+static ScenarioTracker_t Tracker;
+
 static void Controller(void){
 
     // If the controller is disabled, exit the function without performing any control actions
@@ -337,6 +304,9 @@ static void Controller(void){
 
     static int ticks = 0;
 
+    // Debounce the classification every run, including while a decision is locked in
+    ScenarioTracker_Update(&Tracker, Left, Center, Right, NULL);
+
     int16_t leftDuty_permil = PWM_AVERAGE;
     int16_t rightDuty_permil = PWM_AVERAGE;
     Error = Right - Left;                       //define error here since it affects correction and implementation to fix speeds
@@ -413,12 +383,16 @@ static void Controller(void){
             Motor_Brake();
         }
 
+        // Log data for performance analysis, the main loop sends it
+        int32_t record[3] = {Error, leftDuty_permil, rightDuty_permil};
+        TelemetryStream_Push(ControlChannel, record);
+
         // Track the number of times the controller has executed for scheduling and logging purposes
         NumControllerExecuted++;
         return;
     }
 
-    scenario_t decision = Classify(Left, Center, Right);
+    scenario_t decision = ScenarioTracker_Scenario(&Tracker);
 
     if (decision == RightJoint) {
        ticks = 155;                          //will trigger the exception for a period of time, more ticks -> longer "locked in" decision
@@ -427,7 +401,7 @@ static void Controller(void){
        leftDuty_permil = PWM_AVERAGE;
        rightDuty_permil = PWM_AVERAGE;                              //still need immediate change
     }
-    else if (decision == LeftJoint) {
+    else if ((decision == LeftJoint) || (decision == CrossRoad)) {   // left-hand rule at a crossroad
         ticks = 35;                          //will trigger the exception for a period of time
         correctedDecision = decision;
         Left = 200;
@@ -477,6 +451,10 @@ static void Controller(void){
         Motor_Brake();
     }
 
+    // Log data for performance analysis, the main loop sends it
+    int32_t record[3] = {Error, leftDuty_permil, rightDuty_permil};
+    TelemetryStream_Push(ControlChannel, record);
+
     // Track the number of times the controller has executed for scheduling and logging purposes
     NumControllerExecuted++;
 
@@ -497,8 +475,9 @@ void Program17_3(void){
     Nokia5110_Init();                // Initialize the Nokia LCD
     LCDClear();                      // Clear the LCD screen
 
-    uint32_t const baudrate = 115200; // Set UART baud rate for PC communication
+    uint32_t const baudrate = TELEMETRY_BAUD; // 460800, the terminal and TelemetryDecode must match
     UART0_Init(baudrate);             // Initialize UART0 communication with set baud rate
+    Console_Init(ConsoleParams, 2);   // Kp and the motors can be changed over UART0
 
     // Use TimerA2 to run the controller at 50 Hz (every 20ms)
     uint16_t const period_4us = 5000;       // Timer period to achieve 20ms (5000 x 4us)
@@ -508,6 +487,10 @@ void Program17_3(void){
     uint16_t const period_2us = 250;        // Timer period to achieve 0.5ms (250 x 2us)
     TimerA1_Init(&IRsampling, period_2us);  // Initialize TimerA1 for controller
 
+    IRDistance_Init();                      // Load stored IR calibration (Program15_5), if any
+    ScenarioTracker_Init(&Tracker, CLASSIFY_SIDEMAX, CLASSIFY_CENTEROPEN, TRACKER_HYSTERESIS,
+                         TRACKER_VOTES, TRACKER_WINDOW, Straight);
+
     // Initialize ADC channels for sensors on pins 17, 14, and 16
     ADC0_InitSWTriggerCh17_14_16();
     uint16_t raw17, raw14, raw16;
@@ -531,6 +514,12 @@ void Program17_3(void){
         // Enter low-power mode, waiting for interrupts
         WaitForInterrupt();
 
+        // Send the records the ISRs logged, without waiting for the UART
+        TelemetryStream_Service();
+
+        // Run the tuning commands typed so far, without waiting for more
+        Console_Poll();
+
         // Update the LCD display every 10 Hz (5 controller runs)
         // Note: Avoid adding LCDOut inside the ISR since Nokia5110 is a slow device.
         if (NumControllerExecuted == LcdUpdateRate) {
@@ -549,6 +538,9 @@ void Program17_3(void){
 
         LaunchPad_RGB(RGB_OFF); // Turn off RGB LED on LaunchPad
         Motor_Coast();          // Set motors to coast mode (stop gradually)
+
+        // Send the rest of the run's data and end its streams
+        TelemetryStream_Close();
         Clock_Delay1ms(300);    // Delay to stabilize
 
         // Update control parameters based on user input or other settings
@@ -557,11 +549,16 @@ void Program17_3(void){
         // Enable/Disable actuators (motors)
         EnableActuator();
 
-        // Transmit the buffer data to the PC for analysis
-        TxBuffer();
-
         LCDClear();               // Clear the LCD screen
-        BufferIndex = 0;
+
+        // Stream the new run, it starts with its own schema frames
+        TelemetryStream_Init();
+        ControlChannel = TelemetryStream_AddChannel("Program17_3", TxFields, 3, 1);
+        IRChannel = TelemetryStream_AddChannel("Program17_3IR", IRFields, 3, IR_DECIMATION);
+
+        // Start the scenario history over after the pause
+        ScenarioTracker_Init(&Tracker, Tracker.SideMax, Tracker.CenterOpen, TRACKER_HYSTERESIS,
+                             TRACKER_VOTES, TRACKER_WINDOW, Straight);
 
         // Enable the controller for active speed control
         IsControllerEnabled = true;
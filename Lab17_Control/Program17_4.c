@@ -0,0 +1,70 @@
+// Program17_4.c
+// Runs on MSP432
+// Calibrates the duty-to-speed table of each wheel with MotorCal_Run
+// and stores it in flash, where MotorCal_Init finds it at every boot.
+// Needs about 1.5 m of clear, flat floor in front of the robot.
+
+#include <stdint.h>
+#include "msp.h"
+#include "../inc/Clock.h"           // System clock management
+#include "../inc/CortexM.h"         // Cortex M specific functions
+#include "../inc/LaunchPad.h"       // MSP432 LaunchPad functionality
+#include "../inc/Motor.h"           // Motor control
+#include "../inc/Nokia5110.h"       // Nokia LCD
+#include "../inc/Tachometer.h"      // Tachometer for motor feedback
+#include "../inc/MotorCal.h"        // Duty-to-speed calibration
+#include "Program17_4.h"
+
+// One table per line: name, deadband duty cycle, and speed at 999 permil
+static void LCDOutMap(char const *name, MotorMap_t const *map){
+    Nokia5110_OutString(name);
+    Nokia5110_OutUDec(map->Duty_permil[0], 4);
+    Nokia5110_OutUDec(map->Speed_rpm[MOTORCAL_POINTS-1], 5);
+}
+
+void Program17_4(void){
+
+    DisableInterrupts();
+    Clock_Init48MHz();
+    LaunchPad_Init();
+    Motor_Init();
+    Nokia5110_Init();
+    Nokia5110_SetContrast(0xB8);
+    Tachometer_Init();
+    EnableInterrupts();
+
+    Nokia5110_Clear();
+    Nokia5110_SetCursor2(1,1); Nokia5110_OutString("Motor cal");
+    Nokia5110_SetCursor2(2,1); Nokia5110_OutString("1.5 m clear");
+    Nokia5110_SetCursor2(5,1); Nokia5110_OutString("SW to start");
+    LaunchPad_Wait4SW();
+    Clock_Delay1ms(1000);              // hands off the robot
+
+    MotorMap_t maps[MOTOR_NUM_WHEELS];
+    LaunchPad_RGB(BLUE);
+    uint8_t fitted = MotorCal_Run(maps);
+    LaunchPad_RGB(RGB_OFF);
+
+    Nokia5110_Clear();
+    if(!fitted){
+        Nokia5110_SetCursor2(1,1); Nokia5110_OutString("Cal failed");
+        Nokia5110_SetCursor2(2,1); Nokia5110_OutString("nothing saved");
+        LaunchPad_RGB(RED);
+        while(1);
+    }
+    Nokia5110_SetCursor2(1,1); Nokia5110_OutString(" duty  rpm");
+    Nokia5110_SetCursor2(2,1); LCDOutMap("L", &maps[MOTOR_LEFT]);
+    Nokia5110_SetCursor2(3,1); LCDOutMap("R", &maps[MOTOR_RIGHT]);
+    Nokia5110_SetCursor2(5,1); Nokia5110_OutString("SW to save");
+    LaunchPad_Wait4SW();
+
+    Nokia5110_SetCursor2(6,1);
+    if(MotorCal_Save(maps)){
+        Nokia5110_OutString("Saved       ");
+        LaunchPad_RGB(GREEN);
+    } else {
+        Nokia5110_OutString("Flash error ");
+        LaunchPad_RGB(RED);
+    }
+    while(1);
+}
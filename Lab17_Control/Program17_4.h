@@ -0,0 +1 @@
+void Program17_4(void);
@@ -0,0 +1,27 @@
+/*
+ * CRC16.c
+ * Runs on MSP432 and on the PC
+ *
+ * CRC-16/CCITT-FALSE, see CRC16.h.
+ *
+ */
+
+#include <stdint.h>
+#include "../inc/CRC16.h"
+
+// CRC of each 4-bit value, so every byte takes two lookups
+// instead of eight shift-and-XOR steps, for a 32-byte table.
+static const uint16_t NibbleTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t CRC16_Update(uint16_t crc, const uint8_t *data, uint32_t count) {
+    while (count) {
+        crc = (crc << 4) ^ NibbleTable[(crc >> 12) ^ (*data >> 4)];
+        crc = (crc << 4) ^ NibbleTable[(crc >> 12) ^ (*data & 0x0F)];
+        data++;
+        count--;
+    }
+    return crc;
+}
@@ -0,0 +1,27 @@
+/*
+ * CRC16.h
+ * Runs on MSP432 and on the PC
+ *
+ * CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF,
+ * no reflection, no final XOR.  The CRC of "123456789" is 0x29B1.
+ * Plain C with no hardware access, so host tools can link it too.
+ *
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#define CRC16_INIT 0xFFFF
+
+/**
+ * Add bytes to a running CRC.  Start with CRC16_INIT; blocks can be
+ * added one after another by passing the previous result back in.
+ * @param crc CRC so far
+ * @param data pointer to the bytes
+ * @param count number of bytes
+ * @return CRC including the new bytes
+ * @brief  Update a CRC-16/CCITT
+ */
+uint16_t CRC16_Update(uint16_t crc, const uint8_t *data, uint32_t count);
+
+#endif /* CRC16_H_ */
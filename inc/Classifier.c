@@ -5,13 +5,21 @@
 
 // All given
 #define SIDEMIN    100   // smallest side distance to the wall in mm
-#define SIDEMAX    400   // largest side distance to wall in mm
 #define CENTERMIN  100   // min distance to the wall in the front
-#define CENTEROPEN 600   // distance to the wall between open/blocked
-#define IRMIN      50    // min possible reading of IR sensor
-#define IRMAX      800   // max possible reading of IR sensor
 
-scenario_t Classify(int32_t left_mm, int32_t center_mm, int32_t right_mm) {
+// thresholds in use, Classify_SetThresholds changes them
+static int32_t SideMax = CLASSIFY_SIDEMAX;
+static int32_t CenterOpen = CLASSIFY_CENTEROPEN;
+
+void Classify_SetThresholds(int32_t sideMax_mm, int32_t centerOpen_mm) {
+    SideMax = sideMax_mm;
+    CenterOpen = centerOpen_mm;
+}
+
+
+// Reference implementation, an if-chain evaluated top to bottom.
+// Classify must return exactly what this returns for every input.
+scenario_t Classify_IfChain(int32_t left_mm, int32_t center_mm, int32_t right_mm) {
 
     // Check if IR sensor readings are invalid first
     if ((left_mm   < IRMIN) || (left_mm   > IRMAX) ||
@@ -20,15 +28,15 @@ scenario_t Classify(int32_t left_mm, int32_t center_mm, int32_t right_mm) {
         return ClassificationError;
     }
 
-    if (center_mm < CENTEROPEN) {
+    if (center_mm < CenterOpen) {
 
-        if ((left_mm < SIDEMAX) && (right_mm < SIDEMAX)) {
+        if ((left_mm < SideMax) && (right_mm < SideMax)) {
             return Blocked;
         }
-        else if ((left_mm < SIDEMAX) && (right_mm >= SIDEMAX)) {
+        else if ((left_mm < SideMax) && (right_mm >= SideMax)) {
             return RightTurn;
         }
-        else if ((left_mm >= SIDEMAX) && (right_mm < SIDEMAX)) {
+        else if ((left_mm >= SideMax) && (right_mm < SideMax)) {
             return LeftTurn;
         }
         else {
@@ -39,10 +47,10 @@ scenario_t Classify(int32_t left_mm, int32_t center_mm, int32_t right_mm) {
 
     else {
 
-        if ((left_mm < SIDEMAX) && (right_mm < SIDEMAX)) {
+        if ((left_mm < SideMax) && (right_mm < SideMax)) {
             return Straight;
         }
-        else if ((left_mm < SIDEMAX) && (right_mm >= SIDEMAX)) {
+        else if ((left_mm < SideMax) && (right_mm >= SideMax)) {
             return RightJoint;
         }
         else {
@@ -51,3 +59,32 @@ scenario_t Classify(int32_t left_mm, int32_t center_mm, int32_t right_mm) {
     }
 }
 
+
+// Quantize one reading against IRMIN/IRMAX and one threshold
+// 0 = invalid, 1 = below threshold, 2 = at or above threshold
+// Comparisons produce 0 or 1, so there are no branches.
+static uint32_t level(int32_t d_mm, int32_t threshold) {
+    uint32_t valid = (d_mm >= IRMIN) & (d_mm <= IRMAX);
+    return valid + (valid & (d_mm >= threshold));
+}
+
+// scenario for each (left, center, right) level, index = 9*left + 3*center + right
+static const uint8_t ScenarioTable[27] = {
+    // left invalid
+    ClassificationError, ClassificationError, ClassificationError,
+    ClassificationError, ClassificationError, ClassificationError,
+    ClassificationError, ClassificationError, ClassificationError,
+    // left close:  center invalid / blocked / open, each with right invalid / close / open
+    ClassificationError, ClassificationError, ClassificationError,
+    ClassificationError, Blocked,             RightTurn,
+    ClassificationError, Straight,            RightJoint,
+    // left open
+    ClassificationError, ClassificationError, ClassificationError,
+    ClassificationError, LeftTurn,            TeeJoint,
+    ClassificationError, LeftJoint,           LeftJoint
+};
+
+scenario_t Classify(int32_t left_mm, int32_t center_mm, int32_t right_mm) {
+    uint32_t index = 9*level(left_mm, SideMax) + 3*level(center_mm, CenterOpen) + level(right_mm, SideMax);
+    return (scenario_t)ScenarioTable[index];
+}
@@ -15,6 +15,15 @@
  */
 
 
+#ifndef CLASSIFIER_H_
+#define CLASSIFIER_H_
+
+#define IRMIN      50    // min possible reading of IR sensor
+#define IRMAX      800   // max possible reading of IR sensor
+
+#define CLASSIFY_SIDEMAX    400   // default largest side distance to wall in mm
+#define CLASSIFY_CENTEROPEN 600   // default distance to the wall between open/blocked
+
 enum scenario {
     ClassificationError = 0,
     LeftTooClose = 1,
@@ -43,6 +52,34 @@ typedef enum scenario scenario_t;
  * @param right: distance measured in mm by right sensor
  * @return enum value representing the scenario the robot
  * @brief  Calculate the distance in mm given the 14-bit ADC value.
+ * @note   Table driven: each distance is quantized against IRMIN, IRMAX
+ *         and its threshold, and the three levels index a scenario table.
  */
 scenario_t Classify(int32_t left_mm, int32_t center_mm, int32_t right_mm);
 
+/**
+ * <b>Classify_IfChain</b>:<br>
+ * Reference version of Classify written as a nested if-chain.
+ * Returns the same scenario as Classify for every input, and is
+ * kept to verify and benchmark the table-driven version.
+ * @param left: distance measured in mm by left sensor
+ * @param center: distance measured in mm by center sensor
+ * @param right: distance measured in mm by right sensor
+ * @return enum value representing the scenario the robot
+ * @brief  Reference classifier
+ */
+scenario_t Classify_IfChain(int32_t left_mm, int32_t center_mm, int32_t right_mm);
+
+/**
+ * <b>Classify_SetThresholds</b>:<br>
+ * Change the side and center thresholds used by Classify and
+ * Classify_IfChain. The defaults are CLASSIFY_SIDEMAX and CLASSIFY_CENTEROPEN.
+ * @param sideMax_mm: side distances below this are walls
+ * @param centerOpen_mm: center distances at or above this are open
+ * @return none
+ * @brief  Set the classifier thresholds
+ */
+void Classify_SetThresholds(int32_t sideMax_mm, int32_t centerOpen_mm);
+
+#endif /* CLASSIFIER_H_ */
+
@@ -0,0 +1,261 @@
+/*
+ * Console.c
+ * Runs on MSP432
+ *
+ * Line-oriented command console on UART0, see Console.h.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../inc/UART0.h"
+#include "../inc/Console.h"
+
+#define CR   0x0D
+#define LF   0x0A
+#define BS   0x08
+#define DEL  0x7F
+
+static const ConsoleParam_t *Params;
+static uint8_t NumParams;
+static char Line[CONSOLE_LINE_SIZE];
+static uint8_t Length;                  // characters in Line
+static uint8_t Overlong;                // 1 once the line did not fit, until its end
+static uint8_t LastCR;                  // 1 if the last character was CR, for CR LF endings
+
+// 1 if the strings match, ignoring case
+static uint8_t same(const char *a, const char *b) {
+    while (*a && *b) {
+        char ca = (*a >= 'A' && *a <= 'Z') ? *a + 32 : *a;
+        char cb = (*b >= 'A' && *b <= 'Z') ? *b + 32 : *b;
+        if (ca != cb) {
+            return 0;
+        }
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Split off the next word: skip spaces, null-terminate the word and
+// move *p past it.  Returns the word, or 0 at the end of the line.
+static char *word(char **p) {
+    char *start;
+    while (**p == ' ') {
+        (*p)++;
+    }
+    if (**p == 0) {
+        return 0;
+    }
+    start = *p;
+    while (**p && (**p != ' ')) {
+        (*p)++;
+    }
+    if (**p) {
+        **p = 0;
+        (*p)++;
+    }
+    return start;
+}
+
+// Signed decimal, returns 0 if it is not a number or does not fit 32 bits
+static uint8_t number(const char *s, int32_t *n) {
+    uint32_t magnitude = 0;
+    uint32_t limit = 2147483647;
+    uint8_t negative = 0;
+    if ((*s == '-') || (*s == '+')) {
+        negative = (*s == '-');
+        limit += negative;
+        s++;
+    }
+    if (*s == 0) {
+        return 0;
+    }
+    while (*s) {
+        if ((*s < '0') || (*s > '9')) {
+            return 0;
+        }
+        if (magnitude > (limit - (*s - '0')) / 10) {
+            return 0;
+        }
+        magnitude = 10*magnitude + (*s - '0');
+        s++;
+    }
+    *n = negative ? -(int32_t)(magnitude - 1) - 1 : (int32_t)magnitude;
+    return 1;
+}
+
+static int32_t read(const ConsoleParam_t *p) {
+    switch (p->Type) {
+    case CONSOLE_I16:
+        return *(int16_t *)p->Value;
+    case CONSOLE_U16:
+        return *(uint16_t *)p->Value;
+    case CONSOLE_BOOL:
+        return *(bool *)p->Value;
+    default:
+        return *(int32_t *)p->Value;
+    }
+}
+
+// One store, so an ISR reading the parameter sees the old or the new value
+static void write(const ConsoleParam_t *p, int32_t n) {
+    switch (p->Type) {
+    case CONSOLE_I16:
+        *(int16_t *)p->Value = n;
+        break;
+    case CONSOLE_U16:
+        *(uint16_t *)p->Value = n;
+        break;
+    case CONSOLE_BOOL:
+        *(bool *)p->Value = (n != 0);
+        break;
+    default:
+        *(int32_t *)p->Value = n;
+        break;
+    }
+}
+
+static const ConsoleParam_t *find(const char *name) {
+    for (int i = 0; i < NumParams; i++) {
+        if (same(name, Params[i].Name)) {
+            return &Params[i];
+        }
+    }
+    UART0_OutString("unknown parameter ");
+    UART0_OutString(name);
+    UART0_OutString("\r\n");
+    return 0;
+}
+
+// "name = value"
+static void show(const ConsoleParam_t *p) {
+    UART0_OutString(p->Name);
+    UART0_OutString(" = ");
+    UART0_OutSDec(read(p));
+    UART0_OutString("\r\n");
+}
+
+static void prompt(void) {
+    UART0_OutString("> ");
+}
+
+void Console_Init(const ConsoleParam_t *params, uint8_t numParams) {
+    Params = params;
+    NumParams = numParams;
+    Length = 0;
+    Overlong = 0;
+    LastCR = 0;
+    UART0_OutString("\r\nConsole, type help\r\n");
+    prompt();
+}
+
+uint8_t Console_Execute(char *line) {
+    char *command = word(&line);
+    char *name, *value;
+    const ConsoleParam_t *p;
+    int32_t n;
+
+    if (command == 0) {
+        return 0;                       // empty line
+    }
+    if (same(command, "list")) {
+        for (int i = 0; i < NumParams; i++) {
+            UART0_OutString(Params[i].Name);
+            UART0_OutString(" = ");
+            UART0_OutSDec(read(&Params[i]));
+            UART0_OutString(" [");
+            UART0_OutSDec(Params[i].Min);
+            UART0_OutString("..");
+            UART0_OutSDec(Params[i].Max);
+            UART0_OutString("]\r\n");
+        }
+        return 0;
+    }
+    if (same(command, "get")) {
+        name = word(&line);
+        if (name == 0) {
+            UART0_OutString("usage: get <name>\r\n");
+        } else if ((p = find(name)) != 0) {
+            show(p);
+        }
+        return 0;
+    }
+    if (same(command, "set")) {
+        name = word(&line);
+        value = word(&line);
+        if ((name == 0) || (value == 0) || word(&line)) {
+            UART0_OutString("usage: set <name> <value>\r\n");
+            return 0;
+        }
+        if ((p = find(name)) == 0) {
+            return 0;
+        }
+        if (number(value, &n) == 0) {
+            UART0_OutString("not a number: ");
+            UART0_OutString(value);
+            UART0_OutString("\r\n");
+            return 0;
+        }
+        if ((n < p->Min) || (n > p->Max)) {
+            UART0_OutString("out of range ");
+            UART0_OutSDec(p->Min);
+            UART0_OutString("..");
+            UART0_OutSDec(p->Max);
+            UART0_OutString("\r\n");
+            return 0;
+        }
+        write(p, n);
+        if (p->OnSet) {
+            p->OnSet();
+        }
+        show(p);
+        return 1;
+    }
+    if (same(command, "help") || same(command, "?")) {
+        UART0_OutString("list, get <name>, set <name> <value>\r\n");
+        return 0;
+    }
+    UART0_OutString("unknown command ");
+    UART0_OutString(command);
+    UART0_OutString(", type help\r\n");
+    return 0;
+}
+
+uint8_t Console_Poll(void) {
+    uint8_t changed = 0;
+    char c;
+    while (UART0_InCharNonBlock(&c)) {
+        if ((c == LF) && LastCR) {
+            LastCR = 0;                 // second half of CR LF
+            continue;
+        }
+        LastCR = (c == CR);
+        if ((c == CR) || (c == LF)) {
+            UART0_OutString("\r\n");
+            if (Overlong) {
+                UART0_OutString("line too long\r\n");
+            } else {
+                Line[Length] = 0;
+                changed |= Console_Execute(Line);
+            }
+            Length = 0;
+            Overlong = 0;
+            prompt();
+        } else if ((c == BS) || (c == DEL)) {
+            if (Length) {
+                Length--;
+                UART0_OutString("\b \b");
+            }
+        } else if ((c >= ' ') && (c <= '~')) {
+            if (Length < CONSOLE_LINE_SIZE - 1) {
+                Line[Length] = c;
+                Length++;
+                UART0_OutChar(c);       // echo
+            } else {
+                Overlong = 1;
+            }
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,74 @@
+/*
+ * Console.h
+ * Runs on MSP432
+ *
+ * Line-oriented command console on UART0 for tuning parameters while
+ * the controller runs.  A program lists its parameters in a registry;
+ * the console reads and writes them by name.  Commands, one per line:
+ *   list               every parameter with its value and range
+ *   get <name>         one parameter
+ *   set <name> <value> change a parameter, value in decimal
+ *   help               the commands
+ * Backspace and Delete edit the line; characters are echoed.
+ *
+ * Console_Poll takes what UART0 has received and returns at once, so
+ * the main loop can call it each time it wakes up.
+ *
+ */
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdbool.h>
+
+#define CONSOLE_LINE_SIZE   32          // longest command line plus the terminating null
+
+// parameter types
+enum ConsoleType {
+    CONSOLE_I16,                        // int16_t
+    CONSOLE_U16,                        // uint16_t
+    CONSOLE_I32,                        // int32_t
+    CONSOLE_BOOL                        // bool, set with 0 or 1
+};
+
+/**
+ * \brief One parameter the console can get and set.
+ */
+typedef struct {
+    const char *Name;           // name typed in commands
+    void *Value;                // the variable, of type Type
+    uint8_t Type;               // enum ConsoleType
+    int32_t Min;                // smallest value set accepts
+    int32_t Max;                // largest value set accepts
+    void (*OnSet)(void);        // called from Console_Poll after a set, NULL for none
+} ConsoleParam_t;
+
+/**
+ * Use a parameter registry and print the prompt.
+ * @param params the parameters, the array must stay valid
+ * @param numParams number of parameters
+ * @return none
+ * @note   UART0_Init must be called once prior
+ * @brief  Initialize the console
+ */
+void Console_Init(const ConsoleParam_t *params, uint8_t numParams);
+
+/**
+ * Process the characters received since the last call and run each
+ * complete line.  Never waits for input; replies go through the
+ * UART0 transmit FIFO.  Call it from the main loop, not an ISR.
+ * @param none
+ * @return 1 if a parameter was set, 0 otherwise
+ * @brief  Run console commands
+ */
+uint8_t Console_Poll(void);
+
+/**
+ * Run one command line as if it had been typed.
+ * @param line null-terminated command, it may be modified
+ * @return 1 if a parameter was set, 0 otherwise
+ * @brief  Run a console command
+ */
+uint8_t Console_Execute(char *line);
+
+#endif /* CONSOLE_H_ */
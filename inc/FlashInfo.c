@@ -0,0 +1,151 @@
+/*
+ * FlashInfo.c
+ * Runs on MSP432
+ *
+ * Erase and program the flash information memory with the FLCTL
+ * registers, one sector erase and immediate-mode word writes.
+ *
+ */
+
+#include <stdint.h>
+#include "msp.h"
+#include "../inc/FlashInfo.h"
+
+#define INFO_START      0x00200000  // first byte of information memory
+#define INFO_USER_END   0x00201000  // end of bank 0 sector 0, the TLV follows
+#define RECORDS_WORDS   (FLASHINFO_RECORDS_SIZE/4)
+
+#define ERASE_START     0x00000001  // ERASE_CTLSTAT bit0, start erase
+#define ERASE_TYPE_INFO 0x00000004  // ERASE_CTLSTAT bits3-2=01, information memory
+#define ERASE_STATUS    0x00030000  // ERASE_CTLSTAT bits17-16, 11 = complete
+#define ERASE_ADDR_ERR  0x00040000  // ERASE_CTLSTAT bit18, address error
+#define ERASE_CLR_STAT  0x00080000  // ERASE_CTLSTAT bit19, clear status
+#define PRG_ENABLE      0x00000001  // PRG_CTLSTAT bit0, word program enable
+#define PRG_MODE        0x00000002  // PRG_CTLSTAT bit1, 0 = immediate write mode
+#define PRG_STATUS      0x00030000  // PRG_CTLSTAT bits17-16, 00 = idle
+#define IFG_PRG         0x00000008  // IFG bit3, word program done
+#define IFG_ERASE       0x00000020  // IFG bit5, erase done
+#define IFG_PRG_ERR     0x00000200  // IFG bit9, program error
+#define INFO_PROT0      0x00000001  // BANK0_INFO_WEPROT bit0, sector 0 protected
+
+static int inUserSector(uint32_t addr) {
+    return (addr >= INFO_START) && (addr < INFO_USER_END);
+}
+
+int FlashInfo_Erase(uint32_t addr) {
+
+    if(!inUserSector(addr)) {
+        return FLASHINFO_ERROR;
+    }
+
+    FLCTL->BANK0_INFO_WEPROT &= ~INFO_PROT0;    // unprotect sector 0
+    FLCTL->CLRIFG = IFG_ERASE;
+
+    // sector erase of information memory
+    // bit1=0,       sector erase
+    // bits3-2=01,   information memory
+    FLCTL->ERASE_CTLSTAT = ERASE_TYPE_INFO;
+    FLCTL->ERASE_SECTADDR = addr&0x003FF000;
+    FLCTL->ERASE_CTLSTAT = ERASE_TYPE_INFO|ERASE_START;
+
+    while((FLCTL->IFG&IFG_ERASE) == 0);         // wait for the erase to finish
+
+    uint32_t status = FLCTL->ERASE_CTLSTAT;
+    FLCTL->ERASE_CTLSTAT = ERASE_TYPE_INFO|ERASE_CLR_STAT;
+    FLCTL->BANK0_INFO_WEPROT |= INFO_PROT0;     // protect again
+
+    if((status&ERASE_ADDR_ERR) || ((status&ERASE_STATUS) != ERASE_STATUS)) {
+        return FLASHINFO_ERROR;
+    }
+
+    // erase verify, every word must read back erased
+    const uint32_t *word = (const uint32_t *)(addr&0x003FF000);
+    for(int i = 0; i < 1024; i++) {
+        if(word[i] != 0xFFFFFFFF) {
+            return FLASHINFO_ERROR;
+        }
+    }
+    return FLASHINFO_NOERROR;
+}
+
+int FlashInfo_Write(uint32_t addr, const uint32_t *source, uint32_t count) {
+
+    if((addr&3) || !inUserSector(addr) || !inUserSector(addr + 4*count - 1)) {
+        return FLASHINFO_ERROR;
+    }
+
+    FLCTL->BANK0_INFO_WEPROT &= ~INFO_PROT0;    // unprotect sector 0
+    FLCTL->CLRIFG = IFG_PRG|IFG_PRG_ERR;
+
+    // immediate write mode, each 32-bit store programs one word
+    FLCTL->PRG_CTLSTAT = (FLCTL->PRG_CTLSTAT&~PRG_MODE)|PRG_ENABLE;
+
+    int result = FLASHINFO_NOERROR;
+    volatile uint32_t *dest = (volatile uint32_t *)addr;
+    for(int i = 0; i < count; i++) {
+        dest[i] = source[i];
+        while(FLCTL->PRG_CTLSTAT&PRG_STATUS);   // wait until idle again
+        if((FLCTL->IFG&IFG_PRG_ERR) || (dest[i] != source[i])) {
+            result = FLASHINFO_ERROR;
+            break;
+        }
+    }
+
+    FLCTL->PRG_CTLSTAT &= ~PRG_ENABLE;
+    FLCTL->BANK0_INFO_WEPROT |= INFO_PROT0;     // protect again
+    return result;
+}
+
+
+// copy of the record area while the sector is erased
+static uint32_t Records[RECORDS_WORDS];
+
+int FlashInfo_Update(uint32_t addr, const uint32_t *source, uint32_t count) {
+
+    uint32_t first = (addr - FLASHINFO_RECORDS_START)/4;
+    if((addr&3) || (addr < FLASHINFO_RECORDS_START) ||
+       (addr + 4*count > FLASHINFO_RECORDS_START + FLASHINFO_RECORDS_SIZE)) {
+        return FLASHINFO_ERROR;
+    }
+
+    // erased destination, nothing else has to move
+    const uint32_t *dest = (const uint32_t *)addr;
+    int blank = 1;
+    for(int i = 0; i < count; i++) {
+        if(dest[i] != 0xFFFFFFFF) {
+            blank = 0;
+            break;
+        }
+    }
+    if(blank) {
+        return FlashInfo_Write(addr, source, count);
+    }
+
+    // keep the other records, erase, and program the area back
+    const uint32_t *area = (const uint32_t *)FLASHINFO_RECORDS_START;
+    for(int i = 0; i < RECORDS_WORDS; i++) {
+        Records[i] = area[i];
+    }
+    for(int i = 0; i < count; i++) {
+        Records[first + i] = source[i];
+    }
+    if(FlashInfo_Erase(FLASHINFO_RECORDS_START) != FLASHINFO_NOERROR) {
+        return FLASHINFO_ERROR;
+    }
+    // program only the words in use, runs of erased words stay erased
+    int i = 0;
+    while(i < RECORDS_WORDS) {
+        if(Records[i] == 0xFFFFFFFF) {
+            i++;
+            continue;
+        }
+        int start = i;
+        while((i < RECORDS_WORDS) && (Records[i] != 0xFFFFFFFF)) {
+            i++;
+        }
+        if(FlashInfo_Write(FLASHINFO_RECORDS_START + 4*start, &Records[start], i - start) != FLASHINFO_NOERROR) {
+            return FLASHINFO_ERROR;
+        }
+    }
+    return FLASHINFO_NOERROR;
+}
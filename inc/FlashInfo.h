@@ -0,0 +1,63 @@
+/*
+ * FlashInfo.h
+ * Runs on MSP432
+ *
+ * Erase and program the 16 KB flash information memory, used to keep
+ * calibration data across resets and reflashing of the main program.
+ * Bank 0 info sectors are 0x00200000 and 0x00201000 (the TLV, do not use),
+ * bank 1 info sectors are 0x00202000 and 0x00203000 (the BSL, do not use),
+ * so 0x00200000 to 0x00200FFF is the sector free for user data.
+ * Its first bytes are the boot-override mailbox, which does nothing
+ * while erased, so keep user records above 0x00200400.
+ *
+ */
+
+#ifndef FLASHINFO_H_
+#define FLASHINFO_H_
+
+#define FLASHINFO_NOERROR   0
+#define FLASHINFO_ERROR     1
+
+// Calibration records live here, each at its own fixed address,
+// e.g. IRCAL_ADDRESS and MOTORCAL_ADDRESS.
+#define FLASHINFO_RECORDS_START 0x00200400
+#define FLASHINFO_RECORDS_SIZE  0x00000400
+
+
+/**
+ * Erase the 4 KB information memory sector containing an address<br>
+ * Every byte of the sector reads 0xFF afterwards.
+ * @param addr any address inside the sector, 0x00200000 to 0x00200FFF
+ * @return FLASHINFO_NOERROR or FLASHINFO_ERROR
+ * @note  Interrupts keep running, but code must not read the sector meanwhile.
+ * @brief  Erase an information memory sector
+ */
+int FlashInfo_Erase(uint32_t addr);
+
+
+/**
+ * Program 32-bit words into erased information memory
+ * @param addr word-aligned destination, inside an erased sector
+ * @param source words to program
+ * @param count number of words
+ * @return FLASHINFO_NOERROR or FLASHINFO_ERROR
+ * @brief  Program information memory
+ */
+int FlashInfo_Write(uint32_t addr, const uint32_t *source, uint32_t count);
+
+
+/**
+ * Replace one record in the calibration record area, keeping the others<br>
+ * Programs directly if the destination is still erased.  Otherwise the
+ * record area is copied to RAM, the sector erased, and the area
+ * programmed back with the new record in place.
+ * @param addr word-aligned record address inside FLASHINFO_RECORDS_START to FLASHINFO_RECORDS_START+FLASHINFO_RECORDS_SIZE
+ * @param source words to program
+ * @param count number of words
+ * @return FLASHINFO_NOERROR or FLASHINFO_ERROR
+ * @note  Anything in the sector outside the record area is erased.
+ * @brief  Update one calibration record
+ */
+int FlashInfo_Update(uint32_t addr, const uint32_t *source, uint32_t count);
+
+#endif /* FLASHINFO_H_ */
@@ -0,0 +1,157 @@
+/*
+ * Format.c
+ * Runs on MSP432 and on the PC
+ *
+ * Integer to ASCII conversion, see Format.h.
+ *
+ */
+
+#include <stdint.h>
+#include "../inc/Format.h"
+
+// "00" to "99", two digits per table lookup
+static const char DigitPairs[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char HexDigits[16] = "0123456789ABCDEF";
+
+// 10^i, the smallest number with i+1 digits
+static const uint32_t Powers[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// n/100 for every 32-bit n.  1374389535 is 2^37/100 rounded up, and the
+// rounding error stays below 1/100 of a unit for n < 2^32, so the result
+// matches the divide exactly.  The Cortex-M4 does this in one UMULL.
+static uint32_t div100(uint32_t n) {
+    return ((uint64_t)n * 1374389535u) >> 37;
+}
+
+// Number of decimal digits in n, at least 1
+static uint8_t decimalLength(uint32_t n) {
+    uint8_t length = 1;
+    while ((length < 10) && (n >= Powers[length])) {
+        length++;
+    }
+    return length;
+}
+
+// Write the length decimal digits of n right to left, ending just before end
+static void decimal(char *end, uint32_t n) {
+    while (n >= 100) {
+        uint32_t q = div100(n);
+        const char *pair = &DigitPairs[2*(n - 100*q)];
+        end -= 2;
+        end[0] = pair[0];
+        end[1] = pair[1];
+        n = q;
+    }
+    if (n >= 10) {
+        end[-2] = DigitPairs[2*n];
+        end[-1] = DigitPairs[2*n + 1];
+    } else {
+        end[-1] = '0' + n;
+    }
+}
+
+// Write sign and magnitude into buf with the width rules of Format.h
+static uint8_t justify(char *buf, uint32_t n, char sign, uint8_t width, uint8_t fixed) {
+    uint8_t digits = decimalLength(n);
+    uint8_t length = digits + (sign != 0);
+    uint8_t count = 0;
+    if (width > FORMAT_MAX_WIDTH) {
+        width = FORMAT_MAX_WIDTH;
+    }
+    if (fixed && (length > width)) {
+        while (count < width) {
+            buf[count++] = '*';
+        }
+        buf[count] = 0;
+        return count;
+    }
+    while (length < width) {
+        buf[count++] = ' ';
+        width--;
+    }
+    if (sign) {
+        buf[count++] = sign;
+    }
+    count += digits;
+    decimal(&buf[count], n);
+    buf[count] = 0;
+    return count;
+}
+
+// magnitude of a signed number, -2147483648 included
+static uint32_t magnitude(int32_t n) {
+    return (n < 0) ? 0u - (uint32_t)n : (uint32_t)n;
+}
+
+uint8_t Format_UDec(char *buf, uint32_t n, uint8_t width) {
+    return justify(buf, n, 0, width, 0);
+}
+
+uint8_t Format_SDec(char *buf, int32_t n, uint8_t width) {
+    return justify(buf, magnitude(n), (n < 0) ? '-' : 0, width, 0);
+}
+
+uint8_t Format_UDecFixed(char *buf, uint32_t n, uint8_t width) {
+    return justify(buf, n, 0, width, 1);
+}
+
+uint8_t Format_SDecFixed(char *buf, int32_t n, uint8_t width) {
+    return justify(buf, magnitude(n), (n < 0) ? '-' : 0, width, 1);
+}
+
+uint8_t Format_UHex(char *buf, uint32_t n, uint8_t digits) {
+    uint8_t length = 1;
+    while ((length < 8) && (n >> (4*length))) {
+        length++;
+    }
+    if (length < digits) {
+        length = (digits > 8) ? 8 : digits;
+    }
+    buf[length] = 0;
+    for (int i = length - 1; i >= 0; i--) {
+        buf[i] = HexDigits[n & 0x0F];
+        n >>= 4;
+    }
+    return length;
+}
+
+uint8_t Format_UFix(char *buf, uint32_t n, uint8_t decimals) {
+    uint8_t length;
+    uint8_t count = 0;
+    if (decimals < 1) {
+        decimals = 1;
+    }
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    length = decimalLength(n);
+    if (length <= decimals) {
+        // 0.00ddd, the digits of n right-aligned after the point
+        buf[count++] = '0';
+        buf[count++] = '.';
+        while (length < decimals) {
+            buf[count++] = '0';
+            decimals--;
+        }
+        count += length;
+        decimal(&buf[count], n);
+    } else {
+        // digits with the point moved in from the right
+        count = length + 1;
+        decimal(&buf[count], n);
+        for (int i = 0; i < length - decimals; i++) {
+            buf[i] = buf[i + 1];
+        }
+        buf[length - decimals] = '.';
+    }
+    buf[count] = 0;
+    return count;
+}
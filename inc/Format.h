@@ -0,0 +1,82 @@
+/*
+ * Format.h
+ * Runs on MSP432 and on the PC
+ *
+ * Integer to ASCII conversion shared by the UART0 and Nokia5110
+ * drivers.  Each function writes a null-terminated string into a
+ * caller buffer of at least FORMAT_BUFFER_SIZE bytes and returns its
+ * length, so a driver can send the whole number in one write.
+ * Decimal digits are produced two at a time from a table, and the
+ * divide by 100 is a multiply by its reciprocal.
+ *
+ * Width rules:
+ *   minimum width - spaces are added in front, longer numbers are not cut
+ *   fixed width   - exactly width characters, all '*' if the number does not fit
+ *
+ */
+
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+#define FORMAT_MAX_WIDTH    15  // widths above this are treated as 15
+#define FORMAT_BUFFER_SIZE  (FORMAT_MAX_WIDTH + 1)
+
+/**
+ * @param buf receives the string
+ * @param n number to convert
+ * @param width minimum width, 0 for no padding
+ * @return number of characters written, not counting the null
+ * @brief  Unsigned decimal, minimum width
+ */
+uint8_t Format_UDec(char *buf, uint32_t n, uint8_t width);
+
+/**
+ * The sign counts toward the width, e.g. -12 in width 4 is " -12".
+ * @param buf receives the string
+ * @param n number to convert
+ * @param width minimum width, 0 for no padding
+ * @return number of characters written, not counting the null
+ * @brief  Signed decimal, minimum width
+ */
+uint8_t Format_SDec(char *buf, int32_t n, uint8_t width);
+
+/**
+ * @param buf receives the string
+ * @param n number to convert
+ * @param width exact width, 1 to FORMAT_MAX_WIDTH
+ * @return width
+ * @brief  Unsigned decimal, fixed width
+ */
+uint8_t Format_UDecFixed(char *buf, uint32_t n, uint8_t width);
+
+/**
+ * @param buf receives the string
+ * @param n number to convert
+ * @param width exact width including the sign, 1 to FORMAT_MAX_WIDTH
+ * @return width
+ * @brief  Signed decimal, fixed width
+ */
+uint8_t Format_SDecFixed(char *buf, int32_t n, uint8_t width);
+
+/**
+ * Upper case hexadecimal without a prefix, e.g. 0x2A with 4 digits is "002A".
+ * @param buf receives the string
+ * @param n number to convert
+ * @param digits minimum number of digits, padded with '0', 0 or 1 for none
+ * @return number of characters written, not counting the null
+ * @brief  Unsigned hexadecimal
+ */
+uint8_t Format_UHex(char *buf, uint32_t n, uint8_t digits);
+
+/**
+ * Unsigned fixed-point decimal, n is the value times 10^decimals,
+ * e.g. 1234 with 2 decimals is "12.34" and 5 with 2 decimals is "0.05".
+ * @param buf receives the string
+ * @param n value in units of 10^-decimals
+ * @param decimals digits after the point, 1 to 9
+ * @return number of characters written, not counting the null
+ * @brief  Unsigned fixed-point decimal
+ */
+uint8_t Format_UFix(char *buf, uint32_t n, uint8_t decimals);
+
+#endif /* FORMAT_H_ */
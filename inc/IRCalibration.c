@@ -0,0 +1,111 @@
+/*
+ * IRCalibration.c
+ * Runs on MSP432 and on a PC
+ *
+ * Integer least squares fit of d = m/(n-c) + r.
+ *
+ */
+
+#include <stdint.h>
+#include "../inc/IRDistance.h"
+#include "../inc/IRCalibration.h"
+
+// a/b rounded to the nearest integer, b > 0
+static int64_t divRound(int64_t a, int64_t b) {
+    if(a >= 0) {
+        return (a + b/2)/b;
+    }
+    return -((-a + b/2)/b);
+}
+
+// 1 if no reading is saturated and the readings fall as the distance grows.
+// A reading in the sensor's fold-back region, closer than its peak, breaks
+// the order with the readings taken farther away.
+static uint8_t monotonic(const uint32_t adc[], const int32_t dist_mm[], uint32_t count) {
+    uint8_t order[IRCAL_MAX_POINTS];
+
+    // insertion sort of the indexes by distance
+    for(int i = 0; i < count; i++) {
+        if(adc[i] >= IRCAL_ADC_SATURATED) {
+            return 0;
+        }
+        int j = i;
+        while((j > 0) && (dist_mm[order[j-1]] > dist_mm[i])) {
+            order[j] = order[j-1];
+            j--;
+        }
+        order[j] = i;
+    }
+    for(int i = 1; i < count; i++) {
+        int32_t nearer = dist_mm[order[i-1]], farther = dist_mm[order[i]];
+        if((farther > nearer) && (adc[order[i]] >= adc[order[i-1]])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint8_t IRCal_Fit(const uint32_t adc[], const int32_t dist_mm[], uint32_t count, IRCoeff_t *coeff) {
+
+    if((count < 3) || (count > IRCAL_MAX_POINTS)) {
+        return 0;
+    }
+    if(!monotonic(adc, dist_mm, count)) {
+        return 0;
+    }
+    int64_t k = count;
+
+    // shift every variable by its truncated mean to keep the products small
+    int64_t sumD = 0, sumN = 0, sumY = 0;
+    for(int i = 0; i < count; i++) {
+        sumD = sumD + dist_mm[i];
+        sumN = sumN + adc[i];
+        sumY = sumY + (int64_t)dist_mm[i]*adc[i];
+    }
+    int64_t d0 = sumD/k, n0 = sumN/k, y0 = sumY/k;
+
+    int64_t sa = 0, sb = 0, se = 0;                 // sums of the shifted variables
+    int64_t saa = 0, sbb = 0, sab = 0, sea = 0, seb = 0;
+    for(int i = 0; i < count; i++) {
+        int64_t a = dist_mm[i] - d0;
+        int64_t b = (int64_t)adc[i] - n0;
+        int64_t e = (int64_t)dist_mm[i]*adc[i] - y0;
+        sa = sa + a;  sb = sb + b;  se = se + e;
+        saa = saa + a*a;  sbb = sbb + b*b;  sab = sab + a*b;
+        sea = sea + e*a;  seb = seb + e*b;
+    }
+
+    // centered sums, S(x,z) = sum(x*z) - sum(x)*sum(z)/k
+    int64_t sdd = saa - divRound(sa*sa, k);
+    int64_t snn = sbb - divRound(sb*sb, k);
+    int64_t sdn = sab - divRound(sa*sb, k);
+    int64_t syd = sea - divRound(se*sa, k);
+    int64_t syn = seb - divRound(se*sb, k);
+
+    // y' = c*d' + r*n', solved by Cramer's rule
+    int64_t det = sdd*snn - sdn*sdn;
+    if(det <= 0) {
+        return 0;                   // all readings at one distance or one ADC value
+    }
+    int64_t c = divRound(syd*snn - syn*sdn, det);
+    int64_t r = divRound(syn*sdd - syd*sdn, det);
+
+    // intercept m-r*c from the means, then m
+    int64_t m = divRound(sumY - c*sumD - r*sumN, k) + r*c;
+    if((m <= 0) || (r >= MAX_DIST)) {
+        return 0;
+    }
+
+    // smallest n with m/(n-c)+r <= MAX_DIST
+    int64_t span = MAX_DIST - r;
+    int64_t adcMax = c + (m + span - 1)/span;
+    if((adcMax <= c) || (adcMax > 16383) || (m > INT32_MAX) || (c < INT32_MIN)) {
+        return 0;
+    }
+
+    coeff->AdcMax = adcMax;
+    coeff->Slope = m;
+    coeff->Offset = c;
+    coeff->DistOffset = r;
+    return 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * IRCalibration.h
+ * Runs on MSP432 and on a PC
+ *
+ * Fits the GP2Y0A21YK0F calibration formula d = m/(n-c) + r to
+ * filtered ADC readings taken at known wall distances.
+ * Uses only integer arithmetic and no hardware, so the same code
+ * runs in the on-robot calibration program and in PC unit tests.
+ *
+ */
+
+#ifndef IRCALIBRATION_H_
+#define IRCALIBRATION_H_
+
+#define IRCAL_MAX_POINTS    16      // most readings one fit accepts
+#define IRCAL_ADC_SATURATED 16000   // readings this high are clipped by the sensor or the ADC
+
+
+/**
+ * Fit m, c and r of one sensor with integer least squares<br>
+ * d = m/(n-c) + r is rewritten as d*n = (m-r*c) + c*d + r*n, which is
+ * linear in (m-r*c, c, r), and solved from the centered normal equations.
+ * AdcMax is then set to the ADC value that reads MAX_DIST.
+ * @param adc filtered 14-bit ADC readings, n
+ * @param dist_mm measured distance from the robot center to the wall for each reading, d
+ * @param count number of readings, 3 to IRCAL_MAX_POINTS
+ * @param coeff pointer to store the fitted coefficients
+ * @return 1 if the fit succeeded, 0 if there were too few or degenerate readings,
+ * a reading was IRCAL_ADC_SATURATED or more, or the readings did not fall as the
+ * distance grew
+ * @note  Readings should span the useful range, for example 200 to 800 mm.
+ * Closer than that the sensor saturates and then folds back, so one distance
+ * can give the same reading as another.
+ * @brief  Fit IR calibration coefficients
+ */
+uint8_t IRCal_Fit(const uint32_t adc[], const int32_t dist_mm[], uint32_t count, IRCoeff_t *coeff);
+
+#endif /* IRCALIBRATION_H_ */
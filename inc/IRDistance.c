@@ -49,15 +49,177 @@ policies, either expressed or implied, of the FreeBSD Project.
 
 #include <stdint.h>
 #include "msp.h"
+#include "../inc/IRDistance.h"
 
-#define MAX_DIST            800         // Max distance in mm.
-
+// Default coefficients, used until IRDistance_Init loads a calibration
 // Update the following coefficients for Lab 15
 #define ADCMAX_LEFT         1945    // Maximum IR ADC value
 #define IRSLOPE_LEFT        1117486  // Calibration coefficient, m
 #define IROFFSET_LEFT       413   // Calibration coefficient, c
 #define DIST_OFFSET_LEFT    70  // Distance from common spot on robot to IR sensor, r
 
+// Update the following coefficients for Lab 15
+// Ensure ADCMAX must be greater than IROFFSET
+#define ADCMAX_CENTER         1883  // Maximum IR ADC value
+#define IRSLOPE_CENTER        1166937   // Calibration coefficient, m
+#define IROFFSET_CENTER       284  // Calibration coefficient, c
+#define DIST_OFFSET_CENTER    70   // Distance from common spot on robot to IR sensor.
+
+// Update the following coefficients for Lab 15
+// Ensure ADCMAX must be greater than IROFFSET
+#define ADCMAX_RIGHT        2084   // Maximum IR ADC value
+#define IRSLOPE_RIGHT       1104642    // Calibration coefficient, m
+#define IROFFSET_RIGHT      570     // Calibration coefficient, c
+#define DIST_OFFSET_RIGHT   70     // Distance from common spot on robot to IR sensor.
+
+
+//************** Division-free conversion **************
+// d = m/(n-c) + r is sampled every IRLUT_STEP ADC codes starting at ADCMAX,
+// and the converters interpolate linearly between two table entries.
+// The compiler evaluates every entry from the coefficients above,
+// so changing a coefficient regenerates the table on the next build.
+// Entries are distance*16 (4 fraction bits), which keeps the
+// interpolation error below 1 mm over the whole 14-bit range.
+
+#define ADC_FULL_SCALE  16383   // largest 14-bit ADC value
+#define IRLUT_SHIFT     6       // log2(IRLUT_STEP)
+#define IRLUT_STEP      (1<<IRLUT_SHIFT)  // ADC codes between table entries
+#define IRLUT_FRAC      4       // fraction bits in each entry
+#define IRLUT_SIZE      257     // enough entries for any ADCMAX >= 0
+
+// table entry i for one sensor, n = ADCMAX + i*IRLUT_STEP
+#define IRLUT(S,i)   (uint16_t)(((IRSLOPE_##S<<IRLUT_FRAC)/(ADCMAX_##S+(i)*IRLUT_STEP-IROFFSET_##S)) \
+                              + (DIST_OFFSET_##S<<IRLUT_FRAC))
+#define IRLUT4(S,i)   IRLUT(S,i), IRLUT(S,(i)+1), IRLUT(S,(i)+2), IRLUT(S,(i)+3)
+#define IRLUT16(S,i)  IRLUT4(S,i), IRLUT4(S,(i)+4), IRLUT4(S,(i)+8), IRLUT4(S,(i)+12)
+#define IRLUT64(S,i)  IRLUT16(S,i), IRLUT16(S,(i)+16), IRLUT16(S,(i)+32), IRLUT16(S,(i)+48)
+#define IRLUT257(S)   IRLUT64(S,0), IRLUT64(S,64), IRLUT64(S,128), IRLUT64(S,192), IRLUT(S,256)
+
+static const uint16_t LeftTable[IRLUT_SIZE] = { IRLUT257(LEFT) };
+static const uint16_t CenterTable[IRLUT_SIZE] = { IRLUT257(CENTER) };
+static const uint16_t RightTable[IRLUT_SIZE] = { IRLUT257(RIGHT) };
+
+// coefficients and table each converter uses, indexed by enum IRSensor
+static IRCoeff_t Coeff[IR_NUM_SENSORS] = {
+    {ADCMAX_LEFT,   IRSLOPE_LEFT,   IROFFSET_LEFT,   DIST_OFFSET_LEFT},
+    {ADCMAX_CENTER, IRSLOPE_CENTER, IROFFSET_CENTER, DIST_OFFSET_CENTER},
+    {ADCMAX_RIGHT,  IRSLOPE_RIGHT,  IROFFSET_RIGHT,  DIST_OFFSET_RIGHT}
+};
+static const uint16_t *Table[IR_NUM_SENSORS] = {LeftTable, CenterTable, RightTable};
+static uint16_t CalTable[IR_NUM_SENSORS][IRLUT_SIZE];  // tables built from run-time coefficients
+
+
+// interpolate between the two table entries around adc_value
+// Input: adc_value >= adcMax, adcMax is the ADC value of table[0]
+// Output: distance in mm
+static int32_t tableConvert(const uint16_t table[], uint32_t adcMax, uint32_t adc_value) {
+    if(adc_value > ADC_FULL_SCALE) {
+        adc_value = ADC_FULL_SCALE;
+    }
+    uint32_t x = adc_value - adcMax;
+    uint32_t i = x>>IRLUT_SHIFT;            // segment
+    uint32_t frac = x&(IRLUT_STEP-1);       // position within the segment
+    uint32_t y0 = table[i];
+    uint32_t y1 = table[i+1];               // y1 <= y0, distance falls as n rises
+    return ((y0<<IRLUT_SHIFT) - (y0-y1)*frac)>>(IRLUT_SHIFT+IRLUT_FRAC);
+}
+
+
+//************** Run-time calibration **************
+
+// table entry i from run-time coefficients, same value the IRLUT macro computes
+// returns -1 if the entry does not fit the uint16_t table format
+static int32_t tableEntry(const IRCoeff_t *coeff, int32_t i) {
+    int64_t n = coeff->AdcMax + i*IRLUT_STEP - coeff->Offset;
+    int64_t entry = (((int64_t)coeff->Slope<<IRLUT_FRAC)/n) + ((int64_t)coeff->DistOffset<<IRLUT_FRAC);
+    if((entry < 0) || (entry > 0xFFFF)) {
+        return -1;
+    }
+    return entry;
+}
+
+// 1 if every table entry of these coefficients is usable
+static uint8_t checkCoefficients(const IRCoeff_t *coeff) {
+    if((coeff->Slope <= 0) || (coeff->AdcMax <= coeff->Offset) ||
+       (coeff->AdcMax > ADC_FULL_SCALE)) {
+        return 0;
+    }
+    for(int i = 0; i < IRLUT_SIZE; i++) {
+        if(tableEntry(coeff, i) < 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// rebuild the RAM table of one sensor and switch its converter to it
+static void loadCoefficients(enum IRSensor sensor, const IRCoeff_t *coeff) {
+    for(int i = 0; i < IRLUT_SIZE; i++) {
+        CalTable[sensor][i] = tableEntry(coeff, i);
+    }
+    Table[sensor] = CalTable[sensor];
+    Coeff[sensor] = *coeff;
+}
+
+
+uint8_t IRDistance_SetCoefficients(enum IRSensor sensor, const IRCoeff_t *coeff) {
+    if((sensor >= IR_NUM_SENSORS) || !checkCoefficients(coeff)) {
+        return 0;
+    }
+    loadCoefficients(sensor, coeff);
+    return 1;
+}
+
+
+void IRDistance_GetCoefficients(enum IRSensor sensor, IRCoeff_t *coeff) {
+    *coeff = Coeff[sensor];
+}
+
+
+// sum of every word before the checksum, complemented so an erased record fails
+static uint32_t checksum(const IRCalRecord_t *record) {
+    const uint32_t *word = (const uint32_t *)record;
+    uint32_t sum = 0;
+    for(int i = 0; i < (sizeof(IRCalRecord_t)/4)-1; i++) {
+        sum = sum + word[i];
+    }
+    return ~sum;
+}
+
+
+void IRDistance_MakeRecord(IRCalRecord_t *record, const IRCoeff_t coeff[IR_NUM_SENSORS]) {
+    record->Magic = IRCAL_MAGIC;
+    for(int i = 0; i < IR_NUM_SENSORS; i++) {
+        record->Coeff[i] = coeff[i];
+    }
+    record->Checksum = checksum(record);
+}
+
+
+uint8_t IRDistance_CheckRecord(const IRCalRecord_t *record) {
+    return (record->Magic == IRCAL_MAGIC) && (record->Checksum == checksum(record));
+}
+
+
+uint8_t IRDistance_Init(void) {
+
+    const IRCalRecord_t *record = (const IRCalRecord_t *)IRCAL_ADDRESS;
+    if(!IRDistance_CheckRecord(record)) {
+        return 0;                       // erased or corrupt, keep the defaults
+    }
+
+    // load all three or none, so the sensors never mix two calibrations
+    for(int i = 0; i < IR_NUM_SENSORS; i++) {
+        if(!checkCoefficients(&record->Coeff[i])) {
+            return 0;
+        }
+    }
+    for(int i = 0; i < IR_NUM_SENSORS; i++) {
+        loadCoefficients((enum IRSensor)i, &record->Coeff[i]);
+    }
+    return 1;
+}
+
 
 // LeftConvert
 // Calculate the distance in mm given the 14-bit ADC value
@@ -69,24 +231,16 @@ policies, either expressed or implied, of the FreeBSD Project.
 // Output: Distance in mm
 
 //comments here apply to all convert functions
-uint16_t LeftConvert(uint32_t adc_value){        // returns left distance in mm
-    // write this for Lab 15
-    if (adc_value < ADCMAX_LEFT) {              //larger ADC values are actually closer, and vice-versa, so this appears counterintuitive but its correct
+int32_t LeftConvert(uint32_t adc_value){        // returns left distance in mm
+    if (adc_value < Coeff[IR_LEFT].AdcMax) {              //larger ADC values are actually closer, and vice-versa, so this appears counterintuitive but its correct
         return MAX_DIST;
     }
-    else {                                      //if ADC value is valid, return distance via calculation
-        return (IRSLOPE_LEFT/(adc_value - IROFFSET_LEFT)) + DIST_OFFSET_LEFT;
+    else {                                      //if ADC value is valid, return distance via table lookup
+        return tableConvert(Table[IR_LEFT], Coeff[IR_LEFT].AdcMax, adc_value);
     }
 }
 
 
-// Update the following coefficients for Lab 15
-// Ensure ADCMAX must be greater than IROFFSET
-#define ADCMAX_CENTER         1883  // Maximum IR ADC value
-#define IRSLOPE_CENTER        1166937   // Calibration coefficient, m
-#define IROFFSET_CENTER       284  // Calibration coefficient, c
-#define DIST_OFFSET_CENTER    70   // Distance from common spot on robot to IR sensor.
-
 // CenterConvert
 // Calculate the distance in mm given the 14-bit ADC value
 // d = m/(n-c) + r, where n is the adc_value
@@ -95,23 +249,16 @@ uint16_t LeftConvert(uint32_t adc_value){        // returns left distance in mm
 // your function should return MAX_DIST
 // Input adc_value: 14-bit ADC data
 // Output: Distance in mm
-uint16_t CenterConvert(uint32_t adc_value){   // returns center distance in mm
-    if (adc_value < ADCMAX_CENTER) {
+int32_t CenterConvert(uint32_t adc_value){   // returns center distance in mm
+    if (adc_value < Coeff[IR_CENTER].AdcMax) {
         return MAX_DIST;
     }
     else {
-        return (IRSLOPE_CENTER/(adc_value - IROFFSET_CENTER)) + DIST_OFFSET_CENTER;
+        return tableConvert(Table[IR_CENTER], Coeff[IR_CENTER].AdcMax, adc_value);
     }
 }
 
 
-// Update the following coefficients for Lab 15
-// Ensure ADCMAX must be greater than IROFFSET
-#define ADCMAX_RIGHT        2084   // Maximum IR ADC value
-#define IRSLOPE_RIGHT       1104642    // Calibration coefficient, m
-#define IROFFSET_RIGHT      570     // Calibration coefficient, c
-#define DIST_OFFSET_RIGHT   70     // Distance from common spot on robot to IR sensor.
-
 // RightConvert
 // Calculate the distance in mm given the 14-bit ADC value
 // d = m/(n-c) + r, where n is the adc_value
@@ -120,12 +267,11 @@ uint16_t CenterConvert(uint32_t adc_value){   // returns center distance in mm
 // your function should return MAX_DIST
 // Input adc_value: 14-bit ADC data
 // Output: Distance in mm
-uint16_t RightConvert(uint32_t adc_value){      // returns right distance in mm
-    if (adc_value < ADCMAX_RIGHT) {
+int32_t RightConvert(uint32_t adc_value){      // returns right distance in mm
+    if (adc_value < Coeff[IR_RIGHT].AdcMax) {
         return MAX_DIST;
     }
     else {
-        return (IRSLOPE_RIGHT/(adc_value - IROFFSET_RIGHT)) + DIST_OFFSET_RIGHT;
+        return tableConvert(Table[IR_RIGHT], Coeff[IR_RIGHT].AdcMax, adc_value);
     }
 }
-
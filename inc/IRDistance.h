@@ -3,7 +3,9 @@
  * @brief     Take infrared distance measurements
  * @details   Provide mid-level functions that convert raw ADC
  * values from the GP2Y0A21YK0F infrared distance sensors to
- * distances in mm.
+ * distances in mm. The formula is evaluated through a table the
+ * compiler builds from the calibration coefficients, so a conversion
+ * uses no division.
  * @version   TI-RSLK MAX v1.1
  * @author    Daniel Valvano and Jonathan Valvano
  * @copyright Copyright 2019 by Jonathan W. Valvano, valvano@mail.utexas.edu,
@@ -68,6 +70,95 @@ policies, either expressed or implied, of the FreeBSD Project.
 #ifndef IRDISTANCE_H_
 #define IRDISTANCE_H_
 
+#define MAX_DIST        800         // Max distance in mm.
+
+// Calibration record location in flash information memory (bank 0, sector 0,
+// above the boot-override mailbox)
+#define IRCAL_ADDRESS   0x00200400
+#define IRCAL_MAGIC     0x49524341  // "IRCA", marks a programmed record
+
+
+/**
+ * \brief Identifies one of the three IR distance sensors.
+ */
+enum IRSensor {
+  IR_LEFT,      // P9.1/A16
+  IR_CENTER,    // P6.1/A14
+  IR_RIGHT,     // P9.0/A17
+  IR_NUM_SENSORS
+};
+
+
+/**
+ * \brief Calibration coefficients of one sensor, d = m/(n-c) + r.
+ */
+typedef struct {
+    int32_t AdcMax;         // ADC value at MAX_DIST, smaller values return MAX_DIST
+    int32_t Slope;          // m
+    int32_t Offset;         // c, must be less than AdcMax
+    int32_t DistOffset;     // r, distance from the robot center to the sensor in mm
+} IRCoeff_t;
+
+
+/**
+ * \brief Calibration record for all three sensors as stored in flash.
+ */
+typedef struct {
+    uint32_t Magic;                     // IRCAL_MAGIC
+    IRCoeff_t Coeff[IR_NUM_SENSORS];    // indexed by enum IRSensor
+    uint32_t Checksum;                  // see IRDistance_MakeRecord
+} IRCalRecord_t;
+
+
+/**
+ * Load calibration coefficients from flash<br>
+ * If a valid record is stored at IRCAL_ADDRESS, the converters
+ * use it from now on, otherwise they keep the compiled-in coefficients.
+ * @param none
+ * @return 1 if the stored calibration was loaded, 0 if not
+ * @note  Call once at boot, before the first conversion.
+ * @brief  Load IR calibration from flash
+ */
+uint8_t IRDistance_Init(void);
+
+/**
+ * Replace the calibration coefficients of one sensor<br>
+ * Rebuilds the conversion table of that sensor in RAM.
+ * @param sensor IR_LEFT, IR_CENTER or IR_RIGHT
+ * @param coeff new coefficients
+ * @return 1 if accepted, 0 if the coefficients are unusable and were ignored
+ * @brief  Set IR calibration coefficients
+ */
+uint8_t IRDistance_SetCoefficients(enum IRSensor sensor, const IRCoeff_t *coeff);
+
+/**
+ * Read the calibration coefficients one sensor currently uses
+ * @param sensor IR_LEFT, IR_CENTER or IR_RIGHT
+ * @param coeff pointer to store the coefficients
+ * @return none
+ * @brief  Get IR calibration coefficients
+ */
+void IRDistance_GetCoefficients(enum IRSensor sensor, IRCoeff_t *coeff);
+
+/**
+ * Fill a calibration record ready to be written to flash<br>
+ * Sets the magic number and the checksum.
+ * @param record pointer to the record to fill
+ * @param coeff coefficients of the three sensors, indexed by enum IRSensor
+ * @return none
+ * @brief  Build an IR calibration record
+ */
+void IRDistance_MakeRecord(IRCalRecord_t *record, const IRCoeff_t coeff[IR_NUM_SENSORS]);
+
+/**
+ * Check the magic number and checksum of a calibration record
+ * @param record pointer to the record
+ * @return 1 if valid, 0 if not
+ * @brief  Validate an IR calibration record
+ */
+uint8_t IRDistance_CheckRecord(const IRCalRecord_t *record);
+
+
 
 /**
  * Convert ADC sample into distance for the GP2Y0A21YK0F
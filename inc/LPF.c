@@ -1,6 +1,6 @@
 // LPF.c
 // Runs on MSP432
-// implements three FIR low-pass filters
+// implements FIR low-pass filters
 
 // Jonathan Valvano
 // September 12, 2017
@@ -41,183 +41,343 @@ policies, either expressed or implied, of the FreeBSD Project.
 
 #include <stdint.h>
 #include "msp.h"
+#include "../inc/LPF.h"
 
-// Newton's method
+// bit-by-bit integer square root, no divides
 // s is an integer
-// isqrt(s) is an integer
-static uint32_t isqrt(uint32_t s)  {
-    uint32_t t = s/10+1;            // initial guess
-    for(int n = 16; n; --n) {   // guaranteed to finish
-        t = ((t*t + s)/t)/2;
+// isqrt(s) is floor(sqrt(s))
+static uint32_t isqrt(uint32_t s) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL<<30;         // highest power of four in 32 bits
+    while(bit > s) {
+        bit = bit>>2;
     }
-    return t;
+    while(bit) {                    // at most 16 iterations
+        if(s >= root+bit) {
+            s = s-(root+bit);
+            root = (root>>1)+bit;
+        } else {
+            root = root>>1;
+        }
+        bit = bit>>2;
+    }
+    return root;
 }
 
-#define MAX_FILTER_SIZE 512
+// returns log2(size) if size is a power of two, LPF_NO_SHIFT otherwise
+static uint8_t log2exact(uint32_t size) {
+    if((size & (size-1)) != 0) {
+        return LPF_NO_SHIFT;
+    }
+    uint8_t shift = 0;
+    while(size > 1) {
+        size = size>>1;
+        shift++;
+    }
+    return shift;
+}
 
 //************** Digital Low Pass Filter **************
 
-uint32_t FilterSize;        // Size-point average, Size = 1 to 512
-uint32_t Queue1[MAX_FILTER_SIZE * 2]; // two copies of multiple access circular queue (MACQ)
-uint32_t *Pt1;               // pointer to the current position of MACQ
-uint32_t I1;                // index to oldest
-uint32_t LPFSum1;            // sum of the last Size samples
+void LPF_InitFilter(LPF_t *filter, LPFSample_t *queue, uint32_t initialValue, uint32_t filterSize) {
 
-void LPF_Init(uint32_t initialValue, uint32_t filterSize) {
+    if(filterSize > MAX_FILTER_SIZE) { filterSize = MAX_FILTER_SIZE; } // max
+    if(filterSize < 1) { filterSize = 1; }                              // min
 
-    FilterSize = (filterSize > MAX_FILTER_SIZE)? MAX_FILTER_SIZE : filterSize; // max
+    filter->Mode = LPF_FIR;
+    filter->PreFilter = 0;
+    filter->Queue = queue;
+    filter->Size = filterSize;
+    filter->Shift = log2exact(filterSize);
+    filter->Sum = filterSize*initialValue;  // prime MACQ with initial data
+    filter->SumSq = (uint64_t)filterSize*initialValue*initialValue;
 
-    I1 = FilterSize-1;
-    LPFSum1 = FilterSize*initialValue;  // prime MACQ with initial data
-    for(int i = 0; i < 2*FilterSize; i++) {
-        Queue1[i] = initialValue;
+#if LPF_COMPACT
+    uint32_t capacity = 1;
+    while(capacity < filterSize) {
+        capacity = capacity<<1;
+    }
+    filter->Mask = capacity-1;
+    filter->Index = 0;
+#else
+    uint32_t capacity = filterSize;
+    filter->Index = filterSize-1;
+#endif
+    for(int i = 0; i < capacity; i++) {
+        queue[i] = initialValue;
     }
 }
 
 
-// calculate one filter output, called at sampling rate
-// Input: new ADC data   Output: filter output
-// y(n) = (x(n)+x(n-1)+...+x(n-FilterSize-1)/FilterSize
-uint32_t LPF_Calc(uint32_t newdata) {
-    if(I1 == 0) {
-        I1 = FilterSize-1;              // wrap
-    } else {
-        I1--;                     // make room for data
-    }
-    LPFSum1 = LPFSum1 + newdata - Queue1[I1];   // subtract oldest, add newest
-    Queue1[I1] = newdata;     // save new data
-    return LPFSum1/FilterSize;
+void LPF_InitIIRFilter(LPF_t *filter, uint32_t initialValue, uint32_t order, uint32_t shift) {
+
+    if(shift > MAX_IIR_SHIFT) { shift = MAX_IIR_SHIFT; } // max
+    if(shift < 1) { shift = 1; }                         // min
+
+    filter->Mode = (order >= 2)? LPF_IIR2 : LPF_IIR1;
+    filter->PreFilter = 0;
+    filter->Queue = 0;          // no sample history
+    filter->Size = 1;           // so the variance reads 0
+    filter->Shift = shift;
+    filter->Sum = initialValue<<shift;
+    filter->Stage2 = initialValue<<shift;
+    filter->SumSq = 0;
 }
 
 
-// calculate noise as standard deviation, called every time buffer refills
-// Input: none   Output: standard deviation
-int32_t Noise(void) {
+//************** Streaming Median Filter **************
 
-    if(FilterSize < 2) { return 0; }
+void LPF_InitMedianFilter(LPFMedian_t *median, int32_t initialValue, uint32_t size) {
 
-    int32_t sum = 0;
-    for(int i = 0; i < FilterSize; i++) {
-        sum = sum + Queue1[i];
+    if(size > MAX_MEDIAN_SIZE) { size = MAX_MEDIAN_SIZE; } // max
+    if((size & 1) == 0) { size++; }                        // odd, 0 becomes 1
+
+    median->Size = size;
+    median->Index = 0;
+    for(int i = 0; i < size; i++) {
+        median->History[i] = initialValue;
+        median->Sorted[i] = initialValue;
     }
+}
 
-    int32_t mean = sum/FilterSize; // DC component
 
-    sum = 0;
-    for(int i = 0; i < FilterSize; i++) {
-        sum = sum + (Queue1[i]-mean)*(Queue1[i]-mean); // total energy in AC part
+// calculate one median output, called at sampling rate
+// Input: new ADC data   Output: median of the last Size samples
+// rolling insertion: the new sample takes the slot of the oldest one
+// and slides left or right until Sorted is in order again
+int32_t LPF_CalcMedianFilter(LPFMedian_t *median, int32_t newdata) {
+
+    int32_t oldest = median->History[median->Index];
+    median->History[median->Index] = newdata;
+    median->Index++;
+    if(median->Index == median->Size) {
+        median->Index = 0;          // wrap
+    }
+
+    uint32_t i = 0;
+    while(median->Sorted[i] != oldest) {
+        i++;                        // oldest is always in Sorted
+    }
+    while((i > 0) && (median->Sorted[i-1] > newdata)) {
+        median->Sorted[i] = median->Sorted[i-1];
+        i--;
+    }
+    while((i < median->Size-1) && (median->Sorted[i+1] < newdata)) {
+        median->Sorted[i] = median->Sorted[i+1];
+        i++;
     }
+    median->Sorted[i] = newdata;
 
-    return isqrt(sum/(FilterSize-1));
+    return median->Sorted[median->Size>>1];
 }
 
 
+void LPF_SetMedianFilter(LPF_t *filter, LPFMedian_t *median) {
+    filter->PreFilter = median;
+}
 
-uint32_t Queue2[MAX_FILTER_SIZE * 2];   // two copies of MACQ
-uint32_t *Pt2;       // pointer to current
-uint32_t LPFSum2;    // sum of the last FilterSize samples
 
-void LPF_Init2(uint32_t initialValue, uint32_t filterSize) {
+// 3-wide median of the last three calls, used without LPF_t
+int32_t Median(int32_t newdata) {
+    static int32_t x1, x2;          // previous two samples
+    int32_t result;
+    if(newdata > x1) {
+        if(x1 > x2) {
+            result = x1;            // x2 < x1 < newdata
+        } else {
+            result = (newdata > x2)? x2 : newdata;
+        }
+    } else {
+        if(x1 < x2) {
+            result = x1;            // newdata <= x1 < x2
+        } else {
+            result = (newdata > x2)? newdata : x2;
+        }
+    }
+    x2 = x1;
+    x1 = newdata;
+    return result;
+}
 
-    FilterSize = (filterSize > MAX_FILTER_SIZE)? MAX_FILTER_SIZE : filterSize;
 
-    Pt2 = &Queue2[0];
+// one IIR stage, state is kept times 2^k so no fraction is lost
+// y(n) = y(n-1) + (x(n)-y(n-1))/2^k
+static uint32_t iirStage(uint32_t *state, uint32_t newdata, uint8_t k) {
+    *state = *state + newdata - (*state>>k);
+    return *state>>k;
+}
+
 
-    LPFSum2 = FilterSize*initialValue; // prime MACQ with initialValue data
+// calculate one filter output, called at sampling rate
+// Input: new ADC data   Output: filter output
+// FIR: y(n) = (x(n)+x(n-1)+...+x(n-Size-1)/Size
+uint32_t LPF_CalcFilter(LPF_t *filter, uint32_t newdata) {
+    if(filter->PreFilter) {
+        newdata = LPF_CalcMedianFilter(filter->PreFilter, newdata);
+    }
+    if(filter->Mode != LPF_FIR) {
+        uint32_t y = iirStage(&filter->Sum, newdata, filter->Shift);
+        if(filter->Mode == LPF_IIR2) {
+            y = iirStage(&filter->Stage2, y, filter->Shift);
+        }
+        return y;
+    }
 
-    for(int i = 0; i < 2*FilterSize; i++) {
-        Queue2[i] = initialValue;
+    uint32_t i = filter->Index;
+#if LPF_COMPACT
+    // the sample Size steps behind the write index leaves the window
+    uint32_t oldest = filter->Queue[(i-filter->Size) & filter->Mask];
+    filter->Queue[i] = newdata;   // save new data
+    filter->Index = (i+1) & filter->Mask;
+#else
+    if(i == 0) {
+        i = filter->Size-1;       // wrap
+    } else {
+        i--;                      // make room for data
+    }
+    uint32_t oldest = filter->Queue[i];
+    filter->Queue[i] = newdata;   // save new data
+    filter->Index = i;
+#endif
+    filter->Sum = filter->Sum + newdata - oldest;   // subtract oldest, add newest
+    filter->SumSq = filter->SumSq + (uint64_t)newdata*newdata - (uint64_t)oldest*oldest;
+    if(filter->Shift != LPF_NO_SHIFT) {
+        return filter->Sum>>filter->Shift;  // power-of-two size, no divide
     }
+    return filter->Sum/filter->Size;
 }
 
 
-// calculate one filter output, called at sampling rate
-// Input: new ADC data   Output: filter output, DAC data
-// y(n) = (Queue(n)+Queue(n-1)+...+x(n-FilterSize-1)/FilterSize
-uint32_t LPF_Calc2(uint32_t newdata) {
-    if(Pt2 == &Queue2[0]) {
-        Pt2 = &Queue2[FilterSize-1];              // wrap
-    } else {
-        Pt2--;                         // make room for data
+// group delay at DC in samples
+// Input: filter   Output: delay in samples
+uint32_t LPF_DelayFilter(const LPF_t *filter) {
+    switch(filter->Mode) {
+        case LPF_IIR1: return (1UL<<filter->Shift)-1;
+        case LPF_IIR2: return 2*((1UL<<filter->Shift)-1);
+        default:       return (filter->Size-1)/2;
     }
-    LPFSum2 = LPFSum2+newdata -*Pt2;   // subtract oldest, add newest
-    *Pt2 = *(Pt2+FilterSize) = newdata;     // two copies of the new data
-    return LPFSum2/FilterSize;
 }
 
 
-// calculate noise as standard deviation, called every time buffer refills
-// Input: none   Output: standard deviation
-int32_t Noise2(void){
+// calculate variance from the running sums, constant time
+// Input: filter   Output: sum((x-mean)^2)/(Size-1), mean truncated to an integer
+uint32_t LPF_VarianceFilter(const LPF_t *filter) {
 
-    if(FilterSize<2) { return 0; }
+    uint32_t size = filter->Size;
+    if(size < 2) { return 0; }
 
-    int32_t sum = 0;
-    for(int i = 0; i < FilterSize; i++) {
-        sum = sum + Queue2[i];
+    uint64_t sum = filter->Sum;
+    uint64_t mean;                  // DC component
+    if(filter->Shift != LPF_NO_SHIFT) {
+        mean = sum>>filter->Shift;
+    } else {
+        mean = sum/size;
     }
 
-    int32_t mean = sum/FilterSize; // DC component
-
-    sum = 0;
-    for(int i = 0; i < FilterSize; i++) {
-        sum = sum + (Queue2[i]-mean)*(Queue2[i]-mean); // total energy in AC part
+    // sum((x-mean)^2) = sum(x^2) - 2*mean*sum(x) + size*mean^2
+    uint64_t energy = filter->SumSq - 2*mean*sum + size*mean*mean; // total energy in AC part
+    if(energy <= 0xFFFFFFFF) {
+        return (uint32_t)energy/(size-1);  // 32-bit hardware divide
     }
+    energy = energy/(size-1);
+    return (energy > 0xFFFFFFFF)? 0xFFFFFFFF : (uint32_t)energy;
+}
 
-    return isqrt(sum/(FilterSize-1));
 
+// calculate noise as standard deviation, constant time
+// Input: filter   Output: standard deviation
+int32_t LPF_NoiseFilter(const LPF_t *filter) {
+    return isqrt(LPF_VarianceFilter(filter));
 }
 
 
-uint32_t Queue3[MAX_FILTER_SIZE * 2];   // two copies of MACQ
-uint32_t *Pt3;       // pointer to current
-uint32_t LPFSum3;    // sum of the last FilterSize samples
-void LPF_Init3(uint32_t initialValue, uint32_t filterSize) {
+//************** Three channels used by the labs **************
 
-    FilterSize = (filterSize > MAX_FILTER_SIZE)? MAX_FILTER_SIZE : filterSize;
+static LPFSample_t Queue1[MAX_FILTER_SIZE];    // MACQ of the first filter
+static LPF_t Filter1;
+static LPFMedian_t Median1;       // optional median stage of the first filter
 
-    Pt3 = &Queue3[0];
+void LPF_Init(uint32_t initialValue, uint32_t filterSize) {
+    LPF_InitFilter(&Filter1, Queue1, initialValue, filterSize);
+}
 
-    LPFSum3 = FilterSize*initialValue; // prime MACQ with initial data
+void LPF_InitIIR(uint32_t initialValue, uint32_t order, uint32_t shift) {
+    LPF_InitIIRFilter(&Filter1, initialValue, order, shift);
+}
 
-    for(int i=0; i<2*FilterSize; i++) {
-        Queue3[i] = initialValue;
-    }
+void LPF_InitMedian(uint32_t initialValue, uint32_t size) {
+    LPF_InitMedianFilter(&Median1, initialValue, size);
+    LPF_SetMedianFilter(&Filter1, &Median1);
 }
 
+uint32_t LPF_Calc(uint32_t newdata) {
+    return LPF_CalcFilter(&Filter1, newdata);
+}
 
-// calculate one filter output, called at sampling rate
-// Input: new ADC data   Output: filter output, DAC data
-// y(n) = (x(n)+x(n-1)+...+x(n-FilterSize-1)/FilterSize
-uint32_t LPF_Calc3(uint32_t newdata) {
-    if(Pt3 == &Queue3[0]) {
-        Pt3 = &Queue3[FilterSize-1];              // wrap
-    } else {
-        Pt3--;                         // make room for data
-    }
-    LPFSum3 = LPFSum3 + newdata - *Pt3;   // subtract oldest, add newest
-    *Pt3 = *(Pt3+FilterSize) = newdata;     // two copies of the new data
-    return LPFSum3/FilterSize;
+int32_t Noise(void) {
+    return LPF_NoiseFilter(&Filter1);
 }
 
+uint32_t Variance(void) {
+    return LPF_VarianceFilter(&Filter1);
+}
 
-// calculate noise as standard deviation, called every time buffer refills
-// Input: none   Output: standard deviation
-int32_t Noise3(void){
 
-    int32_t sum,mean;
+static LPFSample_t Queue2[MAX_FILTER_SIZE];    // MACQ of the second filter
+static LPF_t Filter2;
+static LPFMedian_t Median2;       // optional median stage of the second filter
 
-    if(FilterSize<2) return 0;
-    sum = 0;
-    for(int i = 0; i < FilterSize; i++) {
-        sum = sum+Queue3[i];
-    }
-    mean = sum/FilterSize; // DC component
-    sum = 0;
-    for(int i=0;i<FilterSize;i++) {
-        sum = sum+(Queue3[i]-mean)*(Queue3[i]-mean); // total energy in AC part
-    }
+void LPF_Init2(uint32_t initialValue, uint32_t filterSize) {
+    LPF_InitFilter(&Filter2, Queue2, initialValue, filterSize);
+}
+
+void LPF_InitIIR2(uint32_t initialValue, uint32_t order, uint32_t shift) {
+    LPF_InitIIRFilter(&Filter2, initialValue, order, shift);
+}
+
+void LPF_InitMedian2(uint32_t initialValue, uint32_t size) {
+    LPF_InitMedianFilter(&Median2, initialValue, size);
+    LPF_SetMedianFilter(&Filter2, &Median2);
+}
 
-    return isqrt(sum/(FilterSize-1));
+uint32_t LPF_Calc2(uint32_t newdata) {
+    return LPF_CalcFilter(&Filter2, newdata);
+}
+
+int32_t Noise2(void) {
+    return LPF_NoiseFilter(&Filter2);
+}
+
+uint32_t Variance2(void) {
+    return LPF_VarianceFilter(&Filter2);
+}
+
+
+static LPFSample_t Queue3[MAX_FILTER_SIZE];    // MACQ of the third filter
+static LPF_t Filter3;
+static LPFMedian_t Median3;       // optional median stage of the third filter
+
+void LPF_Init3(uint32_t initialValue, uint32_t filterSize) {
+    LPF_InitFilter(&Filter3, Queue3, initialValue, filterSize);
 }
 
+void LPF_InitIIR3(uint32_t initialValue, uint32_t order, uint32_t shift) {
+    LPF_InitIIRFilter(&Filter3, initialValue, order, shift);
+}
+
+void LPF_InitMedian3(uint32_t initialValue, uint32_t size) {
+    LPF_InitMedianFilter(&Median3, initialValue, size);
+    LPF_SetMedianFilter(&Filter3, &Median3);
+}
+
+uint32_t LPF_Calc3(uint32_t newdata) {
+    return LPF_CalcFilter(&Filter3, newdata);
+}
+
+int32_t Noise3(void) {
+    return LPF_NoiseFilter(&Filter3);
+}
+
+uint32_t Variance3(void) {
+    return LPF_VarianceFilter(&Filter3);
+}
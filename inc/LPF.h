@@ -1,12 +1,14 @@
 /**
  * @file      LPF.h
- * @brief     implements three FIR low-pass filters
+ * @brief     implements FIR low-pass filters
  * @details   Finite length LPF<br>
  1) Size is the depth 2 to 512<br>
  2) y(n) = (sum(x(n)+x(n-1)+...+x(n-size-1))/size<br>
  3) To use a filter<br>
    a) initialize it once<br>
    b) call the filter at the sampling rate<br>
+ 4) LPF_Init/LPF_Calc, LPF_Init2/LPF_Calc2 and LPF_Init3/LPF_Calc3
+    are three ready-made channels built on LPF_t<br>
  * @version   TI-RSLK MAX v1.1
  * @author    Daniel Valvano and Jonathan Valvano
  * @copyright Copyright 2019 by Jonathan W. Valvano, valvano@mail.utexas.edu,
@@ -55,13 +57,179 @@ policies, either expressed or implied, of the FreeBSD Project.
 */
 
 
+
+#ifndef LPF_H_
+#define LPF_H_
+
+#define MAX_FILTER_SIZE 512     // largest supported filter depth, a power of two
+#define LPF_NO_SHIFT    0xFF    // Shift value for sizes that are not a power of two
+
+// LPF_COMPACT 1 stores samples as 16 bits in a single-copy ring whose
+// capacity is a power of two, so it wraps with a mask instead of a compare.
+// 16 bits hold the 14-bit ADC samples exactly, so the outputs do not change.
+// Build with LPF_COMPACT 0 to store full 32-bit samples.
+#ifndef LPF_COMPACT
+#define LPF_COMPACT 1
+#endif
+
+#define MAX_IIR_SHIFT   15      // largest IIR shift, keeps 14-bit data inside 32 bits
+
+/**
+ * \brief Selects how an LPF channel computes its output.
+ */
+enum LPFMode {
+  LPF_FIR,  // moving average over a MACQ of Size samples
+  LPF_IIR1, // first-order exponential smoothing, no sample history
+  LPF_IIR2  // two first-order stages in cascade, no sample history
+};
+
+#if LPF_COMPACT
+typedef uint16_t LPFSample_t;
+#else
+typedef uint32_t LPFSample_t;
+#endif
+
+#define MAX_MEDIAN_SIZE 7       // widest median pre-filter
+
+/**
+ * \brief State of one streaming median filter, 1 to MAX_MEDIAN_SIZE wide.
+ * Keeps the window twice, in arrival order and sorted, so each new
+ * sample costs one rolling insertion of at most MAX_MEDIAN_SIZE steps.
+ */
+typedef struct {
+    int32_t History[MAX_MEDIAN_SIZE];   // window in arrival order, circular
+    int32_t Sorted[MAX_MEDIAN_SIZE];    // same window in ascending order
+    uint32_t Size;                      // width of the window, odd
+    uint32_t Index;                     // index to oldest in History
+} LPFMedian_t;
+
+/**
+ * \brief State of one low-pass filter channel.
+ * Each channel has its own MACQ and its own depth, so any number of
+ * channels with different window sizes can run side by side.
+ * IIR channels use no MACQ, only Sum and Stage2.
+ */
+typedef struct {
+    LPFSample_t *Queue; // MACQ storage, see LPF_InitFilter for its length
+    uint32_t Size;      // depth of the filter, 1 to MAX_FILTER_SIZE
+#if LPF_COMPACT
+    uint32_t Mask;      // ring capacity-1, capacity is Size rounded up to a power of two
+    uint32_t Index;     // index where the next sample goes
+#else
+    uint32_t Index;     // index to oldest
+#endif
+    uint32_t Sum;       // sum of the last Size samples, IIR: first stage times 2^Shift
+    uint64_t SumSq;     // sum of the squares of the last Size samples
+    uint32_t Stage2;    // IIR: second stage times 2^Shift
+    uint8_t  Shift;     // log2(Size) if Size is a power of two, else LPF_NO_SHIFT, IIR: k
+    uint8_t  Mode;      // enum LPFMode
+    LPFMedian_t *PreFilter; // optional median stage run before the LPF, 0 for none
+} LPF_t;
+
+/**
+ * Initialize one LPF channel<br>
+ * Set all data to an initial value<br>
+ * @param filter pointer to the channel state
+ * @param queue MACQ storage owned by the caller, at least size entries,
+ *        rounded up to a power of two when LPF_COMPACT is 1
+ * @param initial value to preload into MACQ
+ * @param size depth of the filter, 1 to MAX_FILTER_SIZE
+ * @return none
+ * @note  a power-of-two size replaces the divide with a shift
+ * @brief  Initialize one LPF channel
+ */
+void LPF_InitFilter(LPF_t *filter, LPFSample_t *queue, uint32_t initial, uint32_t size);
+
+/**
+ * Initialize one LPF channel as an IIR filter<br>
+ * y(n) = y(n-1) + (x(n)-y(n-1))/2^shift, computed with shifts and adds<br>
+ * Order 2 runs two of these stages in cascade<br>
+ * @param filter pointer to the channel state
+ * @param initial value the filter output starts at
+ * @param order 1 or 2
+ * @param shift k, 1 to MAX_IIR_SHIFT, time constant is about 2^k samples
+ * @return none
+ * @note  needs no MACQ, Noise and Variance of an IIR channel return 0
+ * @brief  Initialize one IIR low-pass channel
+ */
+void LPF_InitIIRFilter(LPF_t *filter, uint32_t initial, uint32_t order, uint32_t shift);
+
+/**
+ * Initialize one streaming median filter<br>
+ * Set all data to an initial value<br>
+ * @param median pointer to the median state
+ * @param initial value to preload into the window
+ * @param size width of the window, 3, 5 or 7 (even sizes are rounded up)
+ * @return none
+ * @brief  Initialize one median filter
+ */
+void LPF_InitMedianFilter(LPFMedian_t *median, int32_t initial, uint32_t size);
+
+/**
+ * Calculate one median filter output<br>
+ * Called at sampling rate, rejects spikes shorter than size/2 samples
+ * @param median pointer to the median state
+ * @param newdata new ADC data
+ * @return median of the last size samples
+ * @brief  streaming median filter
+ */
+int32_t LPF_CalcMedianFilter(LPFMedian_t *median, int32_t newdata);
+
+/**
+ * Chain a median filter in front of one LPF channel<br>
+ * LPF_CalcFilter then passes each sample through the median first
+ * @param filter pointer to the channel state
+ * @param median pointer to an initialized median state, 0 to remove it
+ * @return none
+ * @note  LPF_InitFilter and LPF_InitIIRFilter remove the median stage
+ * @brief  Add a median pre-filter to one LPF channel
+ */
+void LPF_SetMedianFilter(LPF_t *filter, LPFMedian_t *median);
+
+/**
+ * Calculate one filter output for one LPF channel<br>
+ * Called at sampling rate
+ * @param filter pointer to the channel state
+ * @param newdata new ADC data, at most 16 bits when LPF_COMPACT is 1
+ * @return result filter output
+ * @brief  FIR or IIR low pass filter
+ */
+uint32_t LPF_CalcFilter(LPF_t *filter, uint32_t newdata);
+
+/**
+ * Group delay of one LPF channel at DC<br>
+ * FIR: (size-1)/2, IIR1: 2^k-1, IIR2: 2*(2^k-1)
+ * @param filter pointer to the channel state
+ * @return delay in samples, divide by the sampling rate for seconds
+ * @brief  filter delay in samples
+ */
+uint32_t LPF_DelayFilter(const LPF_t *filter);
+
+/**
+ * Calculate variance of one LPF channel<br>
+ * Uses the running sums, so it may be called on every sample
+ * @param filter pointer to the channel state
+ * @return sum((x-mean)^2)/(size-1), with the mean truncated to an integer
+ * @brief  calculate variance of the samples in the MACQ
+ */
+uint32_t LPF_VarianceFilter(const LPF_t *filter);
+
+/**
+ * Calculate noise of one LPF channel as standard deviation<br>
+ * Uses the running sums, so it may be called on every sample
+ * @param filter pointer to the channel state
+ * @return standard deviation, floor(sqrt(variance))
+ * @brief  calculate amount of random noise
+ */
+int32_t LPF_NoiseFilter(const LPF_t *filter);
+
 /**
  * Initialize first LPF<br>
  * Set all data to an initial value<br>
  * @param initial value to preload into MACQ
  * @param size depth of the filter, 2 to 512
  * @return none
- * @note  all three filters share the same size
+ * @note  wrapper around LPF_InitFilter, each filter keeps its own size
  * @brief  Initialize first LPF
  */
 void LPF_Init(uint32_t initial, uint32_t size);
@@ -75,22 +243,54 @@ void LPF_Init(uint32_t initial, uint32_t size);
  */
 uint32_t LPF_Calc(uint32_t newdata);
 
+/**
+ * Initialize the first LPF as an IIR filter<br>
+ * LPF_Calc then runs the IIR instead of the moving average
+ * @param initial value the filter output starts at
+ * @param order 1 or 2
+ * @param shift k, 1 to MAX_IIR_SHIFT
+ * @return none
+ * @note  wrapper around LPF_InitIIRFilter
+ * @brief  Initialize first LPF in IIR mode
+ */
+void LPF_InitIIR(uint32_t initial, uint32_t order, uint32_t shift);
+
+/**
+ * Chain a median filter in front of the first LPF<br>
+ * Call after LPF_Init or LPF_InitIIR
+ * @param initial value to preload into the median window
+ * @param size width of the median, 3, 5 or 7
+ * @return none
+ * @note  wrapper around LPF_InitMedianFilter and LPF_SetMedianFilter
+ * @brief  Add a median pre-filter to the first LPF
+ */
+void LPF_InitMedian(uint32_t initial, uint32_t size);
+
 /**
  * First LPF, calculate noise as standard deviation<br>
- * Called every time the buffer refills
+ * Constant time, may be called at the sampling rate
  * @param none
  * @return standard deviation
  * @brief  calculate amount of random noise
  */
 int32_t Noise(void);
 
+/**
+ * First LPF, calculate variance<br>
+ * Constant time, may be called at the sampling rate
+ * @param none
+ * @return variance
+ * @brief  calculate variance of the samples in the MACQ
+ */
+uint32_t Variance(void);
+
 /**
  * Initialize second LPF<br>
  * Set all data to an initial value<br>
  * @param initial value to preload into MACQ
  * @param size depth of the filter, 2 to 512
  * @return none
- * @note  all three filters share the same size
+ * @note  wrapper around LPF_InitFilter, each filter keeps its own size
  * @brief  Initialize second LPF
  */
 void LPF_Init2(uint32_t initial, uint32_t size);
@@ -104,22 +304,54 @@ void LPF_Init2(uint32_t initial, uint32_t size);
  */
 uint32_t LPF_Calc2(uint32_t newdata);
 
+/**
+ * Initialize the second LPF as an IIR filter<br>
+ * LPF_Calc2 then runs the IIR instead of the moving average
+ * @param initial value the filter output starts at
+ * @param order 1 or 2
+ * @param shift k, 1 to MAX_IIR_SHIFT
+ * @return none
+ * @note  wrapper around LPF_InitIIRFilter
+ * @brief  Initialize second LPF in IIR mode
+ */
+void LPF_InitIIR2(uint32_t initial, uint32_t order, uint32_t shift);
+
+/**
+ * Chain a median filter in front of the second LPF<br>
+ * Call after LPF_Init2 or LPF_InitIIR2
+ * @param initial value to preload into the median window
+ * @param size width of the median, 3, 5 or 7
+ * @return none
+ * @note  wrapper around LPF_InitMedianFilter and LPF_SetMedianFilter
+ * @brief  Add a median pre-filter to the second LPF
+ */
+void LPF_InitMedian2(uint32_t initial, uint32_t size);
+
 /**
  * Second LPF, calculate noise as standard deviation<br>
- * Called every time the buffer refills
+ * Constant time, may be called at the sampling rate
  * @param none
  * @return standard deviation
  * @brief  calculate amount of random noise
  */
 int32_t Noise2(void);
 
+/**
+ * Second LPF, calculate variance<br>
+ * Constant time, may be called at the sampling rate
+ * @param none
+ * @return variance
+ * @brief  calculate variance of the samples in the MACQ
+ */
+uint32_t Variance2(void);
+
 /**
  * Initialize third LPF<br>
  * Set all data to an initial value<br>
  * @param initial value to preload into MACQ
  * @param size depth of the filter, 2 to 512
  * @return none
- * @note  all three filters share the same size
+ * @note  wrapper around LPF_InitFilter, each filter keeps its own size
  * @brief  Initialize third LPF
  */
 void LPF_Init3(uint32_t initial, uint32_t size);
@@ -133,15 +365,47 @@ void LPF_Init3(uint32_t initial, uint32_t size);
  */
 uint32_t LPF_Calc3(uint32_t newdata);
 
+/**
+ * Initialize the third LPF as an IIR filter<br>
+ * LPF_Calc3 then runs the IIR instead of the moving average
+ * @param initial value the filter output starts at
+ * @param order 1 or 2
+ * @param shift k, 1 to MAX_IIR_SHIFT
+ * @return none
+ * @note  wrapper around LPF_InitIIRFilter
+ * @brief  Initialize third LPF in IIR mode
+ */
+void LPF_InitIIR3(uint32_t initial, uint32_t order, uint32_t shift);
+
+/**
+ * Chain a median filter in front of the third LPF<br>
+ * Call after LPF_Init3 or LPF_InitIIR3
+ * @param initial value to preload into the median window
+ * @param size width of the median, 3, 5 or 7
+ * @return none
+ * @note  wrapper around LPF_InitMedianFilter and LPF_SetMedianFilter
+ * @brief  Add a median pre-filter to the third LPF
+ */
+void LPF_InitMedian3(uint32_t initial, uint32_t size);
+
 /**
  * Third LPF, calculate noise as standard deviation<br>
- * Called every time the buffer refills
+ * Constant time, may be called at the sampling rate
  * @param none
  * @return standard deviation
  * @brief  calculate amount of random noise
  */
 int32_t Noise3(void);
 
+/**
+ * Third LPF, calculate variance<br>
+ * Constant time, may be called at the sampling rate
+ * @param none
+ * @return variance
+ * @brief  calculate variance of the samples in the MACQ
+ */
+uint32_t Variance3(void);
+
 /**
  * 3-wide non recursive Median filter <br>
  * Called with new data at sampling rate
@@ -150,3 +414,5 @@ int32_t Noise3(void);
  * @brief  Median filter
  */
 int32_t Median(int32_t newdata);
+
+#endif /* LPF_H_ */
@@ -62,6 +62,13 @@ policies, either expressed or implied, of the FreeBSD Project.
 // Right motor PWM (EN) connected to P2.6/TA0CCP3 (J4.39)
 // Right motor sleep (nSleep) connected to P3.6 (J2.11)
 
+// Direction and compare values waiting for the next PWM period boundary.
+// TA0_0_IRQHandler copies them to the hardware.
+static volatile uint8_t PendingDir;       // PH bits for P5.5 (right) and P5.4 (left)
+static volatile uint16_t PendingLeft;     // next TA0CCR4
+static volatile uint16_t PendingRight;    // next TA0CCR3
+#define LATCH_MARGIN 16                   // TA0 counts TA0_0_IRQHandler may take after reading TA0R
+
 // ------------Motor_Init------------
 // Initialize GPIO pins for output, which will be used to control
 // the direction of the motors and
@@ -90,6 +97,14 @@ void Motor_Init(void){
     // initialize PWM with 0% duty cycle
     PWM_Init34(15000);
 
+    // TA0CCR0 interrupt latches Motor_SetVelocity at the start of the PWM period,
+    // armed only while an update is pending
+    PendingDir = 0;
+    PendingLeft = 0;
+    PendingRight = 0;
+    NVIC->IP[8] = 1 << 5;       // Priority 1, early in the period before short pulses end
+    NVIC->ISER[0] = 0x00000100; // Enable interrupt 8 (TA0_0)
+
 }
 
 
@@ -102,9 +117,12 @@ void Motor_Init(void){
 void Motor_Coast(void){
     // write this as part of Lab 13
     // Note: setting nSleep = 0 and PWM (EN) = 0 makes the robot "coast"
+    TIMER_A0->CCTL[0] &= ~0x0010;   // drop any pending Motor_SetVelocity
+    TIMER_A0->CCTL[4] = 0x0000; // OUTMOD 0, left motor low
     TIMER_A0->CCR[4] = 0x0000;  //left motor
 
     // Update left PWM to 0
+    TIMER_A0->CCTL[3] = 0x0000; // OUTMOD 0, right motor low
     TIMER_A0->CCR[3] = 0x0000;  //right motor
 
     // Update right PWM to 0
@@ -121,9 +139,12 @@ void Motor_Coast(void){
 void Motor_Brake(void){
     // write this as part of Lab 13
     // Note: setting nSleep = 1 and PWM (EN) = 0 makes the robot "brake"
+    TIMER_A0->CCTL[0] &= ~0x0010;   // drop any pending Motor_SetVelocity
+    TIMER_A0->CCTL[4] = 0x0000; // OUTMOD 0, left motor low
     TIMER_A0->CCR[4] = 0x0000;
 
     // Update left PWM to stop motor
+    TIMER_A0->CCTL[3] = 0x0000; // OUTMOD 0, right motor low
     TIMER_A0->CCR[3] = 0x0000;
 
     // Update right PWM to stop motor
@@ -153,6 +174,123 @@ void Motor_Stop(uint16_t dummy1, uint16_t dummy2){
 }
 
 
+// ------------Motor_SetPWMFrequency------------
+// Change the motor PWM frequency, e.g. to 20 kHz, above the audible
+// range and fast enough that the motor current does not ripple at
+// the PWM rate.  The duty cycles are kept.  A Motor_SetVelocity that
+// has not reached the hardware yet is dropped, call it again after.
+// Input: frequency_Hz  PWM frequency, see PWM_SetFrequency34
+// Output: none
+// Assumes: Motor_Init() has been called
+void Motor_SetPWMFrequency(uint32_t frequency_Hz){
+    long sr = StartCritical();
+    TIMER_A0->CCTL[0] &= ~0x0010;   // drop any pending Motor_SetVelocity
+    PWM_SetFrequency34(frequency_Hz);
+    EndCritical(sr);
+}
+
+
+// ------------Motor_SetVelocity------------
+// Set the direction and duty cycle of both wheels in one call.
+// Positive is forward, negative is backward, 0 brakes that wheel.
+// The new directions and compare values are written together by the
+// TA0CCR0 interrupt at the start of the next PWM period (within one
+// period, 20 ms at the default 50 Hz, 50 us at 20 kHz).  A wheel that
+// changes direction, or whose new pulse would already be over when the
+// interrupt runs, is held low for the rest of that period.  So a wheel
+// never pulses in the old direction after its PH pin changed, and no
+// pulse is longer than the old or new duty cycle.
+// A later call before the boundary replaces the pending one.
+// Input: left_permil  signed duty cycle of left wheel (-999 to 999)
+//        right_permil signed duty cycle of right wheel (-999 to 999)
+// Output: none
+// Assumes: Motor_Init() has been called
+void Motor_SetVelocity(int16_t left_permil, int16_t right_permil){
+    uint8_t dir = 0;
+
+    if (left_permil < 0) {
+        dir |= 0x10;            // PH = 1, left backward
+        left_permil = -left_permil;
+    }
+    if (right_permil < 0) {
+        dir |= 0x20;            // PH = 1, right backward
+        right_permil = -right_permil;
+    }
+    if (left_permil > 999) {
+        left_permil = 999;
+    }
+    if (right_permil > 999) {
+        right_permil = 999;
+    }
+
+    // convert permil to TA0 units for the current PWM period
+    uint16_t left = PWM_Compare34(left_permil);
+    uint16_t right = PWM_Compare34(right_permil);
+
+    long sr = StartCritical();
+    PendingDir = dir;
+    PendingLeft = left;
+    PendingRight = right;
+    if ((TIMER_A0->CCTL[0] & 0x0010) == 0) {
+        // arm on the next boundary, not on a flag left from an earlier period
+        TIMER_A0->CCTL[0] = (TIMER_A0->CCTL[0] & ~0x0001) | 0x0010;
+    }
+    // Activate motors
+    P3->OUT |= 0xC0;
+    EndCritical(sr);
+
+    // The motors run until software issues another command (don't turn off)
+}
+
+
+//------------TA0_0_IRQHandler------------
+// TA0CCR0 interrupt, when TA0R wraps to 0 and both pulses start, while
+// a Motor_SetVelocity update is pending.  The update is always applied
+// here, then the interrupt is disarmed.  A new compare value still
+// ahead of the count just moves the end of the running pulse.  A wheel
+// that changes direction, or whose new compare value the count may
+// already have passed, is first forced low with OUTMOD 0; reset/set
+// then keeps it low until the next wrap.
+// Input: none
+// Output: none
+void TA0_0_IRQHandler(void){
+    uint16_t count;
+    uint8_t change;
+
+    TIMER_A0->CCTL[0] &= ~0x0001;   // acknowledge
+    if ((TIMER_A0->CCTL[0] & 0x0010) == 0) {
+        return;     // cancelled by Motor_Coast or Motor_Brake
+    }
+
+    // TA0R counts on SMCLK, asynchronous to the CPU; read until two reads agree
+    do {
+        count = TIMER_A0->R;
+    } while (count != TIMER_A0->R);
+    if (count == TIMER_A0->CCR[0]) {
+        count = 0;  // entered before the wrap, no pulse has started yet
+    }
+
+    change = (P5->OUT ^ PendingDir) & 0x30;
+    if ((change & 0x20) || (PendingRight <= count + LATCH_MARGIN)) {
+        TIMER_A0->CCTL[3] = 0x0000; // OUTMOD 0, right output low now
+    }
+    if ((change & 0x10) || (PendingLeft <= count + LATCH_MARGIN)) {
+        TIMER_A0->CCTL[4] = 0x0000; // OUTMOD 0, left output low now
+    }
+    P5->OUT ^= change;
+    TIMER_A0->CCR[4] = PendingLeft;
+    TIMER_A0->CCR[3] = PendingRight;
+    // reset/set, output unchanged until its next event; 0 stays in OUTMOD 0
+    if (PendingLeft) {
+        TIMER_A0->CCTL[4] = 0x00E0;
+    }
+    if (PendingRight) {
+        TIMER_A0->CCTL[3] = 0x00E0;
+    }
+    TIMER_A0->CCTL[0] &= ~0x0010;   // done, disarm
+}
+
+
 // ------------Motor_Forward------------
 // Drive the robot forward by running left and
 // right wheels forward with the given duty
@@ -162,21 +300,7 @@ void Motor_Stop(uint16_t dummy1, uint16_t dummy2){
 // Output: none
 // Assumes: Motor_Init() has been called
 void Motor_Forward(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
-
-    // write this as part of Lab 13
-
-    // set direction of motors
-    P5->OUT &= ~0x30;
-
-    // update PWMs
-    PWM_DutyRight(rightDuty_permil);
-    PWM_DutyLeft(leftDuty_permil);
-
-    // Activate motors
-    P3->OUT |= 0xC0;
-
-    // FYI: The motors run until software issues another command (don't turn off)
-
+    Motor_SetVelocity(leftDuty_permil, rightDuty_permil);
 }
 
 
@@ -188,20 +312,7 @@ void Motor_Forward(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
 // Output: none
 // Assumes: Motor_Init() has been called
 void Motor_TurnRight(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
-
-    // write this as part of Lab 13
-    // set direction of motors
-    P5->OUT &= ~0x10;       //PH = 1, backward
-    P5->OUT |= 0x20;        //PH = 0, forward
-
-    // update PWMs
-    PWM_DutyRight(rightDuty_permil);
-    PWM_DutyLeft(leftDuty_permil);
-
-    // Activate motors
-    // FYI: The motors run until software issues another command (don't turn off)
-    P3->OUT |= 0xC0;
-
+    Motor_SetVelocity(leftDuty_permil, -(int16_t)rightDuty_permil);
 }
 
 
@@ -213,21 +324,7 @@ void Motor_TurnRight(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
 // Output: none
 // Assumes: Motor_Init() has been called
 void Motor_TurnLeft(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
-
-    // Write this as part of Lab 13
-    // Set direction of motors
-    P5->OUT |= 0x10;                    //opposite of TurnRight for both of these
-    P5->OUT &= ~0x20;
-
-    // update PWMs
-    PWM_DutyRight(rightDuty_permil);
-    PWM_DutyLeft(leftDuty_permil);
-
-    // Activate motors
-    P3->OUT |= 0xC0;
-
-    // The motors run until software issues another command (don't turn off)
-
+    Motor_SetVelocity(-(int16_t)leftDuty_permil, rightDuty_permil);
 }
 
 // ------------Motor_Backward------------
@@ -239,19 +336,5 @@ void Motor_TurnLeft(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
 // Output: none
 // Assumes: Motor_Init() has been called
 void Motor_Backward(uint16_t leftDuty_permil, uint16_t rightDuty_permil){
-
-
-    // write this as part of Lab 13
-    // set direction of motors
-    P5->OUT |= 0x30;                //PH = 1, backward (both wheels)
-
-    // update PWMs
-    PWM_DutyRight(rightDuty_permil);
-    PWM_DutyLeft(leftDuty_permil);
-
-    // Activate motors
-    P3->OUT |= 0xC0;
-
-    // The motors run until software issues another command (don't turn off)
-
+    Motor_SetVelocity(-(int16_t)leftDuty_permil, -(int16_t)rightDuty_permil);
 }
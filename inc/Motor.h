@@ -112,6 +112,32 @@ void Motor_Stop(uint16_t dummy1, uint16_t dummy2);
  */
 void Motor_Coast(void);
 
+/**
+ * Change the motor PWM frequency, keeping the duty cycles.
+ * Motor_Init starts at 50 Hz; ultrasonic rates such as 20 kHz
+ * remove the torque ripple of the slow carrier.
+ * @param frequency_Hz PWM frequency, PWM_MIN_FREQUENCY_HZ to PWM_MAX_FREQUENCY_HZ
+ * @return none
+ * @note Assumes Motor_Init() has been called
+ * @note Duty resolution is 0.1% up to 12 kHz and 0.17% at 20 kHz, see PWM_SetFrequency34
+ * @brief  Set the motor PWM frequency
+ */
+void Motor_SetPWMFrequency(uint32_t frequency_Hz);
+
+/**
+ * Set the direction and duty cycle of both wheels.
+ * Positive drives the wheel forward, negative backward, 0 brakes it.
+ * Both wheels change together at the next PWM period boundary, so a
+ * wheel never pulses in the wrong direction during a direction change.
+ * @param left_permil  signed duty cycle of left wheel (-999 to 999)
+ * @param right_permil signed duty cycle of right wheel (-999 to 999)
+ * @return none
+ * @note Assumes Motor_Init() has been called
+ * @note Takes effect at the start of the next PWM period; a later call before then replaces it.
+ * @brief  Set both wheel velocities
+ */
+void Motor_SetVelocity(int16_t left_permil, int16_t right_permil);
+
 /**
  * Drive the robot forward by running left and
  * right wheels forward with the given duty
@@ -120,6 +146,7 @@ void Motor_Coast(void);
  * @param rightDuty_permil duty cycle of right wheel (0 to 999)
  * @return none
  * @note Assumes Motor_Init() has been called
+ * @note Same as Motor_SetVelocity(leftDuty_permil, rightDuty_permil)
  * @brief  Drive the robot forward
  */
 void Motor_Forward(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
@@ -132,6 +159,7 @@ void Motor_Forward(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
  * @param rightDuty_permil duty cycle of right wheel (0 to 999)
  * @return none
  * @note Assumes Motor_Init() has been called
+ * @note Same as Motor_SetVelocity(leftDuty_permil, -rightDuty_permil)
  * @brief  Turn the robot to the right
  */
 void Motor_TurnRight(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
@@ -144,6 +172,7 @@ void Motor_TurnRight(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
  * @param rightDuty_permil duty cycle of right wheel (0 to 999)
  * @return none
  * @note Assumes Motor_Init() has been called
+ * @note Same as Motor_SetVelocity(-leftDuty_permil, rightDuty_permil)
  * @brief  Turn the robot to the left
  */
 void Motor_TurnLeft(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
@@ -156,6 +185,7 @@ void Motor_TurnLeft(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
  * @param rightDuty_permil duty cycle of right wheel (0 to 999)
  * @return none
  * @note Assumes Motor_Init() has been called
+ * @note Same as Motor_SetVelocity(-leftDuty_permil, -rightDuty_permil)
  * @brief  Drive the robot backward
  */
 void Motor_Backward(uint16_t leftDuty_permil, uint16_t rightDuty_permil);
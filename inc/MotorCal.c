@@ -0,0 +1,239 @@
+/*
+ * MotorCal.c
+ * Runs on MSP432
+ *
+ * Per-wheel duty-to-speed calibration, see MotorCal.h.
+ *
+ */
+
+#include <stdint.h>
+#include "../inc/Clock.h"
+#include "../inc/Motor.h"
+#include "../inc/Tachometer.h"
+#include "../inc/FlashInfo.h"
+#include "../inc/MotorCal.h"
+
+#define CAL_STEP_PERMIL     10      // deadband search step
+#define CAL_STEP_MS         200     // time at each deadband step, longer than the stall timeout
+#define CAL_MAX_DEADBAND    600     // give up if a wheel does not turn by here
+#define CAL_SETTLE_MS       300     // time to reach steady state at a new duty cycle
+#define CAL_SAMPLES         10      // speed samples per point
+#define CAL_SAMPLE_MS       20
+#define CAL_REST_MS         1000    // stopped between the sweeps
+
+// Default tables, used until MotorCal_Init loads a calibration.
+// A straight line from a 150 permil deadband at 10 rpm to 120 rpm at 999.
+static MotorMap_t Map[MOTOR_NUM_WHEELS] = {
+    {{150, 271, 393, 514, 636, 757, 879, 999}, {10, 26, 42, 57, 73, 89, 104, 120}},
+    {{150, 271, 393, 514, 636, 757, 879, 999}, {10, 26, 42, 57, 73, 89, 104, 120}}
+};
+
+
+// duty cycles strictly increasing up to 999, speeds non-decreasing
+static uint8_t checkMap(const MotorMap_t *map) {
+    if((map->Duty_permil[0] == 0) || (map->Duty_permil[MOTORCAL_POINTS-1] > 999) ||
+       (map->Speed_rpm[MOTORCAL_POINTS-1] == 0)) {
+        return 0;
+    }
+    for(int i = 1; i < MOTORCAL_POINTS; i++) {
+        if((map->Duty_permil[i] <= map->Duty_permil[i-1]) ||
+           (map->Speed_rpm[i] < map->Speed_rpm[i-1])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+uint8_t MotorCal_SetMap(enum MotorWheel wheel, const MotorMap_t *map) {
+    if(!checkMap(map)) {
+        return 0;
+    }
+    Map[wheel] = *map;
+    return 1;
+}
+
+
+void MotorCal_GetMap(enum MotorWheel wheel, MotorMap_t *map) {
+    *map = Map[wheel];
+}
+
+
+int16_t MotorCal_Velocity(enum MotorWheel wheel, int16_t speed_rpm) {
+    const MotorMap_t *map = &Map[wheel];
+    int32_t s = (speed_rpm < 0) ? -(int32_t)speed_rpm : speed_rpm;
+    int32_t duty;
+
+    if(s == 0) {
+        return 0;
+    }
+    if(s <= map->Speed_rpm[0]) {
+        duty = map->Duty_permil[0];             // slowest speed the wheel holds
+    } else if(s > map->Speed_rpm[MOTORCAL_POINTS-1]) {
+        duty = 999;                             // faster than measured, full power
+    } else {
+        // Speed_rpm[i] < s <= Speed_rpm[i+1], so the segment is not flat
+        int i = 0;
+        while(s > map->Speed_rpm[i+1]) {
+            i++;
+        }
+        int32_t ds = map->Speed_rpm[i+1] - map->Speed_rpm[i];
+        int32_t dd = map->Duty_permil[i+1] - map->Duty_permil[i];
+        duty = map->Duty_permil[i] + (dd*(s - map->Speed_rpm[i]) + ds/2)/ds;
+    }
+    return (speed_rpm < 0) ? -duty : duty;
+}
+
+
+void MotorCal_SetSpeed(int16_t left_rpm, int16_t right_rpm) {
+    Motor_SetVelocity(MotorCal_Velocity(MOTOR_LEFT, left_rpm),
+                      MotorCal_Velocity(MOTOR_RIGHT, right_rpm));
+}
+
+
+uint8_t MotorCal_Fit(MotorMap_t *map) {
+    for(int i = 1; i < MOTORCAL_POINTS; i++) {
+        if(map->Speed_rpm[i] < map->Speed_rpm[i-1]) {
+            map->Speed_rpm[i] = map->Speed_rpm[i-1];
+        }
+    }
+    return checkMap(map);
+}
+
+
+// Tachometer period in 2/3 us to rpm, 0 stays 0 (stopped)
+static uint32_t toRPM(uint16_t period) {
+    return period ? (PULSE2RPM + period/2)/period : 0;
+}
+
+
+uint8_t MotorCal_Run(MotorMap_t maps[MOTOR_NUM_WHEELS]) {
+    uint16_t deadband[MOTOR_NUM_WHEELS] = {0, 0};
+    uint16_t duty[MOTOR_NUM_WHEELS] = {0, 0};
+    uint32_t sum[MOTOR_NUM_WHEELS][MOTORCAL_POINTS];
+    uint16_t leftPeriod, rightPeriod;
+
+    // Deadband: raise the duty cycle of each wheel until it turns
+    for(uint16_t d = CAL_STEP_PERMIL; (deadband[MOTOR_LEFT] == 0) || (deadband[MOTOR_RIGHT] == 0); d += CAL_STEP_PERMIL) {
+        if(d > CAL_MAX_DEADBAND) {
+            Motor_Brake();
+            return 0;
+        }
+        for(int w = 0; w < MOTOR_NUM_WHEELS; w++) {
+            if(deadband[w] == 0) {
+                duty[w] = d;
+            }
+        }
+        Motor_SetVelocity(duty[MOTOR_LEFT], duty[MOTOR_RIGHT]);
+        Clock_Delay1ms(CAL_STEP_MS);
+        Tachometer_GetSpeeds(&leftPeriod, &rightPeriod);
+        if(leftPeriod && (deadband[MOTOR_LEFT] == 0)) {
+            deadband[MOTOR_LEFT] = d;
+        }
+        if(rightPeriod && (deadband[MOTOR_RIGHT] == 0)) {
+            deadband[MOTOR_RIGHT] = d;
+        }
+    }
+    Motor_Brake();
+    Clock_Delay1ms(CAL_REST_MS);
+
+    // Duty cycles from the deadband to 999, evenly spaced
+    for(int w = 0; w < MOTOR_NUM_WHEELS; w++) {
+        for(int i = 0; i < MOTORCAL_POINTS; i++) {
+            maps[w].Duty_permil[i] = deadband[w] + ((999 - deadband[w])*i)/(MOTORCAL_POINTS-1);
+            sum[w][i] = 0;
+        }
+    }
+
+    // Sweep forward, then backward back to the start
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < MOTORCAL_POINTS; i++) {
+            int16_t left = maps[MOTOR_LEFT].Duty_permil[i];
+            int16_t right = maps[MOTOR_RIGHT].Duty_permil[i];
+            if(pass) {
+                left = -left;
+                right = -right;
+            }
+            Motor_SetVelocity(left, right);
+            Clock_Delay1ms(CAL_SETTLE_MS);
+            for(int k = 0; k < CAL_SAMPLES; k++) {
+                Clock_Delay1ms(CAL_SAMPLE_MS);
+                Tachometer_GetSpeeds(&leftPeriod, &rightPeriod);
+                sum[MOTOR_LEFT][i] += toRPM(leftPeriod);
+                sum[MOTOR_RIGHT][i] += toRPM(rightPeriod);
+            }
+        }
+        Motor_Brake();
+        Clock_Delay1ms(CAL_REST_MS);
+    }
+
+    uint8_t ok = 1;
+    for(int w = 0; w < MOTOR_NUM_WHEELS; w++) {
+        for(int i = 0; i < MOTORCAL_POINTS; i++) {
+            maps[w].Speed_rpm[i] = (sum[w][i] + CAL_SAMPLES)/(2*CAL_SAMPLES);
+        }
+        ok &= MotorCal_Fit(&maps[w]);
+    }
+    return ok;
+}
+
+
+// sum of every word before the checksum, complemented so an erased record fails
+static uint32_t checksum(const MotorCalRecord_t *record) {
+    const uint32_t *word = (const uint32_t *)record;
+    uint32_t sum = 0;
+    for(int i = 0; i < (sizeof(MotorCalRecord_t)/4)-1; i++) {
+        sum = sum + word[i];
+    }
+    return ~sum;
+}
+
+
+void MotorCal_MakeRecord(MotorCalRecord_t *record, const MotorMap_t maps[MOTOR_NUM_WHEELS]) {
+    record->Magic = MOTORCAL_MAGIC;
+    for(int i = 0; i < MOTOR_NUM_WHEELS; i++) {
+        record->Map[i] = maps[i];
+    }
+    record->Checksum = checksum(record);
+}
+
+
+uint8_t MotorCal_CheckRecord(const MotorCalRecord_t *record) {
+    return (record->Magic == MOTORCAL_MAGIC) && (record->Checksum == checksum(record));
+}
+
+
+uint8_t MotorCal_Init(void) {
+
+    const MotorCalRecord_t *record = (const MotorCalRecord_t *)MOTORCAL_ADDRESS;
+    if(!MotorCal_CheckRecord(record)) {
+        return 0;                       // erased or corrupt, keep the defaults
+    }
+
+    // load both or none, so the wheels never mix two calibrations
+    for(int i = 0; i < MOTOR_NUM_WHEELS; i++) {
+        if(!checkMap(&record->Map[i])) {
+            return 0;
+        }
+    }
+    for(int i = 0; i < MOTOR_NUM_WHEELS; i++) {
+        Map[i] = record->Map[i];
+    }
+    return 1;
+}
+
+
+uint8_t MotorCal_Save(const MotorMap_t maps[MOTOR_NUM_WHEELS]) {
+    MotorCalRecord_t record;
+
+    for(int i = 0; i < MOTOR_NUM_WHEELS; i++) {
+        if(!checkMap(&maps[i])) {
+            return 0;
+        }
+    }
+    MotorCal_MakeRecord(&record, maps);
+    if(FlashInfo_Update(MOTORCAL_ADDRESS, (const uint32_t *)&record, sizeof(record)/4) != FLASHINFO_NOERROR) {
+        return 0;
+    }
+    return MotorCal_Init();
+}
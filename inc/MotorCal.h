@@ -0,0 +1,152 @@
+/*
+ * MotorCal.h
+ * Runs on MSP432
+ *
+ * Per-wheel duty-to-speed calibration.  MotorCal_Run sweeps the duty
+ * cycle of both wheels and records the steady-state speed from the
+ * tachometer; the result is a short table per wheel whose first point
+ * is the deadband, the smallest duty cycle that turns the wheel.
+ * Inverting the tables lets a controller ask for a speed and get the
+ * duty cycle each wheel needs for it, so both wheels track without
+ * hand-trimmed duty cycles.  The tables are kept in flash.
+ *
+ */
+
+#ifndef MOTORCAL_H_
+#define MOTORCAL_H_
+
+// Calibration record location in flash information memory, see FlashInfo.h
+#define MOTORCAL_ADDRESS    0x00200600
+#define MOTORCAL_MAGIC      0x4D43414C  // "MCAL", marks a programmed record
+
+#define MOTORCAL_POINTS     8           // points per wheel, the first is the deadband
+
+/**
+ * \brief Identifies one of the two wheels.
+ */
+enum MotorWheel {
+  MOTOR_LEFT,
+  MOTOR_RIGHT,
+  MOTOR_NUM_WHEELS
+};
+
+/**
+ * \brief Duty-to-speed table of one wheel.
+ * Duty cycles strictly increase and speeds never decrease.
+ */
+typedef struct {
+    uint16_t Duty_permil[MOTORCAL_POINTS];  // Duty_permil[0] is the deadband
+    uint16_t Speed_rpm[MOTORCAL_POINTS];    // steady-state speed at each duty cycle
+} MotorMap_t;
+
+/**
+ * \brief Calibration record for both wheels as stored in flash.
+ */
+typedef struct {
+    uint32_t Magic;                         // MOTORCAL_MAGIC
+    MotorMap_t Map[MOTOR_NUM_WHEELS];       // indexed by enum MotorWheel
+    uint32_t Checksum;                      // see MotorCal_MakeRecord
+} MotorCalRecord_t;
+
+
+/**
+ * Load the wheel tables from flash<br>
+ * If a valid record is stored at MOTORCAL_ADDRESS it is used from now
+ * on, otherwise the compiled-in tables are kept.
+ * @param none
+ * @return 1 if the stored calibration was loaded, 0 if not
+ * @brief  Load motor calibration from flash
+ */
+uint8_t MotorCal_Init(void);
+
+/**
+ * Replace the table of one wheel
+ * @param wheel MOTOR_LEFT or MOTOR_RIGHT
+ * @param map new table
+ * @return 1 if accepted, 0 if the table is not increasing and was ignored
+ * @brief  Set a wheel table
+ */
+uint8_t MotorCal_SetMap(enum MotorWheel wheel, const MotorMap_t *map);
+
+/**
+ * @param wheel MOTOR_LEFT or MOTOR_RIGHT
+ * @param map pointer to store the table in use
+ * @return none
+ * @brief  Get a wheel table
+ */
+void MotorCal_GetMap(enum MotorWheel wheel, MotorMap_t *map);
+
+/**
+ * Duty cycle that runs a wheel at a speed, interpolated in its table<br>
+ * 0 rpm gives 0, speeds below the deadband speed give the deadband
+ * duty cycle, speeds above the table give 999.
+ * @param wheel MOTOR_LEFT or MOTOR_RIGHT
+ * @param speed_rpm wanted speed, negative for backward
+ * @return signed duty cycle in permil, for Motor_SetVelocity or MotorRamp_SetTarget
+ * @brief  Speed to duty cycle
+ */
+int16_t MotorCal_Velocity(enum MotorWheel wheel, int16_t speed_rpm);
+
+/**
+ * Run both wheels at a speed, Motor_SetVelocity with MotorCal_Velocity
+ * @param left_rpm  signed speed of the left wheel
+ * @param right_rpm signed speed of the right wheel
+ * @return none
+ * @note   Assumes Motor_Init() has been called
+ * @brief  Set both wheel speeds
+ */
+void MotorCal_SetSpeed(int16_t left_rpm, int16_t right_rpm);
+
+/**
+ * Sort measured points into a table<br>
+ * Makes the speeds non-decreasing (a noisy point takes the speed
+ * of the point before it) and checks the duty cycles increase.
+ * @param map table with Duty_permil and measured Speed_rpm filled in
+ * @return 1 if usable, 0 if the duty cycles do not increase or the wheel never moved
+ * @brief  Clean up a measured table
+ */
+uint8_t MotorCal_Fit(MotorMap_t *map);
+
+/**
+ * Measure the table of both wheels<br>
+ * Steps the duty cycle up until each wheel turns (the deadband), then
+ * measures the steady-state speed at MOTORCAL_POINTS duty cycles from
+ * the deadband to 999, once forward and once backward, and averages.
+ * The robot drives about 1.5 m forward and comes back.
+ * Blocks for about 15 s.
+ * @param maps pointer to store the tables, indexed by enum MotorWheel
+ * @return 1 if both tables are usable, 0 if not
+ * @note   Assumes Clock_Init48MHz(), Motor_Init() and Tachometer_Init() have
+ *         been called, and interrupts are enabled.
+ * @brief  Calibrate both wheels
+ */
+uint8_t MotorCal_Run(MotorMap_t maps[MOTOR_NUM_WHEELS]);
+
+/**
+ * Fill a calibration record ready to be written to flash<br>
+ * Sets the magic number and the checksum.
+ * @param record pointer to the record to fill
+ * @param maps tables of both wheels, indexed by enum MotorWheel
+ * @return none
+ * @brief  Build a motor calibration record
+ */
+void MotorCal_MakeRecord(MotorCalRecord_t *record, const MotorMap_t maps[MOTOR_NUM_WHEELS]);
+
+/**
+ * Check the magic number and checksum of a calibration record
+ * @param record pointer to the record
+ * @return 1 if valid, 0 if not
+ * @brief  Validate a motor calibration record
+ */
+uint8_t MotorCal_CheckRecord(const MotorCalRecord_t *record);
+
+/**
+ * Store both tables in flash and use them from now on
+ * @param maps tables of both wheels, indexed by enum MotorWheel
+ * @return 1 if saved, 0 on a flash error or unusable tables
+ * @note   No other code may read the information memory meanwhile.
+ * @brief  Save motor calibration
+ */
+uint8_t MotorCal_Save(const MotorMap_t maps[MOTOR_NUM_WHEELS]);
+
+#endif /* MOTORCAL_H_ */
@@ -0,0 +1,84 @@
+/*
+ * MotorRamp.c
+ * Runs on MSP432
+ *
+ * Acceleration-limited motor commands, see MotorRamp.h.
+ *
+ */
+
+#include <stdint.h>
+#include "msp.h"
+#include "../inc/CortexM.h"
+#include "../inc/Motor.h"
+#include "../inc/MotorRamp.h"
+
+static uint16_t Rate;                   // permil per tick, 0 = no limit
+static volatile int16_t TargetLeft;     // written by the foreground, read by SysTick_Handler
+static volatile int16_t TargetRight;
+static volatile int16_t ActualLeft;     // last duty cycles sent to Motor_SetVelocity
+static volatile int16_t ActualRight;
+
+int16_t MotorRamp_Step(int16_t actual, int16_t target, uint16_t maxStep) {
+    int32_t diff = (int32_t)target - actual;
+    if ((maxStep == 0) || ((diff <= maxStep) && (diff >= -(int32_t)maxStep))) {
+        return target;
+    }
+    return (diff > 0) ? actual + maxStep : actual - maxStep;
+}
+
+void MotorRamp_Init(uint16_t rate_permil_per_ms) {
+    Rate = rate_permil_per_ms * MOTOR_RAMP_TICK_MS;
+    TargetLeft = 0;
+    TargetRight = 0;
+    ActualLeft = 0;
+    ActualRight = 0;
+
+    SysTick->CTRL = 0;                  // disable SysTick during setup
+    SysTick->LOAD = 48000 * MOTOR_RAMP_TICK_MS - 1;   // 48 MHz bus clock
+    SysTick->VAL = 0;                   // any write clears the count
+    SCB->SHP[11] = MOTOR_RAMP_PRIORITY << 5;
+    SysTick->CTRL = 0x00000007;         // enable with core clock and interrupts
+}
+
+void MotorRamp_SetRate(uint16_t rate_permil_per_ms) {
+    Rate = rate_permil_per_ms * MOTOR_RAMP_TICK_MS;
+}
+
+void MotorRamp_SetTarget(int16_t left_permil, int16_t right_permil) {
+    long sr = StartCritical();
+    TargetLeft = left_permil;
+    TargetRight = right_permil;
+    EndCritical(sr);
+}
+
+void MotorRamp_Brake(void) {
+    long sr = StartCritical();
+    TargetLeft = 0;
+    TargetRight = 0;
+    ActualLeft = 0;
+    ActualRight = 0;
+    Motor_Brake();
+    EndCritical(sr);
+}
+
+void MotorRamp_Get(int16_t *left_permil, int16_t *right_permil) {
+    long sr = StartCritical();
+    *left_permil = ActualLeft;
+    *right_permil = ActualRight;
+    EndCritical(sr);
+}
+
+// Runs every MOTOR_RAMP_TICK_MS; only talks to the motors while ramping.
+// A critical section, so a MotorRamp_Brake from a higher priority
+// interrupt (e.g. a bump) cannot be undone by a step computed before it.
+void SysTick_Handler(void) {
+    long sr = StartCritical();
+    int16_t left = MotorRamp_Step(ActualLeft, TargetLeft, Rate);
+    int16_t right = MotorRamp_Step(ActualRight, TargetRight, Rate);
+    if ((left != ActualLeft) || (right != ActualRight)) {
+        ActualLeft = left;
+        ActualRight = right;
+        Motor_SetVelocity(left, right);
+    }
+    EndCritical(sr);
+}
@@ -0,0 +1,76 @@
+/*
+ * MotorRamp.h
+ * Runs on MSP432
+ *
+ * Acceleration-limited motor commands.  Callers set a target signed
+ * duty cycle for each wheel; a 1 kHz SysTick task moves the actual
+ * duty cycles toward the targets by at most the ramp rate each
+ * millisecond and passes them to Motor_SetVelocity.  Limiting how
+ * fast the duty cycle changes keeps the wheels from slipping, so the
+ * tachometer distances stay a good measure of the robot's travel.
+ * MotorRamp_Brake bypasses the ramp for emergencies.
+ *
+ */
+
+#ifndef MOTORRAMP_H_
+#define MOTORRAMP_H_
+
+#define MOTOR_RAMP_TICK_MS     1    // SysTick task period
+#define MOTOR_RAMP_PRIORITY    2    // SysTick priority, below the bump and PWM update interrupts
+
+/**
+ * Move a duty cycle toward its target by at most maxStep.
+ * The ramp goes through 0 when the direction changes.
+ * @param actual present signed duty cycle in permil
+ * @param target wanted signed duty cycle in permil
+ * @param maxStep largest change, 0 means no limit
+ * @return next signed duty cycle in permil
+ * @brief  One step of the ramp
+ */
+int16_t MotorRamp_Step(int16_t actual, int16_t target, uint16_t maxStep);
+
+/**
+ * Start the 1 kHz ramp task with both wheels stopped.
+ * @param rate_permil_per_ms largest duty cycle change per ms, 0 means no limit
+ * @return none
+ * @note   Assumes Motor_Init() and Clock_Init48MHz() have been called.
+ *         Uses SysTick; interrupts must be enabled for the ramp to run.
+ * @brief  Initialize the motor ramp
+ */
+void MotorRamp_Init(uint16_t rate_permil_per_ms);
+
+/**
+ * @param rate_permil_per_ms largest duty cycle change per ms, 0 means no limit
+ * @return none
+ * @brief  Change the ramp rate
+ */
+void MotorRamp_SetRate(uint16_t rate_permil_per_ms);
+
+/**
+ * Set the duty cycles the wheels ramp toward, both at once.
+ * Positive is forward, negative backward, as for Motor_SetVelocity.
+ * @param left_permil  signed target duty cycle of left wheel (-999 to 999)
+ * @param right_permil signed target duty cycle of right wheel (-999 to 999)
+ * @return none
+ * @brief  Set the target velocities
+ */
+void MotorRamp_SetTarget(int16_t left_permil, int16_t right_permil);
+
+/**
+ * Emergency stop: brake both wheels now, without ramping, and set
+ * both targets to 0.  A later MotorRamp_SetTarget ramps up from 0.
+ * @param none
+ * @return none
+ * @brief  Brake immediately
+ */
+void MotorRamp_Brake(void);
+
+/**
+ * @param left_permil  pointer to store the present left duty cycle
+ * @param right_permil pointer to store the present right duty cycle
+ * @return none
+ * @brief  Duty cycles the ramp has reached
+ */
+void MotorRamp_Get(int16_t *left_permil, int16_t *right_permil);
+
+#endif /* MOTORRAMP_H_ */
@@ -88,6 +88,7 @@ policies, either expressed or implied, of the FreeBSD Project.
 #include <stdint.h>
 #include "msp.h"
 #include "SPIA3.h"
+#include "Format.h"
 
 // *************************** Screen dimensions ***************************
 #define SCREENW     84
@@ -113,6 +114,36 @@ policies, either expressed or implied, of the FreeBSD Project.
 #define DC          (*((volatile uint8_t *)0x42099058))   /* Port 9 Output, bit 6 is DC*/
 #define RESET       (*((volatile uint8_t *)0x4209904C))   /* Port 9 Output, bit 3 is RESET*/
 
+#define SCREEN_SIZE (SCREENW*SCREENH/8)
+
+uint8_t Screen[SCREEN_SIZE]; // buffer stores the next image to be printed on the screen
+
+// One bit per Screen byte, set when the byte may differ from what the
+// display shows.  Nokia5110_Update sends only the marked bytes, so
+// everything that changes Screen or writes the display must keep the
+// bits right.  Bytes 0 to 503 are bits 0 to 31 of Dirty[0] and so on.
+static uint32_t Dirty[(SCREEN_SIZE + 31)/32];
+
+static void markDirty(uint16_t i) {
+    Dirty[i >> 5] |= 1u << (i & 31);
+}
+
+// Store a byte of Screen, marking it only if it changes
+static void put(uint16_t i, uint8_t data) {
+    if (Screen[i] != data) {
+        Screen[i] = data;
+        markDirty(i);
+    }
+}
+
+// The display contents are unknown, send all of Screen next time
+static void invalidate(void) {
+    for (int i = 0; i < SCREEN_SIZE/32; i++) {
+        Dirty[i] = 0xFFFFFFFF;
+    }
+    Dirty[SCREEN_SIZE/32] = (1u << (SCREEN_SIZE % 32)) - 1;
+}
+
 
 // This table contains the hex values that represent pixels
 // for a font that is 5 pixels wide and 8 pixels high
@@ -339,6 +370,8 @@ void Nokia5110_SetContrast(uint8_t contrast){
     commandwrite(0x14);     // LCD bias mode 1:48: try 0x13 or 0x14
     commandwrite(0x20);     // we must send 0x20 before modifying the display control mode
     commandwrite(0x0C);     // set display control to normal mode: 0x0D for inverse
+
+    invalidate();           // display RAM is undefined after a reset
 }
 
 
@@ -387,6 +420,8 @@ void Nokia5110_Init(void) {
 // Note: takes 14us to output a character
 void Nokia5110_OutChar(char data) {
 
+    invalidate();           // written where the cursor is, Screen no longer matches
+
     datawrite(0x00);        // blank vertical line padding
     for(int i = 0; i < 5; i = i+1){
         datawrite(ASCII[data - 0x20][i]);
@@ -406,105 +441,30 @@ void Nokia5110_OutString(const char* ptr){                          //BONUS - DO
     }
 }
 
-#define STR_NUM_LENGTH 12   // To store a string for 32-bit signed and unsigned integers.
-static char Buffer[STR_NUM_LENGTH];
-
-//******** Nokia_Num2String *****************
-// This is a static (private and internal) helper function.
-// Converts a number to a fixed-length string and store it
-// in Buffer defined above.
-// Input:
-// n: a number to convert into a string.
-//   It must be an unsigned integer: uint8_t, uint16_t, uint32_t, or unsigned int.
-// Output: number of digits in the string.
-//
-// Examples:
-// If the input is 24860, Buffer becomes "06842xxxxx" and it returns 5 (# of digits).
-//             +---+---+---+---+---+---+---+---+---+---+
-//  Buffer --> |'0'|'6'|'8'|'4'|'2'| x | x | x | x | x |
-//             +---+---+---+---+---+---+---+---+---+---+
-// If the input is 4860, the output will be "0684xxxxxx" and it returns 4  (# of digits).
-// If the input is 860, the output will be "068xxxxxxx" and it returns 3  (# of digits).
-// where x denotes a garbage value previously stored in the array.
-static int Nokia_Num2String(uint32_t n) {
-
-    int count = 0;
-    do {
-        Buffer[count++] = (n%10) + '0';
-        n = n/10;
-    } while (n);
-
-    return count;
-}
-
+// Numbers are converted by Format.c and printed as one string.
 
-void Nokia5110_OutUDec(uint32_t n, int min_length){
-    int count = Nokia_Num2String(n);                                    //given
-
-    if (count >= min_length){                                           //iterate through the string, account for starting from back
-        for (int i = 0; i < count; i++){
-            Nokia5110_OutChar(Buffer[count - (i + 1)]);
-        }
+// min_length as a Format width, longer than a row is the same as a row
+static uint8_t minWidth(int min_length){
+    if(min_length < 0){
+        return 0;
     }
-    else {                                                              //if we need spaces, add spaces and iterate using min_length
-        while (count != 0) {
-            if (min_length > count) {                                   //our "if" was the easy part - no spaces needed
-                Nokia5110_OutChar(' ');                                 //count is the length of the string, and min_length is the minimum length
-                min_length--;                                           //we iterate using min_length - this becomes the number of spaces needed to be filled (dynamic, changes)
-            }
-            else {                                                      //this is the other case; when the string is longer than min length
-                Nokia5110_OutChar(Buffer[min_length - 1]);              //account for printing from the back
-                min_length--;                                           //iterate both number of spaces left (min_length) and the length of the string (count)
-                count--;
-            }
-}
-}
-}
-
-//********HexSingle_Helper*****************
-// Helper function to display a single hex digit.
-// Prints one character between 0 and F
-// Inputs: n unsigned number to print.
-//   n will be bit masked: n = n & 0x0F;
-// Outputs: none
-static void HexSingle_Helper(uint8_t n){
-    n = n & 0x0F;
-    if(n > 9) {
-        Nokia5110_OutChar('A'+n-10);
-    } else {
-        Nokia5110_OutChar(n+'0');        // ones digit
+    if(min_length > FORMAT_MAX_WIDTH){
+        return FORMAT_MAX_WIDTH;
     }
+    return min_length;
 }
 
-void Nokia5110_OutSDec(int32_t n, int min_length){
-    uint32_t x = 0;                                             //given
-
-    if (n < 0) {                                                //if number is negative, we set x to be the abs value
-        x = (uint32_t)(-n);
-    }
-    else {                                                      //unchanged value, positive number
-        x = (uint32_t)(n);
-    }
-
-    int count = Nokia_Num2String(x);                            //x is set to the length of the number, which became a string
-    int count2 = count;                                         //this is a width that takes into account the additional width from the negative sign
-                                                                //however, initialize it as count for standard (positive) numbers
-    if (n < 0) {                                                //if negative, this increases (as stated above
-        count2 = count + 1;
-    }
-
-    while (min_length > count2) {                               //iterate via min_length, compare to width to determine spaces needed
-        Nokia5110_OutChar(' ');
-        min_length--;
-    }
+void Nokia5110_OutUDec(uint32_t n, int min_length){
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UDec(buf, n, minWidth(min_length));
+    Nokia5110_OutString(buf);
+}
 
-    if (n < 0) {                                                //negative comes AFTER spaces, as to not distort the spacing between the sign and numbers on the LCD
-        Nokia5110_OutChar('-');
-    }
 
-    for (int i = 0; i < count; i++) {                           //iterate though the string (count) via for-loop
-        Nokia5110_OutChar(Buffer[count - (i + 1)]);             //use Buffer, as the string is stored here - use count as the address - account for starting from back
-    }
+void Nokia5110_OutSDec(int32_t n, int min_length){
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_SDec(buf, n, minWidth(min_length));
+    Nokia5110_OutString(buf);
 }
 
 
@@ -514,9 +474,9 @@ void Nokia5110_OutSDec(int32_t n, int min_length){
 // Inputs: n unsigned number 0-255 to print
 // Outputs: none
 void Nokia5110_OutU8Hex(uint8_t n) {
-    Nokia5110_OutString("0x");
-    HexSingle_Helper(n/16);            // 16s digit
-    HexSingle_Helper(n);               // ones digit
+    char buf[FORMAT_BUFFER_SIZE] = "0x";
+    Format_UHex(&buf[2], n, 2);
+    Nokia5110_OutString(buf);
 }
 
 
@@ -534,6 +494,150 @@ void Nokia5110_Out8Bin(uint8_t n) {
 
 
 
+// Retained-mode drawing: the functions below only change Screen, and
+// Nokia5110_Update sends the bytes that changed.  Drawing what is
+// already shown costs no SPI time at all.
+
+// Clean bytes between two changed ones that are sent anyway rather
+// than starting a new run; a cursor move is two commands, each
+// waiting for the SPI to go idle.
+#define MAX_GAP 2
+
+//********Nokia5110_DrawString*****************
+// Draw a string into the screen buffer at a character cell,
+// 7 columns per character as Nokia5110_OutChar prints them.
+// Characters past the right edge are cut off.
+// Inputs: row  1 (top) to 6 (bottom)
+//         col  1 (left) to 12 (right)
+//         ptr  pointer to NULL-terminated ASCII string
+// Outputs: none
+void Nokia5110_DrawString(uint8_t row, uint8_t col, const char *ptr){
+    if((row < 1) || (row > 6) || (col < 1) || (col > 12)){
+        return;
+    }
+    uint16_t i = SCREENW*(row-1) + 7*(col-1);
+    uint16_t end = SCREENW*row;
+    while((*ptr != '\0') && (i < end)){
+        uint8_t c = *ptr++;
+        if((c < 0x20) || (c > 0x7F)){
+            c = ' ';
+        }
+        put(i++, 0x00);         // blank vertical line padding
+        for(int k = 0; k < 5; k = k+1){
+            put(i++, ASCII[c - 0x20][k]);
+        }
+        put(i++, 0x00);         // blank vertical line padding
+    }
+}
+
+
+void Nokia5110_DrawUDec(uint8_t row, uint8_t col, uint32_t n, int min_length){
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UDec(buf, n, minWidth(min_length));
+    Nokia5110_DrawString(row, col, buf);
+}
+
+
+void Nokia5110_DrawSDec(uint8_t row, uint8_t col, int32_t n, int min_length){
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_SDec(buf, n, minWidth(min_length));
+    Nokia5110_DrawString(row, col, buf);
+}
+
+
+//********Nokia5110_FillRect*****************
+// Turn a rectangle of the screen buffer on or off, e.g. for
+// bar graphs or to blank part of the screen.  Parts outside
+// the screen are cut off.
+// Inputs: i       top row (0 to 47), y-coordinate
+//         j       left column (0 to 83), x-coordinate
+//         height  rows
+//         width   columns
+//         on      1 to turn the pixels on, 0 to turn them off
+// Outputs: none
+void Nokia5110_FillRect(uint32_t i, uint32_t j, uint32_t height, uint32_t width, uint8_t on){
+    if((i >= SCREENH) || (j >= SCREENW)){
+        return;
+    }
+    if(height > SCREENH - i){
+        height = SCREENH - i;
+    }
+    if(width > SCREENW - j){
+        width = SCREENW - j;
+    }
+    uint32_t bottom = i + height;
+    while(i < bottom){
+        // the rows of this rectangle in one bank of 8
+        uint32_t bits = 8 - (i & 0x07);
+        if(bits > bottom - i){
+            bits = bottom - i;
+        }
+        uint8_t mask = ((1u << bits) - 1) << (i & 0x07);
+        uint16_t k = SCREENW*(i >> 3) + j;
+        for(uint32_t x = 0; x < width; x = x+1){
+            put(k, on ? (Screen[k] | mask) : (Screen[k] & ~mask));
+            k = k+1;
+        }
+        i = i + bits;
+    }
+}
+
+
+//********Nokia5110_Invalidate*****************
+// Mark the whole screen buffer as changed, so the next
+// Nokia5110_Update sends all of it.
+// Inputs: none
+// Outputs: none
+void Nokia5110_Invalidate(void){
+    invalidate();
+}
+
+
+//********Nokia5110_Update*****************
+// Send the screen buffer bytes that changed since the display
+// last showed them.  Each run of changed bytes in a bank costs
+// one cursor move plus its bytes; the cursor move is skipped
+// when the run starts where the previous one ended.
+// Inputs: none
+// Outputs: number of bytes sent, commands included
+// Assumes: LCD is in default horizontal addressing mode (V = 0)
+uint16_t Nokia5110_Update(void){
+    uint16_t sent = 0;
+    uint16_t address = SCREEN_SIZE;     // display RAM address, none known yet
+    uint16_t i = 0;
+    while(i < SCREEN_SIZE){
+        if(Dirty[i >> 5] == 0){
+            i = (i | 31) + 1;           // 32 clean bytes
+            continue;
+        }
+        if((Dirty[i >> 5] & (1u << (i & 31))) == 0){
+            i = i+1;
+            continue;
+        }
+        // a run ends at the bank edge or after more than MAX_GAP clean bytes
+        uint16_t bankEnd = SCREENW*(i/SCREENW + 1);
+        uint16_t last = i;
+        for(uint16_t k = i+1; (k < bankEnd) && (k - last <= MAX_GAP + 1); k = k+1){
+            if(Dirty[k >> 5] & (1u << (k & 31))){
+                last = k;
+            }
+        }
+        if(address != i){
+            commandwrite(0x80|(i % SCREENW));   // setting bit 7 updates X-position
+            commandwrite(0x40|(i / SCREENW));   // setting bit 6 updates Y-position
+            sent = sent + 2;
+        }
+        sent = sent + (last + 1 - i);
+        for(; i <= last; i = i+1){
+            datawrite(Screen[i]);
+            Dirty[i >> 5] &= ~(1u << (i & 31));
+        }
+        address = i;                    // the display moves on by itself, into the next bank too
+    }
+    return sent;
+}
+
+
 // ==========================================================
 //
 //               DO NOT MODIFY ANYTHING BELOW
@@ -588,6 +692,9 @@ void Nokia5110_Clear(void){
     int i;
     for(i=0; i<(MAX_X*MAX_Y/8); i=i+1){
         datawrite(0x00);
+        if(Screen[i]){
+            markDirty(i);
+        }
     }
 
     Nokia5110_SetCursor2(1, 1);
@@ -604,12 +711,13 @@ void Nokia5110_DrawFullImage(const uint8_t *ptr){
     Nokia5110_SetCursor2(1, 1);
     for(i=0; i<(MAX_X*MAX_Y/8); i=i+1){
         datawrite(ptr[i]);
+        if(Screen[i] != ptr[i]){
+            markDirty(i);
+        }
     }
 }
 
 
-uint8_t Screen[SCREENW*SCREENH/8]; // buffer stores the next image to be printed on the screen
-
 //********Nokia5110_PrintBMP*****************
 // Bitmaps defined above were created for the LM3S1968 or
 // LM3S8962's 4-bit grayscale OLED display.  They also
@@ -661,18 +769,18 @@ void Nokia5110_PrintBMP(uint8_t xpos, uint8_t ypos, const uint8_t *bmp, uint8_t
 
         // the left pixel is in the upper 4 bits
         if(((bmp[j]>>4)&0xF) > threshold){
-          Screen[screenx] |= mask;
+          put(screenx, Screen[screenx] | mask);
         } else{
-          Screen[screenx] &= ~mask;
+          put(screenx, Screen[screenx] & ~mask);
         }
 
         screenx = screenx + 1;
 
         // the right pixel is in the lower 4 bits
         if((bmp[j]&0xF) > threshold){
-          Screen[screenx] |= mask;
+          put(screenx, Screen[screenx] | mask);
         } else{
-          Screen[screenx] &= ~mask;
+          put(screenx, Screen[screenx] & ~mask);
         }
 
         screenx = screenx + 1;
@@ -705,19 +813,20 @@ void Nokia5110_PrintBMP(uint8_t xpos, uint8_t ypos, const uint8_t *bmp, uint8_t
 // Outputs: none
 void Nokia5110_ClearBuffer(void){int i;
     for(i=0; i<SCREENW*SCREENH/8; i=i+1){
-        Screen[i] = 0;              // clear buffer
+        put(i, 0);                  // clear buffer
     }
 }
 
 
 //********Nokia5110_DisplayBuffer*****************
 // Fill the whole screen by drawing a 48x84 screen image
-// from the RAM buffer.
+// from the RAM buffer.  Only the bytes that changed since
+// the display last showed them are sent.
 // Inputs: none
 // Outputs: none
 // Assumes: LCD is in default horizontal addressing mode (V = 0)
 void Nokia5110_DisplayBuffer(void){
-    Nokia5110_DrawFullImage(Screen);
+    Nokia5110_Update();
 }
 
 
@@ -729,7 +838,7 @@ const unsigned char Masks[8]={0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80};
 //        j  the column index  (0 to 83 in this case), x-coordinate
 // Output: none
 void Nokia5110_ClrPxl(uint32_t i, uint32_t j){
-    Screen[84*(i>>3) + j] &= ~Masks[i&0x07];
+    put(84*(i>>3) + j, Screen[84*(i>>3) + j] & ~Masks[i&0x07]);
 }
 
 
@@ -740,5 +849,5 @@ void Nokia5110_ClrPxl(uint32_t i, uint32_t j){
 //        j  the column index  (0 to 83 in this case), x-coordinate
 // Output: none
 void Nokia5110_SetPxl(uint32_t i, uint32_t j){
-    Screen[84*(i>>3) + j] |= Masks[i&0x07];
+    put(84*(i>>3) + j, Screen[84*(i>>3) + j] | Masks[i&0x07]);
 }
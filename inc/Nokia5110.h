@@ -326,7 +326,8 @@ void Nokia5110_ClearBuffer(void);
 
 /**
  * Fill the whole screen by drawing a 48x84 screen image
- * from the RAM buffer.
+ * from the RAM buffer.  Only the bytes that changed since the
+ * display last showed them are sent, see Nokia5110_Update().
  * @param none
  * @return none
  * @note  LCD is in default horizontal addressing mode (V = 0)
@@ -359,5 +360,94 @@ void Nokia5110_ClrPxl(uint32_t i, uint32_t j);
  */
 void Nokia5110_SetPxl(uint32_t i, uint32_t j);
 
+/**
+ * Draw a string into the internal screen buffer at a character
+ * cell, 7 columns per character as Nokia5110_OutChar() prints
+ * them.  Characters past the right edge are cut off.  Drawing
+ * the text that is already there changes nothing, so a status
+ * display can simply redraw every field each time.
+ * @param row  row of the first character (1 <= row <= 6)
+ * @param col  column of the first character (1 <= col <= 12)
+ * @param ptr  pointer to NULL-terminated ASCII string
+ * @return none
+ * @note Call Nokia5110_Update() to see this change.
+ * @see Nokia5110_DrawUDec(), Nokia5110_DrawSDec(), Nokia5110_Update()
+ * @brief  Draw a string in internal screen buffer.
+ */
+void Nokia5110_DrawString(uint8_t row, uint8_t col, const char *ptr);
+
+/**
+ * Draw a number in unsigned decimal format into the internal
+ * screen buffer, padded as Nokia5110_OutUDec() does.
+ * @param row  row of the first character (1 <= row <= 6)
+ * @param col  column of the first character (1 <= col <= 12)
+ * @param n  32-bit unsigned number
+ * @param min_length minimum length to draw, spaces are added in front
+ * @return none
+ * @note Call Nokia5110_Update() to see this change.
+ * @see Nokia5110_DrawString(), Nokia5110_OutUDec(), Nokia5110_Update()
+ * @brief  Draw a 32-bit unsigned number in internal screen buffer.
+ */
+void Nokia5110_DrawUDec(uint8_t row, uint8_t col, uint32_t n, int min_length);
+
+/**
+ * Draw a number in signed decimal format into the internal
+ * screen buffer, padded as Nokia5110_OutSDec() does.
+ * @param row  row of the first character (1 <= row <= 6)
+ * @param col  column of the first character (1 <= col <= 12)
+ * @param n  32-bit signed number
+ * @param min_length minimum length to draw, spaces are added in front
+ * @return none
+ * @note Call Nokia5110_Update() to see this change.
+ * @see Nokia5110_DrawString(), Nokia5110_OutSDec(), Nokia5110_Update()
+ * @brief  Draw a 32-bit signed number in internal screen buffer.
+ */
+void Nokia5110_DrawSDec(uint8_t row, uint8_t col, int32_t n, int min_length);
+
+/**
+ * Turn a rectangle of the internal screen buffer on or off,
+ * e.g. for bar graphs or to blank part of the screen.  Parts
+ * outside the screen are cut off.
+ * @param i  top row (0 to 47), y-coordinate
+ * @param j  left column (0 to 83), x-coordinate
+ * @param height  number of rows
+ * @param width  number of columns
+ * @param on  1 to turn the pixels on, 0 to turn them off
+ * @return none
+ * @note Call Nokia5110_Update() to see this change.
+ * @see Nokia5110_SetPxl(), Nokia5110_ClrPxl(), Nokia5110_Update()
+ * @brief  Fill a rectangle in internal screen buffer.
+ */
+void Nokia5110_FillRect(uint32_t i, uint32_t j, uint32_t height, uint32_t width, uint8_t on);
+
+/**
+ * Mark the whole internal screen buffer as changed, so the
+ * next Nokia5110_Update() sends all of it.  Needed only after
+ * writing to the display in a way this driver cannot see.
+ * @param none
+ * @return none
+ * @see Nokia5110_Update()
+ * @brief  Resend the whole screen on the next update.
+ */
+void Nokia5110_Invalidate(void);
+
+/**
+ * Send the bytes of the internal screen buffer that changed
+ * since the display last showed them.  The buffer functions
+ * (Nokia5110_Draw..., Nokia5110_FillRect(), Nokia5110_SetPxl(),
+ * Nokia5110_ClrPxl(), Nokia5110_PrintBMP(), Nokia5110_ClearBuffer())
+ * record which bytes they change.  Each run of changed bytes
+ * costs one cursor move plus the bytes themselves.  Printing
+ * with Nokia5110_OutChar() and friends, or Nokia5110_SetContrast(),
+ * makes the next update send the whole buffer.
+ * @param none
+ * @return number of bytes sent over SPI, commands included
+ * @note  Call it from the main loop, not an ISR.  It moves the
+ *        cursor, so set it again before printing with Nokia5110_OutChar().
+ * @see Nokia5110_DrawString(), Nokia5110_DisplayBuffer()
+ * @brief  Send the changed part of internal screen buffer to the display.
+ */
+uint16_t Nokia5110_Update(void);
+
 
 #endif /* NOKIA5110_H_ */
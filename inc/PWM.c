@@ -44,17 +44,27 @@ those of the authors and should not be interpreted as representing official
 policies, either expressed or implied, of the FreeBSD Project.
 */
 
+#include <stdint.h>
 #include "msp.h"
+#include "../inc/PWM.h"
 
+// Writes one output's compare value.  Reset/set (OUTMOD 7) would still
+// give a one-count pulse at 0, so 0 holds the output low (OUTMOD 0).
+static void setCompare(int i, uint16_t compare){
+    TIMER_A0->CCR[i] = compare;
+    TIMER_A0->CCTL[i] = compare ? 0x00E0 : 0x0000;
+}
 
 //***************************PWM_Init34*******************************
 // Initializes PWM outputs on P2.6 and P2.7
 // Inputs: period (in 1.333µs units)
-// Configures TimerA0 with SMCLK=12MHz, divide by 8, up-down mode
+// Configures TimerA0 with SMCLK=12MHz, divide by 16, up mode
 // P2.6: PWM signal based on TA0CCR3, P2.7: PWM signal based on TA0CCR4
-// TimerA0 period: T_TA0 = T_c_TA0 * CCR0 = CCR0 * 2/3 us.
-// PWM period: T_PWM = T_TA0 * 2 = CCR0 * 4/3 us.
-// Duty cycle for P2.6: duty_right/period, for P2.7: duty_left/period
+// TimerA0 counts 0 to CCR0 = period-1, T_c_TA0 = 4/3 us.
+// PWM period: T_PWM = (CCR0+1) * 4/3 us = period * 4/3 us.
+// Each output is set when TA0R wraps to 0 and reset when it reaches
+// its compare value, so both pulses start together at the wrap.
+// Both outputs start low, OUTMOD 0, see PWM_DutyRight and PWM_DutyLeft.
 void PWM_Init34(uint16_t period){
 
     // write this as part of Lab 13
@@ -64,42 +74,96 @@ void PWM_Init34(uint16_t period){
     P2->SEL0 |= 0b11000000;
     P2->SEL1 &= ~0b11000000;
     P2->DIR |= 0b11000000;
-    TIMER_A0->CCTL[0] =	0b10000000;		// CCI0 toggle
-    TIMER_A0->CCR[0] =	period;		// T_PWM is CCR0*4/3 us, if CCR0 = 15000, T_PWM = 20 ms.
-    TIMER_A0->EX0 =	0;			// divide by 1
-    TIMER_A0->CCTL[3] =	0x0040;		// CCR3 toggle/reset
-    TIMER_A0->CCR[3] =	0;		// CCR3 duty cycle is duty1/period
-    TIMER_A0->CCTL[4] =	0x0040;		// CCR4 toggle/reset
-    TIMER_A0->CCR[4] = 0;		// CCR4 duty cycle is duty2/period
-    TIMER_A0->CTL =	0x02F0;			// SMCLK=12MHz, divide by 8, up-down mode
+    TIMER_A0->CCTL[0] =	0x0000;		// CCR0 only sets the period
+    TIMER_A0->CCR[0] =	period - 1;	// T_PWM is (CCR0+1)*4/3 us, if CCR0 = 14999, T_PWM = 20 ms.
+    TIMER_A0->EX0 =	1;			// divide by 2
+    TIMER_A0->CCTL[3] =	0x0000;		// CCR3 output low
+    TIMER_A0->CCR[3] =	0;		// CCR3 duty cycle is CCR3/period
+    TIMER_A0->CCTL[4] =	0x0000;		// CCR4 output low
+    TIMER_A0->CCR[4] = 0;		// CCR4 duty cycle is CCR4/period
+    TIMER_A0->CTL =	0x02D4;			// SMCLK=12MHz, divide by 8, clear, up mode
     
 
 }
 
 
+//***************************PWM_SetFrequency34*******************************
+// Changes the frequency of the PWM outputs on P2.6 and P2.7 at run time.
+// Uses the smallest TimerA0 clock divider that fits the period in 16 bits,
+// so the duty cycle has CCR0+1 steps: 60000 at 50 Hz, 2400 at 5 kHz,
+// 600 at 20 kHz (0.17%).  Finer than 0.1% needs 1000 steps, up to
+// 12 kHz with SMCLK = 12 MHz in up mode.
+// Both duty cycles are kept, rescaled to the new period.
+// Inputs: frequency_Hz, PWM_MIN_FREQUENCY_HZ to PWM_MAX_FREQUENCY_HZ, clamped
+// Outputs: none
+// Assumes: PWM_Init34 has been called, SMCLK = 12 MHz
+void PWM_SetFrequency34(uint32_t frequency_Hz){
+    uint32_t counts, divider, id, ex;
+
+    if (frequency_Hz < PWM_MIN_FREQUENCY_HZ) {
+        frequency_Hz = PWM_MIN_FREQUENCY_HZ;
+    }
+    if (frequency_Hz > PWM_MAX_FREQUENCY_HZ) {
+        frequency_Hz = PWM_MAX_FREQUENCY_HZ;
+    }
+
+    // up mode: T_PWM = (CCR0 + 1) * divider / SMCLK
+    // divider = ID (1, 2, 4, 8) * EX0 (1 to 8), at most 65536 counts
+    counts = PWM_SMCLK_HZ / frequency_Hz;
+    divider = (counts + 65535) / 65536;
+    id = 0;
+    while (divider > 8 * (1u << id)) {
+        id++;           // /2, /4, /8
+    }
+    ex = (divider + (1u << id) - 1) >> id;    // 1 to 8
+    divider = ex << id;
+    counts = (PWM_SMCLK_HZ / divider + frequency_Hz / 2) / frequency_Hz;   // rounded
+
+    // keep both duty cycles, as a fraction of the period
+    uint32_t old = TIMER_A0->CCR[0] + 1;
+    uint32_t right = (TIMER_A0->CCR[3] * counts + old / 2) / old;
+    uint32_t left = (TIMER_A0->CCR[4] * counts + old / 2) / old;
+
+    TIMER_A0->CTL &= ~0x0030;       // stop, MC = 0
+    TIMER_A0->EX0 = ex - 1;
+    TIMER_A0->CCR[0] = counts - 1;
+    setCompare(3, (right > counts - 2) ? counts - 2 : right);
+    setCompare(4, (left > counts - 2) ? counts - 2 : left);
+    TIMER_A0->CTL = 0x0200 | (id << 6) | 0x0004 | 0x0010;  // SMCLK, ID, clear TA0R, up mode
+}
+
+
+//***************************PWM_Compare34*******************************
+// Converts a duty cycle to a TA0CCR3/TA0CCR4 value for the current period.
+// The output is high for compare counts out of CCR0+1.  The result is
+// capped at CCR0-1, so every period ends low and TA0_0_IRQHandler in
+// Motor.c always finds both pulses still running or already over.
+// Inputs: duty_permil, duty cycle in 0.1% units, values above 1000 saturate
+// Outputs: compare value, 0 to CCR0-1, rounded to nearest
+uint16_t PWM_Compare34(uint16_t duty_permil){
+    uint32_t period = TIMER_A0->CCR[0] + 1;
+    uint32_t compare;
+
+    if (duty_permil > 1000) {
+        duty_permil = 1000;
+    }
+    compare = (duty_permil * period + 500) / 1000;
+    return (compare > period - 2) ? period - 2 : compare;
+}
+
+
 //***************************PWM_DutyRight*******************************
 // change duty cycle of PWM output on P2.6
 // Inputs:  duty_permil, duty cycle is in per 1,000 (0.1%)
-// Calculates duty cycle as (duty_permil * 30) / 2
+// Converts with PWM_Compare34, which keeps the last count of each period low
 // Updates CCR3 with new duty cycle
 // Outputs: none
 void PWM_DutyRight(uint16_t duty_permil){
 
-    // convert duty_permil (0 - 999) to duty in TA0 unit (0 - 14999)
-    // duty = duty_permil * 15000/1000 (or 30/2)
-    uint16_t duty = (duty_permil * 30) >> 1;
-
     // write this as part of Lab 13
 
-    // if new duty cycle is greater than period, return immediately
-    if (duty > TIMER_A0->CCR[0]){
-        return;
-    }
-
     // assign new duty cycle to CCR[3]
-    TIMER_A0->CCR[3] = duty;
-
-
+    setCompare(3, PWM_Compare34(duty_permil));
 
 }
 
@@ -108,22 +172,13 @@ void PWM_DutyRight(uint16_t duty_permil){
 // Updates duty cycle of PWM on P2.7
 // Inputs: duty_permil (duty cycle in 0.1% steps)
 // Outputs: none
-// Calculates duty cycle as (duty_permil * 30) / 2
+// Converts with PWM_Compare34, which keeps the last count of each period low
 // Updates CCR4 with new duty cycle
 void PWM_DutyLeft(uint16_t duty_permil){
 
-    // convert duty_permil (0 - 999) to duty in TA0 unit (0 - 14999)
-    // duty = duty_permil * 15000/1000 (or 30/2)
-    uint16_t duty = (duty_permil * 30) >> 1;
-
     // write this as part of Lab 13
 
-    // if new duty cycle is greater than period, return immediately
-    if (duty > TIMER_A0->CCR[0]){
-        return;
-    }
-
     // assign new duty cycle to CCR[4]
-    TIMER_A0->CCR[4] = duty;
+    setCompare(4, PWM_Compare34(duty_permil));
 
 }
@@ -61,18 +61,42 @@ policies, either expressed or implied, of the FreeBSD Project.
 
 /**
  * @details  Initializes PWM on P2.6 and P2.7
- * @remark   TimerA0 counts up to CCR0 and back down, 1.333µs per unit
- * @remark   P2.6: 1 when TA0CCR3 on way down, 0 when TA0CCR3 on way up
- * @remark   P2.7: 1 when TA0CCR4 on way down, 0 when TA0CCR4 on way up
+ * @remark   TimerA0 counts up from 0 to period-1, 1.333µs per unit
+ * @remark   P2.6: 1 from the wrap to 0 until TA0CCR3, OUTMOD 0 (low) while TA0CCR3 is 0
+ * @remark   P2.7: 1 from the wrap to 0 until TA0CCR4, OUTMOD 0 (low) while TA0CCR4 is 0
  * @param    period is the PWM period in 1.333µs units
  * @brief    PWM initialization
  */
 void PWM_Init34(uint16_t period);
 
+// SMCLK assumed by PWM_SetFrequency34, set by Clock_Init48MHz
+#define PWM_SMCLK_HZ        12000000
+#define PWM_MIN_FREQUENCY_HZ       2
+#define PWM_MAX_FREQUENCY_HZ   25000
+
+/**
+ * @details  Changes the PWM frequency on P2.6 and P2.7, keeping both duty cycles
+ * @remark   Picks the smallest clock divider, so the period has as many steps as fit in 16 bits
+ * @remark   Duty resolution is 1/(CCR0+1): 0.1% or finer up to 12 kHz, 0.17% at 20 kHz
+ * @param    frequency_Hz is the PWM frequency, PWM_MIN_FREQUENCY_HZ to PWM_MAX_FREQUENCY_HZ
+ * @brief    Set PWM frequency
+ */
+void PWM_SetFrequency34(uint32_t frequency_Hz);
+
+
+/**
+ * @details  Converts a duty cycle to a TA0CCR3/TA0CCR4 compare value for the current period
+ * @remark   The output is high for the compare value in counts out of TA0CCR0+1
+ * @param    duty_permil is the duty cycle in 0.1% units, above 1000 saturates
+ * @return   compare value, 0 to TA0CCR0-1, so every period ends low
+ * @brief    Duty cycle to compare value
+ */
+uint16_t PWM_Compare34(uint16_t duty_permil);
+
 
 /**
  * @details  Updates duty cycle on P2.6
- * @param    duty_permil is the duty cycle in 0.1% units
+ * @param    duty_permil is the duty cycle in 0.1% units, above 1000 saturates
  * @brief    Set duty cycle for P2.6
  */
 void PWM_DutyRight(uint16_t duty_permil);
@@ -80,7 +104,7 @@ void PWM_DutyRight(uint16_t duty_permil);
 
 /**
  * @details  Updates duty cycle on P2.7
- * @param    duty_permil is the duty cycle in 0.1% units
+ * @param    duty_permil is the duty cycle in 0.1% units, above 1000 saturates
  * @brief    Set duty cycle for P2.7
  */
 void PWM_DutyLeft(uint16_t duty_permil);
@@ -0,0 +1,117 @@
+/*
+ * ScenarioTracker.c
+ * Runs on MSP432
+ *
+ * Hysteresis on each sensor plus N-of-M voting over the scenario.
+ * See ScenarioTracker.h.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../inc/ScenarioTracker.h"
+
+// scenario for each combination of open sensors, index = 4*left + 2*center + right
+// Same as Classify except that all open is CrossRoad instead of LeftJoint.
+static const uint8_t OpenTable[8] = {
+    Blocked,        // left closed, center closed, right closed
+    RightTurn,      //                             right open
+    Straight,       //              center open
+    RightJoint,
+    LeftTurn,       // left open,   center closed
+    TeeJoint,
+    LeftJoint,      //              center open
+    CrossRoad
+};
+
+// Move one sensor state across its hysteresis band.
+static uint8_t hysteresis(uint8_t open, int32_t d_mm, int32_t threshold, int32_t band) {
+    if (open) {
+        return d_mm >= threshold - band;
+    }
+    return d_mm >= threshold + band;
+}
+
+void ScenarioTracker_Init(ScenarioTracker_t *tracker, int32_t sideMax_mm, int32_t centerOpen_mm,
+                          int32_t hysteresis_mm, uint8_t votes, uint8_t window, scenario_t initial) {
+
+    if (window < 1) {
+        window = 1;
+    }
+    if (window > TRACKER_MAX_WINDOW) {
+        window = TRACKER_MAX_WINDOW;
+    }
+    if (votes < 1) {
+        votes = 1;
+    }
+    if (votes > window) {
+        votes = window;
+    }
+
+    tracker->SideMax = sideMax_mm;
+    tracker->CenterOpen = centerOpen_mm;
+    tracker->Hysteresis = hysteresis_mm;
+    tracker->LeftOpen = 0;
+    tracker->CenterIsOpen = 0;
+    tracker->RightOpen = 0;
+    tracker->Votes = votes;
+    tracker->Window = window;
+    tracker->Index = 0;
+    for (int i = 0; i < 16; i++) {
+        tracker->Count[i] = 0;
+    }
+    for (int i = 0; i < window; i++) {
+        tracker->History[i] = initial;
+    }
+    tracker->Count[initial & 0x0F] = window;
+    tracker->Scenario = initial;
+    tracker->Duration = 0;
+}
+
+uint8_t ScenarioTracker_Update(ScenarioTracker_t *tracker, int32_t left_mm,
+                               int32_t center_mm, int32_t right_mm, ScenarioEvent_t *event) {
+
+    uint8_t raw;
+
+    if ((left_mm   < IRMIN) || (left_mm   > IRMAX) ||
+        (center_mm < IRMIN) || (center_mm > IRMAX) ||
+        (right_mm  < IRMIN) || (right_mm  > IRMAX)) {
+        raw = ClassificationError;
+    } else {
+        tracker->LeftOpen = hysteresis(tracker->LeftOpen, left_mm, tracker->SideMax, tracker->Hysteresis);
+        tracker->CenterIsOpen = hysteresis(tracker->CenterIsOpen, center_mm, tracker->CenterOpen, tracker->Hysteresis);
+        tracker->RightOpen = hysteresis(tracker->RightOpen, right_mm, tracker->SideMax, tracker->Hysteresis);
+        raw = OpenTable[4*tracker->LeftOpen + 2*tracker->CenterIsOpen + tracker->RightOpen];
+    }
+
+    // replace the oldest vote with this one
+    tracker->Count[tracker->History[tracker->Index]]--;
+    tracker->History[tracker->Index] = raw;
+    tracker->Count[raw]++;
+    tracker->Index++;
+    if (tracker->Index == tracker->Window) {
+        tracker->Index = 0;
+    }
+
+    tracker->Duration++;
+    if ((raw == tracker->Scenario) || (tracker->Count[raw] < tracker->Votes)) {
+        return 0;
+    }
+
+    if (event != NULL) {
+        event->Previous = tracker->Scenario;
+        event->Current = (scenario_t)raw;
+        event->Duration = tracker->Duration - 1;   // this sample belongs to the new scenario
+    }
+    tracker->Scenario = (scenario_t)raw;
+    tracker->Duration = 1;
+    return 1;
+}
+
+scenario_t ScenarioTracker_Scenario(const ScenarioTracker_t *tracker) {
+    return tracker->Scenario;
+}
+
+uint32_t ScenarioTracker_Duration(const ScenarioTracker_t *tracker) {
+    return tracker->Duration;
+}
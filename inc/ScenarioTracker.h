@@ -0,0 +1,97 @@
+/*
+ * ScenarioTracker.h
+ * Runs on MSP432
+ *
+ * Debounces the scenario seen by the three IR sensors over time.
+ * Each sensor is open or closed with hysteresis around its threshold,
+ * and a scenario is accepted only after it wins N of the last M
+ * samples.  A change of the accepted scenario is reported as an
+ * event together with how long the previous scenario lasted.
+ * Unlike Classify, all three sides open is reported as CrossRoad.
+ *
+ * Each update is a handful of compares and two counter updates,
+ * so it can run inside the 50 Hz controller ISR.
+ *
+ */
+
+#ifndef SCENARIOTRACKER_H_
+#define SCENARIOTRACKER_H_
+
+#include "Classifier.h"
+
+#define TRACKER_MAX_WINDOW 16   // largest M for N-of-M voting
+
+/**
+ * \brief A change of the debounced scenario.
+ */
+typedef struct {
+    scenario_t Previous;    // scenario that just ended
+    scenario_t Current;     // scenario that just started
+    uint32_t Duration;      // number of updates Previous was held
+} ScenarioEvent_t;
+
+/**
+ * \brief State of one scenario tracker.
+ */
+typedef struct {
+    int32_t SideMax;        // side threshold in mm
+    int32_t CenterOpen;     // center threshold in mm
+    int32_t Hysteresis;     // half width of the band around each threshold in mm
+    uint8_t LeftOpen;       // sensor states after hysteresis, 1 = open
+    uint8_t CenterIsOpen;
+    uint8_t RightOpen;
+    uint8_t Votes;          // N, votes needed to accept a scenario
+    uint8_t Window;         // M, number of recent samples that vote
+    uint8_t Index;          // next slot in History
+    uint8_t History[TRACKER_MAX_WINDOW];   // last M raw scenarios
+    uint8_t Count[16];      // votes per scenario in History
+    scenario_t Scenario;    // debounced scenario
+    uint32_t Duration;      // updates since Scenario was accepted
+} ScenarioTracker_t;
+
+/**
+ * Initialize a tracker.  Sensor states start closed and the history
+ * is filled with the initial scenario, so nothing is reported until
+ * real samples win the vote.
+ * @param tracker pointer to the tracker state
+ * @param sideMax_mm side threshold, see Classify_SetThresholds
+ * @param centerOpen_mm center threshold, see Classify_SetThresholds
+ * @param hysteresis_mm a sensor opens at threshold+hysteresis and closes below threshold-hysteresis
+ * @param votes N, 1 to window
+ * @param window M, 1 to TRACKER_MAX_WINDOW
+ * @param initial scenario to start in, e.g. Straight
+ * @return none
+ * @brief  Initialize a scenario tracker
+ */
+void ScenarioTracker_Init(ScenarioTracker_t *tracker, int32_t sideMax_mm, int32_t centerOpen_mm,
+                          int32_t hysteresis_mm, uint8_t votes, uint8_t window, scenario_t initial);
+
+/**
+ * Add one set of distance readings.  Readings outside IRMIN to IRMAX
+ * vote for ClassificationError and leave the sensor states alone.
+ * @param tracker pointer to the tracker state
+ * @param left_mm distance measured by the left sensor
+ * @param center_mm distance measured by the center sensor
+ * @param right_mm distance measured by the right sensor
+ * @param event filled in when the debounced scenario changes, may be NULL
+ * @return 1 if the debounced scenario changed, 0 if not
+ * @brief  Update a scenario tracker
+ */
+uint8_t ScenarioTracker_Update(ScenarioTracker_t *tracker, int32_t left_mm,
+                               int32_t center_mm, int32_t right_mm, ScenarioEvent_t *event);
+
+/**
+ * @param tracker pointer to the tracker state
+ * @return debounced scenario
+ * @brief  Current debounced scenario
+ */
+scenario_t ScenarioTracker_Scenario(const ScenarioTracker_t *tracker);
+
+/**
+ * @param tracker pointer to the tracker state
+ * @return number of updates since the current scenario was accepted
+ * @brief  Age of the current scenario
+ */
+uint32_t ScenarioTracker_Duration(const ScenarioTracker_t *tracker);
+
+#endif /* SCENARIOTRACKER_H_ */
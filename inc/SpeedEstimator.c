@@ -0,0 +1,194 @@
+/*
+ * SpeedEstimator.c
+ * Runs on MSP432
+ *
+ * M/T wheel speed estimator with a table-driven reciprocal.
+ * See SpeedEstimator.h.
+ *
+ */
+
+#include <stdint.h>
+#include "../inc/TA3InputCapture.h"
+#include "../inc/Tachometer.h"
+#include "../inc/SpeedEstimator.h"
+
+// Recip[i] = round(2^32 / (256 + i)), i = 0 to 256
+static const uint32_t Recip[257] = {
+    16777216, 16711935, 16647160, 16582885, 16519105, 16455813, 16393005, 16330674,
+    16268816, 16207424, 16146494, 16086020, 16025997, 15966421, 15907286, 15848588,
+    15790321, 15732481, 15675063, 15618063, 15561476, 15505297, 15449523, 15394148,
+    15339169, 15284581, 15230380, 15176563, 15123124, 15070061, 15017368, 14965043,
+    14913081, 14861479, 14810232, 14759338, 14708792, 14658591, 14608732, 14559211,
+    14510025, 14461169, 14412642, 14364439, 14316558, 14268994, 14221746, 14174810,
+    14128182, 14081860, 14035841, 13990121, 13944699, 13899571, 13854733, 13810184,
+    13765921, 13721940, 13678240, 13634817, 13591669, 13548793, 13506186, 13463847,
+    13421773, 13379960, 13338408, 13297112, 13256072, 13215284, 13174746, 13134457,
+    13094412, 13054612, 13015052, 12975732, 12936648, 12897800, 12859184, 12820798,
+    12782641, 12744710, 12707004, 12669520, 12632257, 12595212, 12558384, 12521771,
+    12485370, 12449181, 12413200, 12377427, 12341860, 12306497, 12271335, 12236374,
+    12201612, 12167046, 12132676, 12098499, 12064515, 12030721, 11997115, 11963697,
+    11930465, 11897416, 11864551, 11831866, 11799361, 11767034, 11734883, 11702908,
+    11671107, 11639478, 11608020, 11576731, 11545611, 11514658, 11483870, 11453246,
+    11422785, 11392486, 11362347, 11332368, 11302546, 11272880, 11243370, 11214014,
+    11184811, 11155759, 11126858, 11098107, 11069503, 11041047, 11012737, 10984571,
+    10956549, 10928670, 10900932, 10873335, 10845877, 10818557, 10791375, 10764329,
+    10737418, 10710642, 10683998, 10657487, 10631107, 10604858, 10578737, 10552745,
+    10526881, 10501143, 10475530, 10450042, 10424678, 10399437, 10374317, 10349319,
+    10324441, 10299682, 10275041, 10250519, 10226113, 10201823, 10177648, 10153587,
+    10129640, 10105805, 10082083, 10058471, 10034970, 10011579, 9988296, 9965121,
+    9942054, 9919093, 9896238, 9873488, 9850842, 9828300, 9805861, 9783525,
+    9761289, 9739155, 9717121, 9695186, 9673350, 9651612, 9629972, 9608428,
+    9586981, 9565629, 9544372, 9523209, 9502140, 9481164, 9460280, 9439489,
+    9418788, 9398178, 9377658, 9357227, 9336885, 9316632, 9296466, 9276387,
+    9256395, 9236489, 9216668, 9196932, 9177281, 9157713, 9138228, 9118827,
+    9099507, 9080269, 9061112, 9042036, 9023041, 9004124, 8985287, 8966529,
+    8947849, 8929246, 8910721, 8892272, 8873899, 8855603, 8837381, 8819235,
+    8801162, 8783164, 8765239, 8747388, 8729608, 8711901, 8694266, 8676702,
+    8659208, 8641785, 8624432, 8607149, 8589935, 8572789, 8555712, 8538702,
+    8521761, 8504886, 8488078, 8471336, 8454660, 8438050, 8421505, 8405024,
+    8388608
+};
+
+// Number of significant bits in x, 0 for x = 0
+static uint32_t bitLength(uint32_t x) {
+    uint32_t n = 0;
+    if (x >= 0x10000) { n += 16; x >>= 16; }
+    if (x >= 0x100)   { n += 8;  x >>= 8; }
+    if (x >= 0x10)    { n += 4;  x >>= 4; }
+    if (x >= 0x4)     { n += 2;  x >>= 2; }
+    if (x >= 0x2)     { n += 1;  x >>= 1; }
+    return n + x;
+}
+
+uint32_t SpeedEstimator_Divide(uint32_t num, uint32_t t) {
+    if (t == 0) {
+        return 0xFFFFFFFF;      // saturate, bitLength(0) would index far past Recip
+    }
+
+    // t = m * 2^e with 256 <= m < 512, and f the next 8 bits of t below m
+    int32_t e = (int32_t)bitLength(t) - 9;
+    uint32_t m, f;
+    if (e >= 8) {
+        m = t >> e;
+        f = (t >> (e - 8)) & 0xFF;
+    } else if (e >= 0) {
+        m = t >> e;
+        f = (t << (8 - e)) & 0xFF;
+    } else {
+        m = t << -e;
+        f = 0;
+    }
+
+    // 2^32/m by linear interpolation between table entries
+    uint32_t j = m - 256;
+    uint32_t r = Recip[j] - (((Recip[j] - Recip[j + 1]) * f) >> 8);
+
+    // num/t = num * r / 2^(32+e), rounded
+    uint32_t shift = 32 + e;
+    uint64_t q = (uint64_t)num * r + ((uint64_t)1 << (shift - 1));
+    q >>= shift;
+    return (q > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)q;
+}
+
+// steps * k / t / 2^shift, keeping the sign of steps
+static int32_t speed(int32_t steps, uint32_t k, uint32_t t, uint8_t shift) {
+    uint32_t m = (steps < 0) ? -steps : steps;
+    if (m > SPEED_MAX_STEPS) {
+        m = SPEED_MAX_STEPS;
+    }
+    int32_t v = (int32_t)((SpeedEstimator_Divide(m * k, t) + ((1 << shift) >> 1)) >> shift);
+    return (steps < 0) ? -v : v;
+}
+
+void SpeedEstimator_Init(SpeedEstimator_t *est, int32_t steps, uint32_t edgeTime, uint32_t stall_ms) {
+    if (stall_ms > 2000000) {
+        stall_ms = 2000000;     // keep stall_ms*1500 inside 32 bits
+    }
+    est->Steps = steps;
+    est->EdgeTime = edgeTime;
+    est->StallTime = stall_ms * 1500;
+    est->Stalled = 1;           // no edge has been seen in this window yet
+    est->Shift = 0;
+    est->Speed_rpm = 0;
+    est->Speed_mmps = 0;
+}
+
+int32_t SpeedEstimator_Update(SpeedEstimator_t *est, int32_t steps, uint32_t edgeTime, uint32_t now) {
+    int32_t m = steps - est->Steps;
+
+    if (m != 0) {
+        uint32_t t = edgeTime - est->EdgeTime;
+        est->Steps = steps;
+        est->EdgeTime = edgeTime;
+        if (est->Stalled || (t == 0)) {
+            // the reference edge came before a stop, T is not a period;
+            // keep the new edge as the reference and measure next time
+            est->Stalled = 0;
+            return est->Speed_rpm;
+        }
+        est->Speed_rpm = speed(m, SPEED_RPM_K, t, est->Shift);
+        est->Speed_mmps = speed(m, SPEED_MMPS_K, t, est->Shift);
+        return est->Speed_rpm;
+    }
+
+    // No edge in this window: the wheel cannot be faster than one step
+    // over the time since the last edge.
+    uint32_t elapsed = now - est->EdgeTime;
+    if (elapsed > est->StallTime) {
+        est->Stalled = 1;
+        est->Speed_rpm = 0;
+        est->Speed_mmps = 0;
+        return 0;
+    }
+    if (elapsed == 0) {
+        return est->Speed_rpm;  // the reference edge is this very tick, no bound yet
+    }
+    int32_t limit = speed(1, SPEED_RPM_K, elapsed, est->Shift);
+    if (est->Speed_rpm > limit) {
+        est->Speed_rpm = limit;
+        est->Speed_mmps = speed(1, SPEED_MMPS_K, elapsed, est->Shift);
+    } else if (est->Speed_rpm < -limit) {
+        est->Speed_rpm = -limit;
+        est->Speed_mmps = -speed(1, SPEED_MMPS_K, elapsed, est->Shift);
+    }
+    return est->Speed_rpm;
+}
+
+int32_t SpeedEstimator_RPM(const SpeedEstimator_t *est) {
+    return est->Speed_rpm;
+}
+
+int32_t SpeedEstimator_MMPS(const SpeedEstimator_t *est) {
+    return est->Speed_mmps;
+}
+
+
+// One estimator per wheel, fed from the tachometer
+static SpeedEstimator_t LeftWheel;
+static SpeedEstimator_t RightWheel;
+
+void SpeedEstimator_InitWheels(uint32_t stall_ms) {
+    int32_t leftSteps, rightSteps;
+    uint32_t leftTime, rightTime;
+    Tachometer_GetEdges(&leftSteps, &leftTime, &rightSteps, &rightTime);
+    SpeedEstimator_Init(&LeftWheel, leftSteps, leftTime, stall_ms);
+    SpeedEstimator_Init(&RightWheel, rightSteps, rightTime, stall_ms);
+    if (Tachometer_CountsPerStep() == QUAD_COUNTS_PER_STEP) {
+        LeftWheel.Shift = 2;    // quadrature counts are quarter steps
+        RightWheel.Shift = 2;
+    }
+}
+
+void SpeedEstimator_UpdateWheels(int32_t *leftSpeed_rpm, int32_t *rightSpeed_rpm) {
+    int32_t leftSteps, rightSteps;
+    uint32_t leftTime, rightTime;
+    Tachometer_GetEdges(&leftSteps, &leftTime, &rightSteps, &rightTime);
+    uint32_t now = TimerA3Capture_Now();
+    *leftSpeed_rpm = SpeedEstimator_Update(&LeftWheel, leftSteps, leftTime, now);
+    *rightSpeed_rpm = SpeedEstimator_Update(&RightWheel, rightSteps, rightTime, now);
+}
+
+void SpeedEstimator_GetMMPS(int32_t *leftSpeed_mmps, int32_t *rightSpeed_mmps) {
+    *leftSpeed_mmps = LeftWheel.Speed_mmps;
+    *rightSpeed_mmps = RightWheel.Speed_mmps;
+}
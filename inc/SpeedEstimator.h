@@ -0,0 +1,115 @@
+/*
+ * SpeedEstimator.h
+ * Runs on MSP432
+ *
+ * M/T wheel speed estimator.  Each control period the number of
+ * encoder steps M is divided by the time T between the edge that
+ * ended the previous window and the last edge in this window, so
+ * both ends of T are edge times and there is no +-1 pulse error.
+ * At high speed many edges make M large; at low speed a window with
+ * no edge keeps the old reference and T simply grows until one comes.
+ * While no edge arrives the estimate is capped at one step over the
+ * time since the last edge, and drops to 0 after the stall timeout.
+ *
+ * M/T is turned into rpm and mm/s with a 257-entry reciprocal table,
+ * a multiply and a shift; no divide instruction is used.
+ *
+ */
+
+#ifndef SPEEDESTIMATOR_H_
+#define SPEEDESTIMATOR_H_
+
+// steps and 2/3 us ticks to speed, speed = M * K / T
+#define SPEED_RPM_K    250000  // 1 step = 1/360 rev, 1 tick = 2/3 us, same as PULSE2RPM
+#define SPEED_MMPS_K   916667  // 1 step = 220/360 mm, 1,500,000 ticks per second
+
+#define SPEED_MAX_STEPS 4095   // larger step counts per window are clipped
+
+/**
+ * \brief State of one wheel speed estimator.
+ */
+typedef struct {
+    int32_t Steps;          // step count at the reference edge
+    uint32_t EdgeTime;      // time of the reference edge in 2/3 us
+    uint32_t StallTime;     // no edge for this long means stopped, in 2/3 us
+    uint8_t Stalled;        // 1 while stopped, the reference edge is stale
+    uint8_t Shift;          // log2 of counts per step, 0 after Init
+    int32_t Speed_rpm;      // latest estimate, negative in reverse
+    int32_t Speed_mmps;
+} SpeedEstimator_t;
+
+/**
+ * Start an estimator from the current step count and edge time.
+ * Call again after Tachometer_ResetSteps.
+ * @param est pointer to the estimator state
+ * @param steps current step count, see Tachometer_GetEdges
+ * @param edgeTime time of the last edge, see Tachometer_GetEdges
+ * @param stall_ms no edge for this long reads as 0 speed
+ * @return none
+ * @brief  Initialize a speed estimator
+ */
+void SpeedEstimator_Init(SpeedEstimator_t *est, int32_t steps, uint32_t edgeTime, uint32_t stall_ms);
+
+/**
+ * Update the estimate at the end of a control period.
+ * @param est pointer to the estimator state
+ * @param steps current step count
+ * @param edgeTime time of the last edge in 2/3 us
+ * @param now current time in 2/3 us, see TimerA3Capture_Now
+ * @return speed in rpm, negative in reverse
+ * @brief  Update a speed estimator
+ */
+int32_t SpeedEstimator_Update(SpeedEstimator_t *est, int32_t steps, uint32_t edgeTime, uint32_t now);
+
+/**
+ * @param est pointer to the estimator state
+ * @return latest speed in rpm
+ * @brief  Speed in rpm
+ */
+int32_t SpeedEstimator_RPM(const SpeedEstimator_t *est);
+
+/**
+ * @param est pointer to the estimator state
+ * @return latest speed in mm/s
+ * @brief  Speed in mm/s
+ */
+int32_t SpeedEstimator_MMPS(const SpeedEstimator_t *est);
+
+/**
+ * Compute num / t without a divide, through the reciprocal table.
+ * Relative error of the reciprocal is below 0.001%, plus rounding.
+ * @param num numerator
+ * @param t denominator
+ * @return num / t rounded to nearest, 0xFFFFFFFF if that does not fit or t is 0
+ * @brief  Table-driven division
+ */
+uint32_t SpeedEstimator_Divide(uint32_t num, uint32_t t);
+
+/**
+ * Initialize one estimator per wheel from the tachometer.
+ * @param stall_ms no edge for this long reads as 0 speed
+ * @return none
+ * @note   Assumes Tachometer_Init() or Tachometer_InitQuadrature() has been called.
+ * @brief  Initialize the wheel speed estimators
+ */
+void SpeedEstimator_InitWheels(uint32_t stall_ms);
+
+/**
+ * Update both wheel estimators, call once per control period.
+ * @param leftSpeed_rpm pointer to store the left wheel speed
+ * @param rightSpeed_rpm pointer to store the right wheel speed
+ * @return none
+ * @brief  Update the wheel speed estimators
+ */
+void SpeedEstimator_UpdateWheels(int32_t *leftSpeed_rpm, int32_t *rightSpeed_rpm);
+
+/**
+ * Speeds of both wheels in mm/s from the last SpeedEstimator_UpdateWheels.
+ * @param leftSpeed_mmps pointer to store the left wheel speed
+ * @param rightSpeed_mmps pointer to store the right wheel speed
+ * @return none
+ * @brief  Wheel speeds in mm/s
+ */
+void SpeedEstimator_GetMMPS(int32_t *leftSpeed_mmps, int32_t *rightSpeed_mmps);
+
+#endif /* SPEEDESTIMATOR_H_ */
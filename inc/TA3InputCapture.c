@@ -53,23 +53,31 @@ policies, either expressed or implied, of the FreeBSD Project.
 
 #include <stdint.h>
 #include "msp.h"
+#include "../inc/CortexM.h"
+
+static void (*CaptureTask0)(uint32_t time); // User-defined function to handle interrupt on P10.4 (TA3CCP0)
+static void (*CaptureTask1)(uint32_t time); // User-defined function to handle interrupt on P10.5 (TA3CCP1)
+
+// Number of times TA3R has rolled over, the upper 16 bits of every timestamp.
+// The 32-bit timestamps wrap after 2^32 x 2/3 us, about 47 minutes, so
+// unsigned differences between them are correct for any period below that.
+static volatile uint16_t Overflows = 0;
+
+// Extend a 16-bit timer value to 32 bits.
+// If the timer rolled over but the overflow interrupt has not run yet
+// (TAIFG still set), a small value belongs to the next overflow count.
+// A value in the upper half was taken before the roll over.
+static uint32_t extend(uint16_t time) {
+    uint32_t high = Overflows;
+    if ((TIMER_A3->CTL & 0x0001) && (time < 0x8000)) {
+        high++;
+    }
+    return (high << 16) | time;
+}
 
-static void (*CaptureTask0)(uint16_t time); // User-defined function to handle interrupt on P10.4 (TA3CCP0)
-static void (*CaptureTask1)(uint16_t time); // User-defined function to handle interrupt on P10.5 (TA3CCP1)
-
-//------------TimerA3Capture_Init------------
-// Initializes Timer A3 in capture mode to generate interrupts on rising edges
-// of P10.4 (TA3CCP0) and P10.5 (TA3CCP1). When an interrupt occurs, the
-// corresponding user-defined function is called.
-// Input:
-//   task0 - Pointer to a function that handles P10.4 rising edge interrupt
-//           The function parameter is the 16-bit timer value at the time of the interrupt.
-//   task1 - Pointer to a function that handles P10.5 rising edge interrupt
-// Output: none
-// Assumptions: SMCLK is 12 MHz
-void TimerA3Capture_Init(void(*task0)(uint16_t time), void(*task1)(uint16_t time)){
-	// write this as part of lab 16
-
+// Shared by TimerA3Capture_Init and TimerA3Capture_InitBothEdges,
+// cctl is the CCTL value for both capture channels.
+static void captureInit(void(*task0)(uint32_t time), void(*task1)(uint32_t time), uint16_t cctl){
 
     CaptureTask0 =  task0;	           // Assign the user function for P10.4 interrupts
 	CaptureTask1 = 	task1;    	       // Assign the user function for P10.5 interrupts
@@ -88,11 +96,11 @@ void TimerA3Capture_Init(void(*task0)(uint16_t time), void(*task1)(uint16_t time
     // Set input clock divider to /8
     TIMER_A3->EX0 = 0x7;
 
-    // Configure Timer A3 for rising edge capture on P10.4 and P10.5
+    // Configure Timer A3 for capture on P10.4 and P10.5
     // synchronous capture source
     // capture mode, output mode, enable capture/compare interrupt, no interrupt pending
-	TIMER_A3->CCTL[0] = 0x4910;
-	TIMER_A3->CCTL[1] = 0x4910;
+	TIMER_A3->CCTL[0] = cctl;
+	TIMER_A3->CCTL[1] = cctl;
 
 	// Set interrupt priorities for Timer A3
 	NVIC->IP[14] = 2 << 5;    // Priority 2 for TA3CCR0 (P10.4)
@@ -101,8 +109,64 @@ void TimerA3Capture_Init(void(*task0)(uint16_t time), void(*task1)(uint16_t time
 	// Enable interrupts for Timer A3 in NVIC
 	NVIC->ISER[0] = 0x0000C000; // Enable interrupt 14 and 15
 
-    // Set Timer A3 to continuous mode and reset the timer
-	TIMER_A3->CTL |= 0x0024;
+    Overflows = 0;
+
+    // Set Timer A3 to continuous mode, reset the timer and
+    // enable the overflow interrupt (TAIE), which shares TA3_N with CCR1
+	TIMER_A3->CTL |= 0x0026;
+}
+
+
+//------------TimerA3Capture_Init------------
+// Initializes Timer A3 in capture mode to generate interrupts on rising edges
+// of P10.4 (TA3CCP0) and P10.5 (TA3CCP1). When an interrupt occurs, the
+// corresponding user-defined function is called.
+// Input:
+//   task0 - Pointer to a function that handles P10.4 rising edge interrupt
+//           The function parameter is the 32-bit time of the edge in 2/3 us:
+//           the captured 16-bit timer value extended with the overflow count.
+//   task1 - Pointer to a function that handles P10.5 rising edge interrupt
+// Output: none
+// Assumptions: SMCLK is 12 MHz
+void TimerA3Capture_Init(void(*task0)(uint32_t time), void(*task1)(uint32_t time)){
+	// write this as part of lab 16
+
+    // rising edge capture (CM=01)
+    captureInit(task0, task1, 0x4910);
+}
+
+
+//------------TimerA3Capture_InitBothEdges------------
+// Same as TimerA3Capture_Init, but captures both rising and falling
+// edges of P10.4 (TA3CCP0) and P10.5 (TA3CCP1), as needed for 4x
+// quadrature decoding.  The user function reads the pin to tell
+// which edge it was.
+// Input:
+//   task0 - Pointer to a function that handles P10.4 edge interrupts
+//   task1 - Pointer to a function that handles P10.5 edge interrupts
+// Output: none
+// Assumptions: SMCLK is 12 MHz
+void TimerA3Capture_InitBothEdges(void(*task0)(uint32_t time), void(*task1)(uint32_t time)){
+    // capture on both edges (CM=11)
+    captureInit(task0, task1, 0xC910);
+}
+
+
+//------------TimerA3Capture_Now------------
+// Returns the current time on the same 32-bit scale as the capture times.
+// Input: none
+// Output: time in 2/3 us
+uint32_t TimerA3Capture_Now(void){
+    uint16_t time;
+    uint32_t now;
+    long sr = StartCritical();
+    // TA3R counts on SMCLK, asynchronous to the CPU; read until two reads agree
+    do {
+        time = TIMER_A3->R;
+    } while (time != TIMER_A3->R);
+    now = extend(time);
+    EndCritical(sr);
+    return now;
 }
 
 
@@ -117,24 +181,32 @@ void TA3_0_IRQHandler(void){
     // Acknowledge the interrupt and clear the flag
 	TIMER_A3->CCTL[0] &= ~0x0001;
 
-    // Call the user function with the timer value
-	(*CaptureTask0)(TIMER_A3->CCR[0]);
+    // Call the user function with the extended timer value
+	(*CaptureTask0)(extend(TIMER_A3->CCR[0]));
 
 }
 
 
 //------------TA3_N_IRQHandler------------
-// Interrupt handler for Timer A3 CCR1 (rising edge on P10.5).
-// It clears the interrupt and calls the user function.
+// Interrupt handler for Timer A3 CCR1 (rising edge on P10.5) and
+// the Timer A3 overflow.  Reading TA3IV returns the highest priority
+// pending source and clears its flag; CCR1 (0x02) comes before the
+// overflow (0x0E), so an edge captured just before a roll over is
+// handled while TAIFG is still set, which extend() accounts for.
 // Input: none
 // Output: none
 void TA3_N_IRQHandler(void){
     // write this as part of lab 16
 
-    // Acknowledge the interrupt and clear the flag
-	TIMER_A3->CCTL[1] &= ~0x0001;
-								 
-    // Call the user function with the timer value
-	(*CaptureTask1)(TIMER_A3->CCR[1]);
-
+    switch (TIMER_A3->IV) {
+    case 0x02:      // CCR1
+        // Call the user function with the extended timer value
+        (*CaptureTask1)(extend(TIMER_A3->CCR[1]));
+        break;
+    case 0x0E:      // TA3R rolled over
+        Overflows++;
+        break;
+    default:
+        break;
+    }
 }
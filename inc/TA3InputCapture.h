@@ -61,19 +61,47 @@ policies, either expressed or implied, of the FreeBSD Project.
  * the corresponding user-defined function is called with the current timer value.
  *
  * @param task0 Pointer to the function that will be called when a rising edge is detected on P10.4 (TA3CCR0).
- *              The function takes a 16-bit timer value (in units of 2/3 microseconds) as its parameter.
+ *              The function takes a 32-bit time (in units of 2/3 microseconds) as its parameter.
  * @param task1 Pointer to the function that will be called when a rising edge is detected on P10.5 (TA3CCR1).
- *              The function takes a 16-bit timer value (in units of 2/3 microseconds) as its parameter.
+ *              The function takes a 32-bit time (in units of 2/3 microseconds) as its parameter.
  *
  * @return None.
  *
  * @note Assumes that the low-speed subsystem master clock (SMCLK) is running at 12 MHz.
+ * @note The 16-bit capture is extended with a count of timer overflows, so the
+ *       difference of two times is correct for periods longer than 43.7 ms.
  *
  * @brief Initializes Timer A3 to trigger interrupts on rising edges of signals from P10.4 and P10.5.
  */
-void TimerA3Capture_Init(void(*task0)(uint16_t time), void(*task1)(uint16_t time));
+void TimerA3Capture_Init(void(*task0)(uint32_t time), void(*task1)(uint32_t time));
 
 
-void TimerA3Capture_Init2(void(*task0)(uint16_t time), void(*task1)(uint16_t time), uint8_t priority);
+/**
+ * Initializes Timer A3 like TimerA3Capture_Init, but captures both the
+ * rising and the falling edges of P10.4 and P10.5.
+ *
+ * @param task0 Pointer to the user function called on each P10.4 edge.
+ * @param task1 Pointer to the user function called on each P10.5 edge.
+ *
+ * @note The user functions read the pins to tell rising from falling edges.
+ *
+ * @brief Initializes Timer A3 for capture on both edges.
+ */
+void TimerA3Capture_InitBothEdges(void(*task0)(uint32_t time), void(*task1)(uint32_t time));
+
+
+/**
+ * Reads the running Timer A3 on the same 32-bit scale as the capture times.
+ *
+ * @return current time in units of 2/3 microseconds
+ *
+ * @note Assumes TimerA3Capture_Init() has been called.
+ *
+ * @brief Current Timer A3 time.
+ */
+uint32_t TimerA3Capture_Now(void);
+
+
+void TimerA3Capture_Init2(void(*task0)(uint32_t time), void(*task1)(uint32_t time), uint8_t priority);
 
 #endif /* TA3INPUTCAPTURE_H_ */
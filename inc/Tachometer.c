@@ -53,65 +53,177 @@ policies, either expressed or implied, of the FreeBSD Project.
 #include <stdint.h>
 #include "msp.h"
 #include "../inc/Clock.h"
+#include "../inc/CortexM.h"
 #include "../inc/TA3InputCapture.h"
 #include "Tachometer.h"
 
-// Global variables to track the previous and current times of interrupts
-// from both the right and left wheel encoders
-static uint16_t PreviousRightTime = 0;  // Stores last interrupt time for right encoder
-static uint16_t CurrentRightTime = 0;   // Stores current interrupt time for right encoder
-static uint16_t PreviousLeftTime = 0;   // Stores last interrupt time for left encoder
-static uint16_t CurrentLeftTime = 0;    // Stores current interrupt time for left encoder
-
-// Step counters for the right and left encoders, tracking total movement
-static int16_t TachoRightSteps = 0;     // Right wheel step count, positive = forward, negative = backward
-static int16_t TachoLeftSteps = 0;      // Left wheel step count, positive = forward, negative = backward
+// Everything the ISRs keep for one wheel.
+// 32-bit words are read and written in one access on the Cortex-M4,
+// so the foreground never sees half of an update made by the ISR.
+typedef struct {
+    volatile int32_t Counts;    // Encoder counts, positive = forward, negative = backward
+                                // 1 per step, or 4 per step in quadrature mode
+    volatile int32_t Distance;  // Distance in mm, updated one count at a time
+    int32_t Remainder;          // Distance below 1 mm in units of 1/DistDen mm, 0 to DistDen-1
+    volatile uint32_t Time;     // Time of the last counted edge in 2/3 us (TimerA3Capture time)
+    volatile uint32_t Period;   // Time of the last full step in 2/3 us, 0 = unknown
+    uint32_t Times[4];          // Times of the last four counted edges
+    uint8_t Index;              // Next slot in Times
+    uint8_t Run;                // Edges in Times since the last stall, up to 4
+    uint8_t State;              // Quadrature state, A in bit 1, B in bit 0
+    volatile uint32_t Glitches; // Illegal quadrature transitions (A and B changed together)
+    enum TachDirection Dir;     // Last known direction
+} wheel_t;
+
+static wheel_t Right;
+static wheel_t Left;
+
+// Counts per step and the mm per count, STEP_DIST_NUM/DistDen
+static uint8_t CountsPerStep = 1;
+static uint8_t CountShift = 0;      // log2(CountsPerStep)
+static int32_t DistDen = STEP_DIST_DEN;
+
+// A wheel with no edge for this long is reported as stopped, in 2/3 us
+static uint32_t StallTime = TACH_STALL_TIMEOUT_MS * 1500;
+
+
+// Count one edge: +1 forward or -1 backward.
+// The period is measured over CountsPerStep edges, one full encoder
+// cycle, so uneven spacing of the A and B edges does not show up as
+// speed ripple in quadrature mode.
+static void countEdge(wheel_t *w, uint32_t currenttime, int32_t count) {
+    // After a stall the time since the last edge is not a period
+    if ((currenttime - w->Time) > StallTime) {
+        w->Run = 0;
+    }
+    // Times[Index - CountsPerStep] is the edge one full step ago
+    if (w->Run >= CountsPerStep) {
+        w->Period = currenttime - w->Times[(w->Index - CountsPerStep) & 0x03];
+    } else {
+        w->Period = 0;
+    }
+    w->Time = currenttime;
+    w->Times[w->Index] = currenttime;
+    w->Index = (w->Index + 1) & 0x03;
+    if (w->Run < 4) {
+        w->Run++;
+    }
 
-// Enum to store the last known direction of both the right and left wheels
-enum TachDirection static TachoRightDir = STOPPED;  // Default: not moving
-enum TachDirection static TachoLeftDir = STOPPED;   // Default: not moving
+    w->Counts += count;
+    w->Dir = (count > 0) ? FORWARD : REVERSE;
+
+    // Move the distance and its sub-mm remainder by one count
+    int32_t r = w->Remainder + count * STEP_DIST_NUM;
+    if (r >= DistDen) {
+        r -= DistDen;
+        w->Distance += 1;
+    } else if (r < 0) {
+        r += DistDen;
+        w->Distance -= 1;
+    }
+    w->Remainder = r;
+}
 
 
 // This function is called by the TimerA3 CCR0 ISR when the right encoder detects movement.
 // It calculates the time between interrupts, determines the direction of movement,
 // and updates the step counter accordingly.
 // Input: currenttime is the time at which the interrupt occurs.
-static void tachometerRightInt(uint16_t currenttime){
-    PreviousRightTime = CurrentRightTime;   // Store the previous interrupt time
-    CurrentRightTime = currenttime;         // Update to current interrupt time
-
+static void tachometerRightInt(uint32_t currenttime){
     // Check the state of Encoder B to determine movement direction
-    if(P5->IN & 0x01) {
-        // If Encoder B is high, the wheel moved forward
-        TachoRightSteps++;                  // Increment step count for forward movement
-        TachoRightDir = FORWARD;            // Set direction to forward
-    } else {
-        // If Encoder B is low, the wheel moved backward
-        TachoRightSteps--;                  // Decrement step count for backward movement
-        TachoRightDir = REVERSE;            // Set direction to reverse
-    }
+    // If Encoder B is high, the wheel moved forward, else backward
+    countEdge(&Right, currenttime, (P5->IN & 0x01) ? 1 : -1);
 }
 
 
 // This function is called by the TimerA3 CCR1 ISR when the left encoder detects movement.
 // It performs the same operations as the right interrupt handler.
 // Input: currenttime is the time at which the interrupt occurs.
-static void tachometerLeftInt(uint16_t currenttime){
-    PreviousLeftTime = CurrentLeftTime;    // Store the previous interrupt time
-    CurrentLeftTime = currenttime;         // Update to current interrupt time
+static void tachometerLeftInt(uint32_t currenttime){
+    countEdge(&Left, currenttime, (P5->IN & 0x04) ? 1 : -1);
+}
 
-    // Check the state of Encoder B to determine movement direction
-    if(P5->IN & 0x04) {
-        // If Encoder B is high, the wheel moved forward
-        TachoLeftSteps++;                  // Increment step count for forward movement
-        TachoLeftDir = FORWARD;            // Set direction to forward
-    } else {
-        // If Encoder B is low, the wheel moved backward
-        TachoLeftSteps--;                  // Decrement step count for backward movement
-        TachoLeftDir = REVERSE;            // Set direction to reverse
+
+// Quadrature decoder, indexed by (previous state << 2) | new state,
+// state = (A << 1) | B.  Forward is A rising while B is high, the
+// same rule as the 1x decoder: 01 -> 11 -> 10 -> 00 -> 01.
+// QUAD_GLITCH marks a jump of two states, which cannot be decoded.
+#define QUAD_GLITCH 2
+static const int8_t QuadTable[16] = {
+//  new: 00           01           10           11
+          0,           1,          -1,  QUAD_GLITCH,    // from 00
+         -1,           0, QUAD_GLITCH,           1,     // from 01
+          1, QUAD_GLITCH,           0,          -1,     // from 10
+QUAD_GLITCH,          -1,           1,           0      // from 11
+};
+
+// Decode one change of the A/B levels of a wheel
+static void quadEdge(wheel_t *w, uint32_t currenttime, uint8_t state) {
+    int8_t count = QuadTable[(w->State << 2) | state];
+    w->State = state;
+    if (count == QUAD_GLITCH) {
+        w->Glitches++;
+    } else if (count != 0) {
+        countEdge(w, currenttime, count);
     }
 }
 
+// A/B levels: right A = P10.4, right B = P5.0, left A = P10.5, left B = P5.2
+static uint8_t rightState(void) {
+    return ((P10->IN & 0x10) ? 2 : 0) | ((P5->IN & 0x01) ? 1 : 0);
+}
+static uint8_t leftState(void) {
+    return ((P10->IN & 0x20) ? 2 : 0) | ((P5->IN & 0x04) ? 1 : 0);
+}
+
+// Called by the TimerA3 CCR0/CCR1 ISRs on both edges of encoder A in quadrature mode
+static void quadRightA(uint32_t currenttime){
+    quadEdge(&Right, currenttime, rightState());
+}
+static void quadLeftA(uint32_t currenttime){
+    quadEdge(&Left, currenttime, leftState());
+}
+
+
+//------------PORT5_IRQHandler------------
+// Both edges of encoder B (P5.0 right, P5.2 left) in quadrature mode.
+// Port pins interrupt on one edge only, so after each edge the edge
+// select is set to catch the opposite one.  The levels are read again
+// afterwards; an edge that came in between is handled in the same call.
+// Runs at the same priority as the TimerA3 captures, so decoding is
+// never interrupted by the other encoder channel.
+// Input: none
+// Output: none
+void PORT5_IRQHandler(void){
+    uint8_t in;
+    uint32_t now = TimerA3Capture_Now();
+    do {
+        in = P5->IN & 0x05;
+        P5->IES = (P5->IES & ~0x05) | in;   // high now: wait for falling (IES=1)
+        P5->IFG &= ~0x05;
+        if ((Right.State & 0x01) != (in & 0x01)) {
+            quadEdge(&Right, now, (Right.State & 0x02) | (in & 0x01));
+        }
+        if ((Left.State & 0x01) != ((in >> 2) & 0x01)) {
+            quadEdge(&Left, now, (Left.State & 0x02) | ((in >> 2) & 0x01));
+        }
+    } while ((P5->IN & 0x05) != in);
+}
+
+
+// Clear one wheel and make the first edge look like the end of a stall, it has no period
+static void resetWheel(wheel_t *w, uint32_t now) {
+    w->Counts = 0;
+    w->Distance = 0;
+    w->Remainder = 0;
+    w->Time = now - StallTime - 1;
+    w->Period = 0;
+    w->Index = 0;
+    w->Run = 0;
+    w->Glitches = 0;
+    w->Dir = STOPPED;
+}
+
 
 // ------------Tachometer_Init------------
 // Initialize the GPIO pins and TimerA3 to interface with the rotary encoders.
@@ -125,43 +237,150 @@ void Tachometer_Init(void){
     P5->SEL0 &= ~0x05;  // Disable alternate functions for P5.0 and P5.2
     P5->SEL1 &= ~0x05;  // Set P5.0 and P5.2 to GPIO mode
     P5->DIR &= ~0x05;   // Set P5.0 and P5.2 as input pins
+    P5->IE &= ~0x05;    // No port interrupts, B is only sampled
+
+    CountsPerStep = 1;
+    CountShift = 0;
+    DistDen = STEP_DIST_DEN;
 
     // Initialize TimerA3 for input capture mode to measure time intervals between encoder pulses.
     // This will allow us to measure speed and count steps for both wheels.
     TimerA3Capture_Init(&tachometerRightInt, &tachometerLeftInt);
+
+    uint32_t now = TimerA3Capture_Now();
+    resetWheel(&Right, now);
+    resetWheel(&Left, now);
+}
+
+
+// ------------Tachometer_InitQuadrature------------
+// Same as Tachometer_Init, but counts both edges of both encoder
+// channels: 1440 counts per wheel revolution instead of 360.
+// Encoder A edges are captured by TimerA3, encoder B edges use the
+// P5 port interrupt.  The step, speed and distance functions keep
+// their units (degrees, 2/3 us per degree, mm).
+// Input: none
+// Output: none
+void Tachometer_InitQuadrature(void){
+
+    P5->SEL0 &= ~0x05;  // P5.0 and P5.2 as GPIO inputs
+    P5->SEL1 &= ~0x05;
+    P5->DIR &= ~0x05;
+
+    CountsPerStep = QUAD_COUNTS_PER_STEP;
+    CountShift = 2;
+    DistDen = QUAD_DIST_DEN;
+
+    TimerA3Capture_InitBothEdges(&quadRightA, &quadLeftA);
+
+    uint32_t now = TimerA3Capture_Now();
+    resetWheel(&Right, now);
+    resetWheel(&Left, now);
+    Right.State = rightState();
+    Left.State = leftState();
+
+    // Interrupt on the next edge of each B input
+    P5->IES = (P5->IES & ~0x05) | (P5->IN & 0x05);
+    P5->IFG &= ~0x05;
+    P5->IE |= 0x05;
+    NVIC->IP[39] = 2 << 5;          // Priority 2, same as the TimerA3 captures
+    NVIC->ISER[1] = 1 << (39 - 32); // Enable interrupt 39 (PORT5)
+}
+
+
+// ------------Tachometer_SetStallTimeout------------
+// Sets how long a wheel may go without an encoder edge before it is
+// reported as stopped (period 0, direction STOPPED).
+// Input: timeout_ms - stall timeout in ms, 1 to 2000000
+// Output: none
+void Tachometer_SetStallTimeout(uint32_t timeout_ms) {
+    if (timeout_ms < 1) {
+        timeout_ms = 1;
+    }
+    if (timeout_ms > 2000000) {
+        timeout_ms = 2000000;   // keep timeout_ms*1500 inside 32 bits
+    }
+    StallTime = timeout_ms * 1500;
+}
+
+
+// Period of one wheel in 2/3 us, or 0 if it has stalled.
+// The time and period are read together so an edge cannot come between them.
+static uint32_t getPeriod(wheel_t *w, uint32_t now) {
+    long sr = StartCritical();
+    uint32_t last = w->Time;
+    uint32_t p = w->Period;
+    EndCritical(sr);
+    if ((now - last) > StallTime) {
+        return 0;
+    }
+    return p;
+}
+
+// Clip a 32-bit period to the 16-bit interface, 0 stays 0 (stopped)
+static uint16_t clipPeriod(uint32_t period) {
+    return (period > 0xFFFF) ? 0xFFFF : period;
+}
+
+// Whole steps (degrees) from counts, rounded toward minus infinity
+static int32_t countsToSteps(int32_t counts) {
+    return counts >> CountShift;
 }
 
 
 // ------------Tachometer_ResetSteps------------
-// Resets the step counters for both the right and left wheels to zero.
+// Resets the step counters and distances for both the right and left wheels to zero.
 // This is useful when starting a new measurement or task.
+// Runs as a critical section so a step cannot land between the clears.
 // Input: none
 // Output: none
 void Tachometer_ResetSteps(void) {
-    TachoRightSteps = 0;  // Reset right wheel step count
-    TachoLeftSteps = 0;   // Reset left wheel step count
+    long sr = StartCritical();
+    Right.Counts = 0;     // Reset right wheel step count
+    Left.Counts = 0;      // Reset left wheel step count
+    Right.Distance = 0;
+    Left.Distance = 0;
+    Right.Remainder = 0;
+    Left.Remainder = 0;
+    EndCritical(sr);
 }
 
 // ------------Tachometer_GetSpeeds------------
 // Retrieves the periods (time between interrupts) for both the left and right wheels.
 // The periods are used to calculate the wheel speeds.
+// A period of 0 means the wheel is stopped; periods above 65535 read as 65535.
 // Input: leftPeriod_2_3rd_us  - pointer to store the left wheel period in units of 2/3 microseconds
 //        rightPeriod_2_3rd_us - pointer to store the right wheel period in units of 2/3 microseconds
 // Output: none
 // Assumes: Tachometer_Init() and Clock_Init48MHz() have been called.
 void Tachometer_GetSpeeds(uint16_t *leftPeriod_2_3rd_us, uint16_t *rightPeriod_2_3rd_us) {
-    *leftPeriod_2_3rd_us = (CurrentLeftTime - PreviousLeftTime);    // Calculate left wheel period
-    *rightPeriod_2_3rd_us = (CurrentRightTime - PreviousRightTime); // Calculate right wheel period
+    uint32_t now = TimerA3Capture_Now();
+    *leftPeriod_2_3rd_us = clipPeriod(getPeriod(&Left, now));      // Left wheel period
+    *rightPeriod_2_3rd_us = clipPeriod(getPeriod(&Right, now));    // Right wheel period
+}
+
+// ------------Tachometer_GetPeriods------------
+// Same as Tachometer_GetSpeeds with the full 32-bit periods.
+// Input: leftPeriod_2_3rd_us  - pointer to store the left wheel period in units of 2/3 microseconds
+//        rightPeriod_2_3rd_us - pointer to store the right wheel period in units of 2/3 microseconds
+// Output: none, a period of 0 means the wheel is stopped
+void Tachometer_GetPeriods(uint32_t *leftPeriod_2_3rd_us, uint32_t *rightPeriod_2_3rd_us) {
+    uint32_t now = TimerA3Capture_Now();
+    *leftPeriod_2_3rd_us = getPeriod(&Left, now);
+    *rightPeriod_2_3rd_us = getPeriod(&Right, now);
 }
 
 // ------------Tachometer_GetDirections------------
 // Retrieves the last known direction of movement for both the left and right wheels.
+// A wheel without an edge for the stall timeout is STOPPED.
 // Input: leftDir  - pointer to store the left wheel's direction (FORWARD/REVERSE/STOPPED)
 //        rightDir - pointer to store the right wheel's direction (FORWARD/REVERSE/STOPPED)
 // Output: none
 void Tachometer_GetDirections(enum TachDirection *leftDir, enum TachDirection *rightDir) {
-    *leftDir = TachoLeftDir;   // Get left wheel direction
-    *rightDir = TachoRightDir; // Get right wheel direction
+    uint32_t now = TimerA3Capture_Now();
+    // Get the wheel directions, STOPPED once a wheel has stalled
+    *leftDir = getPeriod(&Left, now) ? Left.Dir : STOPPED;
+    *rightDir = getPeriod(&Right, now) ? Right.Dir : STOPPED;
 }
 
 // ------------Tachometer_GetSteps------------
@@ -170,20 +389,71 @@ void Tachometer_GetDirections(enum TachDirection *leftDir, enum TachDirection *r
 // Input: leftSteps_deg  - pointer to store the number of steps (degrees) for the left wheel
 //        rightSteps_deg - pointer to store the number of steps (degrees) for the right wheel
 // Output: none
-void Tachometer_GetSteps(int16_t* leftSteps_deg, int16_t* rightSteps_deg) {
-    *leftSteps_deg = TachoLeftSteps;   // Get total steps for left wheel
-    *rightSteps_deg = TachoRightSteps; // Get total steps for right wheel
+void Tachometer_GetSteps(int32_t* leftSteps_deg, int32_t* rightSteps_deg) {
+    *leftSteps_deg = countsToSteps(Left.Counts);   // Get total steps for left wheel
+    *rightSteps_deg = countsToSteps(Right.Counts); // Get total steps for right wheel
+}
+
+// ------------Tachometer_GetCounts------------
+// Retrieves the raw encoder counts: one per step, or four per step
+// (quarter degrees) in quadrature mode.
+// Input: leftCounts  - pointer to store the left wheel count
+//        rightCounts - pointer to store the right wheel count
+// Output: none
+void Tachometer_GetCounts(int32_t *leftCounts, int32_t *rightCounts) {
+    *leftCounts = Left.Counts;
+    *rightCounts = Right.Counts;
+}
+
+// ------------Tachometer_CountsPerStep------------
+// Input: none
+// Output: 1, or 4 in quadrature mode
+uint8_t Tachometer_CountsPerStep(void) {
+    return CountsPerStep;
+}
+
+// ------------Tachometer_GetGlitches------------
+// Retrieves the number of illegal quadrature transitions (both encoder
+// channels changing between two decodes) since the last init.
+// Always 0 outside quadrature mode.
+// Input: leftGlitches  - pointer to store the left wheel glitch count
+//        rightGlitches - pointer to store the right wheel glitch count
+// Output: none
+void Tachometer_GetGlitches(uint32_t *leftGlitches, uint32_t *rightGlitches) {
+    *leftGlitches = Left.Glitches;
+    *rightGlitches = Right.Glitches;
+}
+
+// ------------Tachometer_GetEdges------------
+// Retrieves the encoder counts together with the time of the edge that
+// made the last count, for speed estimators such as SpeedEstimator.
+// Both wheels are read in one critical section.
+// Input: leftCounts  - pointer to store the left wheel count, see Tachometer_GetCounts
+//        leftTime    - pointer to store the time of the last left edge (2/3 us)
+//        rightCounts - pointer to store the right wheel count
+//        rightTime   - pointer to store the time of the last right edge (2/3 us)
+// Output: none
+void Tachometer_GetEdges(int32_t *leftCounts, uint32_t *leftTime,
+                         int32_t *rightCounts, uint32_t *rightTime) {
+    long sr = StartCritical();
+    *leftCounts = Left.Counts;
+    *leftTime = Left.Time;
+    *rightCounts = Right.Counts;
+    *rightTime = Right.Time;
+    EndCritical(sr);
 }
 
 // ------------Tachometer_GetDistances------------
-// Calculates the distances traveled by the left and right wheels based on the step count.
-// Converts steps to distance using a predefined step-to-distance conversion factor (STEP2DISTANCE).
+// Retrieves the distances traveled by the left and right wheels.
+// The ISR converts each count with STEP_DIST_NUM/STEP_DIST_DEN (or
+// QUAD_DIST_DEN) and carries the sub-mm remainder, so no multiply or
+// divide is needed here.
 // Input: leftDistance_mm  - pointer to store the distance traveled by the left wheel (in mm)
 //        rightDistance_mm - pointer to store the distance traveled by the right wheel (in mm)
 // Output: none
-void Tachometer_GetDistances(int16_t* leftDistance_mm, int16_t* rightDistance_mm) {
-    *leftDistance_mm = TachoLeftSteps * STEP2DISTANCE;   // Convert left steps to distance (mm)
-    *rightDistance_mm = TachoRightSteps * STEP2DISTANCE; // Convert right steps to distance (mm)
+void Tachometer_GetDistances(int32_t* leftDistance_mm, int32_t* rightDistance_mm) {
+    *leftDistance_mm = Left.Distance;    // Get left distance (mm)
+    *rightDistance_mm = Right.Distance;  // Get right distance (mm)
 }
 
 
@@ -196,15 +466,20 @@ void Tachometer_GetDistances(int16_t* leftDistance_mm, int16_t* rightDistance_mm
 //        rightDir             - pointer to store the right wheel direction (FORWARD/REVERSE/STOPPED)
 //        rightSteps_deg       - pointer to store the right wheel step count (in degrees)
 // Output: none
-void Tachometer_Get(uint16_t* leftPeriod_2_3rd_us, enum TachDirection* leftDir, int16_t* leftSteps_deg,
-                   uint16_t* rightPeriod_2_3rd_us, enum TachDirection* rightDir, int16_t* rightSteps_deg) {
+void Tachometer_Get(uint16_t* leftPeriod_2_3rd_us, enum TachDirection* leftDir, int32_t* leftSteps_deg,
+                   uint16_t* rightPeriod_2_3rd_us, enum TachDirection* rightDir, int32_t* rightSteps_deg) {
+    uint32_t now = TimerA3Capture_Now();
+    uint32_t period;
+
     // Retrieve left wheel data
-    *leftPeriod_2_3rd_us = (CurrentLeftTime - PreviousLeftTime);  // Calculate left period
-    *leftDir = TachoLeftDir;   // Get left direction
-    *leftSteps_deg = TachoLeftSteps;   // Get left step count
+    period = getPeriod(&Left, now);
+    *leftPeriod_2_3rd_us = clipPeriod(period);  // Left period, 0 if stopped
+    *leftDir = period ? Left.Dir : STOPPED;     // Get left direction
+    *leftSteps_deg = countsToSteps(Left.Counts);    // Get left step count
 
     // Retrieve right wheel data
-    *rightPeriod_2_3rd_us = (CurrentRightTime - PreviousRightTime); // Calculate right period
-    *rightDir = TachoRightDir;  // Get right direction
-    *rightSteps_deg = TachoRightSteps;  // Get right step count
+    period = getPeriod(&Right, now);
+    *rightPeriod_2_3rd_us = clipPeriod(period); // Right period, 0 if stopped
+    *rightDir = period ? Right.Dir : STOPPED;   // Get right direction
+    *rightSteps_deg = countsToSteps(Right.Counts);  // Get right step count
 }
@@ -87,6 +87,10 @@ enum TachDirection {
 // speed (RPM) = PULSE2RPM / pulses
 #define PULSE2RPM   250000
 
+// A wheel without an encoder edge for this long is reported as stopped.
+// Change at run time with Tachometer_SetStallTimeout.
+#define TACH_STALL_TIMEOUT_MS  100
+
 
 // Convert number of steps (angle in degrees) to distance in mm.
 // distance (mm) = steps * STEP2DISTANCE
@@ -96,6 +100,19 @@ enum TachDirection {
 // 1 full wheel revolution (360 degrees) = 220 mm of displacement.
 #define STEP2DISTANCE  220/360 // no parentheses should be added, e.g., (220/360)
 
+// The same ratio reduced, used to convert one step at a time.
+// Each step adds STEP_DIST_NUM/STEP_DIST_DEN mm; the remainder below 1 mm
+// is kept in the tachometer ISR, so the distance never drifts from
+// floor(steps * 220 / 360) no matter how far the robot travels.
+#define STEP_DIST_NUM  11
+#define STEP_DIST_DEN  18
+
+// In quadrature mode (Tachometer_InitQuadrature) each edge of encoder A
+// and encoder B is counted, 4 counts per step, 1440 per wheel revolution.
+// Each count adds STEP_DIST_NUM/QUAD_DIST_DEN mm.
+#define QUAD_COUNTS_PER_STEP  4
+#define QUAD_DIST_DEN  72
+
 
 /**
  * Initializes GPIO pins for input to determine motor direction and
@@ -107,17 +124,53 @@ enum TachDirection {
 void Tachometer_Init(void);
 
 
+/**
+ * Initializes the tachometer in quadrature mode: both edges of both
+ * encoder channels are counted, for 4x the distance and speed resolution.
+ * Encoder A edges use Timer A3 capture on both edges, encoder B edges
+ * use the Port 5 interrupt (priority 2, like Timer A3).
+ * All other Tachometer functions keep their units.
+ * @param none
+ * @return none
+ * @note Transitions that skip a quadrature state are not counted, see Tachometer_GetGlitches.
+ * @brief Initializes the tachometer for 4x quadrature decoding.
+ */
+void Tachometer_InitQuadrature(void);
+
+
+/**
+ * Sets how long a wheel may go without an encoder edge before its
+ * period reads 0 and its direction reads STOPPED.
+ * @param timeout_ms stall timeout in ms, default TACH_STALL_TIMEOUT_MS
+ * @return none
+ * @brief Sets the tachometer stall timeout.
+ */
+void Tachometer_SetStallTimeout(uint32_t timeout_ms);
+
+
 /**
  * Retrieves the most recent tachometer speed measurements.
  * @param leftPeriod_2_3rd_us Pointer to store the left wheel tachometer period (in units of 2/3 microseconds).
  * @param rightPeriod_2_3rd_us Pointer to store the right wheel tachometer period (in units of 2/3 microseconds).
  * @return none
  * @note Assumes Tachometer_Init() and Clock_Init48MHz() have been called.
+ * @note A period of 0 means the wheel is stopped. Periods above 65535 read as 65535.
  * @brief Retrieves the most recent tachometer speeds.
  */
 void Tachometer_GetSpeeds(uint16_t *leftPeriod_2_3rd_us, uint16_t *rightPeriod_2_3rd_us);
 
 
+/**
+ * Retrieves the most recent tachometer periods at full 32-bit width.
+ * @param leftPeriod_2_3rd_us Pointer to store the left wheel tachometer period (in units of 2/3 microseconds).
+ * @param rightPeriod_2_3rd_us Pointer to store the right wheel tachometer period (in units of 2/3 microseconds).
+ * @return none
+ * @note A period of 0 means the wheel is stopped.
+ * @brief Retrieves the most recent tachometer periods.
+ */
+void Tachometer_GetPeriods(uint32_t *leftPeriod_2_3rd_us, uint32_t *rightPeriod_2_3rd_us);
+
+
 /**
  * Retrieves the most recent direction of the wheels.
  * @param leftDir Pointer to store the direction of the left wheel (FORWARD, REVERSE, or STOPPED).
@@ -137,7 +190,54 @@ void Tachometer_GetDirections(enum TachDirection *leftDir, enum TachDirection *r
  * @note Assumes Tachometer_Init() and Clock_Init48MHz() have been called.
  * @brief Retrieves the most recent tachometer step count.
  */
-void Tachometer_GetSteps(int16_t *leftSteps_deg, int16_t *rightSteps_deg);
+void Tachometer_GetSteps(int32_t *leftSteps_deg, int32_t *rightSteps_deg);
+
+
+/**
+ * Retrieves the raw encoder counts of each wheel.
+ * @param leftCounts Pointer to store the left wheel count.
+ * @param rightCounts Pointer to store the right wheel count.
+ * @return none
+ * @note Counts equal steps after Tachometer_Init() and are 4 per step after Tachometer_InitQuadrature().
+ * @brief Retrieves the encoder counts.
+ */
+void Tachometer_GetCounts(int32_t *leftCounts, int32_t *rightCounts);
+
+
+/**
+ * @param none
+ * @return 1 after Tachometer_Init(), QUAD_COUNTS_PER_STEP after Tachometer_InitQuadrature()
+ * @brief Encoder counts per step.
+ */
+uint8_t Tachometer_CountsPerStep(void);
+
+
+/**
+ * Retrieves the number of illegal quadrature transitions, where both
+ * encoder channels changed between two decodes and the direction is
+ * unknown.  These transitions are not counted as steps.
+ * @param leftGlitches Pointer to store the left wheel glitch count.
+ * @param rightGlitches Pointer to store the right wheel glitch count.
+ * @return none
+ * @note Counts since the last init; always 0 after Tachometer_Init().
+ * @brief Retrieves the quadrature glitch counts.
+ */
+void Tachometer_GetGlitches(uint32_t *leftGlitches, uint32_t *rightGlitches);
+
+
+/**
+ * Retrieves the encoder counts with the time of the last encoder edge of each wheel,
+ * read together so the count and the time belong to the same edge.
+ * @param leftCounts Pointer to store the left wheel count, see Tachometer_GetCounts.
+ * @param leftTime Pointer to store the time of the last left edge (in units of 2/3 microseconds).
+ * @param rightCounts Pointer to store the right wheel count.
+ * @param rightTime Pointer to store the time of the last right edge (in units of 2/3 microseconds).
+ * @return none
+ * @note Times are on the TimerA3Capture_Now() scale.
+ * @brief Retrieves encoder counts and edge times.
+ */
+void Tachometer_GetEdges(int32_t *leftCounts, uint32_t *leftTime,
+                         int32_t *rightCounts, uint32_t *rightTime);
 
 
 /**
@@ -146,13 +246,14 @@ void Tachometer_GetSteps(int16_t *leftSteps_deg, int16_t *rightSteps_deg);
  * @param rightDistance_mm Pointer to store the distance traveled by the right wheel in mm.
  * @return none
  * @note Assumes Tachometer_Init() and Clock_Init48MHz() have been called.
+ * @note Distances are rounded toward minus infinity, i.e. floor(steps*220/360).
  * @brief Retrieves the distances traveled by the wheels.
  */
-void Tachometer_GetDistances(int16_t* leftDistance_mm, int16_t* rightDistance_mm);
+void Tachometer_GetDistances(int32_t* leftDistance_mm, int32_t* rightDistance_mm);
 
 
 /**
- * Resets the tachometer step counts for both wheels.
+ * Resets the tachometer step counts and distances for both wheels.
  * @param none
  * @return none
  * @note Assumes Tachometer_Init() and Clock_Init48MHz() have been called.
@@ -175,10 +276,10 @@ void Tachometer_ResetSteps(void);
  */
 void Tachometer_Get(uint16_t *leftPeriod_2_3rd_us,
                     enum TachDirection *leftDir,
-                    int16_t *leftSteps,
+                    int32_t *leftSteps,
                     uint16_t *rightPeriod_2_3rd_us,
                     enum TachDirection *rightDir,
-                    int16_t *rightSteps);
+                    int32_t *rightSteps);
 
 
 #endif /* TACHOMETER_H_ */
@@ -0,0 +1,203 @@
+/*
+ * Telemetry.c
+ * Runs on MSP432
+ *
+ * Binary framed logging over UART0, see Telemetry.h.
+ *
+ */
+
+#include <stdint.h>
+#include "../inc/CRC16.h"
+#include "../inc/UART0.h"
+#include "../inc/Telemetry.h"
+
+#define FRAME_SIZE (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_SIZE)
+
+// Each stream fills its own payload, which is copied into a frame when
+// it is sent.  Two frames, one is filled while DMA sends the other.
+// UART0_OutBuffer waits for the previous block, so a frame is free
+// again once the other one has been handed over.
+static uint8_t Frames[2][FRAME_SIZE];
+static uint8_t Current;                 // frame filled by the next sendFrame
+static uint16_t Sequence;               // sequence number of the next frame
+
+typedef struct {
+    const TelemetryField_t *Fields;
+    uint8_t NumFields;
+    uint8_t RecordSize;                 // bytes per packed record
+    uint8_t Capacity;                   // records per data frame
+    uint8_t Length;                     // payload bytes, 0 while no data frame is started
+    uint32_t Records;                   // records counted since Telemetry_Open
+    uint8_t Payload[TELEMETRY_MAX_PAYLOAD];
+} stream_t;
+static stream_t Streams[TELEMETRY_MAX_STREAMS];
+
+static void putU16(uint8_t *p, uint16_t n) {
+    p[0] = n;
+    p[1] = n >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t n) {
+    p[0] = n;
+    p[1] = n >> 8;
+    p[2] = n >> 16;
+    p[3] = n >> 24;
+}
+
+static int32_t saturate(int32_t n, int32_t min, int32_t max) {
+    if (n < min) {
+        return min;
+    }
+    if (n > max) {
+        return max;
+    }
+    return n;
+}
+
+// Append a length byte and up to TELEMETRY_MAX_NAME characters
+static void putName(stream_t *s, const char *name) {
+    uint8_t *count = &s->Payload[s->Length];
+    s->Length++;
+    *count = 0;
+    while (name[*count] && (*count < TELEMETRY_MAX_NAME)) {
+        s->Payload[s->Length] = name[*count];
+        s->Length++;
+        (*count)++;
+    }
+}
+
+// Frame the payload of a stream, send it and switch frames
+static void sendFrame(stream_t *s, uint8_t type) {
+    uint8_t *frame = Frames[Current];
+    uint32_t end = TELEMETRY_HEADER_SIZE + s->Length;
+    frame[0] = TELEMETRY_SYNC0;
+    frame[1] = TELEMETRY_SYNC1;
+    frame[2] = type;
+    putU16(&frame[3], Sequence);
+    frame[5] = s->Length;
+    for (int i = 0; i < s->Length; i++) {
+        frame[TELEMETRY_HEADER_SIZE + i] = s->Payload[i];
+    }
+    putU16(&frame[end], CRC16_Update(CRC16_INIT, &frame[2], end - 2));
+    UART0_OutBuffer((const char *)frame, end + TELEMETRY_CRC_SIZE);
+    Sequence++;
+    Current ^= 1;
+    s->Length = 0;
+}
+
+void Telemetry_Open(uint8_t stream, const char *name, const TelemetryField_t *fields, uint8_t numFields) {
+    stream_t *s = &Streams[stream];
+    if (numFields > TELEMETRY_MAX_FIELDS) {
+        numFields = TELEMETRY_MAX_FIELDS;
+    }
+    s->Fields = fields;
+    s->NumFields = numFields;
+    s->RecordSize = 0;
+    for (int i = 0; i < numFields; i++) {
+        s->RecordSize += TELEMETRY_SIZE(fields[i].Type);
+    }
+    s->Capacity = (TELEMETRY_MAX_PAYLOAD - TELEMETRY_DATA_SIZE) / s->RecordSize;
+    s->Records = 0;
+
+    s->Payload[0] = TELEMETRY_VERSION;
+    s->Payload[1] = stream;
+    s->Payload[2] = numFields;
+    s->Payload[3] = s->RecordSize;
+    s->Length = 4;
+    putName(s, name);
+    for (int i = 0; i < numFields; i++) {
+        s->Payload[s->Length] = fields[i].Type;
+        s->Length++;
+        putName(s, fields[i].Name);
+    }
+    sendFrame(s, TELEMETRY_SCHEMA);
+}
+
+uint8_t Telemetry_Add(uint8_t stream, const int32_t *values) {
+    stream_t *s = &Streams[stream];
+    uint8_t *p;
+    if (s->Length == 0) {
+        // a new data frame starts with the number of its first record
+        s->Payload[0] = stream;
+        putU32(&s->Payload[1], s->Records);
+        s->Length = TELEMETRY_DATA_SIZE;
+    }
+    p = &s->Payload[s->Length];
+    for (int i = 0; i < s->NumFields; i++) {
+        switch (s->Fields[i].Type) {
+        case TELEMETRY_I8:
+            *p = saturate(values[i], -128, 127);
+            break;
+        case TELEMETRY_U8:
+            *p = saturate(values[i], 0, 255);
+            break;
+        case TELEMETRY_I16:
+            putU16(p, saturate(values[i], -32768, 32767));
+            break;
+        case TELEMETRY_U16:
+            putU16(p, saturate(values[i], 0, 65535));
+            break;
+        default:                        // I32 and U32
+            putU32(p, values[i]);
+            break;
+        }
+        p += TELEMETRY_SIZE(s->Fields[i].Type);
+    }
+    s->Length += s->RecordSize;
+    s->Records++;
+    if (s->Length + s->RecordSize > TELEMETRY_MAX_PAYLOAD) {
+        sendFrame(s, TELEMETRY_DATA);
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t Telemetry_Skip(uint8_t stream, uint32_t count) {
+    uint8_t sent = Telemetry_Send(stream);
+    Streams[stream].Records += count;
+    return sent;
+}
+
+uint8_t Telemetry_Send(uint8_t stream) {
+    stream_t *s = &Streams[stream];
+    if (s->Length == 0) {
+        return 0;
+    }
+    sendFrame(s, TELEMETRY_DATA);
+    return 1;
+}
+
+uint8_t Telemetry_Pending(uint8_t stream) {
+    stream_t *s = &Streams[stream];
+    if (s->Length == 0) {
+        return 0;
+    }
+    return (s->Length - TELEMETRY_DATA_SIZE) / s->RecordSize;
+}
+
+uint8_t Telemetry_Room(uint8_t stream) {
+    return Streams[stream].Capacity - Telemetry_Pending(stream);
+}
+
+void Telemetry_Close(uint8_t stream) {
+    stream_t *s = &Streams[stream];
+    Telemetry_Send(stream);
+    s->Payload[0] = stream;
+    putU32(&s->Payload[1], s->Records);
+    s->Length = TELEMETRY_DATA_SIZE;
+    sendFrame(s, TELEMETRY_END);
+}
+
+void Telemetry_Begin(const char *name, const TelemetryField_t *fields, uint8_t numFields) {
+    Sequence = 0;
+    Telemetry_Open(0, name, fields, numFields);
+}
+
+void Telemetry_Record(const int32_t *values) {
+    Telemetry_Add(0, values);
+}
+
+void Telemetry_End(void) {
+    Telemetry_Close(0);
+    UART0_Flush();
+}
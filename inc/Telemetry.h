@@ -0,0 +1,169 @@
+/*
+ * Telemetry.h
+ * Runs on MSP432
+ *
+ * Binary framed logging over UART0, a compact replacement for CSV dumps.
+ * A stream is a schema frame naming the fields, data frames holding
+ * packed records, and an end frame with the record count.  Up to
+ * TELEMETRY_MAX_STREAMS streams can be open at once, their frames
+ * interleave on the wire.
+ *
+ * Frame, multi-byte values little-endian:
+ *   0xA5 0x5A  sync
+ *   type       'S' schema, 'D' data, 'E' end
+ *   seq        uint16, +1 per frame of any stream
+ *   length     uint8, number of payload bytes
+ *   payload
+ *   crc        uint16, CRC16_Update over type through payload
+ * Schema payload: version, stream number, number of fields, record
+ *   size, then the stream name and each field as type byte followed
+ *   by its name, every name as a length byte and that many characters.
+ * Data payload: stream number, uint32 number of the first record,
+ *   then the records, each field in schema order at its own width.
+ * End payload: stream number, uint32 total records.
+ *
+ * A receiver resyncs on 0xA5 0x5A, so text between frames is skipped.
+ * A CRC error or a sequence gap means lost bytes, and the record
+ * number in each data frame tells which records are missing.
+ * tools/TelemetryDecode turns a captured stream back into CSV.
+ *
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#define TELEMETRY_SYNC0         0xA5
+#define TELEMETRY_SYNC1         0x5A
+#define TELEMETRY_SCHEMA        'S'
+#define TELEMETRY_DATA          'D'
+#define TELEMETRY_END           'E'
+#define TELEMETRY_VERSION       2
+#define TELEMETRY_HEADER_SIZE   6       // sync, type, seq and length
+#define TELEMETRY_DATA_SIZE     5       // stream and first record, ahead of the records
+#define TELEMETRY_CRC_SIZE      2
+#define TELEMETRY_MAX_PAYLOAD   240
+#define TELEMETRY_MAX_FIELDS    8
+#define TELEMETRY_MAX_NAME      15      // longest stream or field name
+#define TELEMETRY_MAX_STREAMS   4       // streams open at the same time
+#define TELEMETRY_BAUD          460800  // UART0 rate of the telemetry programs and TelemetryDecode
+
+// field types, the size in bytes is TELEMETRY_SIZE(type)
+enum TelemetryType {
+    TELEMETRY_I8 = 1,
+    TELEMETRY_U8,
+    TELEMETRY_I16,
+    TELEMETRY_U16,
+    TELEMETRY_I32,
+    TELEMETRY_U32
+};
+#define TELEMETRY_SIZE(type) (1 << (((type) - 1) >> 1))
+
+/**
+ * \brief One column of a telemetry stream.
+ */
+typedef struct {
+    const char *Name;       // column name, at most TELEMETRY_MAX_NAME characters
+    uint8_t Type;           // enum TelemetryType
+} TelemetryField_t;
+
+/**
+ * Start stream 0 on its own: reset the sequence number and send the
+ * schema frame.  Used for one-shot dumps with Telemetry_Record and
+ * Telemetry_End.
+ * @param name stream name, at most TELEMETRY_MAX_NAME characters
+ * @param fields columns of each record, the array must stay valid until Telemetry_End
+ * @param numFields 1 to TELEMETRY_MAX_FIELDS
+ * @return none
+ * @note   UART0_Init must be called once prior
+ * @brief  Begin a telemetry stream
+ */
+void Telemetry_Begin(const char *name, const TelemetryField_t *fields, uint8_t numFields);
+
+/**
+ * Add one record to stream 0, see Telemetry_Add.
+ * @param values one value per field, in schema order
+ * @return none
+ * @brief  Add a record to the telemetry stream
+ */
+void Telemetry_Record(const int32_t *values);
+
+/**
+ * Close stream 0, then wait until everything has gone out.
+ * @param none
+ * @return none
+ * @brief  End a telemetry stream
+ */
+void Telemetry_End(void);
+
+/**
+ * Open a stream next to the ones already open: restart its record
+ * count and send its schema frame.  The sequence number keeps running.
+ * @param stream 0 to TELEMETRY_MAX_STREAMS-1
+ * @param name stream name, at most TELEMETRY_MAX_NAME characters
+ * @param fields columns of each record, the array must stay valid until Telemetry_Close
+ * @param numFields 1 to TELEMETRY_MAX_FIELDS
+ * @return none
+ * @note   UART0_Init must be called once prior
+ * @brief  Open a telemetry stream
+ */
+void Telemetry_Open(uint8_t stream, const char *name, const TelemetryField_t *fields, uint8_t numFields);
+
+/**
+ * Add one record.  Each value is saturated to its field type, U32
+ * fields take the bits as they are.  A data frame is sent by DMA
+ * each time one fills up, which waits if the previous frame is
+ * still going out.
+ * @param stream an open stream
+ * @param values one value per field, in schema order
+ * @return 1 if a frame was sent, 0 if the record only went into the frame
+ * @brief  Add a record to a telemetry stream
+ */
+uint8_t Telemetry_Add(uint8_t stream, const int32_t *values);
+
+/**
+ * Count records that were lost before reaching the stream.  The
+ * partly filled frame is sent, so the next data frame starts with
+ * a record number that shows the gap.
+ * @param stream an open stream
+ * @param count number of records lost
+ * @return 1 if a frame was sent, 0 if none was pending
+ * @brief  Skip lost records
+ */
+uint8_t Telemetry_Skip(uint8_t stream, uint32_t count);
+
+/**
+ * Send the partly filled data frame, if there is one.
+ * @param stream an open stream
+ * @return 1 if a frame was sent, 0 if none was pending
+ * @brief  Send pending records
+ */
+uint8_t Telemetry_Send(uint8_t stream);
+
+/**
+ * Records in the partly filled data frame
+ * @param stream an open stream
+ * @return number of records not sent yet
+ * @brief  Pending record count
+ */
+uint8_t Telemetry_Pending(uint8_t stream);
+
+/**
+ * Room left in the current data frame.  The Telemetry_Add that takes
+ * the last place sends the frame, so Telemetry_Add only sends when
+ * this is 1 or less.
+ * @param stream an open stream
+ * @return number of records that fit in the current frame
+ * @brief  Free record places
+ */
+uint8_t Telemetry_Room(uint8_t stream);
+
+/**
+ * Send the partly filled data frame and the end frame.  Does not
+ * wait for them to go out.
+ * @param stream an open stream
+ * @return none
+ * @brief  Close a telemetry stream
+ */
+void Telemetry_Close(uint8_t stream);
+
+#endif /* TELEMETRY_H_ */
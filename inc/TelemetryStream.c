@@ -0,0 +1,173 @@
+/*
+ * TelemetryStream.c
+ * Runs on MSP432
+ *
+ * Live telemetry while the robot runs, see TelemetryStream.h.
+ *
+ */
+
+#include <stdint.h>
+#include "msp.h"
+#include "../inc/CortexM.h"
+#include "../inc/UART0.h"
+#include "../inc/Telemetry.h"
+#include "../inc/TelemetryStream.h"
+
+// A producer reserves a slot inside a short critical section, fills it
+// with interrupts enabled and then marks it ready.  A producer that
+// interrupts another takes the next slot, so the drain stops at the
+// first slot that is not ready yet and keeps the records in order.
+// The indices run freely and are masked on use.  A barrier on each
+// side of Ready keeps the compiler (and the bus) from moving the slot
+// contents past it: Values, Lost and Channel are plain memory, and
+// only Ready is volatile.
+#define SLOT_MASK (TELEMETRY_STREAM_SLOTS - 1)
+typedef struct {
+    int32_t Values[TELEMETRY_MAX_FIELDS];
+    uint32_t Lost;                      // records of this channel dropped just before this one
+    uint8_t Channel;
+    volatile uint8_t Ready;             // set by the producer, cleared by the drain
+} slot_t;
+static slot_t Ring[TELEMETRY_STREAM_SLOTS];
+static volatile uint32_t PutI;          // next slot to reserve, producers only
+static volatile uint32_t GetI;          // next slot to drain, TelemetryStream_Service only
+
+typedef struct {
+    uint8_t NumFields;
+    uint16_t Decimation;
+    uint16_t Count;                     // records pushed since the last one kept
+    uint32_t Lost;                      // dropped, not yet reported in a slot
+    uint32_t Dropped;                   // dropped since the channel was added
+} channel_t;
+static channel_t Channels[TELEMETRY_MAX_STREAMS];
+static uint8_t NumChannels;
+
+void TelemetryStream_Init(void) {
+    long sr = StartCritical();
+    NumChannels = 0;
+    PutI = GetI = 0;
+    for (int i = 0; i < TELEMETRY_STREAM_SLOTS; i++) {
+        Ring[i].Ready = 0;
+    }
+    EndCritical(sr);
+}
+
+int8_t TelemetryStream_AddChannel(const char *name, const TelemetryField_t *fields,
+                                  uint8_t numFields, uint16_t decimation) {
+    channel_t *ch;
+    if (NumChannels >= TELEMETRY_MAX_STREAMS) {
+        return -1;
+    }
+    if (numFields > TELEMETRY_MAX_FIELDS) {
+        numFields = TELEMETRY_MAX_FIELDS;
+    }
+    ch = &Channels[NumChannels];
+    ch->NumFields = numFields;
+    ch->Decimation = (decimation == 0) ? 1 : decimation;
+    ch->Count = 0;
+    ch->Lost = 0;
+    ch->Dropped = 0;
+    Telemetry_Open(NumChannels, name, fields, numFields);
+    NumChannels++;
+    return NumChannels - 1;
+}
+
+void TelemetryStream_Push(int8_t channel, const int32_t *values) {
+    channel_t *ch;
+    slot_t *slot;
+    uint32_t lost;
+    long sr;
+    if ((channel < 0) || (channel >= NumChannels)) {
+        return;
+    }
+    ch = &Channels[channel];
+    sr = StartCritical();
+    ch->Count++;
+    if (ch->Count < ch->Decimation) {
+        EndCritical(sr);
+        return;
+    }
+    ch->Count = 0;
+    if ((PutI - GetI) >= TELEMETRY_STREAM_SLOTS) {
+        ch->Lost++;
+        ch->Dropped++;
+        EndCritical(sr);
+        return;
+    }
+    slot = &Ring[PutI & SLOT_MASK];
+    PutI++;
+    lost = ch->Lost;
+    ch->Lost = 0;
+    EndCritical(sr);
+
+    for (int i = 0; i < ch->NumFields; i++) {
+        slot->Values[i] = values[i];
+    }
+    slot->Lost = lost;
+    slot->Channel = channel;
+    __DMB();                            // contents written before Ready says so
+    slot->Ready = 1;
+}
+
+void TelemetryStream_Service(void) {
+    while (GetI != PutI) {
+        slot_t *slot = &Ring[GetI & SLOT_MASK];
+        uint8_t channel;
+        if (slot->Ready == 0) {
+            return;                     // its producer was interrupted, try again later
+        }
+        __DMB();                        // contents read after Ready
+        channel = slot->Channel;
+        // UART0_OutBuffer waits while the line is busy, so leave the
+        // record for later if it would send a frame now
+        if (UART0_TxBusy() &&
+            ((Telemetry_Room(channel) <= 1) || (slot->Lost && Telemetry_Pending(channel)))) {
+            return;
+        }
+        if (slot->Lost) {
+            Telemetry_Skip(channel, slot->Lost);
+        }
+        Telemetry_Add(channel, slot->Values);
+        slot->Ready = 0;
+        GetI++;
+    }
+}
+
+void TelemetryStream_Flush(void) {
+    uint32_t end = PutI;                // not the records pushed meanwhile, they could keep coming
+    TelemetryStream_Service();
+    while ((int32_t)(end - GetI) > 0) {
+        WaitForInterrupt();             // the UART or a producer interrupts
+        TelemetryStream_Service();
+    }
+    for (int i = 0; i < NumChannels; i++) {
+        // records dropped since the last one queued would show up
+        // only with the next record, report them now
+        long sr = StartCritical();
+        uint32_t lost = Channels[i].Lost;
+        Channels[i].Lost = 0;
+        EndCritical(sr);
+        Telemetry_Skip(i, lost);
+    }
+    UART0_Flush();
+}
+
+void TelemetryStream_Close(void) {
+    uint8_t channels = NumChannels;
+    long sr;
+    TelemetryStream_Flush();
+    sr = StartCritical();
+    NumChannels = 0;                    // pushes from now on are ignored
+    EndCritical(sr);
+    for (int i = 0; i < channels; i++) {
+        Telemetry_Close(i);
+    }
+    UART0_Flush();
+}
+
+uint32_t TelemetryStream_GetDropped(int8_t channel) {
+    if ((channel < 0) || (channel >= NumChannels)) {
+        return 0;
+    }
+    return Channels[channel].Dropped;
+}
@@ -0,0 +1,96 @@
+/*
+ * TelemetryStream.h
+ * Runs on MSP432
+ *
+ * Live telemetry while the robot runs.  Interrupts push records into
+ * a ring without waiting; the main loop drains the ring into
+ * Telemetry frames whenever UART0 can take them.  RAM stays bounded
+ * however long the run is, and records the ring has no room for are
+ * dropped and counted, so the decoder reports them as missing.
+ *
+ * Each channel is one Telemetry stream with its own schema and a
+ * decimation: it keeps one of every N records pushed to it.
+ *
+ */
+
+#ifndef TELEMETRYSTREAM_H_
+#define TELEMETRYSTREAM_H_
+
+#include "../inc/Telemetry.h"
+
+#define TELEMETRY_STREAM_SLOTS  64      // ring records, must be a power of two
+
+/**
+ * Empty the ring and remove all channels.  Call it before adding the
+ * channels of each run, so every run starts with fresh schema frames.
+ * @param none
+ * @return none
+ * @brief  Initialize live telemetry
+ */
+void TelemetryStream_Init(void);
+
+/**
+ * Add a channel and send its schema frame.
+ * @param name stream name, at most TELEMETRY_MAX_NAME characters
+ * @param fields columns of each record, the array must stay valid
+ * @param numFields 1 to TELEMETRY_MAX_FIELDS
+ * @param decimation keep one of every decimation records pushed, 1 keeps all
+ * @return channel number for TelemetryStream_Push, or -1 when all
+ *         TELEMETRY_MAX_STREAMS channels are taken
+ * @note   UART0_Init must be called once prior. Call it before the
+ *         interrupts that push to the channel are running.
+ * @brief  Add a telemetry channel
+ */
+int8_t TelemetryStream_AddChannel(const char *name, const TelemetryField_t *fields,
+                                  uint8_t numFields, uint16_t decimation);
+
+/**
+ * Queue one record.  Never waits: safe from any interrupt priority
+ * and from several interrupts at once.  When the ring is full the
+ * record is dropped and counted.
+ * @param channel number returned by TelemetryStream_AddChannel
+ * @param values one value per field, in schema order
+ * @return none
+ * @brief  Push a record
+ */
+void TelemetryStream_Push(int8_t channel, const int32_t *values);
+
+/**
+ * Move records from the ring into frames.  Stops instead of waiting
+ * when a frame would have to be sent while UART0 is still busy, so
+ * it returns quickly.  Call it from the main loop, not an ISR.
+ * @param none
+ * @return none
+ * @brief  Drain the ring
+ */
+void TelemetryStream_Service(void);
+
+/**
+ * Drain the ring, send every partly filled frame and wait until they
+ * have gone out, so the host has all records pushed so far.  Call it
+ * from the main loop with interrupts enabled, e.g. when a run stops.
+ * @param none
+ * @return none
+ * @brief  Send all pending records
+ */
+void TelemetryStream_Flush(void);
+
+/**
+ * Send all pending records as TelemetryStream_Flush does, then the
+ * end frame of every channel, and remove the channels.  Records
+ * pushed afterwards are ignored until channels are added again.
+ * @param none
+ * @return none
+ * @brief  End live telemetry
+ */
+void TelemetryStream_Close(void);
+
+/**
+ * @param channel number returned by TelemetryStream_AddChannel
+ * @return number of records dropped because the ring was full,
+ *         decimated records are not counted
+ * @brief  Dropped record count
+ */
+uint32_t TelemetryStream_GetDropped(int8_t channel);
+
+#endif /* TELEMETRYSTREAM_H_ */
@@ -1,6 +1,7 @@
 // UART0.c
 // Runs on MSP432
-// Busy-wait device driver for the UART UCA0.
+// Device driver for the UART UCA0, busy-wait receive and
+// interrupt-driven transmit through a FIFO, plus DMA for large buffers.
 // Daniel Valvano
 // July 11, 2019
 // Modified by EE345L students Charlie Gough && Matt Hawk
@@ -47,6 +48,8 @@ policies, either expressed or implied, of the FreeBSD Project.
 #include <stdio.h>
 #include "UART0.h"
 #include "msp.h"
+#include "CortexM.h"
+#include "Format.h"
 
 // Standard ASCII characters
 // Carriage return (CR)
@@ -64,25 +67,157 @@ policies, either expressed or implied, of the FreeBSD Project.
 
 // NOTE: UART0 is connected to the USB port
 
+// Transmit FIFO, filled by UART0_OutChar and emptied by EUSCIA0_IRQHandler.
+// The indices run freely and are masked on use, so Put-Get is the number
+// of bytes waiting even after they wrap.
+#define TXFIFO_MASK (UART0_TXFIFO_SIZE - 1)
+static char TxFifo[UART0_TXFIFO_SIZE];
+static volatile uint32_t TxPutI;        // next slot to fill, foreground only
+static volatile uint32_t TxGetI;        // next slot to send, EUSCIA0_IRQHandler only
+static volatile uint32_t TxStalls;      // calls that had to wait for room
+static volatile uint32_t TxOverflows;   // bytes dropped because waiting was impossible
+
+// Receive FIFO, filled by EUSCIA0_IRQHandler and emptied by UART0_InChar
+// and UART0_InCharNonBlock, indexed the same way.
+#define RXFIFO_MASK (UART0_RXFIFO_SIZE - 1)
+static char RxFifo[UART0_RXFIFO_SIZE];
+static volatile uint32_t RxPutI;        // next slot to fill, EUSCIA0_IRQHandler only
+static volatile uint32_t RxGetI;        // next slot to read, foreground only
+static volatile uint32_t RxOverflows;   // bytes lost because the FIFO was full
+
+// DMA channel 0, trigger 1 is UCA0TXIFG.  The control table holds the
+// primary and alternate structures of channels 0 to 7 and must be aligned
+// to its size.  Each structure is source end, destination end, control.
+#define DMA_MAX_COUNT 1024              // most bytes in one DMA cycle
+#pragma DATA_ALIGN(DmaTable, 256)
+static volatile uint32_t DmaTable[64];
+#define DMA_PRIMARY   0                 // word offset of channel 0 primary structure
+#define DMA_ALTERNATE 32                // word offset of channel 0 alternate structure
+static const char *DmaSource;           // next byte not yet given to a structure
+static volatile uint32_t DmaLeft;       // bytes not yet given to a structure
+static volatile uint8_t DmaBusy;        // 1 while UART0_OutBuffer owns TXBUF
+
+// 1 if the caller can sleep until EUSCIA0_IRQHandler makes room,
+// 0 in an ISR or a critical section
+static uint8_t canWait(long sr){
+    return ((sr & 1) == 0) && ((SCB->ICSR & 0x1FF) == 0);
+}
+
+// UCBRSx for the fractional part of N, eUSCI baud rate table in the
+// MSP432P4 technical reference.  Use the last entry whose fraction,
+// in units of 1/10000, is not above that of N.
+#define NUM_BRS 36
+static const uint16_t BrsFraction[NUM_BRS] = {
+       0,  529,  715,  835, 1001, 1252, 1430, 1670, 2147, 2224, 2503, 3000,
+    3335, 3575, 3753, 4003, 4286, 4378, 5002, 5715, 6003, 6254, 6432, 6667,
+    7001, 7147, 7503, 7861, 8004, 8333, 8464, 8572, 8751, 9004, 9170, 9288
+};
+static const uint8_t BrsValue[NUM_BRS] = {
+    0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x11, 0x21, 0x22, 0x44, 0x25,
+    0x49, 0x4A, 0x52, 0x92, 0x53, 0x55, 0xAA, 0x6B, 0xAD, 0xB5, 0xB6, 0xD6,
+    0xB7, 0xBB, 0xDD, 0xED, 0xEE, 0xBF, 0xDF, 0xEF, 0xF7, 0xFB, 0xFD, 0xFE
+};
+
+static int32_t BaudError;               // ppm, of the rate set by UART0_Init
+
+//------------UART0_BaudSettings------------
+// eUSCI baud rate algorithm.  N = clock/baudrate.
+// N > 16: oversampling, UCBRx = INT(N/16), UCBRFx = INT(N) mod 16
+// otherwise: UCBRx = INT(N), no first-stage modulation
+// Either way UCBRSx comes from the fractional part of N.
+// Input: BRCLK frequency in Hz, baud rate in bits per second,
+//        pointers to receive the BRW and MCTLW register values
+// Output: none
+void UART0_BaudSettings(uint32_t clock, uint32_t baudrate, uint16_t *brw, uint16_t *mctlw){
+    uint32_t n = clock / baudrate;
+    uint32_t fraction = ((uint64_t)(clock % baudrate) * 10000) / baudrate;
+    int i = NUM_BRS - 1;
+    while(BrsFraction[i] > fraction){
+        i--;
+    }
+    if((n > 16) || ((n == 16) && (clock % baudrate))){
+        *brw = n / 16;
+        *mctlw = (BrsValue[i] << 8) | ((n % 16) << 4) | 0x0001;
+    }else{
+        *brw = n;
+        *mctlw = BrsValue[i] << 8;
+    }
+}
+
+//------------UART0_BaudErrorSettings------------
+// Average baud rate error of register settings.  A bit is
+// 16*UCBRx + UCBRFx (oversampling) or UCBRx BRCLK cycles, and each
+// bit set in UCBRSx adds one cycle to one of every 8 bits.
+// Input: BRCLK frequency in Hz, wanted baud rate, BRW and MCTLW values
+// Output: (actual - wanted)/wanted in parts per million
+int32_t UART0_BaudErrorSettings(uint32_t clock, uint32_t baudrate, uint16_t brw, uint16_t mctlw){
+    uint32_t cycles8;                           // BRCLK cycles in 8 bits
+    uint8_t brs = mctlw >> 8;
+    if(mctlw & 0x0001){
+        cycles8 = 8*(16*brw + ((mctlw >> 4) & 0x0F));
+    }else{
+        cycles8 = 8*brw;
+    }
+    while(brs){
+        cycles8 += brs & 1;
+        brs >>= 1;
+    }
+    return ((int64_t)clock * 8000000) / ((uint64_t)cycles8 * baudrate) - 1000000;
+}
+
+//------------UART0_GetBaudError------------
+// Input: none
+// Output: error of the baud rate set by UART0_Init in parts per million
+int32_t UART0_GetBaudError(void){
+    return BaudError;
+}
+
 //------------UART0_Init------------
 // Initializes UART0 (with a 12 MHz SMCLK clock),
 // using an 8-bit data length, no parity, and one stop bit.
 // Input: baudrate in baud per second
 // Output: none
 void UART0_Init(uint32_t baudrate){
+    uint16_t brw, mctlw;
 
     // you write this as part of Lab 11
 
     // hold the USCI module in reset mode
     EUSCI_A0->CTLW0 = 0x0001;
     EUSCI_A0->CTLW0 = 0x00C1;
-    EUSCI_A0->BRW = 12000000 / baudrate;
-    EUSCI_A0->MCTLW = 0;
+    UART0_BaudSettings(UART0_BRCLK_HZ, baudrate, &brw, &mctlw);
+    EUSCI_A0->BRW = brw;
+    EUSCI_A0->MCTLW = mctlw;
+    BaudError = UART0_BaudErrorSettings(UART0_BRCLK_HZ, baudrate, brw, mctlw);
     P1->SEL0 |= 0x0C;
     P1->SEL1 &= ~0x0C;
     EUSCI_A0->CTLW0 &= ~0x0001;
     EUSCI_A0->IE &= ~0x000F;
 
+    // empty transmit FIFO, UCTXIE is armed by UART0_OutChar
+    TxPutI = TxGetI = 0;
+    TxStalls = TxOverflows = 0;
+    // empty receive FIFO, UCRXIE stays armed
+    RxPutI = RxGetI = 0;
+    RxOverflows = 0;
+    EUSCI_A0->IE |= 0x01;
+    NVIC->IP[16] = UART0_TX_PRIORITY << 5;  // EUSCIA0 is IRQ 16
+    NVIC->ISER[0] = 0x00010000;
+
+    // channel 0 for UART0_OutBuffer, one byte per UCA0TXIFG edge
+    DMA_Control->ENACLR = 0x01;
+    DmaBusy = 0;
+    DmaLeft = 0;
+    DMA_Control->CFG = 0x01;                // master enable
+    DMA_Control->CTLBASE = (uint32_t)DmaTable;
+    DMA_Channel->CH_SRCCFG[0] = 1;          // UCA0TX
+    DMA_Control->USEBURSTCLR = 0x01;
+    DMA_Control->REQMASKCLR = 0x01;
+    DMA_Control->PRIOCLR = 0x01;
+    DMA_Channel->INT1_SRCCFG = 0x20;        // DMA_INT1 on channel 0 done
+    NVIC->IP[33] = UART0_TX_PRIORITY << 5;  // DMA_INT1 is IRQ 33
+    NVIC->ISER[1] = 0x00000002;
+
 
     // Configure UART settings:
     // bit15=0,      no parity bits
@@ -101,10 +236,9 @@ void UART0_Init(uint32_t baudrate){
 
     // Set the baud rate
     // N = clock/baud rate, for 115,200 baud: N = 12,000,000 / 115,200 = 104.1667
-    // UCBR = int(N) = 104
+    // N > 16, so oversample: UCBR = int(N/16) = 6, UCBRF = int(N) mod 16 = 8
+    // and UCBRS = 0x20 for the fraction 0.1667, see UART0_BaudSettings
     // Note: 'baudrate' is a function argument passed into this initialization function. 
-
-    // Clear modulation control
     
     // Configure P1.3 and P1.2 as primary UART function pins
 
@@ -116,22 +250,259 @@ void UART0_Init(uint32_t baudrate){
 
 //------------UART0_InChar------------
 // Waits for a new character to be received on UART0
+// Sleeps until EUSCIA0_IRQHandler puts one in the receive FIFO.  In an
+// ISR or with interrupts disabled the handler cannot run, so it polls
+// the receive flag instead.
 // Input: none
 // Output: ASCII code of the received character
 char UART0_InChar(void) {
+    char data;
+    while(1){
+        long sr = StartCritical();
+        if(RxGetI != RxPutI){
+            data = RxFifo[RxGetI & RXFIFO_MASK];
+            RxGetI++;
+            EndCritical(sr);
+            return data;
+        }
+        if(canWait(sr) == 0){
+            if(EUSCI_A0->IFG & 0x01){
+                data = EUSCI_A0->RXBUF;         // clears UCRXIFG
+                EndCritical(sr);
+                return data;
+            }
+            EndCritical(sr);
+            continue;
+        }
+        EndCritical(sr);
+        WaitForInterrupt();                     // every byte received interrupts
+    }
+}
 
-    while((EUSCI_A0->IFG & 0x01) == 0);     // Wait for the receive flag to be set
-    return((char)(EUSCI_A0->RXBUF));        // Return received character
+//------------UART0_InCharNonBlock------------
+// Takes a character from the receive FIFO if there is one
+// Input: pointer to store the character
+// Output: 1 if a character was stored, 0 if none was waiting
+uint8_t UART0_InCharNonBlock(char *data){
+    if(RxGetI == RxPutI){
+        return 0;
+    }
+    *data = RxFifo[RxGetI & RXFIFO_MASK];
+    RxGetI++;                                   // only the foreground moves RxGetI
+    return 1;
+}
 
+//------------UART0_GetRxOverflows------------
+// Input: none
+// Output: number of received bytes lost since UART0_Init
+uint32_t UART0_GetRxOverflows(void){
+    return RxOverflows;
 }
 
 //------------UART0_OutChar------------
-// Sends an 8-bit character via UART0
+// Queues an 8-bit character for UART0
+// Returns as soon as the character is in the transmit FIFO.
+// When the FIFO is full it sleeps until there is room, unless it is
+// called from an ISR or with interrupts disabled, then the character
+// is dropped and counted as an overflow.
 // Input: 8-bit ASCII character to be transmitted
 // Output: none
 void UART0_OutChar(char data){
-        while((EUSCI_A0->IFG & 0x02) == 0);     //UCTXFIG - wait until its 1
-        EUSCI_A0->TXBUF = data;                 //write data after determining its empty
+    uint8_t stalled = 0;
+    while(1){
+        long sr = StartCritical();
+        if((TxPutI - TxGetI) < UART0_TXFIFO_SIZE){
+            TxFifo[TxPutI & TXFIFO_MASK] = data;
+            TxPutI++;
+            if(DmaBusy == 0){
+                EUSCI_A0->IE |= 0x02;           // UCTXIE, DMA_INT1_IRQHandler arms it otherwise
+            }
+            EndCritical(sr);
+            return;
+        }
+        EndCritical(sr);
+        if(canWait(sr) == 0){
+            TxOverflows++;
+            return;
+        }
+        if(stalled == 0){
+            TxStalls++;
+            stalled = 1;
+        }
+        WaitForInterrupt();                     // every byte sent interrupts
+    }
+}
+
+// Stores each received byte, and sends the next FIFO byte each time
+// TXBUF empties.  A receive interrupt can arrive while TXBUF still
+// holds a byte, so transmit waits for UCTXIFG as well as UCTXIE.
+void EUSCIA0_IRQHandler(void){
+    if(EUSCI_A0->IFG & 0x01){
+        char data = EUSCI_A0->RXBUF;            // clears UCRXIFG
+        if((RxPutI - RxGetI) < UART0_RXFIFO_SIZE){
+            RxFifo[RxPutI & RXFIFO_MASK] = data;
+            RxPutI++;
+        }else{
+            RxOverflows++;
+        }
+    }
+    if((EUSCI_A0->IE & 0x02) == 0){
+        return;                                 // transmit is idle or belongs to the DMA
+    }
+    if((EUSCI_A0->IFG & 0x02) == 0){
+        return;                                 // TXBUF still full, its UCTXIFG comes later
+    }
+    if(TxGetI != TxPutI){
+        EUSCI_A0->TXBUF = TxFifo[TxGetI & TXFIFO_MASK];  // clears UCTXIFG
+        TxGetI++;
+    }else{
+        EUSCI_A0->IE &= ~0x02;                  // FIFO empty, disarm UCTXIE
+    }
+}
+
+// Give the next piece of the DMA buffer to one control structure.
+// Every structure but the last is ping-pong, so the channel moves to the
+// other structure on the next UCA0TXIFG edge without losing it.
+static void dmaLoad(uint32_t offset){
+    uint32_t count = DmaLeft;
+    if(count > DMA_MAX_COUNT){
+        count = DMA_MAX_COUNT;
+    }
+    DmaLeft -= count;
+    DmaTable[offset] = (uint32_t)(DmaSource + count - 1);         // source end
+    DmaTable[offset + 1] = (uint32_t)&EUSCI_A0->TXBUF;            // destination end
+    // bits31-30=11 fixed destination, bits27-26=00 byte source increment,
+    // bytes, arbitrate every transfer, bits2-0 = 011 ping-pong or 001 basic
+    DmaTable[offset + 2] = 0xC0000000 | ((count - 1) << 4) | (DmaLeft ? 0x3 : 0x1);
+    DmaSource += count;
+}
+
+//------------UART0_OutBuffer------------
+// Sends a block of bytes via UART0 using DMA.
+// Waits for bytes already queued, then returns while the DMA streams
+// the block.  The buffer must not change until UART0_TxBusy returns 0.
+// Characters queued meanwhile are sent after the block.
+// Input: pointer to the bytes, number of bytes
+// Output: none
+void UART0_OutBuffer(const char *buf, uint32_t count){
+    long sr;
+    if(count == 0){
+        return;
+    }
+    while(1){
+        sr = StartCritical();
+        if((DmaBusy == 0) && (TxGetI == TxPutI)){
+            break;
+        }
+        EndCritical(sr);
+        if(canWait(sr) == 0){
+            TxOverflows += count;
+            return;
+        }
+        WaitForInterrupt();
+    }
+    EUSCI_A0->IE &= ~0x02;                      // TXBUF belongs to the DMA now
+    DmaBusy = 1;
+    DmaSource = buf;
+    DmaLeft = count;
+    dmaLoad(DMA_PRIMARY);
+    if(DmaLeft){
+        dmaLoad(DMA_ALTERNATE);
+    }
+    DMA_Control->ALTCLR = 0x01;                 // start with the primary structure
+    DMA_Control->ENASET = 0x01;
+    // UCTXIFG is already high, so there is no edge for the first byte
+    DMA_Channel->SW_CHTRIG = 0x01;
+    EndCritical(sr);
+}
+
+// Runs each time a control structure finishes
+void DMA_INT1_IRQHandler(void){
+    if(DMA_Control->ENASET & 0x01){
+        // the finished structure has its mode reset to 0 (stop)
+        if(DmaLeft){
+            if((DmaTable[DMA_PRIMARY + 2] & 0x7) == 0){
+                dmaLoad(DMA_PRIMARY);
+            }else if((DmaTable[DMA_ALTERNATE + 2] & 0x7) == 0){
+                dmaLoad(DMA_ALTERNATE);
+            }
+        }
+        return;
+    }
+    // basic structure done, the channel disabled itself
+    DmaBusy = 0;
+    if(TxGetI != TxPutI){
+        EUSCI_A0->IE |= 0x02;                   // resume the FIFO
+    }
+}
+
+//------------UART0_TxBusy------------
+// Input: none
+// Output: 1 while queued bytes or a DMA block are still going out, 0 when idle
+uint8_t UART0_TxBusy(void){
+    return (DmaBusy || (TxGetI != TxPutI) || (EUSCI_A0->STATW & 0x01));
+}
+
+// Does the transmit work of EUSCIA0_IRQHandler and DMA_INT1_IRQHandler
+// when they cannot run, in an ISR or a critical section.  Clearing the
+// pending bit keeps the handler from running again for the same event
+// once interrupts are back; a request still active pends again.
+static void pollTx(void){
+    if(DmaBusy){
+        if(NVIC->ISPR[1] & 0x00000002){         // DMA_INT1, a structure finished
+            NVIC->ICPR[1] = 0x00000002;
+            DMA_INT1_IRQHandler();
+        }
+    }else if((EUSCI_A0->IE & 0x02) && (EUSCI_A0->IFG & 0x02)){
+        EUSCIA0_IRQHandler();                   // TXBUF empty, send the next FIFO byte
+        NVIC->ICPR[0] = 0x00010000;
+    }
+}
+
+//------------UART0_Flush------------
+// Waits until everything queued has left the shift register.
+// Sleeps while the interrupts drain the FIFO and the DMA block.  In an
+// ISR or with interrupts disabled they cannot run, so it polls their
+// flags and moves the bytes itself.
+// Input: none
+// Output: none
+void UART0_Flush(void){
+    while(1){
+        long sr = StartCritical();
+        if((DmaBusy == 0) && (TxGetI == TxPutI)){
+            EndCritical(sr);
+            break;
+        }
+        if(canWait(sr) == 0){
+            pollTx();
+            EndCritical(sr);
+            continue;
+        }
+        EndCritical(sr);
+        WaitForInterrupt();                     // every byte or DMA structure sent interrupts
+    }
+    while(EUSCI_A0->STATW & 0x01);              // UCBUSY, last byte shifting out
+}
+
+//------------UART0_TxFree------------
+// Input: none
+// Output: number of bytes UART0_OutChar can queue without waiting
+uint32_t UART0_TxFree(void){
+    return UART0_TXFIFO_SIZE - (TxPutI - TxGetI);
+}
+
+//------------UART0_GetTxStalls------------
+// Input: none
+// Output: number of UART0_OutChar calls that waited for FIFO room since UART0_Init
+uint32_t UART0_GetTxStalls(void){
+    return TxStalls;
+}
+
+//------------UART0_GetTxOverflows------------
+// Input: none
+// Output: number of bytes dropped since UART0_Init
+uint32_t UART0_GetTxOverflows(void){
+    return TxOverflows;
 }
 
 
@@ -140,12 +511,28 @@ void UART0_OutChar(char data){
 // Input: pointer to the null-terminated string
 // Output: none
 void UART0_OutString(const char* ptr){
-    // you write this as part of Lab 11
-    // You must use UART0_OutChar
     while(*ptr != 0) {
-        UART0_OutChar(*ptr);
-        ptr++;
-}
+        // copy what fits in one short critical section, at most 16 bytes
+        long sr = StartCritical();
+        uint32_t room = UART0_TXFIFO_SIZE - (TxPutI - TxGetI);
+        if(room > 16){
+            room = 16;
+        }
+        while(room && (*ptr != 0)){
+            TxFifo[TxPutI & TXFIFO_MASK] = *ptr;
+            TxPutI++;
+            ptr++;
+            room--;
+        }
+        if(DmaBusy == 0){
+            EUSCI_A0->IE |= 0x02;
+        }
+        EndCritical(sr);
+        if((room == 0) && (*ptr != 0)){
+            UART0_OutChar(*ptr);                // FIFO full, wait or count the overflow
+            ptr++;
+        }
+    }
 }
 
 //===============================================================
@@ -189,13 +576,9 @@ uint32_t UART0_InUDec(void) {
 // Output: none
 // Variable format 1-10 digits with no space before or after
 void UART0_OutUDec(uint32_t n){
-
-    if(n >= 10){
-        UART0_OutUDec(n/10);
-        n = n%10;
-    }
-
-    UART0_OutChar(n+'0'); /* n is between 0 and 9 */
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UDec(buf, n, 0);
+    UART0_OutString(buf);
 }
 
 //-----------------------UART0_OutSDec-----------------------
@@ -204,76 +587,9 @@ void UART0_OutUDec(uint32_t n){
 // Output: none
 // Variable format 1-10 digits with no space before or after
 void UART0_OutSDec(int32_t n){
-
-    if(n < 0){
-      UART0_OutChar('-');
-      UART0_OutUDec(-n);
-    }else{
-      UART0_OutUDec(n);
-    }
-}
-
-
-uint32_t Messageindexb;
-char Messageb[8];
-
-void static fillmessageb(uint32_t n){
-// This function uses recursion to convert decimal number
-//   of unspecified length as an ASCII string
-  if(n >= 10){
-    fillmessageb(n/10);
-    n = n%10;
-  }
-  Messageb[Messageindexb] = (n+'0'); /* n is between 0 and 9 */
-  if(Messageindexb<7)Messageindexb++;
-}
-
-
-void static fillmessage4b(uint32_t n){
-  if(n>=1000){  // 1000 to 9999
-    Messageindexb = 0;
-  } else if(n>=100){  // 100 to 999
-    Messageb[0] = ' ';
-    Messageindexb = 1;
-  }else if(n>=10){ //
-    Messageb[0] = ' '; /* n is between 10 and 99 */
-    Messageb[1] = ' ';
-    Messageindexb = 2;
-  }else{
-    Messageb[0] = ' '; /* n is between 0 and 9 */
-    Messageb[1] = ' ';
-    Messageb[2] = ' ';
-    Messageindexb = 3;
-  }
-  fillmessageb(n);
-}
-
-
-void static fillmessage5b(uint32_t n){
-    if(n > 99999) n = 99999;
-    if(n >= 10000) {  // 10000 to 99999
-        Messageindexb = 0;
-    } else if(n >= 1000) {  // 1000 to 9999
-        Messageb[0] = ' ';
-        Messageindexb = 1;
-    } else if(n >= 100) {  // 100 to 999
-        Messageb[0] = ' ';
-        Messageb[1] = ' ';
-        Messageindexb = 2;
-    } else if(n >= 10) { //
-        Messageb[0] = ' '; /* n is between 10 and 99 */
-        Messageb[1] = ' ';
-        Messageb[2] = ' ';
-        Messageindexb = 3;
-    } else {
-        Messageb[0] = ' '; /* n is between 0 and 9 */
-        Messageb[1] = ' ';
-        Messageb[2] = ' ';
-        Messageb[3] = ' ';
-        Messageindexb = 4;
-    }
-
-    fillmessageb(n);
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_SDec(buf, n, 0);
+    UART0_OutString(buf);
 }
 
 
@@ -283,14 +599,9 @@ void static fillmessage5b(uint32_t n){
 // Output: none
 // Fixed format 4 digits with no space before or after
 void UART0_OutUDec4(uint32_t n){
-    if(n>9999) {
-        UART0_OutString("****");
-    } else {
-        Messageindexb = 0;
-        fillmessage4b(n);
-        Messageb[Messageindexb] = 0; // terminate
-        UART0_OutString(Messageb);
-    }
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UDecFixed(buf, n, 4);                // "****" above 9999
+    UART0_OutString(buf);
 }
 
 
@@ -300,14 +611,9 @@ void UART0_OutUDec4(uint32_t n){
 // Output: none
 // Fixed format 5 digits with no space before or after
 void UART0_OutUDec5(uint32_t n){
-  if(n>99999){
-    UART0_OutString("*****");
-  }else{
-    Messageindexb = 0;
-    fillmessage5b(n);
-    Messageb[Messageindexb] = 0; // terminate
-    UART0_OutString(Messageb);
-  }
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UDecFixed(buf, n, 5);                // "*****" above 99999
+    UART0_OutString(buf);
 }
 
 
@@ -317,9 +623,9 @@ void UART0_OutUDec5(uint32_t n){
 // Output: none
 // fixed format <digit>.<digit> with no space before or after
 void UART0_OutUFix1(uint32_t n){
-    UART0_OutUDec(n/10);
-    UART0_OutChar('.');
-    UART0_OutUDec(n%10);
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UFix(buf, n, 1);
+    UART0_OutString(buf);
 }
 
 
@@ -329,11 +635,9 @@ void UART0_OutUFix1(uint32_t n){
 // Output: none
 // fixed format <digit>.<digit><digit> with no space before or after
 void UART0_OutUFix2(uint32_t n){
-    UART0_OutUDec(n/100);
-    UART0_OutChar('.');
-    n = n%100;
-    UART0_OutUDec(n/10);
-    UART0_OutUDec(n%10);
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UFix(buf, n, 2);
+    UART0_OutString(buf);
 }
 
 
@@ -390,39 +694,21 @@ uint32_t UART0_InUHex(void){
 // Output: none
 // Variable format 1 to 8 digits with no space before or after
 void UART0_OutUHex(uint32_t number){
-// This function uses recursion to convert the number of
-//   unspecified length as an ASCII string
-  if(number >= 0x10){
-    UART0_OutUHex(number/0x10);
-    UART0_OutUHex(number%0x10);
-  }
-  else{
-    if(number < 0xA){
-      UART0_OutChar(number+'0');
-     }
-    else{
-      UART0_OutChar((number-0x0A)+'A');
-    }
-  }
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UHex(buf, number, 0);
+    UART0_OutString(buf);
 }
 
 
 //--------------------------UART0_OutUHex2----------------------------
-// Output a 32-bit number in unsigned hexadecimal format
+// Output the low byte of a number in unsigned hexadecimal format
 // Input: 32-bit number to be transferred
 // Output: none
 // Fixed format 2 digits with no space before or after
-void outnibble(uint32_t n){
-    if(n < 0xA){
-   UART0_OutChar(n+'0');
-  }
-  else{
-    UART0_OutChar((n-0x0A)+'A');
-  }
-}
 void UART0_OutUHex2(uint32_t number){
-  outnibble(number/0x10); // ms digit
-  outnibble(number%0x10); // ls digit
+    char buf[FORMAT_BUFFER_SIZE];
+    Format_UHex(buf, number & 0xFF, 2);
+    UART0_OutString(buf);
 }
 
 
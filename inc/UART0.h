@@ -9,7 +9,8 @@
  * 4) Call UART0_Initprintf()
  * @remark    UCA0RXD (VCP receive) connected to P1.2
  * @remark    UCA0TXD (VCP transmit) connected to P1.3
- * @remark    Busy-wait device driver for the EUSCI A0 UART
+ * @remark    Interrupt-driven receive and transmit through FIFOs,
+ * and DMA transmit of whole buffers for the EUSCI A0 UART
  * @version   TI-RSLK MAX v1.1
  * @author    Daniel Valvano and Jonathan Valvano
  * @copyright Copyright 2019 by Jonathan W. Valvano, valvano@mail.utexas.edu,
@@ -65,18 +66,59 @@ policies, either expressed or implied, of the FreeBSD Project.
  * @{*/
 // standard ASCII symbols
 
+#define UART0_BRCLK_HZ    12000000  // SMCLK, clocks the baud rate generator
+#define UART0_TXFIFO_SIZE 1024  // transmit FIFO bytes, must be a power of two
+#define UART0_RXFIFO_SIZE 64    // receive FIFO bytes, must be a power of two
+#define UART0_TX_PRIORITY 5     // EUSCIA0 and DMA_INT1 priority, below the control loops
+
 
 /**
  * @details   Initialize EUSCI_A0 for UART operation
  * @details   custom baud rate (assuming 12 MHz SMCLK clock),
  * @details   8 bit word length, no parity bits, one stop bit
- * @param  baudrate is the baudrate of UART2.
+ * @details   The divider and modulation come from UART0_BaudSettings,
+ * @details   so rates such as 230400, 460800 and 921600 work as well.
+ * @param  baudrate is the baudrate of UART0, up to 1/3 of UART0_BRCLK_HZ
  * @return none
  * @note   assumes 48 MHz bus and 12 MHz SMCLK
+ * @see    UART0_GetBaudError
  * @brief  Initialize EUSCI A0
  */
 void UART0_Init(uint32_t baudrate);
 
+/**
+ * @details   eUSCI baud rate algorithm from the technical reference:
+ * @details   N = clock/baudrate; if N > 16 oversample with
+ * @details   UCBRx = INT(N/16) and UCBRFx = INT(N) mod 16, else UCBRx = INT(N);
+ * @details   UCBRSx is looked up from the fractional part of N.
+ * @param  clock is the BRCLK frequency in Hz
+ * @param  baudrate is the wanted baud rate
+ * @param  brw receives the UCAxBRW value
+ * @param  mctlw receives the UCAxMCTLW value
+ * @return none
+ * @brief  Compute baud rate register settings
+ */
+void UART0_BaudSettings(uint32_t clock, uint32_t baudrate, uint16_t *brw, uint16_t *mctlw);
+
+/**
+ * @details   Average baud rate error of register settings
+ * @param  clock is the BRCLK frequency in Hz
+ * @param  baudrate is the wanted baud rate
+ * @param  brw is the UCAxBRW value
+ * @param  mctlw is the UCAxMCTLW value
+ * @return (actual - wanted)/wanted in parts per million
+ * @brief  Baud rate error of register settings
+ */
+int32_t UART0_BaudErrorSettings(uint32_t clock, uint32_t baudrate, uint16_t brw, uint16_t mctlw);
+
+/**
+ * @details   Average baud rate error of the rate set by UART0_Init
+ * @param  none
+ * @return (actual - wanted)/wanted in parts per million
+ * @brief  Achieved baud rate error
+ */
+int32_t UART0_GetBaudError(void);
+
 
 /**
  * @details   Initializes C standard library, enables printf to work
@@ -93,8 +135,10 @@ void UART0_Initprintf(void);
 
 /**
  * @details   Receive a character from EUSCI_A0 UART
- * @details   Busy-wait synchronization,
- * @details   blocking, wait for new serial port input
+ * @details   Interrupt synchronization, EUSCIA0_IRQHandler puts every
+ * @details   received character in the receive FIFO.
+ * @details   Blocking, sleeps until there is new serial port input.
+ * @details   In an ISR or with interrupts disabled it busy-waits instead.
  * @param  none
  * @return ASCII code for key typed
  * @note   UART0_Init must be called once prior
@@ -102,11 +146,33 @@ void UART0_Initprintf(void);
  */
 char UART0_InChar(void);
 
+/**
+ * @details   Receive a character from EUSCI_A0 UART without waiting
+ * @param  data is where the character is stored
+ * @return 1 if a character was received, 0 if the receive FIFO is empty
+ * @note   UART0_Init must be called once prior. Call it from the
+ *         foreground only, like UART0_InChar.
+ * @brief  Receive byte into MSP432 if one is waiting
+ */
+uint8_t UART0_InCharNonBlock(char *data);
+
+/**
+ * @details   Number of received bytes lost since UART0_Init because
+ * @details   the receive FIFO was full
+ * @param  none
+ * @return number of bytes lost
+ * @brief  Receive overflow count
+ */
+uint32_t UART0_GetRxOverflows(void);
+
 
 /**
  * @details   Transmit a character to EUSCI_A0 UART
- * @details   Busy-wait synchronization,
- * @details   blocking, wait for UART to be ready
+ * @details   Interrupt synchronization, the character is put in the
+ * @details   transmit FIFO and EUSCIA0_IRQHandler sends it later.
+ * @details   If the FIFO is full it sleeps until there is room.
+ * @details   In an ISR or with interrupts disabled it cannot wait,
+ * @details   so the character is dropped and counted instead.
  * @param  data is the ASCII code for key to send
  * @return none
  * @note   UART0_Init must be called once prior
@@ -114,6 +180,63 @@ char UART0_InChar(void);
  */
 void UART0_OutChar(char data);
 
+/**
+ * @details   Transmit a block of bytes to EUSCI_A0 UART with DMA channel 0
+ * @details   Waits for bytes already queued, starts the DMA and returns.
+ * @details   The CPU is not involved until the block is done, and
+ * @details   characters queued meanwhile go out after the block.
+ * @param  buf is pointer to the bytes, it must stay valid until UART0_TxBusy returns 0
+ * @param  count is the number of bytes, any size
+ * @return none
+ * @note   UART0_Init must be called once prior
+ * @brief  Transmit a buffer out of MSP432 with DMA
+ */
+void UART0_OutBuffer(const char *buf, uint32_t count);
+
+/**
+ * @details   Check whether transmission is finished
+ * @param  none
+ * @return 1 while queued bytes or a DMA block are going out, 0 when idle
+ * @brief  Transmitter busy
+ */
+uint8_t UART0_TxBusy(void);
+
+/**
+ * @details   Wait until every queued byte has left the shift register
+ * @details   Also works in an ISR or with interrupts disabled, by
+ * @details   polling the transmit and DMA flags instead of sleeping
+ * @param  none
+ * @return none
+ * @brief  Wait for transmission to finish
+ */
+void UART0_Flush(void);
+
+/**
+ * @details   Room left in the transmit FIFO
+ * @param  none
+ * @return number of bytes UART0_OutChar can queue without waiting
+ * @brief  Free transmit FIFO space
+ */
+uint32_t UART0_TxFree(void);
+
+/**
+ * @details   Back-pressure count, the number of UART0_OutChar calls
+ * @details   that found the FIFO full and waited, since UART0_Init
+ * @param  none
+ * @return number of calls that waited
+ * @brief  Transmit stall count
+ */
+uint32_t UART0_GetTxStalls(void);
+
+/**
+ * @details   Number of bytes dropped since UART0_Init because the FIFO
+ * @details   was full in a context that could not wait
+ * @param  none
+ * @return number of bytes dropped
+ * @brief  Transmit overflow count
+ */
+uint32_t UART0_GetTxOverflows(void);
+
 
 /**
  * @details   Transmit a string to EUSCI_A0 UART
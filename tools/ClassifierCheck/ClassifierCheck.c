@@ -0,0 +1,458 @@
+// ClassifierCheck.c
+// Runs on Linux (host), not on the MSP432
+// Exhaustive check of Classify() in inc/Classifier.c.  This is the
+// host version of Program15_2 and Program15_3 in Lab15_ADC: the
+// robot takes hours to sweep 1000^3 inputs, a PC takes seconds.
+//
+// The (left, center, right) cube is cut into slabs of one left value.
+// Each thread owns a range of slabs and works from its front; a thread
+// that runs dry steals the back half of the largest remaining range.
+// Mismatching cells are merged into boxes of identical (result, truth)
+// along right, then center, then left, so a wrong threshold shows up
+// as one line instead of thousands.
+//
+// Solution.obj is built for the Cortex-M4 and cannot be linked here,
+// so the reference is Classify_IfChain (the original nested-if
+// version), selectable with -DREFERENCE=<function>.
+//
+// Build and run from this directory:
+//   gcc -O2 -pthread -I../../inc ClassifierCheck.c ../../inc/Classifier.c -o ClassifierCheck
+//   ./ClassifierCheck            full 1000^3 sweep, all cores
+//   ./ClassifierCheck -c         CornerCases only (Program15_2)
+//   ./ClassifierCheck -b 10000000  time both versions instead of sweeping
+// Options:
+//   -c          use the 18 CornerCases values on every axis
+//   -r <n>      sweep 0..n-1 on every axis (default 1000)
+//   -j <n>      number of threads (default: all online cores)
+//   -t <s>,<c>  Classify_SetThresholds(s, c) before the sweep
+//   -n <n>      print at most n mismatch boxes (default 50)
+//   -b <n>      time DUT and REFERENCE on one thread, n random inputs
+//               from 0..r-1 (or from CornerCases with -c), and report
+//               classifications per second; the results must also match
+// Exit status is 0 when every cell matches.
+//
+// The times are for this PC.  An x86 predicts the if-chain well on a
+// real corridor, so random inputs, where every branch is a coin toss,
+// show the most the table can save; the Cortex-M4 has no branch
+// predictor and pays for every taken branch.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "Classifier.h"
+
+#ifndef DUT
+#define DUT        Classify
+#endif
+#ifndef REFERENCE
+#define REFERENCE  Classify_IfChain
+#endif
+
+#define STR2(x) #x
+#define STR(x)  STR2(x)
+
+#define MAX_THREADS 256
+#define MAX_BOXES   (1 << 20)   // per thread, further mismatches are only counted
+
+// same values as Program15_2 in Lab15_ADC/Lab15_ADCmain.c
+static const int32_t CornerCases[18] = {49,50,51,149,150,151,211,212,213,353,354,355,599,600,601,799,800,801};
+
+// a run of mismatches, in axis indices, inclusive on both ends
+typedef struct {
+    uint32_t l0, l1;
+    uint32_t c0, c1;
+    uint32_t r0, r1;
+    uint8_t result, truth;
+} box_t;
+
+typedef struct {
+    pthread_mutex_t Lock;
+    uint32_t Next;              // next slab to take from the front
+    uint32_t End;               // one past the last slab owned
+    box_t *Boxes;
+    uint32_t NumBoxes;
+    uint64_t Errors;
+    uint64_t Dropped;           // mismatching boxes not stored (MAX_BOXES)
+    uint32_t Steals;
+} worker_t;
+
+static const int32_t *Axis;     // distance for each index
+static uint32_t AxisN;
+static worker_t Workers[MAX_THREADS];
+static uint32_t NumWorkers;
+
+static const char *ScenarioName(uint8_t s) {
+    switch (s) {
+    case ClassificationError: return "ClassificationError";
+    case LeftTooClose:        return "LeftTooClose";
+    case RightTooClose:       return "RightTooClose";
+    case LeftTooClose | RightTooClose: return "RL2Close";
+    case CenterTooClose:      return "CenterTooClose";
+    case LeftTooClose | CenterTooClose:  return "LC2Close";
+    case RightTooClose | CenterTooClose: return "RC2Close";
+    case LeftTooClose | RightTooClose | CenterTooClose: return "RLC2Close";
+    case Straight:            return "Straight";
+    case LeftTurn:            return "LeftTurn";
+    case RightTurn:           return "RightTurn";
+    case TeeJoint:            return "TeeJoint";
+    case LeftJoint:           return "LeftJoint";
+    case RightJoint:          return "RightJoint";
+    case CrossRoad:           return "CrossRoad";
+    case Blocked:             return "Blocked";
+    default:                  return "?";
+    }
+}
+
+// Take one slab, from our own range if possible, else steal.
+// Returns 0 when no work is left anywhere.
+static int TakeSlab(worker_t *me, uint32_t *slab) {
+    pthread_mutex_lock(&me->Lock);
+    if (me->Next < me->End) {
+        *slab = me->Next++;
+        pthread_mutex_unlock(&me->Lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&me->Lock);
+
+    for (;;) {
+        // pick the victim with the most work left
+        worker_t *victim = NULL;
+        uint32_t most = 0;
+        for (uint32_t i = 0; i < NumWorkers; i++) {
+            worker_t *w = &Workers[i];
+            uint32_t left = w->End - w->Next;   // racy peek, rechecked below
+            if (w != me && w->Next < w->End && left > most) {
+                most = left;
+                victim = w;
+            }
+        }
+        if (victim == NULL) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&victim->Lock);
+        uint32_t remaining = victim->End - victim->Next;
+        if (victim->Next >= victim->End) {
+            pthread_mutex_unlock(&victim->Lock);
+            continue;   // drained while we looked, try another
+        }
+        uint32_t half = (remaining + 1) / 2;
+        uint32_t start = victim->End - half;
+        victim->End = start;
+        pthread_mutex_unlock(&victim->Lock);
+
+        pthread_mutex_lock(&me->Lock);
+        me->Next = start + 1;
+        me->End = start + half;
+        me->Steals++;
+        pthread_mutex_unlock(&me->Lock);
+        *slab = start;
+        return 1;
+    }
+}
+
+static box_t *NewBox(worker_t *me) {
+    if (me->NumBoxes == MAX_BOXES) {
+        me->Dropped++;
+        return NULL;
+    }
+    return &me->Boxes[me->NumBoxes++];
+}
+
+// Compare every cell with left = Axis[l].  Runs along right are
+// merged with an identical run on the previous center row, which
+// is found with a two-pointer walk since both rows are sorted by r0.
+static void CheckSlab(worker_t *me, uint32_t l, uint32_t *prev, uint32_t *cur) {
+    int32_t left = Axis[l];
+    uint32_t numPrev = 0;
+
+    for (uint32_t c = 0; c < AxisN; c++) {
+        int32_t center = Axis[c];
+        uint32_t numCur = 0;
+        uint32_t p = 0;
+        uint32_t r = 0;
+
+        while (r < AxisN) {
+            uint8_t result = DUT(left, center, Axis[r]);
+            uint8_t truth = REFERENCE(left, center, Axis[r]);
+            if (result == truth) {
+                r++;
+                continue;
+            }
+            // extend the run while the same mismatch repeats
+            uint32_t r0 = r++;
+            while (r < AxisN &&
+                   DUT(left, center, Axis[r]) == result &&
+                   REFERENCE(left, center, Axis[r]) == truth) {
+                r++;
+            }
+            uint32_t r1 = r - 1;
+            me->Errors += r1 - r0 + 1;
+
+            while (p < numPrev && me->Boxes[prev[p]].r0 < r0) {
+                p++;
+            }
+            if (p < numPrev) {
+                box_t *b = &me->Boxes[prev[p]];
+                if (b->r0 == r0 && b->r1 == r1 && b->result == result && b->truth == truth) {
+                    b->c1 = c;
+                    cur[numCur++] = prev[p++];
+                    continue;
+                }
+            }
+            box_t *b = NewBox(me);
+            if (b != NULL) {
+                *b = (box_t){l, l, c, c, r0, r1, result, truth};
+                cur[numCur++] = (uint32_t)(b - me->Boxes);
+            }
+        }
+
+        uint32_t *tmp = prev;
+        prev = cur;
+        cur = tmp;
+        numPrev = numCur;
+    }
+}
+
+static void *Worker(void *arg) {
+    worker_t *me = arg;
+    // one row holds at most AxisN/2+1 runs
+    uint32_t *prev = malloc(sizeof(uint32_t) * (AxisN / 2 + 1));
+    uint32_t *cur = malloc(sizeof(uint32_t) * (AxisN / 2 + 1));
+    uint32_t slab;
+
+    if (prev == NULL || cur == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    while (TakeSlab(me, &slab)) {
+        CheckSlab(me, slab, prev, cur);
+    }
+    free(prev);
+    free(cur);
+    return NULL;
+}
+
+// order so that boxes which differ only in left are adjacent
+static int CompareCR(const void *a, const void *b) {
+    const box_t *x = a, *y = b;
+    if (x->c0 != y->c0) return x->c0 < y->c0 ? -1 : 1;
+    if (x->c1 != y->c1) return x->c1 < y->c1 ? -1 : 1;
+    if (x->r0 != y->r0) return x->r0 < y->r0 ? -1 : 1;
+    if (x->r1 != y->r1) return x->r1 < y->r1 ? -1 : 1;
+    if (x->result != y->result) return x->result < y->result ? -1 : 1;
+    if (x->truth != y->truth) return x->truth < y->truth ? -1 : 1;
+    if (x->l0 != y->l0) return x->l0 < y->l0 ? -1 : 1;
+    return 0;
+}
+
+static int CompareLCR(const void *a, const void *b) {
+    const box_t *x = a, *y = b;
+    if (x->l0 != y->l0) return x->l0 < y->l0 ? -1 : 1;
+    if (x->c0 != y->c0) return x->c0 < y->c0 ? -1 : 1;
+    if (x->r0 != y->r0) return x->r0 < y->r0 ? -1 : 1;
+    return 0;
+}
+
+static double Seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static volatile uint32_t Sink;
+
+// time one version over the same inputs, returns classifications per second
+static double Rate(scenario_t (*f)(int32_t, int32_t, int32_t), const int32_t *in, uint32_t count) {
+    double best = 0;
+    for (int run = 0; run < 5; run++) {
+        uint32_t sum = 0;
+        double start = Seconds();
+        for (uint32_t i = 0; i < count; i++) {
+            sum += f(in[3*i], in[3*i+1], in[3*i+2]);
+        }
+        double rate = count / (Seconds() - start);
+        Sink = sum;
+        if (rate > best) {
+            best = rate;
+        }
+    }
+    return best;
+}
+
+// -b: random inputs from the axis, both versions timed, best of 5 runs
+static int Bench(uint32_t count) {
+    int32_t *in = malloc(sizeof(int32_t) * 3 * (uint64_t)count);
+    uint64_t errors = 0;
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    if (in == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    for (uint64_t i = 0; i < 3 * (uint64_t)count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        in[i] = Axis[(state >> 32) % AxisN];
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        errors += DUT(in[3*i], in[3*i+1], in[3*i+2]) != REFERENCE(in[3*i], in[3*i+1], in[3*i+2]);
+    }
+    double dut = Rate(DUT, in, count);
+    double ref = Rate(REFERENCE, in, count);
+    printf("%u random inputs from %u values, one thread, best of 5 runs:\n", count, AxisN);
+    printf("  %-18s %8.1f M classifications/s\n", STR(DUT), dut / 1e6);
+    printf("  %-18s %8.1f M classifications/s\n", STR(REFERENCE), ref / 1e6);
+    printf("  %s runs at %.2fx the rate of %s, %llu mismatches\n", STR(DUT), dut / ref,
+           STR(REFERENCE), (unsigned long long)errors);
+    free(in);
+    return errors != 0;
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c] [-r n] [-j threads] [-t side,center] [-n maxboxes] [-b n]\n", name);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    int corner = 0;
+    uint32_t range = 1000;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t maxPrint = 50;
+    uint32_t bench = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "cr:j:t:n:b:")) != -1) {
+        switch (opt) {
+        case 'b': bench = strtoul(optarg, NULL, 0); break;
+        case 'c': corner = 1; break;
+        case 'r': range = strtoul(optarg, NULL, 0); break;
+        case 'j': threads = strtol(optarg, NULL, 0); break;
+        case 'n': maxPrint = strtoul(optarg, NULL, 0); break;
+        case 't': {
+            long side, center;
+            if (sscanf(optarg, "%ld,%ld", &side, &center) != 2) Usage(argv[0]);
+            Classify_SetThresholds(side, center);
+            break;
+        }
+        default: Usage(argv[0]);
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    int32_t *values = NULL;
+    if (corner) {
+        Axis = CornerCases;
+        AxisN = sizeof(CornerCases) / sizeof(CornerCases[0]);
+    } else {
+        if (range == 0) Usage(argv[0]);
+        values = malloc(sizeof(int32_t) * range);
+        if (values == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 2;
+        }
+        for (uint32_t i = 0; i < range; i++) {
+            values[i] = (int32_t)i;
+        }
+        Axis = values;
+        AxisN = range;
+    }
+    if (bench) {
+        int status = Bench(bench);
+        free(values);
+        return status;
+    }
+    if ((uint32_t)threads > AxisN) threads = AxisN;
+    NumWorkers = (uint32_t)threads;
+
+    // deal the slabs out evenly, stealing evens out the rest
+    for (uint32_t i = 0; i < NumWorkers; i++) {
+        worker_t *w = &Workers[i];
+        pthread_mutex_init(&w->Lock, NULL);
+        w->Next = (uint32_t)((uint64_t)AxisN * i / NumWorkers);
+        w->End = (uint32_t)((uint64_t)AxisN * (i + 1) / NumWorkers);
+        w->Boxes = malloc(sizeof(box_t) * MAX_BOXES);
+        if (w->Boxes == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 2;
+        }
+    }
+
+    double start = Seconds();
+    pthread_t tid[MAX_THREADS];
+    for (uint32_t i = 0; i < NumWorkers; i++) {
+        pthread_create(&tid[i], NULL, Worker, &Workers[i]);
+    }
+    for (uint32_t i = 0; i < NumWorkers; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    double elapsed = Seconds() - start;
+
+    uint64_t errors = 0, dropped = 0, numBoxes = 0;
+    uint32_t steals = 0;
+    for (uint32_t i = 0; i < NumWorkers; i++) {
+        errors += Workers[i].Errors;
+        dropped += Workers[i].Dropped;
+        numBoxes += Workers[i].NumBoxes;
+        steals += Workers[i].Steals;
+    }
+
+    // gather, then merge boxes that continue along left
+    box_t *all = malloc(sizeof(box_t) * (numBoxes ? numBoxes : 1));
+    if (all == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < NumWorkers; i++) {
+        memcpy(&all[n], Workers[i].Boxes, sizeof(box_t) * Workers[i].NumBoxes);
+        n += Workers[i].NumBoxes;
+        free(Workers[i].Boxes);
+    }
+    qsort(all, n, sizeof(box_t), CompareCR);
+    uint64_t merged = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        box_t *last = merged ? &all[merged - 1] : NULL;
+        if (last && last->c0 == all[i].c0 && last->c1 == all[i].c1 &&
+            last->r0 == all[i].r0 && last->r1 == all[i].r1 &&
+            last->result == all[i].result && last->truth == all[i].truth &&
+            last->l1 + 1 == all[i].l0) {
+            last->l1 = all[i].l1;
+        } else {
+            all[merged++] = all[i];
+        }
+    }
+    qsort(all, merged, sizeof(box_t), CompareLCR);
+
+    uint64_t cells = (uint64_t)AxisN * AxisN * AxisN;
+    printf("%s vs %s, %s %u^3 = %llu cells, %u threads, %u steals, %.2f s (%.0f M cells/s)\n",
+           STR(DUT), STR(REFERENCE), corner ? "CornerCases" : "0..n-1",
+           AxisN, (unsigned long long)cells, NumWorkers, steals,
+           elapsed, cells / elapsed / 1e6);
+    printf("mismatches: %llu in %llu boxes\n",
+           (unsigned long long)errors, (unsigned long long)merged);
+    for (uint64_t i = 0; i < merged && i < maxPrint; i++) {
+        box_t *b = &all[i];
+        uint64_t size = (uint64_t)(b->l1 - b->l0 + 1) * (b->c1 - b->c0 + 1) * (b->r1 - b->r0 + 1);
+        printf("  left [%d,%d] center [%d,%d] right [%d,%d]: %s, expected %s (%llu cells)\n",
+               Axis[b->l0], Axis[b->l1], Axis[b->c0], Axis[b->c1], Axis[b->r0], Axis[b->r1],
+               ScenarioName(b->result), ScenarioName(b->truth), (unsigned long long)size);
+    }
+    if (merged > maxPrint) {
+        printf("  ... %llu more boxes (-n to show more)\n", (unsigned long long)(merged - maxPrint));
+    }
+    if (dropped) {
+        printf("  %llu runs were counted but not boxed (more than %u per thread)\n",
+               (unsigned long long)dropped, MAX_BOXES);
+    }
+
+    free(all);
+    free(values);
+    return errors != 0;
+}
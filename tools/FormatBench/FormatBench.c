@@ -0,0 +1,438 @@
+// FormatBench.c
+// Runs on Linux (host), not on the MSP432
+// Checks inc/Format.c against the number printing it replaced in
+// inc/UART0.c and inc/Nokia5110.c, and times both.  The old routines
+// are copied below as they were, with their output character function
+// writing into a buffer; the new ones are the driver wrappers around
+// Format_*.  Every output must match byte for byte.
+//
+// Inputs are every value up to 2^20, the values around each power of
+// 10 and 16 and the 32-bit limits, then random 32-bit values, each with
+// every min_length from 0 to 12 for the Nokia functions.  div100 is also
+// checked against a real divide for all 2^32 inputs.
+//
+// The times are for this PC and say little about the robot.  An x86
+// already divides by a constant with a multiply and predicts the
+// recursion, so the old code is not slower here.  On the Cortex-M4
+// the new code saves a call per digit and half of the divides.
+//
+// Build and run from this directory:
+//   gcc -O2 -I../../inc FormatBench.c ../../inc/Format.c -o FormatBench
+//   ./FormatBench            check and time
+//   ./FormatBench -n 1000000 use 1000000 random values (default 10000000)
+// Exit status is 0 when every output matches.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "Format.h"
+
+static char Out[64];            // output of one call
+static int OutN;
+
+static void OutChar(char c) {
+    Out[OutN++] = c;
+}
+
+static void OutString(const char *s) {
+    while (*s) OutChar(*s++);
+}
+
+// ---------- old inc/UART0.c ----------
+
+static void OldUDec(uint32_t n) {
+    if (n >= 10) {
+        OldUDec(n/10);
+        n = n%10;
+    }
+    OutChar(n+'0');
+}
+
+static void OldSDec(int32_t n) {
+    if (n < 0) {
+        OutChar('-');
+        OldUDec(-n);
+    } else {
+        OldUDec(n);
+    }
+}
+
+static uint32_t Messageindexb;
+static char Messageb[8];
+
+static void fillmessageb(uint32_t n) {
+    if (n >= 10) {
+        fillmessageb(n/10);
+        n = n%10;
+    }
+    Messageb[Messageindexb] = (n+'0');
+    if (Messageindexb < 7) Messageindexb++;
+}
+
+static void fillmessage4b(uint32_t n) {
+    if (n >= 1000) {
+        Messageindexb = 0;
+    } else if (n >= 100) {
+        Messageb[0] = ' ';
+        Messageindexb = 1;
+    } else if (n >= 10) {
+        Messageb[0] = ' ';
+        Messageb[1] = ' ';
+        Messageindexb = 2;
+    } else {
+        Messageb[0] = ' ';
+        Messageb[1] = ' ';
+        Messageb[2] = ' ';
+        Messageindexb = 3;
+    }
+    fillmessageb(n);
+}
+
+static void fillmessage5b(uint32_t n) {
+    if (n > 99999) n = 99999;
+    if (n >= 10000) {
+        Messageindexb = 0;
+    } else if (n >= 1000) {
+        Messageb[0] = ' ';
+        Messageindexb = 1;
+    } else if (n >= 100) {
+        Messageb[0] = ' ';
+        Messageb[1] = ' ';
+        Messageindexb = 2;
+    } else if (n >= 10) {
+        Messageb[0] = ' ';
+        Messageb[1] = ' ';
+        Messageb[2] = ' ';
+        Messageindexb = 3;
+    } else {
+        Messageb[0] = ' ';
+        Messageb[1] = ' ';
+        Messageb[2] = ' ';
+        Messageb[3] = ' ';
+        Messageindexb = 4;
+    }
+    fillmessageb(n);
+}
+
+static void OldUDec4(uint32_t n) {
+    if (n > 9999) {
+        OutString("****");
+    } else {
+        Messageindexb = 0;
+        fillmessage4b(n);
+        Messageb[Messageindexb] = 0;
+        OutString(Messageb);
+    }
+}
+
+static void OldUDec5(uint32_t n) {
+    if (n > 99999) {
+        OutString("*****");
+    } else {
+        Messageindexb = 0;
+        fillmessage5b(n);
+        Messageb[Messageindexb] = 0;
+        OutString(Messageb);
+    }
+}
+
+static void OldUFix1(uint32_t n) {
+    OldUDec(n/10);
+    OutChar('.');
+    OldUDec(n%10);
+}
+
+static void OldUFix2(uint32_t n) {
+    OldUDec(n/100);
+    OutChar('.');
+    n = n%100;
+    OldUDec(n/10);
+    OldUDec(n%10);
+}
+
+static void OldUHex(uint32_t number) {
+    if (number >= 0x10) {
+        OldUHex(number/0x10);
+        OldUHex(number%0x10);
+    } else {
+        if (number < 0xA) {
+            OutChar(number+'0');
+        } else {
+            OutChar((number-0x0A)+'A');
+        }
+    }
+}
+
+static void outnibble(uint32_t n) {
+    if (n < 0xA) {
+        OutChar(n+'0');
+    } else {
+        OutChar((n-0x0A)+'A');
+    }
+}
+
+static void OldUHex2(uint32_t number) {
+    outnibble(number/0x10);
+    outnibble(number%0x10);
+}
+
+// ---------- old inc/Nokia5110.c ----------
+
+static char Buffer[12];
+
+static int Nokia_Num2String(uint32_t n) {
+    int count = 0;
+    do {
+        Buffer[count++] = (n%10) + '0';
+        n = n/10;
+    } while (n);
+    return count;
+}
+
+static void OldNokiaUDec(uint32_t n, int min_length) {
+    int count = Nokia_Num2String(n);
+    if (count >= min_length) {
+        for (int i = 0; i < count; i++) {
+            OutChar(Buffer[count - (i + 1)]);
+        }
+    } else {
+        while (count != 0) {
+            if (min_length > count) {
+                OutChar(' ');
+                min_length--;
+            } else {
+                OutChar(Buffer[min_length - 1]);
+                min_length--;
+                count--;
+            }
+        }
+    }
+}
+
+static void OldNokiaSDec(int32_t n, int min_length) {
+    uint32_t x = (n < 0) ? (uint32_t)(-n) : (uint32_t)n;
+    int count = Nokia_Num2String(x);
+    int count2 = (n < 0) ? count + 1 : count;
+    while (min_length > count2) {
+        OutChar(' ');
+        min_length--;
+    }
+    if (n < 0) {
+        OutChar('-');
+    }
+    for (int i = 0; i < count; i++) {
+        OutChar(Buffer[count - (i + 1)]);
+    }
+}
+
+static void HexSingle_Helper(uint8_t n) {
+    n = n & 0x0F;
+    if (n > 9) {
+        OutChar('A'+n-10);
+    } else {
+        OutChar(n+'0');
+    }
+}
+
+static void OldNokiaU8Hex(uint8_t n) {
+    OutString("0x");
+    HexSingle_Helper(n/16);
+    HexSingle_Helper(n);
+}
+
+// ---------- new, as in the drivers ----------
+
+static void NewUDec(uint32_t n)  { char b[FORMAT_BUFFER_SIZE]; Format_UDec(b, n, 0); OutString(b); }
+static void NewSDec(int32_t n)   { char b[FORMAT_BUFFER_SIZE]; Format_SDec(b, n, 0); OutString(b); }
+static void NewUDec4(uint32_t n) { char b[FORMAT_BUFFER_SIZE]; Format_UDecFixed(b, n, 4); OutString(b); }
+static void NewUDec5(uint32_t n) { char b[FORMAT_BUFFER_SIZE]; Format_UDecFixed(b, n, 5); OutString(b); }
+static void NewUFix1(uint32_t n) { char b[FORMAT_BUFFER_SIZE]; Format_UFix(b, n, 1); OutString(b); }
+static void NewUFix2(uint32_t n) { char b[FORMAT_BUFFER_SIZE]; Format_UFix(b, n, 2); OutString(b); }
+static void NewUHex(uint32_t n)  { char b[FORMAT_BUFFER_SIZE]; Format_UHex(b, n, 0); OutString(b); }
+static void NewUHex2(uint32_t n) { char b[FORMAT_BUFFER_SIZE]; Format_UHex(b, n & 0xFF, 2); OutString(b); }
+static void NewNokiaUDec(uint32_t n, int w) { char b[FORMAT_BUFFER_SIZE]; Format_UDec(b, n, w); OutString(b); }
+static void NewNokiaSDec(int32_t n, int w)  { char b[FORMAT_BUFFER_SIZE]; Format_SDec(b, n, w); OutString(b); }
+static void NewNokiaU8Hex(uint8_t n) {
+    char b[FORMAT_BUFFER_SIZE] = "0x";
+    Format_UHex(&b[2], n, 2);
+    OutString(b);
+}
+
+// ---------- comparison ----------
+
+typedef struct {
+    const char *Name;
+    void (*Old)(uint32_t n, int w);
+    void (*New)(uint32_t n, int w);
+    uint32_t Max;               // largest input in the documented range
+    int Widths;                 // 1 if min_length is used
+    uint64_t Calls, Errors;
+    double OldTime, NewTime;
+} test_t;
+
+static void oUDec(uint32_t n, int w)  { (void)w; OldUDec(n); }
+static void nUDec(uint32_t n, int w)  { (void)w; NewUDec(n); }
+static void oSDec(uint32_t n, int w)  { (void)w; OldSDec(n); }
+static void nSDec(uint32_t n, int w)  { (void)w; NewSDec(n); }
+static void oUDec4(uint32_t n, int w) { (void)w; OldUDec4(n); }
+static void nUDec4(uint32_t n, int w) { (void)w; NewUDec4(n); }
+static void oUDec5(uint32_t n, int w) { (void)w; OldUDec5(n); }
+static void nUDec5(uint32_t n, int w) { (void)w; NewUDec5(n); }
+static void oUFix1(uint32_t n, int w) { (void)w; OldUFix1(n); }
+static void nUFix1(uint32_t n, int w) { (void)w; NewUFix1(n); }
+static void oUFix2(uint32_t n, int w) { (void)w; OldUFix2(n); }
+static void nUFix2(uint32_t n, int w) { (void)w; NewUFix2(n); }
+static void oUHex(uint32_t n, int w)  { (void)w; OldUHex(n); }
+static void nUHex(uint32_t n, int w)  { (void)w; NewUHex(n); }
+static void oUHex2(uint32_t n, int w) { (void)w; OldUHex2(n); }
+static void nUHex2(uint32_t n, int w) { (void)w; NewUHex2(n); }
+static void oNUDec(uint32_t n, int w) { OldNokiaUDec(n, w); }
+static void nNUDec(uint32_t n, int w) { NewNokiaUDec(n, w); }
+static void oNSDec(uint32_t n, int w) { OldNokiaSDec(n, w); }
+static void nNSDec(uint32_t n, int w) { NewNokiaSDec(n, w); }
+static void oNHex(uint32_t n, int w)  { (void)w; OldNokiaU8Hex(n); }
+static void nNHex(uint32_t n, int w)  { (void)w; NewNokiaU8Hex(n); }
+
+// UART0_OutUHex2 prints two hex digits only for 0 to 255, the old code
+// printed non-hex characters above that and the new one the low byte.
+static test_t Tests[] = {
+    {.Name = "UART0_OutUDec",      .Old = oUDec,  .New = nUDec,  .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutSDec",      .Old = oSDec,  .New = nSDec,  .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutUDec4",     .Old = oUDec4, .New = nUDec4, .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutUDec5",     .Old = oUDec5, .New = nUDec5, .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutUFix1",     .Old = oUFix1, .New = nUFix1, .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutUFix2",     .Old = oUFix2, .New = nUFix2, .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutUHex",      .Old = oUHex,  .New = nUHex,  .Max = 0xFFFFFFFF, .Widths = 0},
+    {.Name = "UART0_OutUHex2",     .Old = oUHex2, .New = nUHex2, .Max = 0xFF,       .Widths = 0},
+    {.Name = "Nokia5110_OutUDec",  .Old = oNUDec, .New = nNUDec, .Max = 0xFFFFFFFF, .Widths = 1},
+    {.Name = "Nokia5110_OutSDec",  .Old = oNSDec, .New = nNSDec, .Max = 0xFFFFFFFF, .Widths = 1},
+    {.Name = "Nokia5110_OutU8Hex", .Old = oNHex,  .New = nNHex,  .Max = 0xFF,       .Widths = 0},
+};
+#define NUM_TESTS (sizeof(Tests) / sizeof(Tests[0]))
+
+static double Seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void Compare(test_t *t, uint32_t n) {
+    char old[64];
+    int oldN;
+    int widths = t->Widths ? 13 : 1;
+    if (n > t->Max) {
+        n &= t->Max;
+    }
+    for (int w = 0; w < widths; w++) {
+        OutN = 0;
+        t->Old(n, w);
+        memcpy(old, Out, OutN);
+        oldN = OutN;
+        OutN = 0;
+        t->New(n, w);
+        t->Calls++;
+        if ((OutN != oldN) || memcmp(old, Out, OutN)) {
+            if (t->Errors < 10) {
+                printf("%s(%u, %d): old \"%.*s\" new \"%.*s\"\n", t->Name, n, w, oldN, old, OutN, Out);
+            }
+            t->Errors++;
+        }
+    }
+}
+
+static volatile int Sink;
+
+// time one implementation over the same inputs
+static double Time(void (*f)(uint32_t, int), const uint32_t *values, uint32_t count, uint32_t max, int w) {
+    double start = Seconds();
+    for (uint32_t i = 0; i < count; i++) {
+        OutN = 0;
+        f(values[i] & max, w);
+        Sink += OutN;
+    }
+    return Seconds() - start;
+}
+
+static uint32_t Random(void) {
+    static uint64_t state = 0x9E3779B97F4A7C15ull;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state >> 32;
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n randomcount]\n", name);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t randomCount = 10000000;
+    uint64_t errors = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n': randomCount = strtoul(optarg, NULL, 0); break;
+        default: Usage(argv[0]);
+        }
+    }
+
+    // the reciprocal divide used by Format.c, for every input
+    for (uint64_t n = 0; n <= 0xFFFFFFFF; n++) {
+        if ((uint32_t)(((uint64_t)n * 1374389535u) >> 37) != n / 100) {
+            printf("div100(%llu) is wrong\n", (unsigned long long)n);
+            errors++;
+            break;
+        }
+    }
+
+    for (uint32_t t = 0; t < NUM_TESTS; t++) {
+        for (uint32_t n = 0; n <= (1 << 20); n++) {
+            Compare(&Tests[t], n);
+        }
+        for (uint64_t p = 1; p <= 0xFFFFFFFF; p *= 10) {
+            for (int d = -2; d <= 2; d++) {
+                Compare(&Tests[t], (uint32_t)(p + d));
+            }
+        }
+        for (uint64_t p = 1; p <= 0xFFFFFFFF; p *= 16) {
+            for (int d = -2; d <= 2; d++) {
+                Compare(&Tests[t], (uint32_t)(p + d));
+            }
+        }
+        Compare(&Tests[t], 0x7FFFFFFF);
+        Compare(&Tests[t], 0x80000000);
+        Compare(&Tests[t], 0xFFFFFFFF);
+        for (uint32_t i = 0; i < randomCount; i++) {
+            Compare(&Tests[t], Random());
+        }
+    }
+
+    uint32_t *values = malloc(sizeof(uint32_t) * randomCount);
+    if (values == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    for (uint32_t i = 0; i < randomCount; i++) {
+        values[i] = Random() >> (Random() & 31);    // all lengths equally likely
+    }
+
+    printf("%-20s %12s %8s %10s %10s %7s\n", "function", "calls", "errors", "old ns", "new ns", "speedup");
+    for (uint32_t t = 0; t < NUM_TESTS; t++) {
+        test_t *p = &Tests[t];
+        int w = p->Widths ? 6 : 0;
+        p->OldTime = Time(p->Old, values, randomCount, p->Max, w);
+        p->NewTime = Time(p->New, values, randomCount, p->Max, w);
+        printf("%-20s %12llu %8llu %10.1f %10.1f %6.2fx\n", p->Name,
+               (unsigned long long)p->Calls, (unsigned long long)p->Errors,
+               1e9 * p->OldTime / randomCount, 1e9 * p->NewTime / randomCount,
+               p->OldTime / p->NewTime);
+        errors += p->Errors;
+    }
+    free(values);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+// IRCalibrationCheck.c
+// Runs on Linux (host), not on the MSP432
+// Checks IRCal_Fit() in inc/IRCalibration.c on synthetic readings.
+// Each sensor is modelled by d = m/(n-c) + r with the default
+// coefficients in inc/IRDistance.c.  Closer than its peak the model
+// folds back: the reading falls again as the wall gets closer, the
+// way the GP2Y0A21YK0F does below about 70 mm from its face.
+//
+// 1. Exact readings at the Program15_5 distances (200 to 800 mm) must
+//    give back m, c and r, and distances within 1 mm.
+// 2. The same readings with uniform noise of +-a ADC codes, n times per
+//    sensor: every fit must succeed, and the fitted curve is compared
+//    with the model from 200 to 800 mm (max and rms error are printed,
+//    the run fails if the max is above -e).
+// 3. Readings IRCal_Fit must reject: a saturated reading, a reading in
+//    the fold-back region (the old 100 and 150 mm table), readings that
+//    rise with distance, too few readings, a single distance.  Shuffled
+//    readings must still fit.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I../../inc IRCalibrationCheck.c ../../inc/IRCalibration.c -lm -o IRCalibrationCheck
+//   ./IRCalibrationCheck
+// Options:
+//   -a <codes>  noise amplitude in ADC codes (default 20)
+//   -n <n>      noisy fits per sensor (default 10000)
+//   -e <mm>     largest distance error allowed with noise (default 15);
+//               at 800 mm one ADC code is about 0.5 mm
+//   -s <n>      random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include "IRDistance.h"
+#include "IRCalibration.h"
+
+// defaults from inc/IRDistance.c, left, center, right
+static const IRCoeff_t Model[IR_NUM_SENSORS] = {
+    {1945, 1117486, 413, 70},
+    {1883, 1166937, 284, 70},
+    {2084, 1104642, 570, 70}
+};
+static const char *Name[IR_NUM_SENSORS] = {"left", "center", "right"};
+
+#define PEAK_MM     140     // model reading is largest here, 70 mm from the sensor face
+
+// Program15_5 table
+static const int32_t CalDistances[] = {200, 250, 300, 350, 400, 500, 600, 700, 800};
+#define NUM_CAL_POINTS ((int)(sizeof(CalDistances)/sizeof(CalDistances[0])))
+
+static long Errors;
+
+static void fail(const char *sensor, const char *what){
+    printf("  %s: %s\n", sensor, what);
+    Errors++;
+}
+
+// model reading at d mm, folded back below PEAK_MM, clipped to 14 bits
+static double reading(const IRCoeff_t *s, double d){
+    if (d < PEAK_MM) {
+        d = 2*PEAK_MM - d;
+    }
+    double n = s->Offset + s->Slope/(d - s->DistOffset);
+    return (n > 16383) ? 16383 : n;
+}
+
+// distance from fitted coefficients at reading n
+static double distance(const IRCoeff_t *f, double n){
+    return f->Slope/(n - f->Offset) + f->DistOffset;
+}
+
+// largest |error| and rms error in mm of fit f against model s, 200 to 800 mm
+static double curveError(const IRCoeff_t *s, const IRCoeff_t *f, double *rms){
+    double max = 0, sum = 0;
+    int k = 0;
+    for (int d = 200; d <= 800; d++) {
+        double e = fabs(distance(f, reading(s, d)) - d);
+        if (e > max) {
+            max = e;
+        }
+        sum += e*e;
+        k++;
+    }
+    *rms = sqrt(sum/k);
+    return max;
+}
+
+static double noise(double a){
+    return a*(2.0*rand()/RAND_MAX - 1);
+}
+
+static void exact(void){
+    for (int s = 0; s < IR_NUM_SENSORS; s++) {
+        uint32_t adc[NUM_CAL_POINTS];
+        IRCoeff_t f;
+        double rms, max;
+
+        for (int i = 0; i < NUM_CAL_POINTS; i++) {
+            adc[i] = lround(reading(&Model[s], CalDistances[i]));
+        }
+        if (!IRCal_Fit(adc, CalDistances, NUM_CAL_POINTS, &f)) {
+            fail(Name[s], "exact readings rejected");
+            continue;
+        }
+        max = curveError(&Model[s], &f, &rms);
+        printf("%-6s exact: m=%d c=%d r=%d AdcMax=%d (model %d %d %d %d), max error %.2f mm\n",
+               Name[s], (int)f.Slope, (int)f.Offset, (int)f.DistOffset, (int)f.AdcMax,
+               (int)Model[s].Slope, (int)Model[s].Offset, (int)Model[s].DistOffset,
+               (int)Model[s].AdcMax, max);
+        if (max > 1.0) {
+            fail(Name[s], "exact readings fit worse than 1 mm");
+        }
+    }
+}
+
+static void noisy(double amplitude, long trials, double limit){
+    for (int s = 0; s < IR_NUM_SENSORS; s++) {
+        double worst = 0, sumRms = 0;
+        long failed = 0;
+
+        for (long t = 0; t < trials; t++) {
+            uint32_t adc[NUM_CAL_POINTS];
+            IRCoeff_t f;
+            double rms, max;
+
+            for (int i = 0; i < NUM_CAL_POINTS; i++) {
+                adc[i] = lround(reading(&Model[s], CalDistances[i]) + noise(amplitude));
+            }
+            if (!IRCal_Fit(adc, CalDistances, NUM_CAL_POINTS, &f)) {
+                failed++;
+                continue;
+            }
+            max = curveError(&Model[s], &f, &rms);
+            if (max > worst) {
+                worst = max;
+            }
+            sumRms += rms;
+        }
+        printf("%-6s +-%.0f codes: %ld fits, %ld rejected, max error %.2f mm, mean rms %.2f mm\n",
+               Name[s], amplitude, trials, failed, worst, sumRms/(trials - failed));
+        if (failed) {
+            fail(Name[s], "noisy readings rejected");
+        }
+        if (worst > limit) {
+            fail(Name[s], "noisy fit error above the limit");
+        }
+    }
+}
+
+// IRCal_Fit must return want on these readings
+static void expect(const char *what, const uint32_t adc[], const int32_t dist[], int count, int want){
+    IRCoeff_t f = {0, 0, 0, 0};
+    int got = IRCal_Fit(adc, dist, count, &f);
+    printf("  %-44s %s\n", what, (got == want) ? (want ? "fits" : "rejected") : "WRONG");
+    if (got != want) {
+        fail("rejection", what);
+    }
+}
+
+static void rejects(void){
+    const IRCoeff_t *s = &Model[IR_LEFT];
+    int32_t dist[IRCAL_MAX_POINTS];
+    uint32_t adc[IRCAL_MAX_POINTS];
+    int i;
+
+    printf("left readings that IRCal_Fit must reject:\n");
+
+    // old Program15_5 table, 100 mm folds back below the 150 mm reading
+    static const int32_t Old[] = {100, 150, 200, 250, 300, 400, 500, 600, 700, 800};
+    for (i = 0; i < 10; i++) {
+        adc[i] = lround(reading(s, Old[i]));
+    }
+    expect("100 to 800 mm, 100 mm in the fold-back", adc, Old, 10, 0);
+
+    // saturated at the closest distance
+    for (i = 0; i < NUM_CAL_POINTS; i++) {
+        dist[i] = CalDistances[i];
+        adc[i] = lround(reading(s, dist[i]));
+    }
+    adc[0] = 16383;
+    expect("200 mm reading saturated", adc, dist, NUM_CAL_POINTS, 0);
+
+    // readings that do not fall as the distance grows
+    adc[0] = lround(reading(s, dist[0]));
+    adc[4] = adc[3];
+    expect("350 and 400 mm give the same reading", adc, dist, NUM_CAL_POINTS, 0);
+    adc[4] = lround(reading(s, dist[4]));
+    for (i = 0; i < NUM_CAL_POINTS; i++) {
+        dist[i] = CalDistances[NUM_CAL_POINTS - 1 - i];   // readings listed for the wrong walls
+    }
+    expect("readings in reverse order of the distances", adc, dist, NUM_CAL_POINTS, 0);
+
+    for (i = 0; i < NUM_CAL_POINTS; i++) {
+        dist[i] = CalDistances[i];
+    }
+    expect("two readings", adc, dist, 2, 0);
+    for (i = 0; i < 4; i++) {
+        dist[i] = 400;
+        adc[i] = lround(reading(s, 400)) + i;
+    }
+    expect("every reading at 400 mm", adc, dist, 4, 0);
+
+    // shuffled but consistent readings still fit
+    for (i = 0; i < NUM_CAL_POINTS; i++) {
+        dist[i] = CalDistances[(i*4) % NUM_CAL_POINTS];
+        adc[i] = lround(reading(s, dist[i]));
+    }
+    expect("200 to 800 mm in shuffled order", adc, dist, NUM_CAL_POINTS, 1);
+}
+
+int main(int argc, char **argv){
+    double amplitude = 20, limit = 15;
+    long trials = 10000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "a:n:e:s:")) != -1) {
+        switch (opt) {
+        case 'a': amplitude = atof(optarg); break;
+        case 'n': trials = atol(optarg); break;
+        case 'e': limit = atof(optarg); break;
+        case 's': srand(atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-a codes] [-n fits] [-e mm] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    exact();
+    noisy(amplitude, trials, limit);
+    rejects();
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+// IRDistanceCheck.c
+// Runs on Linux (host), not on the MSP432
+// Checks the table conversion in inc/IRDistance.c against the formula
+// it replaced, d = m/(n-c) + r with an integer divide, and times both.
+// formula() below is the old converter body for any coefficients.
+//
+// 1. The compiled-in tables: LeftConvert, CenterConvert and RightConvert
+//    for every 14-bit code 0 to 16383, and codes above 16383.
+// 2. Tables built at run time by IRDistance_SetCoefficients, for the
+//    defaults and for random coefficients of the same shape (AdcMax
+//    1000 to 3000, AdcMax-c 1200 to 2000, r 0 to 100, m chosen so that
+//    AdcMax reads 800 mm), every code again.  The interpolation error
+//    at MAX_DIST is about 750000/(AdcMax-c)^2 mm, so a fit much more
+//    curved than these sensors (AdcMax-c near 500) can be off by 3 mm.
+// Every result must be within -e mm of the formula, and codes below
+// AdcMax must give MAX_DIST exactly.
+//
+// The times are for this PC and say little about the robot.  An x86
+// divides in a few cycles; the Cortex-M4 UDIV takes 2 to 12, which the
+// table replaces with one multiply.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I. -I../../inc IRDistanceCheck.c ../../inc/IRDistance.c -o IRDistanceCheck
+//   ./IRDistanceCheck
+// Options:
+//   -e <mm>  largest difference allowed (default 1)
+//   -n <n>   random coefficient sets (default 1000)
+//   -s <n>   random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "IRDistance.h"
+
+#define ADC_FULL_SCALE  16383
+
+// defaults from inc/IRDistance.c, left, center, right
+static const IRCoeff_t Default[IR_NUM_SENSORS] = {
+    {1945, 1117486, 413, 70},
+    {1883, 1166937, 284, 70},
+    {2084, 1104642, 570, 70}
+};
+static const char *Name[IR_NUM_SENSORS] = {"left", "center", "right"};
+static int32_t (*const Convert[IR_NUM_SENSORS])(uint32_t) = {LeftConvert, CenterConvert, RightConvert};
+
+// the converter before the table, for any coefficients
+static int32_t formula(const IRCoeff_t *c, uint32_t adc_value){
+    if (adc_value < c->AdcMax) {
+        return MAX_DIST;
+    }
+    else {
+        return (c->Slope/(adc_value - c->Offset)) + c->DistOffset;
+    }
+}
+
+// old LeftConvert, for the timing
+static int32_t oldLeftConvert(uint32_t adc_value){
+    if (adc_value < 1945) {
+        return MAX_DIST;
+    }
+    else {
+        return (1117486/(adc_value - 413)) + 70;
+    }
+}
+
+static long Errors;
+static int Limit = 1;
+
+// compares one converter with the formula for every code, returns the
+// largest difference and counts the codes that differ
+static int sweep(const char *what, int32_t (*convert)(uint32_t), const IRCoeff_t *c, long *differ){
+    int worst = 0;
+    for (uint32_t n = 0; n <= ADC_FULL_SCALE + 100; n++) {
+        int32_t want = formula(c, (n > ADC_FULL_SCALE) ? ADC_FULL_SCALE : n);
+        int32_t got = convert(n);
+        int e = abs(got - want);
+        if (e) {
+            (*differ)++;
+        }
+        if (e > worst) {
+            worst = e;
+        }
+        if ((e > Limit) || ((n < c->AdcMax) && e)) {
+            if (Errors < 20) {
+                printf("  %s: code %u gives %d mm, formula %d mm\n", what, n, (int)got, (int)want);
+            }
+            Errors++;
+        }
+    }
+    return worst;
+}
+
+static void compiled(void){
+    for (int s = 0; s < IR_NUM_SENSORS; s++) {
+        long differ = 0;
+        int worst = sweep(Name[s], Convert[s], &Default[s], &differ);
+        printf("%-6s compiled table: largest difference %d mm, %ld of %d codes differ\n",
+               Name[s], worst, differ, ADC_FULL_SCALE + 101);
+    }
+}
+
+static void runtime(long sets){
+    int worst = 0;
+    long differ = 0, rejected = 0;
+
+    for (int s = 0; s < IR_NUM_SENSORS; s++) {
+        if (!IRDistance_SetCoefficients((enum IRSensor)s, &Default[s])) {
+            printf("  %s: defaults rejected by IRDistance_SetCoefficients\n", Name[s]);
+            Errors++;
+            continue;
+        }
+        int e = sweep(Name[s], Convert[s], &Default[s], &differ);
+        if (e > worst) {
+            worst = e;
+        }
+    }
+    printf("defaults through IRDistance_SetCoefficients: largest difference %d mm\n", worst);
+
+    worst = 0;
+    differ = 0;
+    for (long i = 0; i < sets; i++) {
+        IRCoeff_t c;
+        enum IRSensor s = (enum IRSensor)(i % IR_NUM_SENSORS);
+        c.AdcMax = 1000 + rand() % 2001;
+        c.Offset = c.AdcMax - 1200 - rand() % 801;
+        c.DistOffset = rand() % 101;
+        c.Slope = (MAX_DIST - c.DistOffset) * (c.AdcMax - c.Offset);
+        if (!IRDistance_SetCoefficients(s, &c)) {
+            rejected++;
+            continue;
+        }
+        int e = sweep(Name[s], Convert[s], &c, &differ);
+        if (e > worst) {
+            worst = e;
+        }
+    }
+    printf("%ld random coefficient sets, %ld rejected: largest difference %d mm, %.1f codes per set differ\n",
+           sets, rejected, worst, (double)differ / (sets - rejected));
+    if (rejected) {
+        printf("  usable coefficients rejected by IRDistance_SetCoefficients\n");
+        Errors++;
+    }
+
+    for (int s = 0; s < IR_NUM_SENSORS; s++) {
+        IRDistance_SetCoefficients((enum IRSensor)s, &Default[s]);
+    }
+}
+
+static double seconds(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static volatile int32_t Sink;
+
+static double timeConvert(int32_t (*convert)(uint32_t), const uint16_t *codes, int count){
+    double start = seconds();
+    for (int r = 0; r < 100; r++) {
+        int32_t sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += convert(codes[i]);
+        }
+        Sink = sum;
+    }
+    return 1e9 * (seconds() - start) / (100.0 * count);
+}
+
+static void timing(void){
+    enum { COUNT = 1 << 16 };
+    static uint16_t codes[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        codes[i] = 1945 + rand() % (ADC_FULL_SCALE - 1945 + 1);
+    }
+    double told = timeConvert(oldLeftConvert, codes, COUNT);
+    double tnew = timeConvert(LeftConvert, codes, COUNT);
+    printf("LeftConvert on this PC: formula %.2f ns, table %.2f ns per conversion\n", told, tnew);
+}
+
+int main(int argc, char **argv){
+    long sets = 1000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:n:s:")) != -1) {
+        switch (opt) {
+        case 'e': Limit = atoi(optarg); break;
+        case 'n': sets = atol(optarg); break;
+        case 's': srand(atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-e mm] [-n sets] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    compiled();
+    runtime(sets);
+    timing();
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
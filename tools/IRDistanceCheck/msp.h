@@ -0,0 +1,11 @@
+// msp.h
+// Runs on Linux (host), not on the MSP432
+// Stand-in for the TI device header.  inc/IRDistance.c includes it but
+// uses no register, so IRDistanceCheck.c needs nothing from it.
+
+#ifndef MSP_H_HOST
+#define MSP_H_HOST
+
+#include <stdint.h>
+
+#endif
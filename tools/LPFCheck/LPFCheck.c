@@ -0,0 +1,314 @@
+// LPFCheck.c
+// Runs on Linux (host), not on the MSP432
+// Checks the LPF channels in inc/LPF.c on synthetic ADC data.
+//
+// 1. Streaming against batch: every depth from 1 to 16 and the depths
+//    around each power of two up to MAX_FILTER_SIZE, fed with uniform
+//    14-bit noise, full-scale 16-bit noise, a 0/65535 square wave (the
+//    largest variance), a slow ramp and a constant.  After every sample
+//    the output, LPF_VarianceFilter and LPF_NoiseFilter must equal a
+//    two-pass computation over a copy of the window: mean truncated,
+//    sum((x-mean)^2)/(size-1), and floor(sqrt()) of that exactly.
+// 2. Step response of FIR channels and of IIR1 and IIR2 channels for
+//    k = 1 to 8, from 2000 to 10000 and back: the output must never
+//    overshoot or move against the step, must settle on the new value
+//    exactly, and the centroid of the response (the measured DC group
+//    delay) must be within 0.5 samples or 2% of LPF_DelayFilter, which
+//    rounds (size-1)/2 down for an even FIR depth.  The samples to 50%
+//    and 90% of the step are printed to compare modes.
+// 3. Cycles per LPF_CalcFilter sample at depths 8, 64, 100 and 512 on
+//    14-bit noise, best of -r runs, with the queue bytes per channel.
+//    Build once with each LPF_COMPACT value to compare the two sample
+//    layouts.  The counts are for this PC (rdtsc, or ns where there is
+//    no rdtsc) and say little about the Cortex-M4, where the compact
+//    layout mainly saves RAM.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I. -I../../inc LPFCheck.c ../../inc/LPF.c -lm -o LPFCheck
+//   ./LPFCheck
+// Add -DLPF_COMPACT=0 to check and time the 32-bit sample layout instead.
+// Options:
+//   -n <n>   samples per depth and signal (default 20000)
+//   -r <n>   timing runs of 2^16 samples (default 20)
+//   -s <n>   random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "LPF.h"
+
+static long Errors;
+
+static void fail(const char *what, uint32_t size, long n, uint64_t got, uint64_t want){
+    if (Errors < 20) {
+        printf("  size %u sample %ld: %s %llu, expected %llu\n", size, n, what,
+               (unsigned long long)got, (unsigned long long)want);
+    }
+    Errors++;
+}
+
+//************** Streaming against batch **************
+
+enum Signal { UNIFORM14, UNIFORM16, SQUARE, RAMP, CONSTANT, NUM_SIGNALS };
+static const char *SignalName[NUM_SIGNALS] = {
+    "14-bit noise", "16-bit noise", "0/65535 square", "ramp", "constant"
+};
+
+static uint32_t sample(enum Signal s, long n){
+    switch (s) {
+    case UNIFORM14: return rand() & 0x3FFF;
+    case UNIFORM16: return rand() & 0xFFFF;
+    case SQUARE:    return (n & 1) ? 65535 : 0;
+    case RAMP:      return (n * 7) & 0xFFFF;
+    default:        return 8192;
+    }
+}
+
+// largest integer whose square is at most v
+static uint32_t floorSqrt(uint32_t v){
+    uint64_t r = (uint64_t)sqrt((double)v);
+    while (r*r > v) {
+        r--;
+    }
+    while ((r+1)*(r+1) <= v) {
+        r++;
+    }
+    return (uint32_t)r;
+}
+
+static void streaming(uint32_t size, enum Signal s, long samples){
+    static LPFSample_t queue[MAX_FILTER_SIZE];
+    uint32_t window[MAX_FILTER_SIZE];   // the last size samples, window[0] oldest
+    LPF_t filter;
+    uint32_t initial = sample(s, 0);
+
+    LPF_InitFilter(&filter, queue, initial, size);
+    for (uint32_t i = 0; i < size; i++) {
+        window[i] = initial;
+    }
+    for (long n = 1; n <= samples; n++) {
+        uint32_t x = sample(s, n);
+        uint32_t y = LPF_CalcFilter(&filter, x);
+
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i+1 < size; i++) {
+            window[i] = window[i+1];
+            sum += window[i];
+        }
+        window[size-1] = x;
+        sum += x;
+        uint64_t mean = sum/size;
+        uint64_t energy = 0;
+        for (uint32_t i = 0; i < size; i++) {
+            int64_t ac = (int64_t)window[i] - (int64_t)mean;
+            energy += ac*ac;
+        }
+        uint64_t variance = (size < 2) ? 0 : energy/(size-1);
+        if (variance > 0xFFFFFFFF) {
+            variance = 0xFFFFFFFF;
+        }
+
+        if (y != mean) {
+            fail("output", size, n, y, mean);
+        }
+        uint32_t v = LPF_VarianceFilter(&filter);
+        if (v != variance) {
+            fail("variance", size, n, v, variance);
+        }
+        uint32_t sd = LPF_NoiseFilter(&filter);
+        if (sd != floorSqrt(variance)) {
+            fail("noise", size, n, sd, floorSqrt(variance));
+        }
+    }
+}
+
+static void streamingAll(long samples){
+    uint32_t sizes[64];
+    int count = 0;
+    for (uint32_t size = 1; size <= 16; size++) {
+        sizes[count++] = size;
+    }
+    for (uint32_t p = 32; p <= MAX_FILTER_SIZE; p *= 2) {
+        sizes[count++] = p-1;
+        sizes[count++] = p;
+        if (p < MAX_FILTER_SIZE) {
+            sizes[count++] = p+1;
+        }
+    }
+
+    for (int s = 0; s < NUM_SIGNALS; s++) {
+        long errors = Errors;
+        for (int i = 0; i < count; i++) {
+            streaming(sizes[i], (enum Signal)s, samples);
+        }
+        printf("%-15s %d depths 1 to %d, %ld samples each: %s\n", SignalName[s], count,
+               MAX_FILTER_SIZE, samples, (Errors == errors) ? "output, variance and noise match" : "FAILED");
+    }
+}
+
+//************** Step response and group delay **************
+
+#define STEP_LOW    2000
+#define STEP_HIGH   10000
+#define STEP_LENGTH 100000      // samples to settle, 2^8 time constants of the slowest IIR2
+
+// one step from 'from' to 'to', returns the measured centroid delay and
+// sets the samples to 50% and 90% of the step
+static double step(LPF_t *filter, const char *name, uint32_t from, uint32_t to, int *n50, int *n90){
+    int32_t rise = (int32_t)to - (int32_t)from;
+    int32_t last = from;
+    double moment = 0;
+    *n50 = *n90 = -1;
+    for (int n = 0; n < STEP_LENGTH; n++) {
+        int32_t y = LPF_CalcFilter(filter, to);
+        int32_t dy = y - last;
+        if ((rise > 0) ? ((dy < 0) || (y > (int32_t)to)) : ((dy > 0) || (y < (int32_t)to))) {
+            if (Errors < 20) {
+                printf("  %s: sample %d moves from %d to %d, against the step or past it\n",
+                       name, n, (int)last, (int)y);
+            }
+            Errors++;
+        }
+        moment += (double)n*dy;
+        if ((*n50 < 0) && (2*(y - (int32_t)from)*(rise > 0 ? 1 : -1) >= abs(rise))) {
+            *n50 = n;
+        }
+        if ((*n90 < 0) && (10*(y - (int32_t)from)*(rise > 0 ? 1 : -1) >= 9*abs(rise))) {
+            *n90 = n;
+        }
+        last = y;
+    }
+    if (last != (int32_t)to) {
+        printf("  %s: settles at %d, not %u\n", name, (int)last, to);
+        Errors++;
+    }
+    return moment/rise;
+}
+
+static void stepMode(LPF_t *filter, const char *name){
+    int up50, up90, down50, down90;
+    double up = step(filter, name, STEP_LOW, STEP_HIGH, &up50, &up90);
+    double down = step(filter, name, STEP_HIGH, STEP_LOW, &down50, &down90);
+    double want = LPF_DelayFilter(filter);
+    double allowed = (want*0.02 > 0.5) ? want*0.02 : 0.5;
+    int ok = (fabs(up - want) <= allowed) && (fabs(down - want) <= allowed);
+    printf("  %-9s %5.0f %8.1f %8.1f %6d %6d  %s\n", name, want, up, down, up50, up90, ok ? "ok" : "FAILED");
+    if (!ok) {
+        Errors++;
+    }
+}
+
+static void stepAll(void){
+    static LPFSample_t queue[MAX_FILTER_SIZE];
+    static const uint32_t Sizes[] = {8, 64, 100, 256};
+    LPF_t filter;
+    char name[16];
+
+    printf("step %d to %d and back, delays in samples:\n", STEP_LOW, STEP_HIGH);
+    printf("  %-9s %5s %8s %8s %6s %6s\n", "mode", "delay", "up", "down", "50%", "90%");
+    for (unsigned i = 0; i < sizeof(Sizes)/sizeof(Sizes[0]); i++) {
+        sprintf(name, "FIR %u", Sizes[i]);
+        LPF_InitFilter(&filter, queue, STEP_LOW, Sizes[i]);
+        stepMode(&filter, name);
+    }
+    for (uint32_t order = 1; order <= 2; order++) {
+        for (uint32_t k = 1; k <= 8; k++) {
+            sprintf(name, "IIR%u k=%u", order, k);
+            LPF_InitIIRFilter(&filter, STEP_LOW, order, k);
+            stepMode(&filter, name);
+        }
+    }
+}
+
+//************** Cycles per sample **************
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TIME_UNIT "cycles"
+static uint64_t ticks(void){
+    return __rdtsc();
+}
+#else
+#define TIME_UNIT "ns"
+static uint64_t ticks(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+}
+#endif
+
+static volatile uint32_t Sink;
+
+static void timing(int runs){
+    static const uint32_t Sizes[] = {8, 64, 100, MAX_FILTER_SIZE};
+    enum { COUNT = 1 << 16 };
+    static uint16_t data[COUNT];
+    static LPFSample_t queue[MAX_FILTER_SIZE];
+    LPF_t filter;
+
+    for (int i = 0; i < COUNT; i++) {
+        data[i] = rand() & 0x3FFF;
+    }
+    printf("LPF_CalcFilter, %s sample layout, best of %d runs:\n",
+           LPF_COMPACT ? "16-bit mask-wrapped" : "32-bit compare-wrapped", runs);
+    for (unsigned k = 0; k < sizeof(Sizes)/sizeof(Sizes[0]); k++) {
+        uint32_t size = Sizes[k];
+        uint32_t capacity = size;
+#if LPF_COMPACT
+        capacity = 1;
+        while (capacity < size) {
+            capacity = capacity<<1;
+        }
+#endif
+        uint64_t best = UINT64_MAX;
+        LPF_InitFilter(&filter, queue, 8192, size);
+        for (int r = 0; r < runs; r++) {
+            uint32_t sum = 0;
+            uint64_t start = ticks();
+            for (int i = 0; i < COUNT; i++) {
+                sum += LPF_CalcFilter(&filter, data[i]);
+            }
+            uint64_t t = ticks() - start;
+            Sink = sum;
+            if (t < best) {
+                best = t;
+            }
+        }
+        printf("  depth %3u: %5.1f %s per sample, queue %4u bytes\n", size,
+               (double)best/COUNT, TIME_UNIT, (unsigned)(capacity*sizeof(LPFSample_t)));
+    }
+}
+
+int main(int argc, char **argv){
+    long samples = 20000;
+    int runs = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:s:")) != -1) {
+        switch (opt) {
+        case 'n': samples = atol(optarg); break;
+        case 'r': runs = atoi(optarg); break;
+        case 's': srand(atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-n samples] [-r runs] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("LPF_COMPACT %d\n", LPF_COMPACT);
+    streamingAll(samples);
+    stepAll();
+    timing(runs);
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
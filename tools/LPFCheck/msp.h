@@ -0,0 +1,11 @@
+// msp.h
+// Runs on Linux (host), not on the MSP432
+// Stand-in for the TI device header.  inc/LPF.c includes it but uses
+// no register, so the LPF tools need nothing from it.
+
+#ifndef MSP_H_HOST
+#define MSP_H_HOST
+
+#include <stdint.h>
+
+#endif
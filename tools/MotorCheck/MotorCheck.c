@@ -0,0 +1,389 @@
+// MotorCheck.c
+// Runs on Linux (host), not on the MSP432
+// Runs inc/Motor.c and inc/PWM.c against a model of TimerA0 in up mode
+// and checks how Motor_SetVelocity updates reach the motor pins.  The
+// model counts TA0R one step at a time, sets TA0CCR0 CCIFG, runs the
+// reset/set and OUTMOD 0 output units for TA0CCR3 (right) and TA0CCR4
+// (left), and calls TA0_0_IRQHandler some counts after the flag, like
+// a late interrupt would.
+//
+// Each run picks a PWM frequency, then calls Motor_SetVelocity and now
+// and then Motor_Brake at random counts, and checks that
+//   - every update is written by the first TA0CCR0 interrupt after it,
+//   - a PH pin never changes while that wheel's output is high,
+//   - in the period of an update no pulse is longer than the old or the
+//     new one, and a wheel that changed direction gets no new pulse,
+//   - every other period has exactly the commanded pulse, the duty
+//     cycle rounded to the nearest count and at most CCR0-1 counts.
+// 20 kHz with 999 permil, the case where the compare value is right
+// next to CCR0, is run first at every latency.  Before that, the PWM
+// frequency set by Motor_Init and Motor_SetPWMFrequency is checked:
+// at least 1000 steps (0.1% duty resolution) up to 12 kHz, and 600
+// steps (0.17%) at 20 kHz, the most a 12 MHz SMCLK gives in up mode.
+//
+// The drivers are compiled as C++ so msp.h in this directory can catch
+// each register write; nothing in them changes.
+//
+// Build and run from this directory:
+//   g++ -O2 -Wall -I. -I../../inc MotorCheck.c ../../inc/Motor.c ../../inc/PWM.c -o MotorCheck
+//   ./MotorCheck
+// Options:
+//   -p <n>      PWM periods per frequency (default 2000)
+//   -l <n>      latest interrupt, in TA0 counts after the flag (default 8)
+//   -s <n>      random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "msp.h"
+#include "CortexM.h"
+#include "PWM.h"
+#include "Motor.h"
+
+void TA0_0_IRQHandler(void);
+
+Timer_A_Type HostTimerA0;
+DIO_PORT_Type HostP2, HostP3, HostP5;
+NVIC_Type HostNVIC;
+
+void DisableInterrupts(void){}
+void EnableInterrupts(void){}
+long StartCritical(void){ return 0; }
+void EndCritical(long sr){ (void)sr; }
+void WaitForInterrupt(void){}
+
+// wheel 0 is right (TA0CCR3, P5.5), wheel 1 is left (TA0CCR4, P5.4)
+static const int Ccr[2] = {3, 4};
+static const uint8_t Ph[2] = {0x20, 0x10};
+
+static int Level[2];            // output pin of each wheel
+static uint8_t LastPh;          // P5 PH bits at the last write
+static long Errors;
+
+static void fail(const char *what, int wheel){
+    if (Errors < 20) {
+        printf("  %s wheel at TA0R=%u: %s\n", wheel ? "left" : "right",
+               (unsigned)HostTimerA0.R, what);
+    }
+    Errors++;
+}
+
+// Register write hook from msp.h, applies writes that act at once.
+void Hw_Write(const void *reg){
+    int w;
+
+    if (reg == &HostTimerA0.CTL) {
+        if (HostTimerA0.CTL & 0x0004) {     // TACLR clears TA0R and itself
+            HostTimerA0.R.Value = 0;
+            HostTimerA0.CTL.Value &= ~0x0004;
+        }
+    }
+    for (w = 0; w < 2; w++) {
+        if ((reg == &HostTimerA0.CCTL[Ccr[w]]) && ((HostTimerA0.CCTL[Ccr[w]] & 0x00E0) == 0)) {
+            Level[w] = (HostTimerA0.CCTL[Ccr[w]] >> 2) & 1;     // OUTMOD 0 drives OUT
+        }
+    }
+    if (reg == &HostP5.OUT) {
+        uint8_t ph = HostP5.OUT & 0x30;
+        for (w = 0; w < 2; w++) {
+            if (((ph ^ LastPh) & Ph[w]) && Level[w]) {
+                fail("PH changed while the output was high", w);
+            }
+        }
+        LastPh = ph;
+    }
+}
+
+// What a wheel is expected to do in one PWM period
+typedef struct {
+    int Exact;          // 1: High must equal Compare, 0: at most Compare
+    int Compare;        // TA0 counts
+    uint8_t Dir;        // PH bit value while high
+} Expect_t;
+
+static Expect_t Now[2];         // this period
+static Expect_t Next[2];        // following periods
+static int High[2];             // counts high so far in this period
+static int Latency, MaxLatency;
+static int Wait = -1;           // counts until the interrupt runs, -1 none pending
+static long Updates, Interrupts;
+static int Pending;             // 1 between Motor_SetVelocity and its interrupt
+static int PendingCompare[2];
+static uint8_t PendingDir;
+
+static int period(void){
+    return HostTimerA0.CCR[0] + 1;
+}
+
+// independent of PWM_Compare34: nearest count, at most CCR0-1
+static int compareOf(int permil){
+    int n = period();
+    int c = (permil * n + 500) / 1000;
+    return (c > n - 2) ? n - 2 : c;
+}
+
+static void endPeriod(void){
+    int w;
+    for (w = 0; w < 2; w++) {
+        if (Now[w].Exact ? (High[w] != Now[w].Compare) : (High[w] > Now[w].Compare)) {
+            char msg[80];
+            sprintf(msg, "pulse of %d counts, expected %s%d", High[w],
+                    Now[w].Exact ? "" : "at most ", Now[w].Compare);
+            fail(msg, w);
+        }
+        Now[w] = Next[w];
+        High[w] = 0;
+    }
+}
+
+static void interrupt(void){
+    int w;
+    uint16_t count = HostTimerA0.R;
+    int before = (count == HostTimerA0.CCR[0]);     // last count of the old period
+
+    Interrupts++;
+    TA0_0_IRQHandler();
+    if (HostTimerA0.CCTL[0] & 0x0010) {
+        fail("update not applied by the first interrupt", 0);
+    }
+    if (!Pending) {
+        return;
+    }
+    Pending = 0;
+    if ((HostP5.OUT & 0x30) != PendingDir) {
+        fail("PH pins differ from Motor_SetVelocity", 0);
+    }
+    for (w = 0; w < 2; w++) {
+        if (HostTimerA0.CCR[Ccr[w]] != PendingCompare[w]) {
+            fail("compare differs from Motor_SetVelocity", w);
+        }
+        Next[w].Exact = 1;
+        Next[w].Compare = PendingCompare[w];
+        Next[w].Dir = PendingDir & Ph[w];
+        if (before) {
+            continue;       // the whole next period is new
+        }
+        // this period: never longer than old or new, none after a reversal
+        int bound = (Now[w].Compare > PendingCompare[w]) ? Now[w].Compare : PendingCompare[w];
+        if (Now[w].Dir != Next[w].Dir) {
+            bound = (High[w] < Now[w].Compare) ? High[w] : Now[w].Compare;
+        }
+        Now[w].Exact = 0;
+        Now[w].Compare = bound;
+        Now[w].Dir = Next[w].Dir;
+    }
+}
+
+// one TA0 count
+static void tick(void){
+    int w;
+    uint16_t r = (HostTimerA0.R == HostTimerA0.CCR[0]) ? 0 : HostTimerA0.R + 1;
+
+    HostTimerA0.R.Value = r;
+    if (r == 0) {
+        endPeriod();
+    }
+    if (r == HostTimerA0.CCR[0]) {
+        HostTimerA0.CCTL[0].Value |= 0x0001;
+    }
+    for (w = 0; w < 2; w++) {
+        if ((HostTimerA0.CCTL[Ccr[w]] & 0x00E0) == 0x00E0) {    // reset/set
+            if (r == 0) {
+                Level[w] = 1;
+            }
+            if (r == HostTimerA0.CCR[Ccr[w]]) {
+                Level[w] = 0;
+            }
+        }
+        if (Level[w]) {
+            High[w]++;
+            if ((HostP5.OUT & Ph[w]) != Now[w].Dir) {
+                fail("output high in the wrong direction", w);
+            }
+        }
+    }
+    if ((HostTimerA0.CCTL[0] & 0x0011) == 0x0011) {
+        if (Wait < 0) {
+            Wait = Latency;
+        }
+        if (Wait == 0) {
+            Wait = -1;
+            interrupt();
+        } else {
+            Wait--;
+        }
+    } else {
+        Wait = -1;
+    }
+}
+
+static void setVelocity(int left, int right){
+    int v[2] = {right, left};
+    int w;
+
+    Motor_SetVelocity(left, right);
+    Updates++;
+    Pending = 1;
+    PendingDir = 0;
+    for (w = 0; w < 2; w++) {
+        int permil = abs(v[w]) > 999 ? 999 : abs(v[w]);
+        PendingCompare[w] = compareOf(permil);
+        if (v[w] < 0) {
+            PendingDir |= Ph[w];
+        }
+    }
+}
+
+static void brake(void){
+    int w;
+
+    Motor_Brake();
+    Pending = 0;
+    for (w = 0; w < 2; w++) {
+        // cut short at once, nothing from the next wrap on
+        Now[w].Exact = 0;
+        Now[w].Compare = High[w];
+        Next[w].Exact = 1;
+        Next[w].Compare = 0;
+    }
+}
+
+static void start(uint32_t frequency){
+    int w;
+
+    // power-on state, before Motor_Init
+    HostP5.OUT.Value = 0;
+    LastPh = 0;
+    for (w = 0; w < 2; w++) {
+        Level[w] = 0;
+        High[w] = 0;
+        Now[w].Exact = Next[w].Exact = 1;
+        Now[w].Compare = Next[w].Compare = 0;
+        Now[w].Dir = Next[w].Dir = 0;
+    }
+    Motor_Init();
+    Motor_SetPWMFrequency(frequency);
+    HostTimerA0.CCTL[0].Value &= ~0x0001;
+    Wait = -1;
+    Pending = 0;
+    Interrupts = 0;
+}
+
+static int randomPermil(void){
+    switch (rand() % 8) {
+    case 0: return 0;
+    case 1: return 999;
+    case 2: return -999;
+    case 3: return 1 + rand() % 20;
+    default: return rand() % 1999 - 999;
+    }
+}
+
+// TA0 frequency from the registers, PWM_SMCLK_HZ / (ID * EX0 * (CCR0+1))
+static double frequencyOf(void){
+    int divider = (1 << ((HostTimerA0.CTL >> 6) & 3)) * (HostTimerA0.EX0 + 1);
+    return (double)PWM_SMCLK_HZ / divider / period();
+}
+
+static void resolution(void){
+    long errors = Errors;
+    uint32_t f;
+    char msg[80];
+
+    start(50);
+    Motor_Init();       // PWM_Init34(15000), 20 ms
+    if (frequencyOf() != 50.0) {
+        sprintf(msg, "Motor_Init runs at %.3f Hz, not 50 Hz", frequencyOf());
+        fail(msg, 0);
+    }
+    for (f = 1000; f <= 20000; f += 500) {
+        start(f);
+        int steps = (f <= 12000) ? 1000 : PWM_SMCLK_HZ / f;
+        if ((period() < steps) || (frequencyOf() < f * 0.999) || (frequencyOf() > f * 1.001)) {
+            sprintf(msg, "%u Hz: %d steps at %.1f Hz", (unsigned)f, period(), frequencyOf());
+            fail(msg, 0);
+        }
+    }
+    start(12000);
+    printf("12000 Hz: %d steps, ", period());
+    start(20000);
+    printf("20000 Hz: %d steps, %s\n", period(), (Errors == errors) ? "ok" : "FAILED");
+}
+
+// 20 kHz, 0 to 999 permil and then to -999 permil on one wheel, every latency
+static void nearTop(void){
+    int latency;
+    long errors = Errors;
+
+    for (latency = 0; latency <= MaxLatency; latency++) {
+        Latency = latency;
+        start(20000);
+        setVelocity(999, 999);
+        for (int i = 0; i < 3 * period(); i++) {
+            tick();
+        }
+        setVelocity(999, -999);
+        for (int i = 0; i < 3 * period(); i++) {
+            tick();
+        }
+        if (Pending || (Interrupts != 2)) {
+            fail("update at 999 permil not applied", 0);
+        }
+    }
+    printf("20000 Hz, 999 permil: compare %d of %d counts, latency 0-%d, %s\n",
+           compareOf(999), period(), MaxLatency, (Errors == errors) ? "ok" : "FAILED");
+}
+
+int main(int argc, char **argv){
+    static const uint32_t Frequencies[] = {50, 1000, 5000, 20000, 25000};
+    long periods = 2000;
+    int opt;
+    unsigned seed = 1;
+
+    MaxLatency = 8;
+    while ((opt = getopt(argc, argv, "p:l:s:")) != -1) {
+        switch (opt) {
+        case 'p': periods = atol(optarg); break;
+        case 'l': MaxLatency = atoi(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-p periods] [-l latency] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+    srand(seed);
+
+    resolution();
+    nearTop();
+    for (unsigned f = 0; f < sizeof(Frequencies) / sizeof(Frequencies[0]); f++) {
+        long errors = Errors;
+        long n, ticks;
+
+        Latency = 0;
+        start(Frequencies[f]);
+        Updates = 0;
+        ticks = periods * period();
+        for (n = 0; n < ticks; n++) {
+            Latency = rand() % (MaxLatency + 1);
+            // about two calls per period, some of them in the same period
+            if (rand() % period() < 2) {
+                if (rand() % 50) {
+                    setVelocity(randomPermil(), randomPermil());
+                } else {
+                    brake();
+                }
+            }
+            tick();
+        }
+        printf("%5u Hz: %5d steps, %6ld updates, %6ld interrupts, %s\n",
+               (unsigned)Frequencies[f], period(), Updates, Interrupts,
+               (Errors == errors) ? "ok" : "FAILED");
+    }
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    return 0;
+}
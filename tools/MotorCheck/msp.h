@@ -0,0 +1,57 @@
+// msp.h
+// Runs on Linux (host), not on the MSP432
+// Stand-in for the TI device header with only the registers that
+// inc/Motor.c and inc/PWM.c use.  The drivers are compiled as C++ so
+// that every register write can call Hw_Write, which lets MotorCheck.c
+// run the Timer_A output units at the moment of each write.
+
+#ifndef MSP_H_HOST
+#define MSP_H_HOST
+
+#include <stdint.h>
+
+void Hw_Write(const void *reg);
+
+template <typename T> class Reg {
+public:
+    operator T() const { return Value; }
+    Reg &operator=(uint32_t x) { Value = (T)x; Hw_Write(this); return *this; }
+    Reg &operator&=(uint32_t x) { return *this = Value & x; }
+    Reg &operator|=(uint32_t x) { return *this = Value | x; }
+    Reg &operator^=(uint32_t x) { return *this = Value ^ x; }
+    T Value;
+};
+
+typedef struct {
+    Reg<uint16_t> CTL;
+    Reg<uint16_t> CCTL[7];
+    Reg<uint16_t> R;
+    Reg<uint16_t> CCR[7];
+    Reg<uint16_t> EX0;
+    Reg<uint16_t> IV;
+} Timer_A_Type;
+
+typedef struct {
+    Reg<uint8_t> IN;
+    Reg<uint8_t> OUT;
+    Reg<uint8_t> DIR;
+    Reg<uint8_t> SEL0;
+    Reg<uint8_t> SEL1;
+} DIO_PORT_Type;
+
+typedef struct {
+    uint32_t ISER[16];
+    uint8_t IP[240];
+} NVIC_Type;
+
+extern Timer_A_Type HostTimerA0;
+extern DIO_PORT_Type HostP2, HostP3, HostP5;
+extern NVIC_Type HostNVIC;
+
+#define TIMER_A0 (&HostTimerA0)
+#define P2       (&HostP2)
+#define P3       (&HostP3)
+#define P5       (&HostP5)
+#define NVIC     (&HostNVIC)
+
+#endif
@@ -0,0 +1,281 @@
+// MotorRampCheck.c
+// Runs on Linux (host), not on the MSP432
+// Checks inc/MotorRamp.c against stub motors.  Motor_SetVelocity,
+// Motor_Brake, StartCritical and EndCritical are replaced below, and
+// the check calls SysTick_Handler itself, once per simulated ms.
+//
+// 1. MotorRamp_Step over a grid of actual, target and maxStep values,
+//    including the int16_t limits: the result moves toward the target
+//    by exactly min(|target-actual|, maxStep), and maxStep 0 jumps.
+// 2. MotorRamp_Init sets SysTick to 1 kHz at 48 MHz, priority 2.
+// 3. Ramps through SysTick_Handler: 0 to 380 and 380 to -150 at
+//    2 permil/ms take 190 and 265 ms, no motor command changes by more
+//    than the rate (so a reversal slows through 0), the motors are
+//    only called while a ramp is in progress, and always inside a
+//    critical section.  Rate 0 jumps in one tick.
+// 4. MotorRamp_Brake, both from the foreground and as a bump interrupt
+//    that arrives while SysTick_Handler is running (it is held off to
+//    the end of the critical section, as the NVIC would): the wheels
+//    brake, no later tick undoes it, and the next target ramps from 0.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I. -I../../inc MotorRampCheck.c ../../inc/MotorRamp.c -o MotorRampCheck
+//   ./MotorRampCheck
+// Options:
+//   -r <permil/ms>  ramp rate of the ramp checks (default 2)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "msp.h"
+#include "CortexM.h"
+#include "Motor.h"
+#include "MotorRamp.h"
+
+void SysTick_Handler(void);    // inc/MotorRamp.c, the vector table calls it on the robot
+
+SysTick_Type HostSysTick;
+SCB_Type HostSCB;
+
+static long Errors;
+
+static void fail(const char *what){
+    if (Errors < 20) {
+        printf("  %s\n", what);
+    }
+    Errors++;
+}
+
+//************** Stub motors and interrupt mask **************
+
+static int Masked;              // PRIMASK, 1 inside a critical section
+static int BumpPending;         // a bump interrupt waits for the mask to clear
+static int BumpAt = -1;         // Motor_SetVelocity call that raises the bump, -1 never
+static long Calls;              // Motor_SetVelocity calls
+static int16_t MotorLeft, MotorRight;   // last duty cycles sent
+static int Braked;              // 1 after Motor_Brake, until the next Motor_SetVelocity
+static int Unmasked;            // motor calls made outside a critical section
+static int Bumps;               // bump interrupts taken
+
+static void bump(void){
+    Bumps++;
+    MotorRamp_Brake();
+}
+
+long StartCritical(void){
+    long sr = Masked;
+    Masked = 1;
+    return sr;
+}
+
+void EndCritical(long sr){
+    Masked = sr;
+    if (!Masked && BumpPending) {
+        BumpPending = 0;
+        bump();                 // the NVIC takes the held-off interrupt now
+    }
+}
+
+void Motor_SetVelocity(int16_t left_permil, int16_t right_permil){
+    if (!Masked) {
+        Unmasked++;
+    }
+    if (Calls++ == BumpAt) {
+        BumpPending = 1;
+    }
+    MotorLeft = left_permil;
+    MotorRight = right_permil;
+    Braked = 0;
+}
+
+void Motor_Brake(void){
+    if (!Masked) {
+        Unmasked++;
+    }
+    MotorLeft = MotorRight = 0;
+    Braked = 1;
+}
+
+//************** MotorRamp_Step **************
+
+static void step(void){
+    static const int32_t Values[] = {-32768, -32767, -999, -500, -380, -150, -3, -2, -1, 0,
+                                     1, 2, 3, 150, 375, 380, 500, 999, 32766, 32767};
+    static const uint32_t Steps[] = {0, 1, 2, 3, 10, 100, 999, 1998, 32767, 65535};
+    enum { NV = sizeof(Values)/sizeof(Values[0]), NS = sizeof(Steps)/sizeof(Steps[0]) };
+    long errors = Errors;
+
+    for (int a = 0; a < NV; a++) {
+        for (int t = 0; t < NV; t++) {
+            for (int s = 0; s < NS; s++) {
+                int32_t actual = Values[a], target = Values[t];
+                int32_t diff = target - actual;
+                int32_t want;
+                if ((Steps[s] == 0) || (labs(diff) <= (long)Steps[s])) {
+                    want = target;
+                } else {
+                    want = (diff > 0) ? actual + (int32_t)Steps[s] : actual - (int32_t)Steps[s];
+                }
+                int16_t got = MotorRamp_Step(actual, target, Steps[s]);
+                if (got != want) {
+                    char msg[100];
+                    sprintf(msg, "MotorRamp_Step(%d, %d, %u) = %d, expected %d",
+                            (int)actual, (int)target, Steps[s], got, (int)want);
+                    fail(msg);
+                }
+            }
+        }
+    }
+    printf("MotorRamp_Step, %d x %d x %d grid: %s\n", NV, NV, NS, (Errors == errors) ? "ok" : "FAILED");
+}
+
+//************** SysTick task **************
+
+// runs the task until both targets are reached, returns the ms taken
+// and checks every motor command on the way
+static int ramp(int16_t left, int16_t right, uint16_t rate, int16_t *reachedLeft, int16_t *reachedRight){
+    int16_t prevLeft, prevRight;
+    int ms = 0;
+
+    MotorRamp_Get(&prevLeft, &prevRight);
+    MotorRamp_SetTarget(left, right);
+    for (;;) {
+        long calls = Calls;
+        SysTick_Handler();
+        ms++;
+        if (Calls == calls) {
+            break;              // settled, the task left the motors alone
+        }
+        if (rate && ((abs(MotorLeft - prevLeft) > rate) || (abs(MotorRight - prevRight) > rate))) {
+            fail("a motor command changed by more than the rate");
+        }
+        prevLeft = MotorLeft;
+        prevRight = MotorRight;
+        if (ms > 100000) {
+            fail("ramp never settles");
+            break;
+        }
+    }
+    *reachedLeft = prevLeft;
+    *reachedRight = prevRight;
+    for (int i = 0; i < 10; i++) {
+        long calls = Calls;
+        SysTick_Handler();
+        if (Calls != calls) {
+            fail("motor called after the ramp settled");
+            break;
+        }
+    }
+    return ms - 1;              // the last tick only found nothing to do
+}
+
+static void expectRamp(const char *what, int16_t left, int16_t right, uint16_t rate, int wantMs){
+    int16_t l, r, gl, gr;
+    int ms = ramp(left, right, rate, &l, &r);
+    MotorRamp_Get(&gl, &gr);
+    int ok = (l == left) && (r == right) && (gl == left) && (gr == right) &&
+             ((wantMs < 0) || (ms == wantMs));
+    printf("  %-36s %4d ms  %s\n", what, ms, ok ? "ok" : "FAILED");
+    if (!ok) {
+        fail(what);
+    }
+}
+
+static void task(uint16_t rate){
+    char what[60];
+    int16_t l, r;
+
+    HostSysTick.LOAD = HostSysTick.CTRL = 0;
+    HostSCB.SHP[11] = 0;
+    MotorRamp_Init(rate);
+    if ((HostSysTick.LOAD != 47999) || (HostSysTick.CTRL != 7) || (HostSCB.SHP[11] != (2 << 5))) {
+        fail("MotorRamp_Init does not start SysTick at 1 kHz, priority 2");
+    }
+    printf("MotorRamp_Init: SysTick LOAD %u CTRL %u priority %u\n",
+           (unsigned)HostSysTick.LOAD, (unsigned)HostSysTick.CTRL, HostSCB.SHP[11] >> 5);
+
+    printf("ramps at %u permil/ms:\n", rate);
+    sprintf(what, "0/0 to 380/375");
+    expectRamp(what, 380, 375, rate, (380 + rate - 1) / rate);
+    sprintf(what, "380/375 to -150/-150, through 0");
+    expectRamp(what, -150, -150, rate, (530 + rate - 1) / rate);
+    sprintf(what, "-150/-150 to -150/999, one wheel");
+    expectRamp(what, -150, 999, rate, (1149 + rate - 1) / rate);
+
+    MotorRamp_SetRate(0);
+    expectRamp("rate 0: -150/999 to 999/-999", 999, -999, 0, 1);
+    MotorRamp_SetRate(rate);
+
+    // brake from the foreground in the middle of a ramp
+    MotorRamp_SetTarget(-500, 500);
+    for (int i = 0; i < 50; i++) {
+        SysTick_Handler();
+    }
+    MotorRamp_Brake();
+    MotorRamp_Get(&l, &r);
+    if (!Braked || l || r) {
+        fail("MotorRamp_Brake did not brake at once");
+    }
+    for (int i = 0; i < 10; i++) {
+        SysTick_Handler();
+    }
+    if (!Braked) {
+        fail("a tick after MotorRamp_Brake drove the motors again");
+    }
+    printf("  %-36s %s\n", "brake from the foreground", Braked ? "ok" : "FAILED");
+    expectRamp("then 0/0 to 200/200", 200, 200, rate, (200 + rate - 1) / rate);
+
+    // bump interrupt raised while SysTick_Handler is in its critical section
+    MotorRamp_SetTarget(600, 600);
+    BumpAt = Calls + (600/rate)/2;  // halfway up the ramp
+    for (int i = 0; (i < 1000) && !Bumps; i++) {
+        SysTick_Handler();
+    }
+    for (int i = 0; i < 10; i++) {
+        SysTick_Handler();
+    }
+    BumpAt = -1;
+    MotorRamp_Get(&l, &r);
+    int ok = (Bumps == 1) && Braked && !l && !r && !BumpPending;
+    printf("  %-36s %s\n", "bump during SysTick_Handler", ok ? "ok" : "FAILED");
+    if (!ok) {
+        fail("a bump during SysTick_Handler was undone by the ramp");
+    }
+    expectRamp("then 0/0 to -100/100", -100, 100, rate, (100 + rate - 1) / rate);
+
+    if (Unmasked) {
+        fail("motors called outside a critical section");
+    }
+    if (Masked) {
+        fail("critical section left open");
+    }
+}
+
+int main(int argc, char **argv){
+    uint16_t rate = 2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        switch (opt) {
+        case 'r': rate = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-r permil/ms]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rate == 0) {
+        fprintf(stderr, "rate must be at least 1 permil/ms\n");
+        return 2;
+    }
+
+    step();
+    task(rate);
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
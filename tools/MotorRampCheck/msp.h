@@ -0,0 +1,28 @@
+// msp.h
+// Runs on Linux (host), not on the MSP432
+// Stand-in for the TI device header with only the registers that
+// inc/MotorRamp.c uses, SysTick and the SysTick priority in SCB.
+
+#ifndef MSP_H_HOST
+#define MSP_H_HOST
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+    volatile uint8_t SHP[12];
+} SCB_Type;
+
+extern SysTick_Type HostSysTick;
+extern SCB_Type HostSCB;
+
+#define SysTick (&HostSysTick)
+#define SCB     (&HostSCB)
+
+#endif
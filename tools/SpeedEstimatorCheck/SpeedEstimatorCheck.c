@@ -0,0 +1,265 @@
+// SpeedEstimatorCheck.c
+// Runs on Linux (host), not on the MSP432
+// Checks inc/SpeedEstimator.c against synthetic encoder edge streams.
+// Tachometer_GetEdges, Tachometer_CountsPerStep and TimerA3Capture_Now
+// are replaced below by a model of two wheels, so the estimator code
+// runs unchanged, one SpeedEstimator_UpdateWheels per control period.
+//
+// 1. SpeedEstimator_Divide against a real divide: every t up to 2^20
+//    for a few numerators, then random 32-bit values.  The error must
+//    stay below 0.001% plus rounding, and t = 0 must saturate.
+// 2. Constant speeds from 3 to 200 rpm, left forward and right
+//    backward, one edge per step and quadrature (4 counts per step),
+//    with edge times jittered by up to -j ticks.  From the second
+//    window with an edge on, every estimate must be within 0.2% or 1 rpm.
+// 3. The wheels stop: the estimate may only fall, never exceeds one
+//    step over the time since the last edge, and is 0 after the stall
+//    timeout.
+// 4. Edge cases: an update whose last edge is at the current tick
+//    (elapsed time 0), called twice, and timestamps that wrap past
+//    2^32 during a run.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I../../inc SpeedEstimatorCheck.c ../../inc/SpeedEstimator.c -o SpeedEstimatorCheck
+//   ./SpeedEstimatorCheck
+// Add -fsanitize=address,undefined to the gcc line to catch a read
+// outside the reciprocal table as well as a wrong result.
+// Options:
+//   -j <ticks>  edge time jitter (default 3, 2 us)
+//   -n <n>      random divides (default 10000000)
+//   -s <n>      random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "TA3InputCapture.h"
+#include "Tachometer.h"
+#include "SpeedEstimator.h"
+
+#define TICKS_PER_S     1500000     // 2/3 us
+#define PERIOD_TICKS    15000       // 10 ms control period
+#define STALL_MS        TACH_STALL_TIMEOUT_MS
+
+// Wheel model, index 0 left and 1 right
+static int32_t Counts[2];           // count at the last edge
+static uint32_t EdgeTime[2];        // time of the last edge
+static uint32_t Now;
+static uint8_t PerStep = 1;
+
+void Tachometer_GetEdges(int32_t *leftCounts, uint32_t *leftTime,
+                         int32_t *rightCounts, uint32_t *rightTime){
+    *leftCounts = Counts[0];
+    *leftTime = EdgeTime[0];
+    *rightCounts = Counts[1];
+    *rightTime = EdgeTime[1];
+}
+
+uint8_t Tachometer_CountsPerStep(void){
+    return PerStep;
+}
+
+uint32_t TimerA3Capture_Now(void){
+    return Now;
+}
+
+static long Errors;
+static int Jitter = 3;
+
+static void fail(const char *what){
+    if (Errors < 20) {
+        printf("  %s\n", what);
+    }
+    Errors++;
+}
+
+static uint32_t random32(void){
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+// num/t rounded, 0xFFFFFFFF when it does not fit, num/t * 1e-5 + 1 allowed
+static void checkDivide(uint32_t num, uint32_t t, double *worst){
+    uint32_t q = SpeedEstimator_Divide(num, t);
+    uint64_t exact = ((uint64_t)num + t/2) / t;
+    if (exact > 0xFFFFFFFF) {
+        exact = 0xFFFFFFFF;
+    }
+    double e = (q > exact) ? (double)(q - exact) : (double)(exact - q);
+    if (e > (double)exact * 1e-5 + 1) {
+        char msg[100];
+        sprintf(msg, "Divide(%u, %u) = %u, expected %llu", num, t, q, (unsigned long long)exact);
+        fail(msg);
+    }
+    if ((exact > 100000) && (e / exact > *worst)) {
+        *worst = e / exact;
+    }
+}
+
+static void divide(long n){
+    static const uint32_t Nums[] = {1, 1000, SPEED_RPM_K, SPEED_MMPS_K,
+                                    SPEED_MAX_STEPS * (uint32_t)SPEED_MMPS_K, 0xFFFFFFFF};
+    double worst = 0;
+    long errors = Errors;
+
+    if (SpeedEstimator_Divide(SPEED_RPM_K, 0) != 0xFFFFFFFF) {
+        fail("Divide(num, 0) does not saturate");
+    }
+    for (unsigned i = 0; i < sizeof(Nums) / sizeof(Nums[0]); i++) {
+        for (uint32_t t = 1; t <= (1u << 20); t++) {
+            checkDivide(Nums[i], t, &worst);
+        }
+    }
+    for (long i = 0; i < n; i++) {
+        uint32_t t = random32() >> (rand() % 32);
+        checkDivide(random32(), t ? t : 1, &worst);
+    }
+    printf("SpeedEstimator_Divide: t = 0 saturates, worst relative error %.2e, %s\n",
+           worst, (Errors == errors) ? "ok" : "FAILED");
+}
+
+// Runs both wheels at rpm (left forward, right backward) from start,
+// for the given control periods, and returns the worst estimate error
+// in rpm from the second window with an edge on (the first edge after
+// Init is only a reference).
+static double run(double rpm, uint32_t start, int periods){
+    double countTicks = (double)TICKS_PER_S * 60 / (rpm * 360 * PerStep);
+    double next = countTicks;       // time of the next count, from start
+    int32_t steps = 0, seen = 0;
+    int windows = 0;                // windows that ended with a new edge
+    double worst = 0;
+
+    Now = start;
+    Counts[0] = Counts[1] = 0;
+    EdgeTime[0] = EdgeTime[1] = start;
+    SpeedEstimator_InitWheels(STALL_MS);
+    for (int p = 1; p <= periods; p++) {
+        uint32_t end = (uint32_t)p * PERIOD_TICKS;
+        while (next <= end) {
+            steps++;
+            uint32_t t = start + (uint32_t)next + (Jitter ? rand() % (2*Jitter + 1) - Jitter : 0);
+            Counts[0] = steps;
+            Counts[1] = -steps;
+            EdgeTime[0] = EdgeTime[1] = t;
+            next += countTicks;
+        }
+        Now = start + end;
+        if (steps != seen) {
+            seen = steps;
+            windows++;
+        }
+        int32_t left, right;
+        SpeedEstimator_UpdateWheels(&left, &right);
+        if (windows >= 2) {
+            double e0 = left - rpm, e1 = right + rpm;
+            if (e0 < 0) e0 = -e0;
+            if (e1 < 0) e1 = -e1;
+            if (e0 > worst) worst = e0;
+            if (e1 > worst) worst = e1;
+        }
+    }
+    return worst;
+}
+
+static void constant(void){
+    static const double Rpm[] = {3, 5, 10, 20, 50, 100, 150, 200};
+
+    for (PerStep = 1; PerStep <= QUAD_COUNTS_PER_STEP; PerStep += QUAD_COUNTS_PER_STEP - 1) {
+        long errors = Errors;
+        printf("%s, jitter +-%d ticks:\n", (PerStep == 1) ? "one edge per step" : "quadrature", Jitter);
+        for (unsigned i = 0; i < sizeof(Rpm) / sizeof(Rpm[0]); i++) {
+            double worst = run(Rpm[i], 12345, 200);
+            double allowed = (Rpm[i] * 0.002 > 1) ? Rpm[i] * 0.002 : 1;
+            printf("  %5.0f rpm: worst error %.2f rpm\n", Rpm[i], worst);
+            if (worst > allowed) {
+                fail("estimate off by more than 0.2% or 1 rpm");
+            }
+        }
+        printf("  %s\n", (Errors == errors) ? "ok" : "FAILED");
+    }
+    PerStep = 1;
+}
+
+static void stop(void){
+    long errors = Errors;
+    int32_t last, left, right;
+
+    run(100, 0, 50);
+    SpeedEstimator_UpdateWheels(&last, &right);
+    uint32_t stopped = EdgeTime[0];
+    for (int p = 0; p < 20; p++) {
+        Now += PERIOD_TICKS;
+        SpeedEstimator_UpdateWheels(&left, &right);
+        uint32_t elapsed = Now - stopped;
+        int32_t limit = (SPEED_RPM_K + elapsed/2) / elapsed;
+        if ((left > last) || (-right > last)) {
+            fail("estimate rose after the wheels stopped");
+        }
+        if ((elapsed <= (uint32_t)STALL_MS * 1500) && ((left > limit + 1) || (-right > limit + 1))) {
+            fail("estimate above one step over the time since the last edge");
+        }
+        if ((elapsed > (uint32_t)STALL_MS * 1500) && (left || right)) {
+            fail("estimate not 0 after the stall timeout");
+        }
+        last = left;
+    }
+    printf("stop at 100 rpm: %s\n", (Errors == errors) ? "ok" : "FAILED");
+}
+
+static void edges(void){
+    long errors = Errors;
+    SpeedEstimator_t est;
+    double worst;
+
+    // reference edge at the current tick, right after Init
+    SpeedEstimator_Init(&est, 0, 5000, STALL_MS);
+    if (SpeedEstimator_Update(&est, 0, 5000, 5000) != 0) {
+        fail("update at the edge tick after Init is not 0");
+    }
+
+    // running at 2500 ticks per step, then an edge exactly at now, twice
+    SpeedEstimator_Init(&est, 0, 0, STALL_MS);
+    SpeedEstimator_Update(&est, 1, 0, 100);
+    int32_t rpm = SpeedEstimator_Update(&est, 2, 2500, 2500);
+    int32_t again = SpeedEstimator_Update(&est, 2, 2500, 2500);
+    if ((rpm != 100) || (again != 100) || (SpeedEstimator_MMPS(&est) != 367)) {
+        char msg[100];
+        sprintf(msg, "elapsed 0: %d then %d rpm, %d mm/s, expected 100, 100, 367",
+                (int)rpm, (int)again, (int)SpeedEstimator_MMPS(&est));
+        fail(msg);
+    }
+
+    // timestamps wrap past 2^32 about 1.5 s into the run
+    worst = run(60, 0xFFFFFFFF - 2250000, 300);
+    if (worst > 1) {
+        fail("estimate wrong across the 32-bit time wrap");
+    }
+    printf("elapsed 0 and time wrap: %s\n", (Errors == errors) ? "ok" : "FAILED");
+}
+
+int main(int argc, char **argv){
+    long n = 10000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:n:s:")) != -1) {
+        switch (opt) {
+        case 'j': Jitter = atoi(optarg); break;
+        case 'n': n = atol(optarg); break;
+        case 's': srand(atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-j ticks] [-n divides] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    divide(n);
+    constant();
+    stop();
+    edges();
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
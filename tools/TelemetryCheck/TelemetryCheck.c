@@ -0,0 +1,185 @@
+// TelemetryCheck.c
+// Runs on Linux (host), not on the MSP432
+// Measures how long the run logs of Level1, Level2, Program17_1 and
+// Program17_3 take to reach the PC as inc/Telemetry.c frames at
+// TELEMETRY_BAUD, against the ASCII CSV dumps they replaced at 115200.
+// UART0_OutBuffer is replaced below by a capture of the bytes sent.
+//
+// 1. Each log is encoded with the field list of its program and values
+//    in the ranges the robot records.  The capture must be a schema
+//    frame, data frames and an end frame with the record count, every
+//    frame with a good CRC and the next sequence number.
+// 2. The CSV the old TxBuffer sent for the same records is rebuilt in
+//    its format: the banner, then one "a,b,c\n\r" line per record,
+//    Level1 with the record index first.
+// 3. Line time is 10 bits per byte (8N1).  The old dump also formatted
+//    each number while it waited for the UART, so its time here is a
+//    lower bound.  Every log must arrive at least 4 times faster.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I../../inc TelemetryCheck.c ../../inc/Telemetry.c ../../inc/CRC16.c -o TelemetryCheck
+//   ./TelemetryCheck
+// Options:
+//   -s <n>   random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "CRC16.h"
+#include "UART0.h"
+#include "Telemetry.h"
+
+#define OLD_BAUD    115200
+#define MAX_CAPTURE (1 << 20)
+
+static uint8_t Capture[MAX_CAPTURE];
+static uint32_t CaptureN;
+
+void UART0_OutBuffer(const char *buf, uint32_t count){
+    for (uint32_t i = 0; (i < count) && (CaptureN < MAX_CAPTURE); i++) {
+        Capture[CaptureN++] = buf[i];
+    }
+}
+
+void UART0_Flush(void){
+}
+
+static long Errors;
+
+static void fail(const char *what){
+    if (Errors < 20) {
+        printf("  %s\n", what);
+    }
+    Errors++;
+}
+
+// One run log: the fields its program streams now, the value range
+// of each, and how the old TxBuffer printed it
+typedef struct {
+    const char *Name;
+    uint32_t Records;           // BUFFER_SIZE of the old dump
+    uint8_t NumFields;
+    TelemetryField_t Fields[4];
+    int32_t Min[4], Max[4];
+    uint8_t OldColumns;         // leading fields the CSV had
+    uint8_t OldIndex;           // 1 if each CSV line started with the record index
+} log_t;
+
+static const log_t Logs[] = {
+    {"Level1", 3000, 3, {{"x", TELEMETRY_I16}, {"y", TELEMETRY_I16}, {"heading", TELEMETRY_U8}},
+     {0, 0, 0}, {3000, 3000, 3}, 2, 1},
+    {"Level2", 1000, 3, {{"error", TELEMETRY_I16}, {"leftDuty", TELEMETRY_U16}, {"rightDuty", TELEMETRY_U16}},
+     {-400, 0, 0}, {400, 999, 999}, 3, 0},
+    {"Program17_1", 1000, 4, {{"leftSpeed", TELEMETRY_U16}, {"rightSpeed", TELEMETRY_U16},
+     {"leftDuty", TELEMETRY_U16}, {"rightDuty", TELEMETRY_U16}},
+     {0, 0, 0, 0}, {200, 200, 999, 999}, 4, 0},
+    {"Program17_3", 1000, 3, {{"error", TELEMETRY_I16}, {"leftDuty", TELEMETRY_U16}, {"rightDuty", TELEMETRY_U16}},
+     {-400, 0, 0}, {400, 999, 999}, 3, 0},
+};
+#define NUM_LOGS (sizeof(Logs)/sizeof(Logs[0]))
+
+// walks the capture frame by frame, returns the records the end frame counts
+static long frames(void){
+    uint32_t i = 0;
+    uint16_t seq = 0;
+    long frames = 0, records = -1;
+
+    while (i < CaptureN) {
+        if ((CaptureN - i < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE) ||
+            (Capture[i] != TELEMETRY_SYNC0) || (Capture[i+1] != TELEMETRY_SYNC1)) {
+            fail("bytes outside a frame");
+            return -1;
+        }
+        uint32_t end = i + TELEMETRY_HEADER_SIZE + Capture[i+5];
+        uint8_t type = Capture[i+2];
+        uint16_t crc = Capture[end] | (Capture[end+1] << 8);
+        if (crc != CRC16_Update(CRC16_INIT, &Capture[i+2], end - i - 2)) {
+            fail("frame CRC does not match");
+        }
+        if ((Capture[i+3] | (Capture[i+4] << 8)) != seq) {
+            fail("frame out of sequence");
+        }
+        if ((frames == 0) != (type == TELEMETRY_SCHEMA)) {
+            fail("the schema frame is not the first");
+        }
+        if (type == TELEMETRY_END) {
+            const uint8_t *p = &Capture[i + TELEMETRY_HEADER_SIZE + 1];
+            records = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+            if (end + TELEMETRY_CRC_SIZE != CaptureN) {
+                fail("bytes after the end frame");
+            }
+        }
+        seq++;
+        frames++;
+        i = end + TELEMETRY_CRC_SIZE;
+    }
+    return records;
+}
+
+static int32_t value(const log_t *g, int f){
+    return g->Min[f] + rand() % (g->Max[f] - g->Min[f] + 1);
+}
+
+static void measure(const log_t *g){
+    char line[80];
+    uint32_t csv = sprintf(line, "\n\r***Receiving buffer data***\n\r");
+
+    CaptureN = 0;
+    Telemetry_Begin(g->Name, g->Fields, g->NumFields);
+    for (uint32_t r = 0; r < g->Records; r++) {
+        int32_t values[4];
+        int n = 0;
+        for (int f = 0; f < g->NumFields; f++) {
+            values[f] = value(g, f);
+        }
+        if (g->OldIndex) {
+            n += sprintf(line + n, "%u,", r);
+        }
+        for (int f = 0; f < g->OldColumns; f++) {
+            n += sprintf(line + n, (f + 1 < g->OldColumns) ? "%d," : "%d\n\r", (int)values[f]);
+        }
+        csv += n;
+        Telemetry_Record(values);
+    }
+    Telemetry_End();
+
+    if (frames() != (long)g->Records) {
+        fail("the end frame does not count every record");
+    }
+    double told = csv * 10.0 / OLD_BAUD;
+    double tnew = CaptureN * 10.0 / TELEMETRY_BAUD;
+    printf("  %-12s %5u %7u %5.1f %6.3f %6u %5.2f %6.3f %5.1fx  %s\n", g->Name, g->Records,
+           csv, (double)csv / g->Records, told, CaptureN, (double)CaptureN / g->Records,
+           tnew, told / tnew, (told >= 4 * tnew) ? "ok" : "FAILED");
+    if (told < 4 * tnew) {
+        fail("less than 4 times faster than the CSV dump");
+    }
+}
+
+int main(int argc, char **argv){
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+        case 's': srand(atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("CSV at %d baud against frames at %d baud, 8N1:\n", OLD_BAUD, TELEMETRY_BAUD);
+    printf("  %-12s %5s %7s %5s %6s %6s %5s %6s %6s\n", "log", "recs", "CSV", "B/rec", "s",
+           "frames", "B/rec", "s", "faster");
+    for (unsigned i = 0; i < NUM_LOGS; i++) {
+        measure(&Logs[i]);
+    }
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
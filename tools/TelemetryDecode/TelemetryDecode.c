@@ -0,0 +1,424 @@
+// TelemetryDecode.c
+// Runs on Linux (host), not on the MSP432
+// Decodes the binary frames sent by inc/Telemetry.c into CSV, or into
+// one text file per column.  Every frame is checked against its CRC and
+// sequence number; a bad frame is dropped and the decoder resyncs on the
+// next 0xA5 0x5A, so text printed between frames is skipped as well.
+// Records lost that way are reported by number on stderr.  Several
+// streams may be open at once (inc/TelemetryStream.c sends one per
+// channel while the robot runs); their frames are told apart by the
+// stream number in each payload.
+//
+// Build from this directory:
+//   gcc -O2 -Wall -I../../inc TelemetryDecode.c ../../inc/CRC16.c -o TelemetryDecode
+// Run:
+//   ./TelemetryDecode /dev/ttyACM0 > run.csv              read a robot until its end frame
+//   ./TelemetryDecode capture.bin > run.csv               decode a saved capture
+//   ./TelemetryDecode -d out capture.bin                  out/<stream>_<field>.txt
+//   ./TelemetryDecode -a /dev/ttyACM0 > live.csv           live telemetry, stop with Ctrl-C
+// Options:
+//   -b <baud>   set up a serial port as raw 8N1 at this baud rate; a
+//               device is set up at TELEMETRY_BAUD (460800), the rate
+//               the robot programs use, when -b is not given
+//   -d <dir>    write one file per column into dir instead of CSV on stdout
+//   -a          keep reading after an end frame (a serial port stops at the first)
+// The input is a file, a serial port, or - for stdin.  The first CSV
+// column is the record number, so gaps in it are lost records.  When
+// the rows switch to another stream, a "# name" line comes first.
+// Exit status is 0 when no frame or record was lost, 1 if any was,
+// 2 for usage errors.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include "CRC16.h"
+#include "Telemetry.h"
+
+#define FRAME_MAX (TELEMETRY_HEADER_SIZE + 255 + TELEMETRY_CRC_SIZE)
+
+typedef struct {
+    char Name[TELEMETRY_MAX_NAME + 1];
+    uint8_t Type;
+    FILE *Column;               // -d output, NULL for CSV
+} field_t;
+
+// buffered input, Buf[0] is the next byte not yet consumed
+static FILE *In;
+static uint8_t Buf[FRAME_MAX];
+static uint32_t BufN;
+static uint64_t Offset;         // input offset of Buf[0]
+
+// the streams being decoded
+typedef struct {
+    int HaveSchema;
+    char Name[TELEMETRY_MAX_NAME + 1];
+    field_t Fields[TELEMETRY_MAX_FIELDS];
+    uint8_t NumFields;
+    uint8_t RecordSize;
+    uint32_t NextRecord;
+} stream_t;
+static stream_t Streams[TELEMETRY_MAX_STREAMS];
+static int Open;                // streams with a schema and no end frame yet
+static uint16_t NextSequence;
+static int HaveSequence;
+
+static const char *OutDir;
+static uint32_t Schemas;        // schemas decoded so far
+static int LastPrinted = -1;    // stream of the last CSV row
+static int Live;                // flush each frame, the input is a serial port
+
+static struct {
+    uint64_t Frames;
+    uint64_t Records;
+    uint64_t Skipped;           // bytes outside good frames
+    uint64_t CrcErrors;
+    uint64_t SequenceGaps;
+    uint64_t MissingRecords;
+} Stats;
+
+// Make sure at least n bytes are buffered. Returns 0 at end of input.
+static int Fill(uint32_t n) {
+    while (BufN < n) {
+        size_t got = fread(&Buf[BufN], 1, n - BufN, In);
+        if (got == 0) {
+            return 0;
+        }
+        BufN += got;
+    }
+    return 1;
+}
+
+static void Drop(uint32_t n) {
+    memmove(Buf, &Buf[n], BufN - n);
+    BufN -= n;
+    Offset += n;
+}
+
+static uint16_t GetU16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t GetU32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int32_t GetField(const uint8_t *p, uint8_t type, int *isUnsigned) {
+    *isUnsigned = 0;
+    switch (type) {
+    case TELEMETRY_I8:  return (int8_t)p[0];
+    case TELEMETRY_U8:  return p[0];
+    case TELEMETRY_I16: return (int16_t)GetU16(p);
+    case TELEMETRY_U16: return GetU16(p);
+    case TELEMETRY_I32: return (int32_t)GetU32(p);
+    default:            *isUnsigned = 1; return (int32_t)GetU32(p);
+    }
+}
+
+// Forget a stream and close its column files
+static void CloseStream(stream_t *s) {
+    for (int i = 0; i < s->NumFields; i++) {
+        if (s->Fields[i].Column) {
+            fclose(s->Fields[i].Column);
+            s->Fields[i].Column = NULL;
+        }
+    }
+    if (s->HaveSchema) {
+        s->HaveSchema = 0;
+        Open--;
+    }
+}
+
+// The stream a data or end payload belongs to, NULL without a schema
+static stream_t *PayloadStream(const uint8_t *p, uint8_t length) {
+    if ((length < TELEMETRY_DATA_SIZE) || (p[0] >= TELEMETRY_MAX_STREAMS) ||
+        !Streams[p[0]].HaveSchema) {
+        return NULL;
+    }
+    return &Streams[p[0]];
+}
+
+// Copy a length-prefixed name. Returns bytes used, 0 if it runs past end.
+static uint32_t GetName(const uint8_t *p, const uint8_t *end, char *name) {
+    uint8_t n = p[0];
+    if ((p + 1 + n > end) || (n > TELEMETRY_MAX_NAME)) {
+        return 0;
+    }
+    memcpy(name, p + 1, n);
+    name[n] = 0;
+    return 1 + n;
+}
+
+static int Schema(const uint8_t *p, uint8_t length) {
+    const uint8_t *end = p + length;
+    uint32_t used;
+    uint8_t size = 0;
+    stream_t *s;
+
+    if ((length < 4) || (p[0] != TELEMETRY_VERSION) || (p[1] >= TELEMETRY_MAX_STREAMS) ||
+        (p[2] == 0) || (p[2] > TELEMETRY_MAX_FIELDS)) {
+        fprintf(stderr, "offset %llu: unsupported schema\n", (unsigned long long)Offset);
+        return 0;
+    }
+    s = &Streams[p[1]];
+    CloseStream(s);
+    s->NumFields = p[2];
+    s->RecordSize = p[3];
+    p += 4;
+    if ((used = GetName(p, end, s->Name)) == 0) return 0;
+    p += used;
+    for (int i = 0; i < s->NumFields; i++) {
+        if ((p >= end) || (p[0] < TELEMETRY_I8) || (p[0] > TELEMETRY_U32)) return 0;
+        s->Fields[i].Type = p[0];
+        size += TELEMETRY_SIZE(p[0]);
+        if ((used = GetName(p + 1, end, s->Fields[i].Name)) == 0) return 0;
+        p += 1 + used;
+    }
+    if (size != s->RecordSize) {
+        fprintf(stderr, "offset %llu: record size %u does not match the fields\n",
+                (unsigned long long)Offset, s->RecordSize);
+        return 0;
+    }
+
+    if (OutDir) {
+        char path[4096];
+        for (int i = 0; i < s->NumFields; i++) {
+            snprintf(path, sizeof(path), "%s/%s_%s.txt", OutDir, s->Name, s->Fields[i].Name);
+            s->Fields[i].Column = fopen(path, "w");
+            if (s->Fields[i].Column == NULL) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                exit(2);
+            }
+        }
+    } else {
+        if (Schemas) printf("\n");         // a blank line between streams
+        printf("# %s\nrecord", s->Name);
+        for (int i = 0; i < s->NumFields; i++) {
+            printf(",%s", s->Fields[i].Name);
+        }
+        printf("\n");
+        LastPrinted = s - Streams;
+    }
+    s->HaveSchema = 1;
+    s->NextRecord = 0;
+    Open++;
+    Schemas++;
+    return 1;
+}
+
+static void Data(const uint8_t *p, uint8_t length) {
+    uint32_t first, count;
+    stream_t *s = PayloadStream(p, length);
+    if ((s == NULL) || ((length - TELEMETRY_DATA_SIZE) % s->RecordSize)) {
+        fprintf(stderr, "offset %llu: data frame without a matching schema\n", (unsigned long long)Offset);
+        Stats.Skipped += length;
+        return;
+    }
+    first = GetU32(p + 1);
+    count = (length - TELEMETRY_DATA_SIZE) / s->RecordSize;
+    if (first > s->NextRecord) {
+        fprintf(stderr, "%s: records %u to %u missing\n", s->Name, s->NextRecord, first - 1);
+        Stats.MissingRecords += first - s->NextRecord;
+    }
+    p += TELEMETRY_DATA_SIZE;
+    if (!OutDir && (LastPrinted != s - Streams)) {
+        printf("# %s\n", s->Name);
+        LastPrinted = s - Streams;
+    }
+    for (uint32_t r = 0; r < count; r++) {
+        if (!OutDir) printf("%u", first + r);
+        for (int i = 0; i < s->NumFields; i++) {
+            int isUnsigned;
+            int32_t v = GetField(p, s->Fields[i].Type, &isUnsigned);
+            FILE *out = OutDir ? s->Fields[i].Column : stdout;
+            if (!OutDir) fputc(',', out);
+            if (isUnsigned) {
+                fprintf(out, "%u", (uint32_t)v);
+            } else {
+                fprintf(out, "%d", v);
+            }
+            if (OutDir) fputc('\n', out);
+            p += TELEMETRY_SIZE(s->Fields[i].Type);
+        }
+        if (!OutDir) printf("\n");
+    }
+    s->NextRecord = first + count;
+    Stats.Records += count;
+    if (Live) {
+        fflush(stdout);
+        for (int i = 0; OutDir && (i < s->NumFields); i++) {
+            fflush(s->Fields[i].Column);
+        }
+    }
+}
+
+// Returns 1 when the last open stream has ended.
+static int End(const uint8_t *p, uint8_t length) {
+    stream_t *s = PayloadStream(p, length);
+    if (s == NULL) {
+        return 0;
+    }
+    if (GetU32(p + 1) > s->NextRecord) {
+        fprintf(stderr, "%s: records %u to %u missing\n", s->Name, s->NextRecord, GetU32(p + 1) - 1);
+        Stats.MissingRecords += GetU32(p + 1) - s->NextRecord;
+    }
+    CloseStream(s);
+    fflush(stdout);
+    return Open == 0;
+}
+
+static int Frame(const uint8_t *frame) {
+    uint8_t type = frame[2];
+    uint16_t sequence = GetU16(&frame[3]);
+    uint8_t length = frame[5];
+    const uint8_t *payload = &frame[TELEMETRY_HEADER_SIZE];
+
+    Stats.Frames++;
+    if (type == TELEMETRY_SCHEMA) {
+        // a robot restart begins again at 0, so do not count a gap here
+        NextSequence = sequence + 1;
+        HaveSequence = 1;
+        if (!Schema(payload, length)) Stats.Skipped += length;
+        return 0;
+    }
+    if (HaveSequence && (sequence != NextSequence)) {
+        fprintf(stderr, "offset %llu: %u frames missing\n", (unsigned long long)Offset,
+                (uint16_t)(sequence - NextSequence));
+        Stats.SequenceGaps++;
+    }
+    NextSequence = sequence + 1;
+    if (type == TELEMETRY_DATA) {
+        Data(payload, length);
+        return 0;
+    }
+    if (type == TELEMETRY_END) {
+        return End(payload, length);
+    }
+    fprintf(stderr, "offset %llu: unknown frame type 0x%02X\n", (unsigned long long)Offset, type);
+    return 0;
+}
+
+static int OpenSerial(const char *path, long baud) {
+    static const struct { long Baud; speed_t Speed; } Speeds[] = {
+        {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600},
+        {115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600}
+    };
+    struct termios tio;
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(2);
+    }
+    if (tcgetattr(fd, &tio) == 0) {
+        size_t i;
+        for (i = 0; i < sizeof(Speeds) / sizeof(Speeds[0]); i++) {
+            if (Speeds[i].Baud == baud) break;
+        }
+        if (i == sizeof(Speeds) / sizeof(Speeds[0])) {
+            fprintf(stderr, "unsupported baud rate %ld\n", baud);
+            exit(2);
+        }
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, Speeds[i].Speed);
+        cfsetospeed(&tio, Speeds[i].Speed);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static int IsDevice(const char *path) {
+    struct stat st;
+    return (stat(path, &st) == 0) && S_ISCHR(st.st_mode);
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr, "usage: %s [-b baud] [-d dir] [-a] <file|device|->\n", name);
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    long baud = 0;
+    int all = 0;
+    int stopAtEnd;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:d:a")) != -1) {
+        switch (opt) {
+        case 'b': baud = strtol(optarg, NULL, 0); break;
+        case 'd': OutDir = optarg; break;
+        case 'a': all = 1; break;
+        default: Usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) Usage(argv[0]);
+
+    if (strcmp(argv[optind], "-") == 0) {
+        In = stdin;
+    } else if (baud || IsDevice(argv[optind])) {
+        if (baud == 0) {
+            baud = TELEMETRY_BAUD;
+        }
+        In = fdopen(OpenSerial(argv[optind], baud), "rb");
+    } else {
+        In = fopen(argv[optind], "rb");
+    }
+    if (In == NULL) {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return 2;
+    }
+    if (OutDir) {
+        mkdir(OutDir, 0777);
+    }
+    // a serial port never reaches end of file, so stop at the end frame
+    stopAtEnd = !all && (baud || isatty(fileno(In)));
+    Live = baud || isatty(fileno(In));
+
+    while (Fill(2)) {
+        if ((Buf[0] != TELEMETRY_SYNC0) || (Buf[1] != TELEMETRY_SYNC1)) {
+            Drop(1);
+            Stats.Skipped++;
+            continue;
+        }
+        if (!Fill(TELEMETRY_HEADER_SIZE)) break;
+        uint32_t size = TELEMETRY_HEADER_SIZE + Buf[5] + TELEMETRY_CRC_SIZE;
+        if (Buf[5] > TELEMETRY_MAX_PAYLOAD) {
+            Drop(1);
+            Stats.Skipped++;
+            continue;
+        }
+        if (!Fill(size)) break;         // truncated at the end of the input
+        if (CRC16_Update(CRC16_INIT, &Buf[2], size - 4) != GetU16(&Buf[size - 2])) {
+            // not a frame after all, or a damaged one: resync from the next byte
+            fprintf(stderr, "offset %llu: CRC error\n", (unsigned long long)Offset);
+            Stats.CrcErrors++;
+            Drop(1);
+            Stats.Skipped++;
+            continue;
+        }
+        int ended = Frame(Buf);
+        Drop(size);
+        if (ended && stopAtEnd) break;
+    }
+    Stats.Skipped += BufN;
+    for (int i = 0; i < TELEMETRY_MAX_STREAMS; i++) {
+        if (Streams[i].HaveSchema) {
+            fprintf(stderr, "%s: input ended before the end frame\n", Streams[i].Name);
+            Stats.MissingRecords++;     // at least the end frame is lost
+            CloseStream(&Streams[i]);
+        }
+    }
+
+    fprintf(stderr, "%llu frames, %llu records, %llu bytes skipped, %llu CRC errors, "
+            "%llu sequence gaps, %llu records missing\n",
+            (unsigned long long)Stats.Frames, (unsigned long long)Stats.Records,
+            (unsigned long long)Stats.Skipped, (unsigned long long)Stats.CrcErrors,
+            (unsigned long long)Stats.SequenceGaps, (unsigned long long)Stats.MissingRecords);
+    return (Stats.CrcErrors || Stats.SequenceGaps || Stats.MissingRecords) ? 1 : 0;
+}
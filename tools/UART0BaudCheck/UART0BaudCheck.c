@@ -0,0 +1,214 @@
+// UART0BaudCheck.c
+// Runs on Linux (host), not on the MSP432
+// Checks UART0_BaudSettings and UART0_BaudErrorSettings in
+// inc/UART0.c.  The whole driver is compiled, with the registers of
+// msp.h in this directory as plain memory, inc/Format.c, and stubs
+// below for the CortexM.c routines and add_device.
+//
+// 1. The eUSCI table in the MSP432P4 technical reference for a 12 MHz
+//    BRCLK, 9600 to 460800 baud, plus 921600, which the table leaves
+//    out and the reference's algorithm gives as UCBRx 13 without
+//    oversampling.  UCOS16, UCBRx and UCBRFx must match exactly.  The
+//    table picks UCBRSx by searching for the smallest worst-case bit
+//    error, where UART0_BaudSettings looks it up from the fraction of
+//    N, so a different UCBRSx is accepted only if it has the same
+//    number of bits set (the same average rate) and its worst-case
+//    transmit error over a 10-bit frame is within 2% of a bit of the
+//    table's.  Every difference is printed.
+// 2. Every baud rate from 1200 to 921600 in steps of 1200, and the
+//    usual rates, at UART0_BRCLK_HZ and at 24 MHz (HFXTCLK/2, should
+//    SMCLK ever be divided by 2 instead of 4): the average error
+//    must equal the one computed here from the register values, and
+//    stay within 0.5% up to 460800.
+// 3. UART0_Init(115200) writes BRW 6 and MCTLW 0x2081 for 12 MHz, and
+//    UART0_GetBaudError reports the error of those settings.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I. -I../../inc UART0BaudCheck.c ../../inc/UART0.c ../../inc/Format.c -o UART0BaudCheck
+//   ./UART0BaudCheck
+// The warnings about #pragma DATA_ALIGN and about casting DMA
+// addresses to uint32_t are expected on a 64-bit host; no DMA runs here.
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "msp.h"
+#include "file.h"
+#include "UART0.h"
+
+EUSCI_A_Type HostEUSCI_A0;
+DIO_PORT_Type HostP1;
+NVIC_Type HostNVIC;
+SCB_Type HostSCB;
+DMA_Control_Type HostDMA_Control;
+DMA_Channel_Type HostDMA_Channel;
+
+// CortexM.c is assembly for the Cortex-M4; nothing here waits
+long StartCritical(void){ return 0; }
+void EndCritical(long sr){ (void)sr; }
+void WaitForInterrupt(void){ }
+void DisableInterrupts(void){ }
+void EnableInterrupts(void){ }
+
+int add_device(char *name, unsigned flags,
+               int (*dopen)(const char *path, unsigned flags, int llv_fd),
+               int (*dclose)(int dev_fd),
+               int (*dread)(int dev_fd, char *buf, unsigned count),
+               int (*dwrite)(int dev_fd, const char *buf, unsigned count),
+               off_t (*dlseek)(int dev_fd, off_t offset, int origin),
+               int (*dunlink)(const char *path),
+               int (*drename)(const char *old_name, const char *new_name)){
+    return 1;
+}
+
+static long Errors;
+
+static void fail(const char *what){
+    if (Errors < 20) {
+        printf("  %s\n", what);
+    }
+    Errors++;
+}
+
+// MSP432P4 technical reference, eUSCI recommended settings, BRCLK 12 MHz
+typedef struct {
+    uint32_t Baud;
+    uint8_t Os16;
+    uint16_t Ucbr;
+    uint8_t Ucbrf;
+    uint8_t Ucbrs;
+    const char *Source;
+} setting_t;
+
+static const setting_t Table12MHz[] = {
+    {  9600, 1, 78,  2, 0x00, "table"},
+    { 19200, 1, 39,  1, 0x00, "table"},
+    { 38400, 1, 19,  8, 0x65, "table"},
+    { 57600, 1, 13,  0, 0x25, "table"},
+    {115200, 1,  6,  8, 0x20, "table"},
+    {230400, 1,  3,  4, 0x02, "table"},
+    {460800, 1,  1, 10, 0x00, "table"},
+    {921600, 0, 13,  0, 0x00, "algorithm"},
+};
+#define NUM_TABLE (sizeof(Table12MHz)/sizeof(Table12MHz[0]))
+
+static int bitsSet(uint8_t x){
+    int n = 0;
+    while (x) {
+        n += x & 1;
+        x >>= 1;
+    }
+    return n;
+}
+
+// BRCLK cycles in bit i of a frame, bit 0 is the start bit
+static uint32_t bitCycles(uint16_t brw, uint16_t mctlw, int i){
+    uint32_t cycles = (mctlw & 0x0001) ? 16*brw + ((mctlw >> 4) & 0x0F) : brw;
+    return cycles + ((mctlw >> (8 + (i & 7))) & 1);
+}
+
+// largest |actual - ideal| end of bit over a 10-bit frame, in % of a bit
+static double worstError(uint32_t clock, uint32_t baud, uint16_t brw, uint16_t mctlw){
+    double n = (double)clock / baud;
+    double t = 0, worst = 0;
+    for (int i = 0; i < 10; i++) {
+        t += bitCycles(brw, mctlw, i);
+        double e = (t - (i + 1)*n) / n * 100;
+        if (e < 0) e = -e;
+        if (e > worst) worst = e;
+    }
+    return worst;
+}
+
+static void table(void){
+    printf("UART0_BaudSettings at 12 MHz against the technical reference:\n");
+    printf("  %7s  %-24s %-24s %9s\n", "baud", "expected OS16 BR BRF BRS", "got", "worst err");
+    for (unsigned k = 0; k < NUM_TABLE; k++) {
+        const setting_t *s = &Table12MHz[k];
+        uint16_t brw, mctlw;
+        UART0_BaudSettings(12000000, s->Baud, &brw, &mctlw);
+        uint16_t want = (s->Ucbrs << 8) | (s->Os16 ? ((s->Ucbrf << 4) | 0x0001) : 0);
+        uint8_t brs = mctlw >> 8;
+        double ours = worstError(12000000, s->Baud, brw, mctlw);
+        double theirs = worstError(12000000, s->Baud, s->Ucbr, want);
+        const char *verdict = "same";
+        if ((brw != s->Ucbr) || ((mctlw & 0x00FF) != (want & 0x00FF))) {
+            verdict = "FAILED";
+            fail("UCBRx, UCBRFx or UCOS16 differs");
+        } else if (brs != s->Ucbrs) {
+            if ((bitsSet(brs) != bitsSet(s->Ucbrs)) || (ours > theirs + 2.0)) {
+                verdict = "FAILED";
+                fail("UCBRSx gives a different rate or a larger bit error");
+            } else {
+                verdict = "UCBRSx differs, same rate";
+            }
+        }
+        printf("  %7u  %u %3u %2u 0x%02X (%-9s) %u %3u %2u 0x%02X  %4.1f%% %4.1f%%  %s\n", s->Baud,
+               s->Os16, s->Ucbr, s->Ucbrf, s->Ucbrs, s->Source,
+               mctlw & 1, brw, (mctlw >> 4) & 0x0F, brs, theirs, ours, verdict);
+    }
+}
+
+static void sweep(uint32_t clock){
+    static const uint32_t Usual[] = {300, 1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400,
+                                     56000, 57600, 115200, 128000, 230400, 256000, 460800, 921600};
+    double worst = 0;
+    uint32_t worstBaud = 0;
+    long errors = Errors;
+
+    for (uint32_t k = 0; k < 768 + sizeof(Usual)/sizeof(Usual[0]); k++) {
+        uint32_t baud = (k < 768) ? 1200*(k + 1) : Usual[k - 768];
+        uint16_t brw, mctlw;
+        UART0_BaudSettings(clock, baud, &brw, &mctlw);
+
+        uint64_t cycles8 = 0;
+        for (int i = 0; i < 8; i++) {
+            cycles8 += bitCycles(brw, mctlw, i);
+        }
+        double exact = ((double)clock * 8 / ((double)cycles8 * baud) - 1) * 1e6;
+        int32_t ppm = UART0_BaudErrorSettings(clock, baud, brw, mctlw);
+        if ((ppm - exact > 1) || (exact - ppm > 1)) {
+            char msg[100];
+            sprintf(msg, "%u baud at %u Hz: UART0_BaudErrorSettings %d ppm, expected %.0f",
+                    baud, clock, (int)ppm, exact);
+            fail(msg);
+        }
+        double e = (exact < 0) ? -exact : exact;
+        if ((baud <= 460800) && (e > worst)) {
+            worst = e;
+            worstBaud = baud;
+        }
+    }
+    printf("%u Hz, 1200 to 921600 baud: worst average error up to 460800 is %.0f ppm at %u, %s\n",
+           clock, worst, worstBaud, (Errors == errors) ? "ok" : "FAILED");
+    if (worst > 5000) {
+        fail("average error above 0.5%");
+    }
+}
+
+static void init(void){
+    HostEUSCI_A0.BRW = HostEUSCI_A0.MCTLW = 0;
+    UART0_Init(115200);
+    int32_t want = UART0_BaudErrorSettings(UART0_BRCLK_HZ, 115200, 6, 0x2081);
+    int ok = (HostEUSCI_A0.BRW == 6) && (HostEUSCI_A0.MCTLW == 0x2081) &&
+             (UART0_GetBaudError() == want) && ((HostEUSCI_A0.CTLW0 & 0x00C1) == 0x00C0);
+    printf("UART0_Init(115200) at %u Hz: BRW %u MCTLW 0x%04X, %d ppm, %s\n", UART0_BRCLK_HZ,
+           HostEUSCI_A0.BRW, HostEUSCI_A0.MCTLW, (int)UART0_GetBaudError(), ok ? "ok" : "FAILED");
+    if (!ok) {
+        fail("UART0_Init registers or UART0_GetBaudError");
+    }
+}
+
+int main(void){
+    table();
+    sweep(UART0_BRCLK_HZ);
+    sweep(24000000);
+    init();
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,23 @@
+// file.h
+// Runs on Linux (host), not on the MSP432
+// Stand-in for the TI compiler's device driver header, which
+// inc/UART0.c uses to route printf to the UART.  UART0BaudCheck.c
+// never calls UART0_Initprintf, so add_device only has to link.
+
+#ifndef FILE_H_HOST
+#define FILE_H_HOST
+
+#include <sys/types.h>
+
+#define _SSA 0      // single stream device
+
+int add_device(char *name, unsigned flags,
+               int (*dopen)(const char *path, unsigned flags, int llv_fd),
+               int (*dclose)(int dev_fd),
+               int (*dread)(int dev_fd, char *buf, unsigned count),
+               int (*dwrite)(int dev_fd, const char *buf, unsigned count),
+               off_t (*dlseek)(int dev_fd, off_t offset, int origin),
+               int (*dunlink)(const char *path),
+               int (*drename)(const char *old_name, const char *new_name));
+
+#endif
@@ -0,0 +1,245 @@
+// UART0Check.c
+// Runs on Linux (host), not on the MSP432
+// Checks that receive and transmit share EUSCIA0_IRQHandler in
+// inc/UART0.c without losing bytes.  The whole driver is compiled with
+// the registers of msp.h in this directory as plain memory, and the
+// code below plays the eUSCI: a write to an empty TXBUF clears
+// UCTXIFG, shifting TXBUF out sets it again, a received byte sets
+// UCRXIFG, and reading RXBUF clears it.  The handler runs whenever an
+// armed flag is set and interrupts are not masked, as the NVIC would.
+//
+// 1. A console reply is queued and its first byte is in TXBUF when a
+//    byte arrives.  The receive interrupt must store the byte and leave
+//    TXBUF alone, and the reply must come out whole.
+// 2. Random queueing, shifting and receiving, -n events: every queued
+//    byte leaves on the wire once and in order, every received byte is
+//    read back in order, and nothing is dropped or counted as an
+//    overflow.  TXBUF is never written while it is full.
+//
+// Build and run from this directory:
+//   gcc -O2 -Wall -I. -I../../inc UART0Check.c ../../inc/UART0.c ../../inc/Format.c -o UART0Check
+//   ./UART0Check
+// The warnings about #pragma DATA_ALIGN and about casting DMA
+// addresses to uint32_t are expected on a 64-bit host; no DMA runs here.
+// Options:
+//   -n <n>   random events (default 1000000)
+//   -s <n>   random seed (default 1)
+// Exit status is 0 when every check passes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "msp.h"
+#include "file.h"
+#include "UART0.h"
+
+void EUSCIA0_IRQHandler(void);  // inc/UART0.c, the vector table calls it on the robot
+
+EUSCI_A_Type HostEUSCI_A0;
+DIO_PORT_Type HostP1;
+NVIC_Type HostNVIC;
+SCB_Type HostSCB;
+DMA_Control_Type HostDMA_Control;
+DMA_Channel_Type HostDMA_Channel;
+
+int add_device(char *name, unsigned flags,
+               int (*dopen)(const char *path, unsigned flags, int llv_fd),
+               int (*dclose)(int dev_fd),
+               int (*dread)(int dev_fd, char *buf, unsigned count),
+               int (*dwrite)(int dev_fd, const char *buf, unsigned count),
+               off_t (*dlseek)(int dev_fd, off_t offset, int origin),
+               int (*dunlink)(const char *path),
+               int (*drename)(const char *old_name, const char *new_name)){
+    return 1;
+}
+
+static long Errors;
+
+static void fail(const char *what){
+    if (Errors < 20) {
+        printf("  %s\n", what);
+    }
+    Errors++;
+}
+
+//************** eUSCI model **************
+
+#define EMPTY    0xFFFF         // TXBUF value while nothing waits in it
+#define MAX_LOG  (1 << 22)
+
+static int Masked;              // PRIMASK, 1 inside a critical section
+static char Wire[MAX_LOG];      // bytes shifted out, in order
+static long WireN;
+static char Queued[MAX_LOG];    // bytes given to UART0_OutChar
+static long QueuedN;
+static char Typed[MAX_LOG];     // bytes received
+static long TypedN;
+static char Read[MAX_LOG];      // bytes UART0_InCharNonBlock returned
+static long ReadN;
+static long Overwrites;         // TXBUF written while full
+
+// runs EUSCIA0_IRQHandler if an armed flag is set, as the NVIC would
+static void irq(void){
+    while (!Masked && (EUSCI_A0->IE & EUSCI_A0->IFG & 0x03)) {
+        uint16_t ifg = EUSCI_A0->IFG;
+        uint16_t before = EUSCI_A0->TXBUF;
+        EUSCIA0_IRQHandler();
+        if (ifg & 0x01) {
+            EUSCI_A0->IFG &= ~0x01;             // the handler read RXBUF
+        }
+        if (EUSCI_A0->TXBUF != before) {
+            if ((ifg & 0x02) == 0) {
+                Overwrites++;                   // the waiting byte is lost
+            }
+            EUSCI_A0->IFG &= ~0x02;             // TXBUF full again
+        }
+    }
+}
+
+// the shift register takes the byte waiting in TXBUF
+static void shift(void){
+    if (EUSCI_A0->TXBUF != EMPTY) {
+        Wire[WireN++] = (char)EUSCI_A0->TXBUF;
+        EUSCI_A0->TXBUF = EMPTY;
+        EUSCI_A0->IFG |= 0x02;
+    }
+    irq();
+}
+
+static void receive(char c){
+    Typed[TypedN++] = c;
+    EUSCI_A0->RXBUF = (uint8_t)c;
+    EUSCI_A0->IFG |= 0x01;
+    irq();
+}
+
+static void queue(char c){
+    Queued[QueuedN++] = c;
+    UART0_OutChar(c);
+}
+
+static void readAll(void){
+    char c;
+    while (UART0_InCharNonBlock(&c)) {
+        Read[ReadN++] = c;
+    }
+}
+
+// CortexM.c is assembly for the Cortex-M4; this is its effect here
+long StartCritical(void){
+    long sr = Masked;
+    Masked = 1;
+    return sr;
+}
+
+void EndCritical(long sr){
+    Masked = sr;
+    irq();                      // a flag set meanwhile interrupts now
+}
+
+void WaitForInterrupt(void){
+    shift();                    // the next thing to happen is a byte leaving
+}
+
+void DisableInterrupts(void){ Masked = 1; }
+void EnableInterrupts(void){ Masked = 0; irq(); }
+
+static void reset(void){
+    memset(&HostEUSCI_A0, 0, sizeof(HostEUSCI_A0));
+    UART0_Init(115200);
+    EUSCI_A0->TXBUF = EMPTY;
+    EUSCI_A0->IFG = 0x02;       // UCTXIFG is set after reset
+    WireN = QueuedN = TypedN = ReadN = 0;
+    Overwrites = 0;
+}
+
+// the wire and the receive side must match what was sent and typed
+static int compare(void){
+    UART0_Flush();
+    shift();                    // the last byte, UCBUSY is not modelled
+    readAll();
+    return (WireN == QueuedN) && !memcmp(Wire, Queued, WireN) &&
+           (ReadN == TypedN) && !memcmp(Read, Typed, ReadN) && !Overwrites &&
+           !UART0_GetRxOverflows() && !UART0_GetTxOverflows();
+}
+
+//************** Checks **************
+
+static void busy(void){
+    const char *reply = "kp = 120\r\n> ";
+
+    reset();
+    for (const char *p = reply; *p; p++) {
+        queue(*p);
+    }
+    int full = (EUSCI_A0->TXBUF == (uint8_t)reply[0]) && !(EUSCI_A0->IFG & 0x02);
+    receive('g');               // typed while 'k' waits in TXBUF
+    int kept = (EUSCI_A0->TXBUF == (uint8_t)reply[0]) && !Overwrites;
+    int ok = full && kept && compare();
+    printf("receive while TXBUF is full: %ld of %ld reply bytes sent, %ld of %ld typed read, %s\n",
+           WireN, QueuedN, ReadN, TypedN, ok ? "ok" : "FAILED");
+    if (!ok) {
+        fail("a receive interrupt overwrote TXBUF or lost a byte");
+    }
+}
+
+static void interleaved(long n){
+    long received = 0;
+
+    reset();
+    for (long i = 0; (i < n) && (QueuedN < MAX_LOG - 1) && (TypedN < MAX_LOG - 1); i++) {
+        switch (rand() % 4) {
+        case 0:
+        case 1:
+            if (UART0_TxFree()) {
+                queue('a' + rand() % 26);
+            }
+            break;
+        case 2:
+            shift();
+            break;
+        default:
+            receive('0' + rand() % 10);
+            received++;
+            if ((rand() % 16) == 0) {
+                readAll();      // the console polls now and then
+            }
+            break;
+        }
+        if ((TypedN - ReadN) >= UART0_RXFIFO_SIZE) {
+            readAll();
+        }
+    }
+    int ok = compare();
+    printf("%ld random events: %ld bytes sent, %ld received, %ld overwrites, %s\n",
+           n, WireN, received, Overwrites, ok ? "ok" : "FAILED");
+    if (!ok) {
+        fail("bytes lost or reordered with receive and transmit interleaved");
+    }
+}
+
+int main(int argc, char **argv){
+    long n = 1000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+        case 'n': n = atol(optarg); break;
+        case 's': srand(atoi(optarg)); break;
+        default:
+            fprintf(stderr, "usage: %s [-n events] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    busy();
+    interleaved(n);
+    if (Errors) {
+        printf("%ld errors\n", Errors);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+// msp.h
+// Runs on Linux (host), not on the MSP432
+// Stand-in for the TI device header with only the registers that
+// inc/UART0.c uses.  They are plain memory; UART0Check.c plays the
+// eUSCI by setting and clearing the flags around each interrupt.
+
+#ifndef MSP_H_HOST
+#define MSP_H_HOST
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint16_t CTLW0;
+    volatile uint16_t BRW;
+    volatile uint16_t MCTLW;
+    volatile uint16_t STATW;
+    volatile uint16_t RXBUF;
+    volatile uint16_t TXBUF;
+    volatile uint16_t IE;
+    volatile uint16_t IFG;
+} EUSCI_A_Type;
+
+typedef struct {
+    volatile uint8_t SEL0;
+    volatile uint8_t SEL1;
+} DIO_PORT_Type;
+
+typedef struct {
+    volatile uint32_t ISER[16];
+    volatile uint32_t ISPR[16];
+    volatile uint32_t ICPR[16];
+    volatile uint8_t IP[240];
+} NVIC_Type;
+
+typedef struct {
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+typedef struct {
+    volatile uint32_t CFG;
+    volatile uint32_t CTLBASE;
+    volatile uint32_t USEBURSTCLR;
+    volatile uint32_t REQMASKCLR;
+    volatile uint32_t ENASET;
+    volatile uint32_t ENACLR;
+    volatile uint32_t ALTCLR;
+    volatile uint32_t PRIOCLR;
+} DMA_Control_Type;
+
+typedef struct {
+    volatile uint32_t CH_SRCCFG[32];
+    volatile uint32_t INT1_SRCCFG;
+    volatile uint32_t SW_CHTRIG;
+} DMA_Channel_Type;
+
+extern EUSCI_A_Type HostEUSCI_A0;
+extern DIO_PORT_Type HostP1;
+extern NVIC_Type HostNVIC;
+extern SCB_Type HostSCB;
+extern DMA_Control_Type HostDMA_Control;
+extern DMA_Channel_Type HostDMA_Channel;
+
+#define EUSCI_A0    (&HostEUSCI_A0)
+#define P1          (&HostP1)
+#define NVIC        (&HostNVIC)
+#define SCB         (&HostSCB)
+#define DMA_Control (&HostDMA_Control)
+#define DMA_Channel (&HostDMA_Channel)
+
+#endif